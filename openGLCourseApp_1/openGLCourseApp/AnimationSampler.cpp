@@ -0,0 +1,378 @@
+#include "AnimationSampler.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <xmmintrin.h>
+
+#include "ThreadPool.h"
+#include "Quaternion.h"
+
+// Characters per pool job, enough to amortise a job's scratch poses
+static const size_t charactersPerJob = 8;
+
+// Frames per pool job when baking
+static const size_t bakeFramesPerJob = 16;
+
+static void MultiplyMatrix(const float* a, const float* b, float* result)
+{
+	// Column-major, each result column a weighted sum of a's columns
+	__m128 a0 = _mm_loadu_ps(a);
+	__m128 a1 = _mm_loadu_ps(a + 4);
+	__m128 a2 = _mm_loadu_ps(a + 8);
+	__m128 a3 = _mm_loadu_ps(a + 12);
+	for (int column = 0; column < 4; column++)
+	{
+		const float* b0 = b + column * 4;
+		__m128 sum = _mm_mul_ps(a0, _mm_set1_ps(b0[0]));
+		sum = _mm_add_ps(sum, _mm_mul_ps(a1, _mm_set1_ps(b0[1])));
+		sum = _mm_add_ps(sum, _mm_mul_ps(a2, _mm_set1_ps(b0[2])));
+		sum = _mm_add_ps(sum, _mm_mul_ps(a3, _mm_set1_ps(b0[3])));
+		_mm_storeu_ps(result + column * 4, sum);
+	}
+}
+
+static void SampleTrack(const AnimationTrack& track, float time, float* value)
+{
+	unsigned int components = track.property == ANIMATION_ROTATION ? 4 : 3;
+	size_t keys = track.times.size();
+	if (time <= track.times[0] || keys == 1)
+	{
+		memcpy(value, &track.values[0], sizeof(float) * components);
+		return;
+	}
+	if (time >= track.times[keys - 1])
+	{
+		memcpy(value, &track.values[(keys - 1) * components], sizeof(float) * components);
+		return;
+	}
+
+	size_t next = std::upper_bound(track.times.begin(), track.times.end(), time) - track.times.begin();
+	size_t key = next - 1;
+	const float* a = &track.values[key * components];
+	const float* b = &track.values[next * components];
+	float span = track.times[next] - track.times[key];
+	float t = track.step || span <= 0.0f ? 0.0f : (time - track.times[key]) / span;
+
+	if (track.property != ANIMATION_ROTATION)
+	{
+		for (unsigned int c = 0; c < 3; c++)
+		{
+			value[c] = a[c] + (b[c] - a[c]) * t;
+		}
+		return;
+	}
+
+	// Slerp along the shorter arc, nlerp once the keys are close enough for it to be exact
+	float cosine = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+	float sign = cosine < 0.0f ? -1.0f : 1.0f;
+	cosine *= sign;
+	float weightA = 1.0f - t;
+	float weightB = t;
+	if (cosine < 0.9995f)
+	{
+		float angle = acosf(cosine);
+		float inverseSine = 1.0f / sinf(angle);
+		weightA = sinf(weightA * angle) * inverseSine;
+		weightB = sinf(weightB * angle) * inverseSine;
+	}
+	float length = 0.0f;
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		value[c] = a[c] * weightA + b[c] * weightB * sign;
+		length += value[c] * value[c];
+	}
+	length = length > 0.0f ? 1.0f / sqrtf(length) : 0.0f;
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		value[c] *= length;
+	}
+}
+
+void AnimationSampler::BakeClip(const Skeleton& skeleton, const std::vector<AnimationTrack>& tracks, float duration, float sampleRate, ThreadPool* pool, AnimationClip& clip)
+{
+	clip.duration = duration > 0.0f ? duration : 0.0f;
+	clip.sampleRate = sampleRate > 0.0f ? sampleRate : 30.0f;
+	clip.frameCount = clip.duration > 0.0f ? (unsigned int)ceilf(clip.duration * clip.sampleRate) + 1 : 1;
+	clip.groupCount = skeleton.GetGroupCount();
+	clip.frames.resize((size_t)clip.frameCount * clip.groupCount);
+
+	// Tracks that cannot be sampled are left out rather than checked per frame
+	std::vector<const AnimationTrack*> usable;
+	for (size_t i = 0; i < tracks.size(); i++)
+	{
+		const AnimationTrack& track = tracks[i];
+		size_t components = track.property == ANIMATION_ROTATION ? 4 : 3;
+		if (track.joint < skeleton.GetJointCount() && !track.times.empty() && track.values.size() >= track.times.size() * components)
+		{
+			usable.push_back(&track);
+		}
+	}
+
+	auto bakeFrames = [&skeleton, &clip, &usable](size_t begin, size_t end)
+	{
+		for (size_t f = begin; f < end; f++)
+		{
+			SoaTransform* frame = &clip.frames[f * clip.groupCount];
+			memcpy(frame, &skeleton.restPose[0], sizeof(SoaTransform) * clip.groupCount);
+
+			float time = std::min((float)f / clip.sampleRate, clip.duration);
+			for (size_t i = 0; i < usable.size(); i++)
+			{
+				const AnimationTrack& track = *usable[i];
+				float value[4];
+				SampleTrack(track, time, value);
+
+				SoaTransform& group = frame[track.joint / 4];
+				unsigned int lane = track.joint % 4;
+				for (unsigned int c = 0; c < (track.property == ANIMATION_ROTATION ? 4u : 3u); c++)
+				{
+					float* target = track.property == ANIMATION_TRANSLATION ? group.translation[c] : track.property == ANIMATION_ROTATION ? group.rotation[c] : group.scale[c];
+					target[lane] = value[c];
+				}
+			}
+		}
+	};
+
+	if (pool && clip.frameCount > bakeFramesPerJob)
+	{
+		pool->ParallelFor(clip.frameCount, bakeFramesPerJob, bakeFrames);
+	}
+	else
+	{
+		bakeFrames(0, clip.frameCount);
+	}
+}
+
+void AnimationSampler::SampleClip(const AnimationClip& clip, float time, SoaTransform* pose)
+{
+	if (clip.duration > 0.0f)
+	{
+		time = fmodf(time, clip.duration);
+		time = time < 0.0f ? time + clip.duration : time;
+	}
+
+	float frame = time * clip.sampleRate;
+	unsigned int first = frame > 0.0f ? (unsigned int)frame : 0;
+	if (first + 1 >= clip.frameCount)
+	{
+		memcpy(pose, &clip.frames[(size_t)(clip.frameCount - 1) * clip.groupCount], sizeof(SoaTransform) * clip.groupCount);
+		return;
+	}
+	BlendPoses(&clip.frames[(size_t)first * clip.groupCount], &clip.frames[(size_t)(first + 1) * clip.groupCount], frame - (float)first, clip.groupCount, pose);
+}
+
+void AnimationSampler::BlendPoses(const SoaTransform* a, const SoaTransform* b, float weight, unsigned int groupCount, SoaTransform* pose)
+{
+	const __m128 weightB = _mm_set1_ps(weight);
+	const __m128 weightA = _mm_set1_ps(1.0f - weight);
+	const __m128 signBit = _mm_set1_ps(-0.0f);
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	for (unsigned int g = 0; g < groupCount; g++)
+	{
+		const SoaTransform& from = a[g];
+		const SoaTransform& to = b[g];
+		SoaTransform& out = pose[g];
+
+		for (int c = 0; c < 3; c++)
+		{
+			__m128 translation = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(from.translation[c]), weightA), _mm_mul_ps(_mm_loadu_ps(to.translation[c]), weightB));
+			__m128 scale = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(from.scale[c]), weightA), _mm_mul_ps(_mm_loadu_ps(to.scale[c]), weightB));
+			_mm_storeu_ps(out.translation[c], translation);
+			_mm_storeu_ps(out.scale[c], scale);
+		}
+
+		__m128 ax = _mm_loadu_ps(from.rotation[0]), ay = _mm_loadu_ps(from.rotation[1]), az = _mm_loadu_ps(from.rotation[2]), aw = _mm_loadu_ps(from.rotation[3]);
+		__m128 bx = _mm_loadu_ps(to.rotation[0]), by = _mm_loadu_ps(to.rotation[1]), bz = _mm_loadu_ps(to.rotation[2]), bw = _mm_loadu_ps(to.rotation[3]);
+
+		// Negate b's weight in lanes where the quaternions lie in opposite hemispheres, so the blend takes the
+		// shorter arc, then renormalize
+		__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+		__m128 signedB = _mm_xor_ps(weightB, _mm_and_ps(dot, signBit));
+		__m128 x = _mm_add_ps(_mm_mul_ps(ax, weightA), _mm_mul_ps(bx, signedB));
+		__m128 y = _mm_add_ps(_mm_mul_ps(ay, weightA), _mm_mul_ps(by, signedB));
+		__m128 z = _mm_add_ps(_mm_mul_ps(az, weightA), _mm_mul_ps(bz, signedB));
+		__m128 w = _mm_add_ps(_mm_mul_ps(aw, weightA), _mm_mul_ps(bw, signedB));
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w))));
+		__m128 inverse = _mm_div_ps(one, length);
+		_mm_storeu_ps(out.rotation[0], _mm_mul_ps(x, inverse));
+		_mm_storeu_ps(out.rotation[1], _mm_mul_ps(y, inverse));
+		_mm_storeu_ps(out.rotation[2], _mm_mul_ps(z, inverse));
+		_mm_storeu_ps(out.rotation[3], _mm_mul_ps(w, inverse));
+	}
+}
+
+void AnimationSampler::LocalToModel(const Skeleton& skeleton, const SoaTransform* pose, float* matrices)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+	unsigned int jointCount = skeleton.GetJointCount();
+
+	for (unsigned int g = 0; g < skeleton.GetGroupCount(); g++)
+	{
+		const SoaTransform& group = pose[g];
+		__m128 x = _mm_loadu_ps(group.rotation[0]), y = _mm_loadu_ps(group.rotation[1]), z = _mm_loadu_ps(group.rotation[2]), w = _mm_loadu_ps(group.rotation[3]);
+		__m128 sx = _mm_loadu_ps(group.scale[0]), sy = _mm_loadu_ps(group.scale[1]), sz = _mm_loadu_ps(group.scale[2]);
+
+		__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+		__m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+		__m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+		// The upper 3x3 of translation * rotation * scale for four joints, column by column
+		float local[9][4];
+		_mm_storeu_ps(local[0], _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx));
+		_mm_storeu_ps(local[1], _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx));
+		_mm_storeu_ps(local[2], _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx));
+		_mm_storeu_ps(local[3], _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy));
+		_mm_storeu_ps(local[4], _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy));
+		_mm_storeu_ps(local[5], _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy));
+		_mm_storeu_ps(local[6], _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz));
+		_mm_storeu_ps(local[7], _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz));
+		_mm_storeu_ps(local[8], _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz));
+
+		// Parents come first, so theirs are final by the time a child reads them
+		for (unsigned int lane = 0; lane < 4 && g * 4 + lane < jointCount; lane++)
+		{
+			unsigned int joint = g * 4 + lane;
+			float matrix[16] =
+			{
+				local[0][lane], local[1][lane], local[2][lane], 0.0f,
+				local[3][lane], local[4][lane], local[5][lane], 0.0f,
+				local[6][lane], local[7][lane], local[8][lane], 0.0f,
+				group.translation[0][lane], group.translation[1][lane], group.translation[2][lane], 1.0f
+			};
+			int parent = skeleton.parents[joint];
+			const float* above = parent >= 0 ? &matrices[(size_t)parent * 16] : &skeleton.rootTransforms[(size_t)joint * 16];
+			MultiplyMatrix(above, matrix, &matrices[(size_t)joint * 16]);
+		}
+	}
+}
+
+unsigned int AnimationSampler::GetPaletteTexels(const Skeleton& skeleton, bool dualQuaternion)
+{
+	return paletteModelTexels + skeleton.GetJointCount() * (dualQuaternion ? paletteDualQuaternionTexels : paletteMatrixTexels);
+}
+
+void AnimationSampler::WritePalette(const Skeleton& skeleton, const float* matrices, const float* model, bool dualQuaternion, float* palette)
+{
+	// Rows of the affine part, the shader takes dot products with (x, y, z, 1)
+	for (int row = 0; row < 3; row++)
+	{
+		palette[row * 4 + 0] = model[row];
+		palette[row * 4 + 1] = model[4 + row];
+		palette[row * 4 + 2] = model[8 + row];
+		palette[row * 4 + 3] = model[12 + row];
+	}
+	palette += paletteModelTexels * 4;
+
+	for (unsigned int joint = 0; joint < skeleton.GetJointCount(); joint++)
+	{
+		float skin[16];
+		MultiplyMatrix(&matrices[(size_t)joint * 16], &skeleton.inverseBindMatrices[(size_t)joint * 16], skin);
+
+		if (!dualQuaternion)
+		{
+			for (int row = 0; row < 3; row++)
+			{
+				palette[row * 4 + 0] = skin[row];
+				palette[row * 4 + 1] = skin[4 + row];
+				palette[row * 4 + 2] = skin[8 + row];
+				palette[row * 4 + 3] = skin[12 + row];
+			}
+			palette += paletteMatrixTexels * 4;
+			continue;
+		}
+
+		// Rotation from the normalized columns, the scale they carried is lost
+		float m[3][3];
+		for (int column = 0; column < 3; column++)
+		{
+			const float* c = &skin[column * 4];
+			float length = sqrtf(c[0] * c[0] + c[1] * c[1] + c[2] * c[2]);
+			length = length > 0.0f ? 1.0f / length : 0.0f;
+			for (int row = 0; row < 3; row++)
+			{
+				m[column][row] = c[row] * length;
+			}
+		}
+
+		float q[4];
+		MatrixToQuaternion(&m[0][0], q);
+
+		// The dual part is half the translation times the rotation
+		const float* t = &skin[12];
+		palette[0] = q[0];
+		palette[1] = q[1];
+		palette[2] = q[2];
+		palette[3] = q[3];
+		palette[4] = 0.5f * (t[0] * q[3] + t[1] * q[2] - t[2] * q[1]);
+		palette[5] = 0.5f * (-t[0] * q[2] + t[1] * q[3] + t[2] * q[0]);
+		palette[6] = 0.5f * (t[0] * q[1] - t[1] * q[0] + t[2] * q[3]);
+		palette[7] = -0.5f * (t[0] * q[0] + t[1] * q[1] + t[2] * q[2]);
+		palette += paletteDualQuaternionTexels * 4;
+	}
+}
+
+void AnimationSampler::EvaluatePoses(const Skeleton& skeleton, const AnimationInstance* instances, size_t count, bool dualQuaternion, ThreadPool* pool, float* palette, AnimationStats& stats)
+{
+	auto start = std::chrono::steady_clock::now();
+	unsigned int groupCount = skeleton.GetGroupCount();
+	size_t entryFloats = (size_t)GetPaletteTexels(skeleton, dualQuaternion) * 4;
+	size_t jobCount = (count + charactersPerJob - 1) / charactersPerJob;
+
+	auto evaluate = [&skeleton, instances, count, dualQuaternion, palette, groupCount, entryFloats](size_t begin, size_t end)
+	{
+		// Scratch for the job's characters, one after another
+		std::vector<SoaTransform> pose(groupCount), blended(groupCount);
+		std::vector<float> matrices((size_t)skeleton.GetJointCount() * 16);
+
+		for (size_t job = begin; job < end; job++)
+		{
+			size_t last = std::min((job + 1) * charactersPerJob, count);
+			for (size_t i = job * charactersPerJob; i < last; i++)
+			{
+				const AnimationInstance& instance = instances[i];
+
+				// Clips baked for another skeleton are ignored, the rest pose stands in
+				const AnimationClip* first = instance.clips[0] && instance.clips[0]->groupCount == groupCount ? instance.clips[0] : NULL;
+				const AnimationClip* second = instance.clips[1] && instance.clips[1]->groupCount == groupCount ? instance.clips[1] : NULL;
+				if (first)
+				{
+					SampleClip(*first, instance.times[0], &pose[0]);
+				}
+				else
+				{
+					memcpy(&pose[0], &skeleton.restPose[0], sizeof(SoaTransform) * groupCount);
+				}
+				if (second && instance.blendWeight > 0.0f)
+				{
+					SampleClip(*second, instance.times[1], &blended[0]);
+					BlendPoses(&pose[0], &blended[0], std::min(instance.blendWeight, 1.0f), groupCount, &pose[0]);
+				}
+
+				LocalToModel(skeleton, &pose[0], &matrices[0]);
+				WritePalette(skeleton, &matrices[0], instance.model, dualQuaternion, palette + i * entryFloats);
+			}
+		}
+	};
+
+	if (groupCount > 0 && count > 0)
+	{
+		if (pool && jobCount > 1)
+		{
+			pool->ParallelFor(jobCount, 1, evaluate);
+		}
+		else
+		{
+			evaluate(0, jobCount);
+		}
+	}
+
+	stats.characters = (unsigned int)count;
+	stats.joints = skeleton.GetJointCount();
+	stats.jobs = (unsigned int)jobCount;
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
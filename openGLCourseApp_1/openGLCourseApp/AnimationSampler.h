@@ -0,0 +1,122 @@
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+class ThreadPool;
+
+// Local transforms of four joints in structure of arrays form, one joint per SSE lane. Joint j lives in group
+// j / 4, lane j % 4. Rotations are unit quaternions x, y, z, w.
+struct SoaTransform
+{
+	float translation[3][4];
+	float rotation[4][4];
+	float scale[3][4];
+};
+
+// Joints are ordered so every parent comes before its children
+struct Skeleton
+{
+	// -1 for roots
+	std::vector<int> parents;
+	// Column-major 4x4 per joint, applied above a root joint (identity for the others), for scene nodes that
+	// place the skeleton without being joints themselves
+	std::vector<float> rootTransforms;
+	// Column-major 4x4 per joint, taking the mesh from its bind pose into the joint's space
+	std::vector<float> inverseBindMatrices;
+	// Local transforms joints keep when a clip leaves them alone, padding lanes hold the identity
+	std::vector<SoaTransform> restPose;
+
+	unsigned int GetJointCount() const { return (unsigned int)parents.size(); }
+	unsigned int GetGroupCount() const { return (unsigned int)restPose.size(); }
+};
+
+enum AnimationProperty
+{
+	ANIMATION_TRANSLATION = 0,
+	ANIMATION_ROTATION = 1,
+	ANIMATION_SCALE = 2
+};
+
+// Keyframes of one joint's translation, rotation or scale as authored, baked into a clip before use
+struct AnimationTrack
+{
+	unsigned int joint;
+	AnimationProperty property;
+	// Hold each key until the next instead of interpolating
+	bool step;
+	// Ascending seconds, and three values per key (four for rotations)
+	std::vector<float> times;
+	std::vector<float> values;
+};
+
+// A clip resampled at a fixed rate, so evaluation never searches for keys: every frame holds every joint's
+// local transform, and any time is a blend of two neighbouring frames
+struct AnimationClip
+{
+	float duration;
+	float sampleRate;
+	unsigned int frameCount;
+	unsigned int groupCount;
+	// frameCount runs of groupCount transforms
+	std::vector<SoaTransform> frames;
+};
+
+// One character's pose: clips[0] at times[0], blended towards clips[1] at times[1] by blendWeight. Times wrap
+// around each clip's duration.
+struct AnimationInstance
+{
+	const AnimationClip* clips[2];
+	float times[2];
+	// 0 samples clips[0] alone, clips[1] may then be NULL
+	float blendWeight;
+	// Column-major 4x4 placing the character, stored at the start of its palette entry
+	const float* model;
+};
+
+struct AnimationStats
+{
+	double milliseconds;
+	unsigned int characters;
+	unsigned int joints;
+	// Pool jobs the characters were divided between
+	unsigned int jobs;
+};
+
+// Skinning palette texels per character ahead of its joints: the rows of its model matrix
+static const unsigned int paletteModelTexels = 3;
+// Per joint, the rows of a 3x4 matrix for linear blend skinning, or a dual quaternion's real and dual parts
+static const unsigned int paletteMatrixTexels = 3;
+static const unsigned int paletteDualQuaternionTexels = 2;
+
+// Pose evaluation for skinned characters on the CPU. Clips are sampled and blended with SSE four joints at a
+// time on their structure of arrays transforms (translation and scale lerped, rotations nlerped along the
+// shorter arc), then composed down the hierarchy and multiplied with the inverse bind matrices into a skinning
+// palette for the vertex shader. Characters are independent, so a crowd is split across the pool with every
+// job writing its own characters' palette entries and no shared state. Dual quaternions keep the volume of
+// twisting joints that linear blending collapses, but carry rotation and translation only, so joint scale is
+// dropped from them.
+class AnimationSampler
+{
+public:
+	// Resample tracks (on joints of skeleton) at sampleRate frames per second over duration seconds. Joints
+	// without a track of a property keep their rest pose's. pool may be NULL to bake on the calling thread.
+	static void BakeClip(const Skeleton& skeleton, const std::vector<AnimationTrack>& tracks, float duration, float sampleRate, ThreadPool* pool, AnimationClip& clip);
+
+	// The clip's local pose at time seconds, wrapped around its duration
+	static void SampleClip(const AnimationClip& clip, float time, SoaTransform* pose);
+	// Blend weight of the way from a towards b, groupCount groups of each
+	static void BlendPoses(const SoaTransform* a, const SoaTransform* b, float weight, unsigned int groupCount, SoaTransform* pose);
+
+	// Column-major 4x4 model space matrix per joint from a local pose
+	static void LocalToModel(const Skeleton& skeleton, const SoaTransform* pose, float* matrices);
+
+	// Texels per character in the palette, its model matrix included
+	static unsigned int GetPaletteTexels(const Skeleton& skeleton, bool dualQuaternion);
+	// Write one character's palette entry (4 floats per texel) from its joints' model space matrices
+	static void WritePalette(const Skeleton& skeleton, const float* matrices, const float* model, bool dualQuaternion, float* palette);
+
+	// Evaluate count characters sharing skeleton into consecutive palette entries of GetPaletteTexels texels.
+	// pool may be NULL to run on the calling thread.
+	static void EvaluatePoses(const Skeleton& skeleton, const AnimationInstance* instances, size_t count, bool dualQuaternion, ThreadPool* pool, float* palette, AnimationStats& stats);
+};
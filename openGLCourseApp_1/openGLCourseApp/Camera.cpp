@@ -1,84 +1,123 @@
-#include "Camera.h"
-
-Camera::Camera() {}
-
-Camera::Camera(glm::vec3 startPosition, glm::vec3 startUp, GLfloat startYaw, GLfloat startPitch, GLfloat startMoveSpeed, GLfloat startTurnSpeed)
-{
-	position = startPosition;
-	worldUp = startUp;
-	yaw = startYaw;
-	pitch = startPitch;
-	front = glm::vec3(0.0f, 0.0f, -1.0f);
-
-	moveSpeed = startMoveSpeed;
-	turnSpeed = startTurnSpeed;
-
-	update();
-}
-
-void Camera::keyControl(bool* keys, GLfloat deltaTime)
-{
-	GLfloat velocity = moveSpeed * deltaTime;
-
-	if (keys[GLFW_KEY_W])
-	{
-		position += front * velocity;
-	}
-
-	if (keys[GLFW_KEY_S])
-	{
-		position -= front * velocity;
-	}
-
-	if (keys[GLFW_KEY_A])
-	{
-		position -= right * velocity;
-	}
-
-	if (keys[GLFW_KEY_D])
-	{
-		position += right * velocity;
-	}
-}
-
-void Camera::mouseControl(GLfloat xChange, GLfloat yChange)
-{
-	xChange *= turnSpeed;
-	yChange *= turnSpeed;
-
-	yaw += xChange;
-	pitch += yChange;
-
-	if (pitch > 89.0f)
-	{
-		pitch = 89.0f;
-	}
-
-	if (pitch < -89.0f)
-	{
-		pitch = -89.0f;
-	}
-
-	update();
-}
-
-glm::mat4 Camera::calculateViewMatrix()
-{
-	return glm::lookAt(position, position + front, up);
-}
-
-void Camera::update()
-{
-	front.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
-	front.y = sin(glm::radians(pitch));
-	front.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
-	front = glm::normalize(front);
-
-	right = glm::normalize(glm::cross(front, worldUp));
-	up = glm::normalize(glm::cross(right, front));
-}
-
-
-Camera::~Camera()
-{
-}
+#include "Camera.h"
+
+Camera::Camera() {}
+
+Camera::Camera(glm::dvec3 startPosition, glm::vec3 startUp, GLfloat startYaw, GLfloat startPitch, GLfloat startMoveSpeed, GLfloat startTurnSpeed)
+{
+	position = startPosition;
+	origin = glm::dvec3(0.0);
+	worldUp = startUp;
+	yaw = startYaw;
+	pitch = startPitch;
+	front = glm::vec3(0.0f, 0.0f, -1.0f);
+
+	moveSpeed = startMoveSpeed;
+	turnSpeed = startTurnSpeed;
+
+	update();
+}
+
+void Camera::keyControl(bool* keys, GLfloat deltaTime)
+{
+	GLdouble velocity = moveSpeed * deltaTime;
+
+	if (keys[GLFW_KEY_W])
+	{
+		position += glm::dvec3(front) * velocity;
+	}
+
+	if (keys[GLFW_KEY_S])
+	{
+		position -= glm::dvec3(front) * velocity;
+	}
+
+	if (keys[GLFW_KEY_A])
+	{
+		position -= glm::dvec3(right) * velocity;
+	}
+
+	if (keys[GLFW_KEY_D])
+	{
+		position += glm::dvec3(right) * velocity;
+	}
+}
+
+void Camera::mouseControl(GLfloat xChange, GLfloat yChange)
+{
+	xChange *= turnSpeed;
+	yChange *= turnSpeed;
+
+	yaw += xChange;
+	pitch += yChange;
+
+	if (pitch > 89.0f)
+	{
+		pitch = 89.0f;
+	}
+
+	if (pitch < -89.0f)
+	{
+		pitch = -89.0f;
+	}
+
+	update();
+}
+
+void Camera::setState(glm::dvec3 newWorldPosition, GLfloat newYaw, GLfloat newPitch)
+{
+	position = newWorldPosition - origin;
+	yaw = newYaw;
+	pitch = newPitch;
+
+	update();
+}
+
+bool Camera::rebaseOrigin(GLdouble rebaseDistance, glm::dvec3& shift)
+{
+	if (rebaseDistance <= 0.0 || glm::length(position) < rebaseDistance)
+	{
+		return false;
+	}
+
+	shift = position;
+	origin += shift;
+	position = glm::dvec3(0.0);
+	return true;
+}
+
+glm::mat4 Camera::calculateViewMatrix()
+{
+	return glm::lookAt(glm::vec3(0.0f), front, up);
+}
+
+glm::mat4 Camera::calculateRelativeModelMatrix(const glm::dmat4& model)
+{
+	glm::dmat4 relative = glm::translate(glm::dmat4(1.0), -position) * model;
+	return glm::mat4(relative);
+}
+
+GLfloat Camera::calculateLodScale(const glm::mat4& relativeModel, const glm::vec4& boundingSphere, const glm::mat4& projection, GLint viewportHeight)
+{
+	// The eye sits at the origin of camera-relative space, the largest axis scale keeps the estimate conservative
+	glm::vec3 center = glm::vec3(relativeModel * glm::vec4(glm::vec3(boundingSphere), 1.0f));
+	GLfloat scale = glm::max(glm::length(glm::vec3(relativeModel[0])), glm::max(glm::length(glm::vec3(relativeModel[1])), glm::length(glm::vec3(relativeModel[2]))));
+	GLfloat distance = glm::max(glm::length(center) - boundingSphere.w * scale, 0.001f);
+
+	return scale * projection[1][1] * viewportHeight * 0.5f / distance;
+}
+
+void Camera::update()
+{
+	front.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
+	front.y = sin(glm::radians(pitch));
+	front.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
+	front = glm::normalize(front);
+
+	right = glm::normalize(glm::cross(front, worldUp));
+	up = glm::normalize(glm::cross(right, front));
+}
+
+
+Camera::~Camera()
+{
+}
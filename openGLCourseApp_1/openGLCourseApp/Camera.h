@@ -1,38 +1,58 @@
-#pragma once
-
-#include <GL\glew.h>
-
-#include <glm\glm.hpp>
-#include <glm\gtc\matrix_transform.hpp>
-
-#include <GLFW\glfw3.h>
-
-class Camera
-{
-public:
-	Camera();
-	Camera(glm::vec3 startPosition, glm::vec3 startUp, GLfloat startYaw, GLfloat startPitch, GLfloat startMoveSpeed, GLfloat startTurnSpeed);
-
-	void keyControl(bool* keys, GLfloat deltaTime);
-	void mouseControl(GLfloat xChange, GLfloat yChange);
-
-	glm::mat4 calculateViewMatrix();
-
-	~Camera();
-
-private:
-	glm::vec3 position;
-	glm::vec3 front;
-	glm::vec3 up;
-	glm::vec3 right;
-	glm::vec3 worldUp;
-
-	GLfloat yaw;
-	GLfloat pitch;
-
-	GLfloat moveSpeed;
-	GLfloat turnSpeed;
-
-	void update();
-};
-
+#pragma once
+
+#include <GL\glew.h>
+
+#include <glm\glm.hpp>
+#include <glm\gtc\matrix_transform.hpp>
+
+#include <GLFW\glfw3.h>
+
+class Camera
+{
+public:
+	Camera();
+	Camera(glm::dvec3 startPosition, glm::vec3 startUp, GLfloat startYaw, GLfloat startPitch, GLfloat startMoveSpeed, GLfloat startTurnSpeed);
+
+	void keyControl(bool* keys, GLfloat deltaTime);
+	void mouseControl(GLfloat xChange, GLfloat yChange);
+
+	// Position relative to the current floating origin
+	glm::dvec3 getPosition() { return position; }
+	glm::dvec3 getOrigin() { return origin; }
+	glm::dvec3 getWorldPosition() { return origin + position; }
+	GLfloat getYaw() { return yaw; }
+	GLfloat getPitch() { return pitch; }
+
+	// Overwrite the camera state directly, used when replaying a recorded path
+	void setState(glm::dvec3 newWorldPosition, GLfloat newYaw, GLfloat newPitch);
+
+	// Move the floating origin under the camera once it strays further than rebaseDistance,
+	// shift receives the offset every origin-relative position must be moved by
+	bool rebaseOrigin(GLdouble rebaseDistance, glm::dvec3& shift);
+
+	// View rotation only, the eye sits at the origin of camera-relative space
+	glm::mat4 calculateViewMatrix();
+	// Model matrix translated into camera-relative space, built in double before narrowing to float
+	glm::mat4 calculateRelativeModelMatrix(const glm::dmat4& model);
+	// Pixels one object unit covers at the nearest point of boundingSphere (centre and radius in object units),
+	// what a level of detail's error is scaled by to measure it on screen
+	GLfloat calculateLodScale(const glm::mat4& relativeModel, const glm::vec4& boundingSphere, const glm::mat4& projection, GLint viewportHeight);
+
+	~Camera();
+
+private:
+	glm::dvec3 position;
+	glm::dvec3 origin;
+	glm::vec3 front;
+	glm::vec3 up;
+	glm::vec3 right;
+	glm::vec3 worldUp;
+
+	GLfloat yaw;
+	GLfloat pitch;
+
+	GLfloat moveSpeed;
+	GLfloat turnSpeed;
+
+	void update();
+};
@@ -0,0 +1,173 @@
+#include "CameraPath.h"
+
+// File layout: header followed by frameCount tightly packed CameraFrame records
+static const unsigned int cameraPathMagic = 0x48545043; // "CPTH"
+static const unsigned int cameraPathVersion = 2;
+
+struct CameraPathHeader
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int frameCount;
+	unsigned int frameSize;
+};
+
+CameraRecorder::CameraRecorder()
+{
+	file = NULL;
+	frameCount = 0;
+	startTime = 0.0f;
+}
+
+bool CameraRecorder::StartRecording(const char* fileLocation, GLfloat startTime)
+{
+	StopRecording();
+
+	file = fopen(fileLocation, "wb");
+	if (!file)
+	{
+		printf("Failed to open %s for camera recording!\n", fileLocation);
+		return false;
+	}
+
+	// Frame count is patched in once the recording stops
+	CameraPathHeader header = { cameraPathMagic, cameraPathVersion, 0, sizeof(CameraFrame) };
+	fwrite(&header, sizeof(header), 1, file);
+
+	frameCount = 0;
+	this->startTime = startTime;
+	return true;
+}
+
+void CameraRecorder::RecordFrame(GLfloat now, Camera& camera)
+{
+	if (!file)
+	{
+		return;
+	}
+
+	glm::dvec3 position = camera.getWorldPosition();
+
+	CameraFrame frame;
+	frame.time = now - startTime;
+	frame.position[0] = position.x;
+	frame.position[1] = position.y;
+	frame.position[2] = position.z;
+	frame.yaw = camera.getYaw();
+	frame.pitch = camera.getPitch();
+	frame.padding = 0.0f;
+
+	fwrite(&frame, sizeof(frame), 1, file);
+	frameCount++;
+}
+
+void CameraRecorder::StopRecording()
+{
+	if (!file)
+	{
+		return;
+	}
+
+	CameraPathHeader header = { cameraPathMagic, cameraPathVersion, frameCount, sizeof(CameraFrame) };
+	fseek(file, 0, SEEK_SET);
+	fwrite(&header, sizeof(header), 1, file);
+
+	fclose(file);
+	file = NULL;
+}
+
+CameraRecorder::~CameraRecorder()
+{
+	StopRecording();
+}
+
+CameraReplay::CameraReplay()
+{
+	cursor = 0;
+}
+
+bool CameraReplay::LoadFromFile(const char* fileLocation)
+{
+	frames.clear();
+	cursor = 0;
+
+	FILE* file = fopen(fileLocation, "rb");
+	if (!file)
+	{
+		printf("Failed to read %s! File doesn't exist.\n", fileLocation);
+		return false;
+	}
+
+	CameraPathHeader header;
+	if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != cameraPathMagic
+		|| header.version != cameraPathVersion || header.frameSize != sizeof(CameraFrame))
+	{
+		printf("%s is not a valid camera path!\n", fileLocation);
+		fclose(file);
+		return false;
+	}
+
+	frames.resize(header.frameCount);
+	size_t framesRead = header.frameCount > 0 ? fread(&frames[0], sizeof(CameraFrame), header.frameCount, file) : 0;
+	fclose(file);
+
+	if (framesRead != header.frameCount)
+	{
+		printf("Camera path %s is truncated, read %u of %u frames\n", fileLocation, (unsigned int)framesRead, header.frameCount);
+		frames.resize(framesRead);
+	}
+
+	return !frames.empty();
+}
+
+bool CameraReplay::ApplyAtTime(GLfloat elapsedTime, Camera& camera)
+{
+	if (frames.empty() || elapsedTime > frames.back().time)
+	{
+		return false;
+	}
+
+	// Playback only moves forward so the search resumes from the previous sample
+	if (cursor >= frames.size() || frames[cursor].time > elapsedTime)
+	{
+		cursor = 0;
+	}
+
+	while (cursor + 1 < frames.size() && frames[cursor + 1].time <= elapsedTime)
+	{
+		cursor++;
+	}
+
+	const CameraFrame& a = frames[cursor];
+	if (cursor + 1 >= frames.size())
+	{
+		camera.setState(glm::dvec3(a.position[0], a.position[1], a.position[2]), a.yaw, a.pitch);
+		return true;
+	}
+
+	const CameraFrame& b = frames[cursor + 1];
+	GLfloat span = b.time - a.time;
+	GLfloat t = span > 0.0f ? (elapsedTime - a.time) / span : 0.0f;
+
+	glm::dvec3 posA(a.position[0], a.position[1], a.position[2]);
+	glm::dvec3 posB(b.position[0], b.position[1], b.position[2]);
+
+	camera.setState(posA + (posB - posA) * (GLdouble)t, a.yaw + (b.yaw - a.yaw) * t, a.pitch + (b.pitch - a.pitch) * t);
+	return true;
+}
+
+bool CameraReplay::ApplyFrame(unsigned int frameIndex, Camera& camera)
+{
+	if (frameIndex >= frames.size())
+	{
+		return false;
+	}
+
+	const CameraFrame& frame = frames[frameIndex];
+	camera.setState(glm::dvec3(frame.position[0], frame.position[1], frame.position[2]), frame.yaw, frame.pitch);
+	return true;
+}
+
+CameraReplay::~CameraReplay()
+{
+}
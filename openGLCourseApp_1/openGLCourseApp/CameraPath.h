@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdio.h>
+#include <vector>
+
+#include <GL\glew.h>
+
+#include "Camera.h"
+
+// One sample of a recorded flythrough, time is relative to the start of the recording
+struct CameraFrame
+{
+	GLdouble position[3];
+	GLfloat time;
+	GLfloat yaw;
+	GLfloat pitch;
+	GLfloat padding;
+};
+
+class CameraRecorder
+{
+public:
+	CameraRecorder();
+
+	bool StartRecording(const char* fileLocation, GLfloat startTime);
+	void RecordFrame(GLfloat now, Camera& camera);
+	void StopRecording();
+
+	bool IsRecording() { return file != NULL; }
+
+	~CameraRecorder();
+
+private:
+	FILE* file;
+	unsigned int frameCount;
+	GLfloat startTime;
+};
+
+class CameraReplay
+{
+public:
+	CameraReplay();
+
+	bool LoadFromFile(const char* fileLocation);
+
+	// Drive the camera from the recording, interpolating between the samples either side of elapsedTime
+	bool ApplyAtTime(GLfloat elapsedTime, Camera& camera);
+	// Drive the camera from a single sample, for fixed-step captures that ignore wall clock time
+	bool ApplyFrame(unsigned int frameIndex, Camera& camera);
+
+	unsigned int GetFrameCount() { return (unsigned int)frames.size(); }
+	GLfloat GetDuration() { return frames.empty() ? 0.0f : frames.back().time; }
+
+	~CameraReplay();
+
+private:
+	std::vector<CameraFrame> frames;
+	size_t cursor;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+
+// On-disk layout shared by the texture cooker and the runtime loader, modelled on KTX2:
+// a fixed header, one CookedTextureLevel per mip (largest first) and the block-compressed
+// level data, each level starting on a cookedTextureAlignment boundary.
+
+static const char cookedTextureIdentifier[8] = { 'C', 'T', 'E', 'X', '\r', '\n', 0x1A, '\n' };
+static const uint32_t cookedTextureVersion = 1;
+static const uint32_t cookedTextureAlignment = 16;
+
+enum CookedTextureEncoding
+{
+	COOKED_BC1 = 1,		// RGB, 1-bit alpha, 8 bytes per 4x4 block
+	COOKED_BC3 = 3,		// RGBA, 16 bytes per block
+	COOKED_BC5 = 5,		// two channel (normal maps), 16 bytes per block
+	COOKED_BC7 = 7,		// RGBA high quality, 16 bytes per block
+	COOKED_ETC2_RGB = 20	// RGB fallback for hardware without BCn, 8 bytes per block
+};
+
+enum CookedTextureFlags
+{
+	COOKED_FLAG_SRGB = 1
+};
+
+struct CookedTextureHeader
+{
+	char identifier[8];
+	uint32_t version;
+	uint32_t encoding;
+	uint32_t flags;
+	uint32_t width;
+	uint32_t height;
+	uint32_t levelCount;
+};
+
+struct CookedTextureLevel
+{
+	uint64_t byteOffset;
+	uint64_t byteLength;
+	uint32_t width;
+	uint32_t height;
+};
+
+static inline uint32_t CookedBlockSize(uint32_t encoding)
+{
+	return (encoding == COOKED_BC1 || encoding == COOKED_ETC2_RGB) ? 8 : 16;
+}
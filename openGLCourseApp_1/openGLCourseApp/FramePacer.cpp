@@ -0,0 +1,167 @@
+#include "FramePacer.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <thread>
+
+// Number of frames the statistics are gathered over
+static const unsigned int frameHistoryLength = 240;
+// The OS sleep is only trusted up to this margin before the deadline, the rest is spun
+static const std::chrono::microseconds spinMargin(2000);
+
+FramePacer::FramePacer()
+{
+	targetFrameTime = 0.0;
+	maxFramesInFlight = 2;
+
+	fences.assign(maxFramesInFlight, (GLsync)0);
+	fenceIndex = 0;
+
+	firstFrame = true;
+
+	frameTimes.assign(frameHistoryLength, 0.0);
+	frameTimeIndex = 0;
+	frameTimeCount = 0;
+}
+
+void FramePacer::setTargetFrameRate(double framesPerSecond)
+{
+	targetFrameTime = framesPerSecond > 0.0 ? 1.0 / framesPerSecond : 0.0;
+}
+
+void FramePacer::setMaxFramesInFlight(unsigned int frames)
+{
+	ClearFences();
+
+	maxFramesInFlight = frames > 0 ? frames : 1;
+	fences.assign(maxFramesInFlight, (GLsync)0);
+	fenceIndex = 0;
+}
+
+void FramePacer::BeginFrame()
+{
+	// The slot about to be reused holds the fence from maxFramesInFlight frames ago
+	GLsync oldest = fences[fenceIndex];
+	if (!oldest)
+	{
+		return;
+	}
+
+	GLenum result = glClientWaitSync(oldest, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	while (result == GL_TIMEOUT_EXPIRED)
+	{
+		result = glClientWaitSync(oldest, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+	}
+
+	if (result == GL_WAIT_FAILED)
+	{
+		printf("Error waiting on frame fence!\n");
+	}
+
+	glDeleteSync(oldest);
+	fences[fenceIndex] = 0;
+}
+
+void FramePacer::EndFrame()
+{
+	fences[fenceIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	fenceIndex = (fenceIndex + 1) % maxFramesInFlight;
+
+	Clock::time_point now = Clock::now();
+	if (firstFrame)
+	{
+		firstFrame = false;
+		lastFrameEnd = now;
+		nextFrameDeadline = now;
+	}
+
+	if (targetFrameTime > 0.0)
+	{
+		nextFrameDeadline += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(targetFrameTime));
+
+		// Fell more than a frame behind, restart the schedule instead of bursting to catch up
+		if (nextFrameDeadline < now)
+		{
+			nextFrameDeadline = now;
+		}
+
+		WaitUntil(nextFrameDeadline);
+		now = Clock::now();
+	}
+
+	RecordFrameTime(std::chrono::duration<double, std::milli>(now - lastFrameEnd).count());
+	lastFrameEnd = now;
+}
+
+void FramePacer::WaitUntil(Clock::time_point deadline)
+{
+	Clock::time_point now = Clock::now();
+	if (deadline - now > spinMargin)
+	{
+		std::this_thread::sleep_for(deadline - now - spinMargin);
+	}
+
+	while (Clock::now() < deadline)
+	{
+		std::this_thread::yield();
+	}
+}
+
+void FramePacer::RecordFrameTime(double frameMs)
+{
+	std::lock_guard<std::mutex> lock(statsMutex);
+
+	frameTimes[frameTimeIndex] = frameMs;
+	frameTimeIndex = (frameTimeIndex + 1) % frameHistoryLength;
+	if (frameTimeCount < frameHistoryLength)
+	{
+		frameTimeCount++;
+	}
+}
+
+FrameStats FramePacer::GetStats()
+{
+	std::vector<double> sorted;
+	{
+		std::lock_guard<std::mutex> lock(statsMutex);
+		sorted.assign(frameTimes.begin(), frameTimes.begin() + frameTimeCount);
+	}
+
+	FrameStats stats = { 0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+	if (sorted.empty())
+	{
+		return stats;
+	}
+
+	std::sort(sorted.begin(), sorted.end());
+
+	double total = 0.0;
+	for (size_t i = 0; i < sorted.size(); i++)
+	{
+		total += sorted[i];
+	}
+
+	stats.frameCount = (unsigned int)sorted.size();
+	stats.averageMs = total / sorted.size();
+	stats.minMs = sorted.front();
+	stats.maxMs = sorted.back();
+	stats.percentile99Ms = sorted[std::min(sorted.size() - 1, (size_t)(sorted.size() * 0.99))];
+	stats.framesPerSecond = stats.averageMs > 0.0 ? 1000.0 / stats.averageMs : 0.0;
+	return stats;
+}
+
+void FramePacer::ClearFences()
+{
+	for (size_t i = 0; i < fences.size(); i++)
+	{
+		if (fences[i])
+		{
+			glDeleteSync(fences[i]);
+			fences[i] = 0;
+		}
+	}
+}
+
+FramePacer::~FramePacer()
+{
+}
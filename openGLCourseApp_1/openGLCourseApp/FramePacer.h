@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include <GL\glew.h>
+
+struct FrameStats
+{
+	unsigned int frameCount;
+	double averageMs;
+	double minMs;
+	double maxMs;
+	double percentile99Ms;
+	double framesPerSecond;
+};
+
+// Paces the render thread: caps the frame rate with a sleep + spin wait, keeps the CPU at most
+// maxFramesInFlight frames ahead of the GPU using fence syncs and records frame times.
+// BeginFrame/EndFrame must be called on the thread that owns the GL context.
+class FramePacer
+{
+public:
+	FramePacer();
+
+	// 0 disables the limiter
+	void setTargetFrameRate(double framesPerSecond);
+	// Configure before rendering starts, changing it drops the outstanding fences
+	void setMaxFramesInFlight(unsigned int frames);
+
+	// Call before issuing GL commands for a frame, blocks until the GPU has caught up
+	void BeginFrame();
+	// Call right after swapping buffers, fences the frame and waits out the rest of the frame budget
+	void EndFrame();
+
+	// Safe to call from any thread
+	FrameStats GetStats();
+
+	void ClearFences();
+
+	~FramePacer();
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	double targetFrameTime;
+	unsigned int maxFramesInFlight;
+
+	std::vector<GLsync> fences;
+	unsigned int fenceIndex;
+
+	Clock::time_point nextFrameDeadline;
+	Clock::time_point lastFrameEnd;
+	bool firstFrame;
+
+	std::mutex statsMutex;
+	std::vector<double> frameTimes;
+	unsigned int frameTimeIndex;
+	unsigned int frameTimeCount;
+
+	void WaitUntil(Clock::time_point deadline);
+	void RecordFrameTime(double frameMs);
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vector>
+
+#include <glm\glm.hpp>
+
+class Mesh;
+class Texture;
+
+// Indices of the finest level left to draw after meshlet culling
+struct MeshletRange
+{
+	unsigned int firstIndex;
+	unsigned int indexCount;
+};
+
+struct DrawItem
+{
+	Mesh* mesh;
+	Texture* texture;
+	glm::mat4 model;
+	// Pixels an object unit covers at the mesh's nearest point, picks its level of detail. 0 draws the coarsest.
+	float lodScale;
+	// rangeCount entries of the packet's meshletRanges from firstRange, used when the finest level is selected.
+	// firstRange -1 draws the level whole.
+	int firstRange;
+	unsigned int rangeCount;
+};
+
+// A mesh of the renderer's MeshBatch sampling an atlas region, drawn together with every other BatchItem
+struct BatchItem
+{
+	unsigned int mesh;
+	int layer;
+	glm::vec4 uvTransform;
+	glm::mat4 model;
+};
+
+// A terrain quadtree node, drawn as one instance of the terrain's grid mesh
+struct TerrainNode
+{
+	// Corner and width in terrain units
+	float x, z, size;
+	// Level of detail whose morph range the node's vertices use, 0 the finest
+	float lod;
+};
+
+// Characters sharing a skinned mesh and skeleton, drawn as one instanced draw. Each instance reads its model
+// matrix and joints from texelsPerInstance consecutive texels of the packet's jointPalette, the first at firstTexel.
+struct SkinnedItem
+{
+	Mesh* mesh;
+	Texture* texture;
+	unsigned int firstTexel;
+	unsigned int texelsPerInstance;
+	unsigned int instanceCount;
+	// Joints as dual quaternions rather than matrices, see AnimationSampler
+	bool dualQuaternion;
+};
+
+// Everything the render thread needs to draw one frame, produced by the simulation on the main thread
+struct FramePacket
+{
+	unsigned int frameNumber;
+	glm::mat4 projection;
+	glm::mat4 view;
+	std::vector<DrawItem> drawList;
+	std::vector<BatchItem> batchList;
+	// Drawn with the renderer's virtual texture, the items' textures are ignored
+	std::vector<DrawItem> virtualList;
+	// Shared by the items of both lists that were meshlet culled
+	std::vector<MeshletRange> meshletRanges;
+	// Nodes selected for the renderer's terrain, drawn with terrainModel and morphed towards terrainEye
+	// (terrain space)
+	std::vector<TerrainNode> terrainNodes;
+	glm::mat4 terrainModel;
+	glm::vec3 terrainEye;
+	// Drawn with the renderer's skinning shader from the palette uploaded for the frame
+	std::vector<SkinnedItem> skinnedList;
+	std::vector<glm::vec4> jointPalette;
+};
@@ -0,0 +1,1064 @@
+#include "GltfFile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "Quaternion.h"
+
+// .glb container: a 12 byte header then chunks, each a length, a type and 4 byte aligned data
+static const uint32_t glbMagic = 0x46546C67;		// "glTF"
+static const uint32_t glbChunkJson = 0x4E4F534A;	// "JSON"
+static const uint32_t glbChunkBinary = 0x004E4942;	// "BIN\0"
+
+static uint32_t ComponentSize(uint32_t componentType)
+{
+	switch (componentType)
+	{
+	case gltfByte:
+	case gltfUnsignedByte:
+		return 1;
+	case gltfShort:
+	case gltfUnsignedShort:
+		return 2;
+	case gltfUnsignedInt:
+	case gltfFloat:
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+static uint32_t ComponentCount(const std::string& type)
+{
+	// MAT2 and MAT3 are not read by anything here, their columns would need padding rules. MAT4 never does.
+	if (type == "SCALAR") return 1;
+	if (type == "VEC2") return 2;
+	if (type == "VEC3") return 3;
+	if (type == "VEC4") return 4;
+	if (type == "MAT4") return 16;
+	return 0;
+}
+
+static float ReadComponent(const unsigned char* source, uint32_t componentType, bool normalized)
+{
+	switch (componentType)
+	{
+	case gltfByte:
+	{
+		float value = (float)*(const int8_t*)source;
+		return normalized ? fmaxf(value / 127.0f, -1.0f) : value;
+	}
+	case gltfUnsignedByte:
+		return normalized ? *source / 255.0f : (float)*source;
+	case gltfShort:
+	{
+		int16_t value;
+		memcpy(&value, source, sizeof(value));
+		return normalized ? fmaxf(value / 32767.0f, -1.0f) : (float)value;
+	}
+	case gltfUnsignedShort:
+	{
+		uint16_t value;
+		memcpy(&value, source, sizeof(value));
+		return normalized ? value / 65535.0f : (float)value;
+	}
+	case gltfUnsignedInt:
+	{
+		uint32_t value;
+		memcpy(&value, source, sizeof(value));
+		return (float)value;
+	}
+	default:
+	{
+		float value;
+		memcpy(&value, source, sizeof(value));
+		return value;
+	}
+	}
+}
+
+static uint32_t ReadIndex(const unsigned char* source, uint32_t componentType)
+{
+	if (componentType == gltfUnsignedByte)
+	{
+		return *source;
+	}
+	if (componentType == gltfUnsignedShort)
+	{
+		uint16_t value;
+		memcpy(&value, source, sizeof(value));
+		return value;
+	}
+
+	uint32_t value;
+	memcpy(&value, source, sizeof(value));
+	return value;
+}
+
+// Column-major 4x4, result = a * b
+static void MultiplyMatrix(const float* a, const float* b, float* result)
+{
+	for (int column = 0; column < 4; column++)
+	{
+		for (int row = 0; row < 4; row++)
+		{
+			float sum = 0.0f;
+			for (int k = 0; k < 4; k++)
+			{
+				sum += a[k * 4 + row] * b[column * 4 + k];
+			}
+			result[column * 4 + row] = sum;
+		}
+	}
+}
+
+static void NodeMatrix(const JsonValue& node, float* matrix)
+{
+	const JsonValue& values = node.GetMember("matrix");
+	if (values.GetSize() == 16)
+	{
+		for (size_t i = 0; i < 16; i++)
+		{
+			matrix[i] = (float)values.GetElement(i).AsNumber(0.0);
+		}
+		return;
+	}
+
+	// T * R * S, the rotation a unit quaternion x, y, z, w
+	const JsonValue& translation = node.GetMember("translation");
+	const JsonValue& rotation = node.GetMember("rotation");
+	const JsonValue& scale = node.GetMember("scale");
+
+	float t[3], s[3];
+	for (size_t i = 0; i < 3; i++)
+	{
+		t[i] = (float)translation.GetElement(i).AsNumber(0.0);
+		s[i] = (float)scale.GetElement(i).AsNumber(1.0);
+	}
+	float x = (float)rotation.GetElement(0).AsNumber(0.0);
+	float y = (float)rotation.GetElement(1).AsNumber(0.0);
+	float z = (float)rotation.GetElement(2).AsNumber(0.0);
+	float w = (float)rotation.GetElement(3).AsNumber(1.0);
+
+	float r[9] = {
+		1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + z * w), 2.0f * (x * z - y * w),
+		2.0f * (x * y - z * w), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + x * w),
+		2.0f * (x * z + y * w), 2.0f * (y * z - x * w), 1.0f - 2.0f * (x * x + y * y)
+	};
+
+	for (int column = 0; column < 3; column++)
+	{
+		for (int row = 0; row < 3; row++)
+		{
+			matrix[column * 4 + row] = r[column * 3 + row] * s[column];
+		}
+		matrix[column * 4 + 3] = 0.0f;
+	}
+	matrix[12] = t[0];
+	matrix[13] = t[1];
+	matrix[14] = t[2];
+	matrix[15] = 1.0f;
+}
+
+// Translation, rotation and scale of an affine matrix without shear, as animation channels replace them
+static void DecomposeMatrix(const float* matrix, float* translation, float* rotation, float* scale)
+{
+	float m[3][3];
+	for (int column = 0; column < 3; column++)
+	{
+		const float* c = &matrix[column * 4];
+		scale[column] = sqrtf(c[0] * c[0] + c[1] * c[1] + c[2] * c[2]);
+		float inverse = scale[column] > 0.0f ? 1.0f / scale[column] : 0.0f;
+		for (int row = 0; row < 3; row++)
+		{
+			m[column][row] = c[row] * inverse;
+		}
+		translation[column] = matrix[12 + column];
+	}
+
+	// A mirrored basis keeps a proper rotation by negating one scale
+	float determinant = m[0][0] * (m[1][1] * m[2][2] - m[2][1] * m[1][2]) - m[1][0] * (m[0][1] * m[2][2] - m[2][1] * m[0][2]) + m[2][0] * (m[0][1] * m[1][2] - m[1][1] * m[0][2]);
+	if (determinant < 0.0f)
+	{
+		scale[0] = -scale[0];
+		m[0][0] = -m[0][0];
+		m[0][1] = -m[0][1];
+		m[0][2] = -m[0][2];
+	}
+
+	MatrixToQuaternion(&m[0][0], rotation);
+}
+
+static std::string DecodeUri(const std::string& uri)
+{
+	// Relative uris may escape spaces and other characters as %XX
+	std::string decoded;
+	for (size_t i = 0; i < uri.size(); i++)
+	{
+		if (uri[i] == '%' && i + 2 < uri.size())
+		{
+			char hex[3] = { uri[i + 1], uri[i + 2], 0 };
+			decoded += (char)strtol(hex, NULL, 16);
+			i += 2;
+		}
+		else
+		{
+			decoded += uri[i];
+		}
+	}
+	return decoded;
+}
+
+GltfFile::GltfFile()
+{
+}
+
+bool GltfFile::Open(const char* fileLocation)
+{
+	Close();
+
+	mappedFiles.push_back(std::unique_ptr<MappedFile>(new MappedFile()));
+	MappedFile& file = *mappedFiles.back();
+	if (!file.Open(fileLocation))
+	{
+		Close();
+		return false;
+	}
+
+	const unsigned char* data = file.GetData();
+	size_t size = file.GetSize();
+	const char* json = (const char*)data;
+	size_t jsonSize = size;
+	const unsigned char* binaryChunk = NULL;
+	size_t binaryChunkSize = 0;
+
+	uint32_t header[3];
+	if (size >= sizeof(header))
+	{
+		memcpy(header, data, sizeof(header));
+	}
+
+	if (size >= sizeof(header) && header[0] == glbMagic)
+	{
+		if (header[1] != 2 || header[2] > size)
+		{
+			printf("%s: unsupported glb version %u or truncated file\n", fileLocation, header[1]);
+			Close();
+			return false;
+		}
+
+		json = NULL;
+		size_t offset = sizeof(header);
+		while (offset + 8 <= header[2])
+		{
+			uint32_t chunk[2];
+			memcpy(chunk, data + offset, sizeof(chunk));
+			offset += sizeof(chunk);
+			if (chunk[0] > header[2] - offset)
+			{
+				break;
+			}
+
+			if (chunk[1] == glbChunkJson && !json)
+			{
+				json = (const char*)data + offset;
+				jsonSize = chunk[0];
+			}
+			else if (chunk[1] == glbChunkBinary && !binaryChunk)
+			{
+				binaryChunk = data + offset;
+				binaryChunkSize = chunk[0];
+			}
+			offset += (chunk[0] + 3) & ~3u;
+		}
+
+		if (!json)
+		{
+			printf("%s: glb has no JSON chunk\n", fileLocation);
+			Close();
+			return false;
+		}
+	}
+
+	JsonValue document;
+	if (!JsonValue::Parse(json, jsonSize, document) || document.GetType() != JSON_OBJECT)
+	{
+		printf("%s is not a glTF file\n", fileLocation);
+		Close();
+		return false;
+	}
+
+	if (!LoadDocument(document, fileLocation, binaryChunk, binaryChunkSize))
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+bool GltfFile::LoadDocument(const JsonValue& document, const char* fileLocation, const unsigned char* binaryChunk, size_t binaryChunkSize)
+{
+	const std::string& version = document.GetMember("asset").GetMember("version").AsString();
+	if (version.empty() || version[0] != '2')
+	{
+		printf("%s: unsupported glTF version %s\n", fileLocation, version.c_str());
+		return false;
+	}
+
+	// Quantised attributes are plain GL vertex formats, anything else required changes how data is read
+	const JsonValue& required = document.GetMember("extensionsRequired");
+	for (size_t i = 0; i < required.GetSize(); i++)
+	{
+		const std::string& extension = required.GetElement(i).AsString();
+		if (extension != "KHR_mesh_quantization")
+		{
+			printf("%s: required extension %s is not supported\n", fileLocation, extension.c_str());
+			return false;
+		}
+	}
+
+	std::string directory = fileLocation;
+	size_t slash = directory.find_last_of("/\\");
+	directory = slash == std::string::npos ? std::string() : directory.substr(0, slash + 1);
+
+	if (!LoadBuffers(document, directory, binaryChunk, binaryChunkSize) || !LoadAccessors(document))
+	{
+		return false;
+	}
+
+	LoadMeshes(document);
+	LoadMaterials(document, directory);
+	LoadNodes(document);
+	LoadSkins(document);
+	LoadAnimations(document);
+	return LoadScene(document);
+}
+
+bool GltfFile::LoadBuffers(const JsonValue& document, const std::string& directory, const unsigned char* binaryChunk, size_t binaryChunkSize)
+{
+	const JsonValue& bufferList = document.GetMember("buffers");
+	for (size_t i = 0; i < bufferList.GetSize(); i++)
+	{
+		const JsonValue& buffer = bufferList.GetElement(i);
+		const std::string& uri = buffer.GetMember("uri").AsString();
+		size_t byteLength;
+		if (!buffer.GetMember("byteLength").AsSize(0, byteLength))
+		{
+			printf("glTF buffer %u has an invalid byte length\n", (unsigned int)i);
+			return false;
+		}
+
+		Buffer entry = { NULL, 0 };
+		if (uri.empty())
+		{
+			// Only the first buffer of a .glb may omit its uri, it is the binary chunk
+			entry.data = i == 0 ? binaryChunk : NULL;
+			entry.size = i == 0 ? binaryChunkSize : 0;
+		}
+		else if (uri.compare(0, 5, "data:") == 0)
+		{
+			int decoded = DecodeDataUri(uri);
+			if (decoded >= 0)
+			{
+				entry.data = decodedData[decoded].empty() ? NULL : &decodedData[decoded][0];
+				entry.size = decodedData[decoded].size();
+			}
+		}
+		else
+		{
+			std::string path = directory + DecodeUri(uri);
+			mappedFiles.push_back(std::unique_ptr<MappedFile>(new MappedFile()));
+			if (mappedFiles.back()->Open(path.c_str()))
+			{
+				entry.data = mappedFiles.back()->GetData();
+				entry.size = mappedFiles.back()->GetSize();
+			}
+		}
+
+		if (!entry.data || entry.size < byteLength)
+		{
+			printf("glTF buffer %u is missing or shorter than its %u bytes\n", (unsigned int)i, (unsigned int)byteLength);
+			return false;
+		}
+		buffers.push_back(entry);
+	}
+
+	const JsonValue& viewList = document.GetMember("bufferViews");
+	for (size_t i = 0; i < viewList.GetSize(); i++)
+	{
+		const JsonValue& view = viewList.GetElement(i);
+		GltfBufferView entry;
+		entry.buffer = (uint32_t)view.GetMember("buffer").AsInt(-1);
+		if (!view.GetMember("byteOffset").AsSize(0, entry.byteOffset) || !view.GetMember("byteLength").AsSize(0, entry.byteLength) ||
+			!view.GetMember("byteStride").AsSize(0, entry.byteStride))
+		{
+			printf("glTF buffer view %u has an invalid offset, length or stride\n", (unsigned int)i);
+			return false;
+		}
+
+		if (entry.buffer >= buffers.size() || entry.byteOffset > buffers[entry.buffer].size || entry.byteLength > buffers[entry.buffer].size - entry.byteOffset)
+		{
+			printf("glTF buffer view %u is outside its buffer\n", (unsigned int)i);
+			return false;
+		}
+		bufferViews.push_back(entry);
+	}
+	return true;
+}
+
+bool GltfFile::CheckRange(int view, size_t byteOffset, size_t count, size_t stride, size_t elementSize)
+{
+	if (view < 0 || (size_t)view >= bufferViews.size())
+	{
+		return false;
+	}
+	if (count == 0)
+	{
+		return true;
+	}
+
+	size_t length = bufferViews[view].byteLength;
+	return byteOffset <= length && elementSize <= length - byteOffset && (count - 1) <= (length - byteOffset - elementSize) / (stride ? stride : 1);
+}
+
+bool GltfFile::LoadAccessors(const JsonValue& document)
+{
+	const JsonValue& accessorList = document.GetMember("accessors");
+	for (size_t i = 0; i < accessorList.GetSize(); i++)
+	{
+		const JsonValue& accessor = accessorList.GetElement(i);
+		GltfAccessor entry;
+		entry.bufferView = accessor.GetMember("bufferView").AsInt(-1);
+		entry.componentType = (uint32_t)accessor.GetMember("componentType").AsInt(0);
+		entry.components = ComponentCount(accessor.GetMember("type").AsString());
+		entry.normalized = accessor.GetMember("normalized").AsBool(false);
+		if (!accessor.GetMember("byteOffset").AsSize(0, entry.byteOffset) || !accessor.GetMember("count").AsSize(0, entry.count))
+		{
+			printf("glTF accessor %u has an invalid offset or count\n", (unsigned int)i);
+			return false;
+		}
+		entry.hasBounds = accessor.GetMember("min").GetSize() >= 3 && accessor.GetMember("max").GetSize() >= 3;
+		for (size_t axis = 0; axis < 3; axis++)
+		{
+			entry.boundsMin[axis] = (float)accessor.GetMember("min").GetElement(axis).AsNumber(0.0);
+			entry.boundsMax[axis] = (float)accessor.GetMember("max").GetElement(axis).AsNumber(0.0);
+		}
+		entry.sparseCount = 0;
+		entry.sparseIndicesView = 0;
+		entry.sparseIndicesOffset = 0;
+		entry.sparseIndicesType = 0;
+		entry.sparseValuesView = 0;
+		entry.sparseValuesOffset = 0;
+
+		uint32_t componentSize = ComponentSize(entry.componentType);
+		size_t elementSize = (size_t)componentSize * entry.components;
+
+		// Unsupported types are kept so indices stay aligned, nothing reads an accessor without components
+		if (componentSize == 0 || entry.components == 0)
+		{
+			entry.components = 0;
+			accessors.push_back(entry);
+			continue;
+		}
+
+		if (entry.bufferView >= 0 && !CheckRange(entry.bufferView, entry.byteOffset, entry.count, GetElementStride(entry), elementSize))
+		{
+			printf("glTF accessor %u is outside its buffer view\n", (unsigned int)i);
+			return false;
+		}
+
+		const JsonValue& sparse = accessor.GetMember("sparse");
+		if (!sparse.IsNull())
+		{
+			const JsonValue& indices = sparse.GetMember("indices");
+			const JsonValue& values = sparse.GetMember("values");
+			size_t sparseCount;
+			bool validSizes = sparse.GetMember("count").AsSize(0, sparseCount) && sparseCount <= entry.count && sparseCount <= UINT32_MAX &&
+				indices.GetMember("byteOffset").AsSize(0, entry.sparseIndicesOffset) && values.GetMember("byteOffset").AsSize(0, entry.sparseValuesOffset);
+			entry.sparseCount = validSizes ? (uint32_t)sparseCount : 0;
+			entry.sparseIndicesView = (uint32_t)indices.GetMember("bufferView").AsInt(-1);
+			entry.sparseIndicesType = (uint32_t)indices.GetMember("componentType").AsInt(0);
+			entry.sparseValuesView = (uint32_t)values.GetMember("bufferView").AsInt(-1);
+
+			uint32_t indexSize = ComponentSize(entry.sparseIndicesType);
+			if (!validSizes || indexSize == 0 || !CheckRange((int)entry.sparseIndicesView, entry.sparseIndicesOffset, entry.sparseCount, indexSize, indexSize) ||
+				!CheckRange((int)entry.sparseValuesView, entry.sparseValuesOffset, entry.sparseCount, elementSize, elementSize))
+			{
+				printf("glTF accessor %u has invalid sparse data\n", (unsigned int)i);
+				return false;
+			}
+		}
+
+		accessors.push_back(entry);
+	}
+	return true;
+}
+
+void GltfFile::LoadMeshes(const JsonValue& document)
+{
+	const JsonValue& meshList = document.GetMember("meshes");
+	for (size_t i = 0; i < meshList.GetSize(); i++)
+	{
+		const JsonValue& primitiveList = meshList.GetElement(i).GetMember("primitives");
+		GltfMesh mesh;
+		mesh.firstPrimitive = (uint32_t)primitives.size();
+		mesh.primitiveCount = (uint32_t)primitiveList.GetSize();
+
+		for (size_t p = 0; p < primitiveList.GetSize(); p++)
+		{
+			const JsonValue& primitive = primitiveList.GetElement(p);
+			const JsonValue& attributes = primitive.GetMember("attributes");
+
+			GltfPrimitive entry;
+			entry.position = attributes.GetMember("POSITION").AsInt(-1);
+			entry.texCoord = attributes.GetMember("TEXCOORD_0").AsInt(-1);
+			entry.indices = primitive.GetMember("indices").AsInt(-1);
+			entry.material = primitive.GetMember("material").AsInt(-1);
+			entry.mode = (uint32_t)primitive.GetMember("mode").AsInt(gltfTriangles);
+			entry.joints = attributes.GetMember("JOINTS_0").AsInt(-1);
+			entry.weights = attributes.GetMember("WEIGHTS_0").AsInt(-1);
+
+			// Anything out of range or of the wrong shape is dropped here so readers can index freely
+			size_t accessorCount = accessors.size();
+			if (entry.position >= (int)accessorCount || (entry.position >= 0 && accessors[entry.position].components != 3))
+			{
+				entry.position = -1;
+			}
+			if (entry.texCoord >= (int)accessorCount || (entry.texCoord >= 0 && accessors[entry.texCoord].components != 2))
+			{
+				entry.texCoord = -1;
+			}
+			uint32_t indexType = entry.indices >= 0 && entry.indices < (int)accessorCount ? accessors[entry.indices].componentType : 0;
+			if (entry.indices >= (int)accessorCount || (entry.indices >= 0 && (accessors[entry.indices].components != 1 ||
+				(indexType != gltfUnsignedByte && indexType != gltfUnsignedShort && indexType != gltfUnsignedInt))))
+			{
+				entry.indices = -1;
+			}
+			entry.material = entry.material < (int)document.GetMember("materials").GetSize() ? entry.material : -1;
+			if (entry.joints >= (int)accessorCount || entry.weights >= (int)accessorCount || entry.joints < 0 || entry.weights < 0 ||
+				accessors[entry.joints].components != 4 || accessors[entry.weights].components != 4)
+			{
+				entry.joints = -1;
+				entry.weights = -1;
+			}
+
+			primitives.push_back(entry);
+		}
+
+		meshes.push_back(mesh);
+	}
+}
+
+void GltfFile::LoadMaterials(const JsonValue& document, const std::string& directory)
+{
+	const JsonValue& imageList = document.GetMember("images");
+	for (size_t i = 0; i < imageList.GetSize(); i++)
+	{
+		const JsonValue& image = imageList.GetElement(i);
+		const std::string& uri = image.GetMember("uri").AsString();
+
+		GltfImage entry;
+		entry.bufferView = image.GetMember("bufferView").AsInt(-1);
+		entry.bufferView = entry.bufferView < (int)bufferViews.size() ? entry.bufferView : -1;
+		entry.mimeType = image.GetMember("mimeType").AsString();
+		int decoded = -1;
+
+		if (uri.compare(0, 5, "data:") == 0)
+		{
+			decoded = DecodeDataUri(uri);
+		}
+		else if (!uri.empty())
+		{
+			entry.path = directory + DecodeUri(uri);
+		}
+
+		images.push_back(entry);
+		imageData.push_back(decoded);
+	}
+
+	const JsonValue& textureList = document.GetMember("textures");
+	const JsonValue& materialList = document.GetMember("materials");
+	for (size_t i = 0; i < materialList.GetSize(); i++)
+	{
+		const JsonValue& material = materialList.GetElement(i);
+		int texture = material.GetMember("pbrMetallicRoughness").GetMember("baseColorTexture").GetMember("index").AsInt(-1);
+
+		GltfMaterial entry;
+		entry.baseColorImage = texture >= 0 ? textureList.GetElement(texture).GetMember("source").AsInt(-1) : -1;
+		entry.baseColorImage = entry.baseColorImage < (int)images.size() ? entry.baseColorImage : -1;
+		entry.alphaCutoff = material.GetMember("alphaMode").AsString() == "MASK" ? (float)material.GetMember("alphaCutoff").AsNumber(0.5) : 0.0f;
+		materials.push_back(entry);
+	}
+}
+
+void GltfFile::LoadNodes(const JsonValue& document)
+{
+	const JsonValue& nodeList = document.GetMember("nodes");
+	nodes.resize(nodeList.GetSize());
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		nodes[i].parent = -1;
+	}
+
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		const JsonValue& node = nodeList.GetElement(i);
+		GltfNode& entry = nodes[i];
+
+		// Until the scene walk replaces it with the full chain of ancestors
+		NodeMatrix(node, entry.world);
+		if (node.GetMember("matrix").GetSize() == 16)
+		{
+			DecomposeMatrix(entry.world, entry.translation, entry.rotation, entry.scale);
+		}
+		else
+		{
+			const JsonValue& rotation = node.GetMember("rotation");
+			for (size_t c = 0; c < 3; c++)
+			{
+				entry.translation[c] = (float)node.GetMember("translation").GetElement(c).AsNumber(0.0);
+				entry.rotation[c] = (float)rotation.GetElement(c).AsNumber(0.0);
+				entry.scale[c] = (float)node.GetMember("scale").GetElement(c).AsNumber(1.0);
+			}
+			entry.rotation[3] = (float)rotation.GetElement(3).AsNumber(1.0);
+		}
+
+		// A node listed as the child of several keeps its first parent, cycles are caught by the scene walk
+		const JsonValue& children = node.GetMember("children");
+		for (size_t c = 0; c < children.GetSize(); c++)
+		{
+			int child = children.GetElement(c).AsInt(-1);
+			if (child >= 0 && (size_t)child < nodes.size() && (size_t)child != i && nodes[child].parent < 0)
+			{
+				nodes[child].parent = (int)i;
+			}
+		}
+	}
+}
+
+void GltfFile::LoadSkins(const JsonValue& document)
+{
+	const JsonValue& skinList = document.GetMember("skins");
+	for (size_t i = 0; i < skinList.GetSize(); i++)
+	{
+		const JsonValue& skin = skinList.GetElement(i);
+		GltfSkin entry;
+		entry.inverseBindMatrices = skin.GetMember("inverseBindMatrices").AsInt(-1);
+		if (entry.inverseBindMatrices >= (int)accessors.size() || (entry.inverseBindMatrices >= 0 && accessors[entry.inverseBindMatrices].components != 16))
+		{
+			entry.inverseBindMatrices = -1;
+		}
+
+		// A skin naming a missing node is kept without joints, so instances can still refer to it by index
+		const JsonValue& joints = skin.GetMember("joints");
+		for (size_t j = 0; j < joints.GetSize(); j++)
+		{
+			int joint = joints.GetElement(j).AsInt(-1);
+			if (joint < 0 || (size_t)joint >= nodes.size())
+			{
+				printf("glTF skin %u names a missing joint\n", (unsigned int)i);
+				entry.joints.clear();
+				break;
+			}
+			entry.joints.push_back((uint32_t)joint);
+		}
+		skins.push_back(entry);
+	}
+}
+
+void GltfFile::LoadAnimations(const JsonValue& document)
+{
+	const JsonValue& animationList = document.GetMember("animations");
+	for (size_t i = 0; i < animationList.GetSize(); i++)
+	{
+		const JsonValue& animation = animationList.GetElement(i);
+		const JsonValue& samplers = animation.GetMember("samplers");
+		const JsonValue& channels = animation.GetMember("channels");
+
+		GltfAnimation entry;
+		entry.name = animation.GetMember("name").AsString();
+		for (size_t c = 0; c < channels.GetSize(); c++)
+		{
+			const JsonValue& target = channels.GetElement(c).GetMember("target");
+			const JsonValue& sampler = samplers.GetElement((size_t)channels.GetElement(c).GetMember("sampler").AsInt(-1));
+			const std::string& path = target.GetMember("path").AsString();
+			const std::string& interpolation = sampler.GetMember("interpolation").AsString();
+			int node = target.GetMember("node").AsInt(-1);
+			int input = sampler.GetMember("input").AsInt(-1);
+			int output = sampler.GetMember("output").AsInt(-1);
+
+			GltfChannel channel;
+			channel.path = path == "translation" ? gltfTranslation : path == "rotation" ? gltfRotation : path == "scale" ? gltfScale : UINT32_MAX;
+			channel.interpolation = interpolation == "STEP" ? gltfStep : interpolation == "CUBICSPLINE" ? gltfCubicSpline : gltfLinear;
+
+			// Morph weights and anything malformed are skipped
+			uint32_t components = channel.path == gltfRotation ? 4 : 3;
+			if (channel.path == UINT32_MAX || node < 0 || (size_t)node >= nodes.size() || input < 0 || (size_t)input >= accessors.size() ||
+				output < 0 || (size_t)output >= accessors.size() || accessors[input].components != 1 || accessors[output].components != components)
+			{
+				continue;
+			}
+			channel.node = (uint32_t)node;
+			channel.input = (uint32_t)input;
+			channel.output = (uint32_t)output;
+			entry.channels.push_back(channel);
+		}
+		animations.push_back(entry);
+	}
+}
+
+bool GltfFile::LoadScene(const JsonValue& document)
+{
+	const JsonValue& nodeList = document.GetMember("nodes");
+	size_t nodeCount = nodeList.GetSize();
+
+	// The default scene, else the first one, else every node that is nobody's child
+	std::vector<int> roots;
+	const JsonValue& sceneList = document.GetMember("scenes");
+	const JsonValue& scene = sceneList.GetElement(document.GetMember("scene").AsInt(0));
+	if (!scene.IsNull())
+	{
+		const JsonValue& sceneNodes = scene.GetMember("nodes");
+		for (size_t i = 0; i < sceneNodes.GetSize(); i++)
+		{
+			roots.push_back(sceneNodes.GetElement(i).AsInt(-1));
+		}
+	}
+	else
+	{
+		std::vector<bool> isChild(nodeCount, false);
+		for (size_t i = 0; i < nodeCount; i++)
+		{
+			const JsonValue& children = nodeList.GetElement(i).GetMember("children");
+			for (size_t c = 0; c < children.GetSize(); c++)
+			{
+				int child = children.GetElement(c).AsInt(-1);
+				if (child >= 0 && (size_t)child < nodeCount)
+				{
+					isChild[child] = true;
+				}
+			}
+		}
+		for (size_t i = 0; i < nodeCount; i++)
+		{
+			if (!isChild[i])
+			{
+				roots.push_back((int)i);
+			}
+		}
+	}
+
+	struct PendingNode
+	{
+		int node;
+		unsigned int depth;
+		float parent[16];
+	};
+
+	static const float identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+	std::vector<PendingNode> stack;
+	for (size_t i = roots.size(); i-- > 0;)
+	{
+		PendingNode pending;
+		pending.node = roots[i];
+		pending.depth = 0;
+		memcpy(pending.parent, identity, sizeof(identity));
+		stack.push_back(pending);
+	}
+
+	while (!stack.empty())
+	{
+		PendingNode pending = stack.back();
+		stack.pop_back();
+
+		// A hierarchy can be no deeper than its node count, anything more is a cycle
+		if (pending.node < 0 || (size_t)pending.node >= nodeCount || pending.depth > nodeCount)
+		{
+			printf("glTF node hierarchy is invalid\n");
+			return false;
+		}
+
+		const JsonValue& node = nodeList.GetElement(pending.node);
+		float local[16], world[16];
+		NodeMatrix(node, local);
+		MultiplyMatrix(pending.parent, local, world);
+
+		int mesh = node.GetMember("mesh").AsInt(-1);
+		if (mesh >= 0 && (size_t)mesh < meshes.size())
+		{
+			GltfInstance instance;
+			instance.mesh = (uint32_t)mesh;
+			memcpy(instance.transform, world, sizeof(world));
+			instance.skin = node.GetMember("skin").AsInt(-1);
+			instance.skin = instance.skin < (int)skins.size() ? instance.skin : -1;
+			instances.push_back(instance);
+		}
+		memcpy(nodes[pending.node].world, world, sizeof(world));
+
+		const JsonValue& children = node.GetMember("children");
+		for (size_t c = children.GetSize(); c-- > 0;)
+		{
+			PendingNode child;
+			child.node = children.GetElement(c).AsInt(-1);
+			child.depth = pending.depth + 1;
+			memcpy(child.parent, world, sizeof(world));
+			stack.push_back(child);
+		}
+	}
+	return true;
+}
+
+int GltfFile::DecodeDataUri(const std::string& uri)
+{
+	size_t comma = uri.find(',');
+	if (comma == std::string::npos || uri.rfind(";base64", comma) == std::string::npos)
+	{
+		printf("glTF data uri is not base64\n");
+		return -1;
+	}
+
+	std::vector<unsigned char> decoded;
+	decoded.reserve((uri.size() - comma) / 4 * 3);
+
+	uint32_t bits = 0;
+	int bitCount = 0;
+	for (size_t i = comma + 1; i < uri.size(); i++)
+	{
+		char c = uri[i];
+		int value = c >= 'A' && c <= 'Z' ? c - 'A' : c >= 'a' && c <= 'z' ? c - 'a' + 26 : c >= '0' && c <= '9' ? c - '0' + 52 : c == '+' ? 62 : c == '/' ? 63 : -1;
+		if (value < 0)
+		{
+			// Padding ends the data
+			break;
+		}
+
+		bits = (bits << 6) | (uint32_t)value;
+		bitCount += 6;
+		if (bitCount >= 8)
+		{
+			bitCount -= 8;
+			decoded.push_back((unsigned char)(bits >> bitCount));
+		}
+	}
+
+	decodedData.push_back(std::vector<unsigned char>());
+	decodedData.back().swap(decoded);
+	return (int)decodedData.size() - 1;
+}
+
+const unsigned char* GltfFile::GetBufferViewData(uint32_t view)
+{
+	if (view >= bufferViews.size())
+	{
+		return NULL;
+	}
+	return buffers[bufferViews[view].buffer].data + bufferViews[view].byteOffset;
+}
+
+const unsigned char* GltfFile::GetImageData(uint32_t image, size_t& size)
+{
+	size = 0;
+	if (image >= images.size())
+	{
+		return NULL;
+	}
+
+	if (imageData[image] >= 0 && !decodedData[imageData[image]].empty())
+	{
+		size = decodedData[imageData[image]].size();
+		return &decodedData[imageData[image]][0];
+	}
+
+	if (images[image].bufferView >= 0)
+	{
+		size = bufferViews[images[image].bufferView].byteLength;
+		return GetBufferViewData(images[image].bufferView);
+	}
+	return NULL;
+}
+
+size_t GltfFile::GetElementStride(const GltfAccessor& accessor)
+{
+	size_t stride = accessor.bufferView >= 0 ? bufferViews[accessor.bufferView].byteStride : 0;
+	return stride ? stride : (size_t)ComponentSize(accessor.componentType) * accessor.components;
+}
+
+bool GltfFile::ReadFloats(uint32_t accessorIndex, uint32_t components, std::vector<float>& values)
+{
+	if (accessorIndex >= accessors.size() || accessors[accessorIndex].components == 0)
+	{
+		return false;
+	}
+
+	const GltfAccessor& accessor = accessors[accessorIndex];
+	uint32_t componentSize = ComponentSize(accessor.componentType);
+	uint32_t readComponents = accessor.components < components ? accessor.components : components;
+	values.assign(accessor.count * components, 0.0f);
+
+	if (accessor.bufferView >= 0)
+	{
+		const unsigned char* source = GetBufferViewData(accessor.bufferView) + accessor.byteOffset;
+		size_t stride = GetElementStride(accessor);
+		for (size_t i = 0; i < accessor.count; i++, source += stride)
+		{
+			for (uint32_t c = 0; c < readComponents; c++)
+			{
+				values[i * components + c] = ReadComponent(source + c * componentSize, accessor.componentType, accessor.normalized);
+			}
+		}
+	}
+
+	if (accessor.sparseCount > 0)
+	{
+		const unsigned char* indices = GetBufferViewData(accessor.sparseIndicesView) + accessor.sparseIndicesOffset;
+		const unsigned char* source = GetBufferViewData(accessor.sparseValuesView) + accessor.sparseValuesOffset;
+		uint32_t indexSize = ComponentSize(accessor.sparseIndicesType);
+		size_t elementSize = (size_t)componentSize * accessor.components;
+
+		for (uint32_t i = 0; i < accessor.sparseCount; i++, source += elementSize)
+		{
+			uint32_t target = ReadIndex(indices + i * indexSize, accessor.sparseIndicesType);
+			if (target >= accessor.count)
+			{
+				printf("glTF sparse index %u is out of range\n", target);
+				return false;
+			}
+
+			for (uint32_t c = 0; c < readComponents; c++)
+			{
+				values[(size_t)target * components + c] = ReadComponent(source + c * componentSize, accessor.componentType, accessor.normalized);
+			}
+		}
+	}
+	return true;
+}
+
+bool GltfFile::ReadIndices(uint32_t accessorIndex, std::vector<uint32_t>& values)
+{
+	if (accessorIndex >= accessors.size() || accessors[accessorIndex].components != 1 || accessors[accessorIndex].componentType == gltfFloat)
+	{
+		return false;
+	}
+
+	const GltfAccessor& accessor = accessors[accessorIndex];
+	values.assign(accessor.count, 0);
+
+	if (accessor.bufferView >= 0)
+	{
+		const unsigned char* source = GetBufferViewData(accessor.bufferView) + accessor.byteOffset;
+		size_t stride = GetElementStride(accessor);
+		for (size_t i = 0; i < accessor.count; i++, source += stride)
+		{
+			values[i] = ReadIndex(source, accessor.componentType);
+		}
+	}
+
+	if (accessor.sparseCount > 0)
+	{
+		const unsigned char* indices = GetBufferViewData(accessor.sparseIndicesView) + accessor.sparseIndicesOffset;
+		const unsigned char* source = GetBufferViewData(accessor.sparseValuesView) + accessor.sparseValuesOffset;
+		uint32_t indexSize = ComponentSize(accessor.sparseIndicesType);
+		uint32_t valueSize = ComponentSize(accessor.componentType);
+
+		for (uint32_t i = 0; i < accessor.sparseCount; i++)
+		{
+			uint32_t target = ReadIndex(indices + i * indexSize, accessor.sparseIndicesType);
+			if (target >= accessor.count)
+			{
+				printf("glTF sparse index %u is out of range\n", target);
+				return false;
+			}
+			values[target] = ReadIndex(source + i * valueSize, accessor.componentType);
+		}
+	}
+	return true;
+}
+
+bool GltfFile::AppendPrimitive(uint32_t primitiveIndex, const float* transform, std::vector<float>& vertices, std::vector<uint32_t>& indices)
+{
+	if (primitiveIndex >= primitives.size())
+	{
+		return false;
+	}
+
+	const GltfPrimitive& primitive = primitives[primitiveIndex];
+	if (primitive.mode != gltfTriangles || primitive.position < 0)
+	{
+		return false;
+	}
+
+	std::vector<float> positions, texCoords;
+	std::vector<uint32_t> primitiveIndices;
+	if (!ReadFloats(primitive.position, 3, positions) ||
+		(primitive.texCoord >= 0 && !ReadFloats(primitive.texCoord, 2, texCoords)) ||
+		(primitive.indices >= 0 && !ReadIndices(primitive.indices, primitiveIndices)))
+	{
+		return false;
+	}
+
+	size_t vertexCount = positions.size() / 3;
+	if (primitive.indices < 0)
+	{
+		primitiveIndices.resize(vertexCount);
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			primitiveIndices[i] = (uint32_t)i;
+		}
+	}
+
+	uint32_t baseVertex = (uint32_t)(vertices.size() / 5);
+	vertices.reserve(vertices.size() + vertexCount * 5);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const float* p = &positions[i * 3];
+		for (int row = 0; row < 3; row++)
+		{
+			vertices.push_back(transform[row] * p[0] + transform[4 + row] * p[1] + transform[8 + row] * p[2] + transform[12 + row]);
+		}
+		vertices.push_back(texCoords.empty() ? 0.0f : texCoords[i * 2]);
+		vertices.push_back(texCoords.empty() ? 0.0f : 1.0f - texCoords[i * 2 + 1]);
+	}
+
+	// Whole triangles only, indices past the vertices would read outside the buffer
+	size_t triangleIndices = primitiveIndices.size() - primitiveIndices.size() % 3;
+	size_t firstIndex = indices.size();
+	indices.reserve(indices.size() + triangleIndices);
+	for (size_t i = 0; i < triangleIndices; i++)
+	{
+		if (primitiveIndices[i] >= vertexCount)
+		{
+			printf("glTF index %u is past the %u vertices\n", primitiveIndices[i], (unsigned int)vertexCount);
+			vertices.resize((size_t)baseVertex * 5);
+			indices.resize(firstIndex);
+			return false;
+		}
+		indices.push_back(baseVertex + primitiveIndices[i]);
+	}
+	return true;
+}
+
+void GltfFile::Close()
+{
+	animations.clear();
+	skins.clear();
+	nodes.clear();
+	instances.clear();
+	imageData.clear();
+	images.clear();
+	materials.clear();
+	meshes.clear();
+	primitives.clear();
+	accessors.clear();
+	bufferViews.clear();
+	buffers.clear();
+	decodedData.clear();
+	mappedFiles.clear();
+}
+
+GltfFile::~GltfFile()
+{
+	Close();
+}
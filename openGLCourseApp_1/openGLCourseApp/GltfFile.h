@@ -0,0 +1,223 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "Json.h"
+#include "MappedFile.h"
+
+// Accessor component types, the same values as the GL enums so they can be handed to glVertexAttribPointer
+static const uint32_t gltfByte = 5120;
+static const uint32_t gltfUnsignedByte = 5121;
+static const uint32_t gltfShort = 5122;
+static const uint32_t gltfUnsignedShort = 5123;
+static const uint32_t gltfUnsignedInt = 5125;
+static const uint32_t gltfFloat = 5126;
+
+// Primitive mode drawn as a triangle list, the only one loaded
+static const uint32_t gltfTriangles = 4;
+
+// Animation channel target paths, morph target weights are not loaded
+static const uint32_t gltfTranslation = 0;
+static const uint32_t gltfRotation = 1;
+static const uint32_t gltfScale = 2;
+
+// Animation sampler interpolation
+static const uint32_t gltfLinear = 0;
+static const uint32_t gltfStep = 1;
+static const uint32_t gltfCubicSpline = 2;
+
+struct GltfBufferView
+{
+	uint32_t buffer;
+	size_t byteOffset;
+	size_t byteLength;
+	// 0 when the elements are tightly packed
+	size_t byteStride;
+};
+
+struct GltfAccessor
+{
+	// -1 when the accessor has no storage and reads as zeros
+	int bufferView;
+	size_t byteOffset;
+	uint32_t componentType;
+	uint32_t components;
+	bool normalized;
+	size_t count;
+	// From the accessor's min and max, which glTF requires for positions
+	bool hasBounds;
+	float boundsMin[3];
+	float boundsMax[3];
+
+	// Sparse accessors replace sparseCount elements of their base data, so they can never be read in place
+	uint32_t sparseCount;
+	uint32_t sparseIndicesView;
+	size_t sparseIndicesOffset;
+	uint32_t sparseIndicesType;
+	uint32_t sparseValuesView;
+	size_t sparseValuesOffset;
+};
+
+struct GltfPrimitive
+{
+	// Accessor indices, -1 when missing
+	int position;
+	int texCoord;
+	int indices;
+	int material;
+	uint32_t mode;
+	// Four joints (indices into the skin's joint list) and their weights per vertex
+	int joints;
+	int weights;
+};
+
+struct GltfMesh
+{
+	uint32_t firstPrimitive;
+	uint32_t primitiveCount;
+};
+
+struct GltfMaterial
+{
+	// Image of the base colour texture, -1 when untextured
+	int baseColorImage;
+	float alphaCutoff;
+};
+
+struct GltfImage
+{
+	// Encoded bytes in a buffer view, -1 for images referenced by uri
+	int bufferView;
+	// Absolute or relative to the working directory, empty for embedded images
+	std::string path;
+	std::string mimeType;
+};
+
+// A mesh placed by the scene, the node hierarchy is already flattened into one column-major matrix
+struct GltfInstance
+{
+	uint32_t mesh;
+	float transform[16];
+	// Skin deforming the mesh, -1 for rigid ones. Skinned meshes are placed by their joints instead of transform.
+	int skin;
+};
+
+// A node as authored, a matrix decomposed into translation, rotation (x, y, z, w) and scale
+struct GltfNode
+{
+	// -1 for nodes that are nobody's child
+	int parent;
+	float translation[3];
+	float rotation[4];
+	float scale[3];
+	// Column-major, every ancestor applied
+	float world[16];
+};
+
+struct GltfSkin
+{
+	// Node of each joint, in the order JOINTS_0 indexes them
+	std::vector<uint32_t> joints;
+	// Accessor of one MAT4 per joint, -1 when they are all identities
+	int inverseBindMatrices;
+};
+
+struct GltfChannel
+{
+	uint32_t node;
+	uint32_t path;
+	uint32_t interpolation;
+	// Accessors of the key times and values, cubic splines storing an in-tangent, value and out-tangent per key
+	uint32_t input;
+	uint32_t output;
+};
+
+struct GltfAnimation
+{
+	std::string name;
+	std::vector<GltfChannel> channels;
+};
+
+// A glTF 2.0 asset opened for reading in place. A .glb is mapped whole and its binary chunk used as buffer 0,
+// external .bin buffers are mapped too and only data uris are decoded into memory, so buffer views point
+// straight into the files. Knows nothing about GL, the converter shares it with GltfModel.
+class GltfFile
+{
+public:
+	GltfFile();
+
+	// .gltf or .glb, told apart by the binary header rather than the extension
+	bool Open(const char* fileLocation);
+	void Close();
+
+	const std::vector<GltfBufferView>& GetBufferViews() { return bufferViews; }
+	const std::vector<GltfAccessor>& GetAccessors() { return accessors; }
+	const std::vector<GltfPrimitive>& GetPrimitives() { return primitives; }
+	const std::vector<GltfMesh>& GetMeshes() { return meshes; }
+	const std::vector<GltfMaterial>& GetMaterials() { return materials; }
+	const std::vector<GltfImage>& GetImages() { return images; }
+	const std::vector<GltfInstance>& GetInstances() { return instances; }
+	const std::vector<GltfNode>& GetNodes() { return nodes; }
+	const std::vector<GltfSkin>& GetSkins() { return skins; }
+	const std::vector<GltfAnimation>& GetAnimations() { return animations; }
+
+	// Start of a buffer view inside its mapped or decoded buffer
+	const unsigned char* GetBufferViewData(uint32_t view);
+	// Encoded bytes of an embedded image, NULL for images stored in their own files
+	const unsigned char* GetImageData(uint32_t image, size_t& size);
+
+	// Bytes between consecutive elements of an accessor as stored
+	size_t GetElementStride(const GltfAccessor& accessor);
+
+	// Read an accessor as tightly packed floats whatever its storage, normalised integers are mapped to
+	// [0, 1] or [-1, 1] and sparse elements substituted. Components beyond the accessor's read as zero.
+	bool ReadFloats(uint32_t accessor, uint32_t components, std::vector<float>& values);
+	bool ReadIndices(uint32_t accessor, std::vector<uint32_t>& values);
+
+	// Interleaved x, y, z, u, v and 32-bit indices of one primitive, positions transformed and the texture
+	// coordinates flipped to the bottom-left origin the rest of the app uses. Appends to the vectors.
+	bool AppendPrimitive(uint32_t primitive, const float* transform, std::vector<float>& vertices, std::vector<uint32_t>& indices);
+
+	~GltfFile();
+
+private:
+	struct Buffer
+	{
+		const unsigned char* data;
+		size_t size;
+	};
+
+	std::vector<std::unique_ptr<MappedFile>> mappedFiles;
+	std::vector<std::vector<unsigned char>> decodedData;
+	std::vector<Buffer> buffers;
+	std::vector<GltfBufferView> bufferViews;
+	std::vector<GltfAccessor> accessors;
+	std::vector<GltfPrimitive> primitives;
+	std::vector<GltfMesh> meshes;
+	std::vector<GltfMaterial> materials;
+	std::vector<GltfImage> images;
+	// Data uri images, decoded here like buffers, index matching images
+	std::vector<int> imageData;
+	std::vector<GltfInstance> instances;
+	std::vector<GltfNode> nodes;
+	std::vector<GltfSkin> skins;
+	std::vector<GltfAnimation> animations;
+
+	bool LoadDocument(const JsonValue& document, const char* fileLocation, const unsigned char* binaryChunk, size_t binaryChunkSize);
+	bool LoadBuffers(const JsonValue& document, const std::string& directory, const unsigned char* binaryChunk, size_t binaryChunkSize);
+	bool LoadAccessors(const JsonValue& document);
+	void LoadMeshes(const JsonValue& document);
+	void LoadMaterials(const JsonValue& document, const std::string& directory);
+	bool LoadScene(const JsonValue& document);
+	void LoadNodes(const JsonValue& document);
+	void LoadSkins(const JsonValue& document);
+	void LoadAnimations(const JsonValue& document);
+
+	// Decode a base64 data uri into decodedData, returning its index or -1
+	int DecodeDataUri(const std::string& uri);
+	// Bounds check a run of count elements of elementSize bytes, stride apart, against a buffer view
+	bool CheckRange(int view, size_t byteOffset, size_t count, size_t stride, size_t elementSize);
+};
@@ -0,0 +1,369 @@
+#include "GltfModel.h"
+
+#include <stdio.h>
+#include <float.h>
+#include <algorithm>
+#include <chrono>
+
+#include <glm\gtc\type_ptr.hpp>
+
+GltfModel::GltfModel()
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		bounds[axis] = 0.0f;
+		bounds[3 + axis] = 0.0f;
+	}
+	bufferBytes = 0;
+}
+
+bool GltfModel::Load(const char* fileLocation, ResourceLoader* resourceLoader, TextureLoader* textureLoader, GltfLoadStats& stats)
+{
+	ClearModel();
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	stats.milliseconds = 0.0;
+	stats.directViews = 0;
+	stats.repackedAccessors = 0;
+	stats.primitives = 0;
+	stats.instances = 0;
+	stats.images = 0;
+	stats.bufferBytes = 0;
+
+	file = std::make_shared<GltfFile>();
+	if (!file->Open(fileLocation))
+	{
+		file.reset();
+		return false;
+	}
+
+	const std::vector<GltfBufferView>& views = file->GetBufferViews();
+	const std::vector<GltfAccessor>& accessors = file->GetAccessors();
+	const std::vector<GltfPrimitive>& primitives = file->GetPrimitives();
+
+	// GL buffer of every view that is drawn from, 0 until a primitive needs it
+	std::vector<GLuint> viewBuffers(views.size(), 0);
+	// Accessors that cannot be read in place, uploaded as tightly packed copies
+	std::shared_ptr<std::vector<std::vector<unsigned char>>> repacked = std::make_shared<std::vector<std::vector<unsigned char>>>();
+	std::vector<GLuint> repackedBuffers;
+
+	struct PendingMesh
+	{
+		std::vector<MeshAttribute> attributes;
+		GLuint indexBuffer;
+		GLenum indexType;
+		size_t indexOffset;
+		GLsizei count;
+	};
+	std::vector<PendingMesh> pending(primitives.size());
+	meshes.assign(primitives.size(), (Mesh*)NULL);
+
+	for (size_t p = 0; p < primitives.size(); p++)
+	{
+		const GltfPrimitive& primitive = primitives[p];
+		if (primitive.mode != gltfTriangles || primitive.position < 0)
+		{
+			continue;
+		}
+
+		// Vertices every attribute holds, nothing may be drawn or indexed past them
+		size_t vertexCount = accessors[primitive.position].count;
+		if (primitive.texCoord >= 0)
+		{
+			vertexCount = std::min(vertexCount, accessors[primitive.texCoord].count);
+		}
+
+		PendingMesh& mesh = pending[p];
+		mesh.count = (GLsizei)vertexCount;
+
+		// Shader locations 0 and 1, the same as every other mesh
+		int attributeAccessors[2] = { primitive.position, primitive.texCoord };
+		for (GLuint location = 0; location < 2; location++)
+		{
+			int index = attributeAccessors[location];
+			if (index < 0)
+			{
+				continue;
+			}
+
+			const GltfAccessor& accessor = accessors[index];
+			MeshAttribute attribute;
+			attribute.location = location;
+			attribute.size = (GLint)accessor.components;
+
+			if (accessor.bufferView >= 0 && accessor.sparseCount == 0)
+			{
+				// Any glTF vertex format is a valid GL one, so the view is bound as stored
+				if (viewBuffers[accessor.bufferView] == 0)
+				{
+					glGenBuffers(1, &viewBuffers[accessor.bufferView]);
+				}
+				attribute.buffer = viewBuffers[accessor.bufferView];
+				attribute.type = (GLenum)accessor.componentType;
+				attribute.normalized = accessor.normalized ? GL_TRUE : GL_FALSE;
+				attribute.stride = (GLsizei)views[accessor.bufferView].byteStride;
+				attribute.offset = accessor.byteOffset;
+			}
+			else
+			{
+				std::vector<float> values;
+				if (!file->ReadFloats((uint32_t)index, accessor.components, values) || values.empty())
+				{
+					continue;
+				}
+
+				repacked->push_back(std::vector<unsigned char>((unsigned char*)&values[0], (unsigned char*)(&values[0] + values.size())));
+				repackedBuffers.push_back(0);
+				glGenBuffers(1, &repackedBuffers.back());
+				stats.repackedAccessors++;
+
+				attribute.buffer = repackedBuffers.back();
+				attribute.type = GL_FLOAT;
+				attribute.normalized = GL_FALSE;
+				attribute.stride = 0;
+				attribute.offset = 0;
+			}
+			mesh.attributes.push_back(attribute);
+		}
+
+		mesh.indexBuffer = 0;
+		mesh.indexType = GL_UNSIGNED_INT;
+		mesh.indexOffset = 0;
+		if (primitive.indices >= 0)
+		{
+			const GltfAccessor& accessor = accessors[primitive.indices];
+			mesh.count = (GLsizei)accessor.count;
+
+			// Read once whichever way they are drawn, a malformed index would have the GPU read past the attributes
+			std::vector<uint32_t> values;
+			if (!file->ReadIndices((uint32_t)primitive.indices, values) || values.empty())
+			{
+				continue;
+			}
+			if (*std::max_element(values.begin(), values.end()) >= vertexCount)
+			{
+				printf("glTF primitive %u indexes past its %u vertices, skipped\n", (unsigned int)p, (unsigned int)vertexCount);
+				continue;
+			}
+
+			// Element buffers have no stride, interleaved indices have to be copied out
+			if (accessor.bufferView >= 0 && accessor.sparseCount == 0 && views[accessor.bufferView].byteStride == 0)
+			{
+				if (viewBuffers[accessor.bufferView] == 0)
+				{
+					glGenBuffers(1, &viewBuffers[accessor.bufferView]);
+				}
+				mesh.indexBuffer = viewBuffers[accessor.bufferView];
+				mesh.indexType = (GLenum)accessor.componentType;
+				mesh.indexOffset = accessor.byteOffset;
+			}
+			else
+			{
+				repacked->push_back(std::vector<unsigned char>((unsigned char*)&values[0], (unsigned char*)(&values[0] + values.size())));
+				repackedBuffers.push_back(0);
+				glGenBuffers(1, &repackedBuffers.back());
+				stats.repackedAccessors++;
+				mesh.indexBuffer = repackedBuffers.back();
+			}
+		}
+
+		meshes[p] = new Mesh();
+		stats.primitives++;
+	}
+
+	// Names were made here, the storage is filled on the loader's shared context straight from the mapped views
+	std::vector<uint32_t> uploadViews;
+	for (size_t i = 0; i < viewBuffers.size(); i++)
+	{
+		if (viewBuffers[i] != 0)
+		{
+			uploadViews.push_back((uint32_t)i);
+			buffers.push_back(viewBuffers[i]);
+			bufferBytes += views[i].byteLength;
+			stats.directViews++;
+		}
+	}
+	for (size_t i = 0; i < repackedBuffers.size(); i++)
+	{
+		buffers.push_back(repackedBuffers[i]);
+		bufferBytes += (*repacked)[i].size();
+	}
+
+	for (size_t p = 0; p < meshes.size(); p++)
+	{
+		if (meshes[p])
+		{
+			meshes[p]->CreateMesh(pending[p].attributes, pending[p].indexBuffer, pending[p].indexType, pending[p].indexOffset, pending[p].count, 1);
+		}
+	}
+
+	std::shared_ptr<GltfFile> source = file;
+	resourceLoader->Enqueue([source, uploadViews, viewBuffers, repacked, repackedBuffers]()
+	{
+		const std::vector<GltfBufferView>& views = source->GetBufferViews();
+		for (size_t i = 0; i < uploadViews.size(); i++)
+		{
+			uint32_t view = uploadViews[i];
+			glBindBuffer(GL_ARRAY_BUFFER, viewBuffers[view]);
+			glBufferData(GL_ARRAY_BUFFER, views[view].byteLength, source->GetBufferViewData(view), GL_STATIC_DRAW);
+		}
+		for (size_t i = 0; i < repackedBuffers.size(); i++)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, repackedBuffers[i]);
+			glBufferData(GL_ARRAY_BUFFER, (*repacked)[i].size(), &(*repacked)[i][0], GL_STATIC_DRAW);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	},
+	[this]()
+	{
+		for (size_t p = 0; p < meshes.size(); p++)
+		{
+			if (meshes[p])
+			{
+				meshes[p]->MarkUploaded();
+			}
+		}
+	});
+
+	// Only images some material samples are decoded, all of them in parallel on the worker pool
+	const std::vector<GltfImage>& images = file->GetImages();
+	const std::vector<GltfMaterial>& materials = file->GetMaterials();
+	textures.assign(images.size(), (Texture*)NULL);
+	for (size_t m = 0; m < materials.size(); m++)
+	{
+		int image = materials[m].baseColorImage;
+		if (image < 0 || textures[image])
+		{
+			continue;
+		}
+
+		size_t size;
+		const unsigned char* data = file->GetImageData((uint32_t)image, size);
+		std::shared_ptr<void> owner = file;
+		if (!data)
+		{
+			// Images in their own files are mapped too, the mapping lives until the worker has decoded it
+			std::shared_ptr<MappedFile> imageFile = std::make_shared<MappedFile>();
+			if (images[image].path.empty() || !imageFile->Open(images[image].path.c_str()))
+			{
+				printf("glTF image %d could not be loaded\n", image);
+				continue;
+			}
+			data = imageFile->GetData();
+			size = imageFile->GetSize();
+			owner = imageFile;
+		}
+
+		textures[image] = new Texture();
+		textures[image]->LoadFallback();
+		textureLoader->QueueTexture(textures[image], data, size, owner, true, materials[m].alphaCutoff, true);
+		stats.images++;
+	}
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		bounds[axis] = FLT_MAX;
+		bounds[3 + axis] = -FLT_MAX;
+	}
+
+	const std::vector<GltfInstance>& instances = file->GetInstances();
+	const std::vector<GltfMesh>& gltfMeshes = file->GetMeshes();
+	for (size_t i = 0; i < instances.size(); i++)
+	{
+		const GltfInstance& instance = instances[i];
+		const GltfMesh& mesh = gltfMeshes[instance.mesh];
+		glm::mat4 model = glm::make_mat4(instance.transform);
+
+		for (uint32_t p = mesh.firstPrimitive; p < mesh.firstPrimitive + mesh.primitiveCount; p++)
+		{
+			if (!meshes[p])
+			{
+				continue;
+			}
+
+			int material = primitives[p].material;
+			int image = material >= 0 ? file->GetMaterials()[material].baseColorImage : -1;
+
+			DrawItem item;
+			item.mesh = meshes[p];
+			item.texture = image >= 0 ? textures[image] : NULL;
+			item.model = model;
+			item.lodScale = 0.0f;
+			item.firstRange = -1;
+			item.rangeCount = 0;
+			drawItems.push_back(item);
+
+			// The corners of the position bounds, placed by the instance
+			const GltfAccessor& position = accessors[primitives[p].position];
+			if (!position.hasBounds)
+			{
+				continue;
+			}
+			for (int corner = 0; corner < 8; corner++)
+			{
+				glm::vec4 point(corner & 1 ? position.boundsMax[0] : position.boundsMin[0],
+					corner & 2 ? position.boundsMax[1] : position.boundsMin[1],
+					corner & 4 ? position.boundsMax[2] : position.boundsMin[2], 1.0f);
+				point = model * point;
+				for (int axis = 0; axis < 3; axis++)
+				{
+					bounds[axis] = point[axis] < bounds[axis] ? point[axis] : bounds[axis];
+					bounds[3 + axis] = point[axis] > bounds[3 + axis] ? point[axis] : bounds[3 + axis];
+				}
+			}
+		}
+	}
+
+	if (bounds[0] > bounds[3])
+	{
+		for (int axis = 0; axis < 6; axis++)
+		{
+			bounds[axis] = 0.0f;
+		}
+	}
+
+	stats.instances = (unsigned int)instances.size();
+	stats.bufferBytes = bufferBytes;
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return true;
+}
+
+void GltfModel::GetBounds(float* boundsMin, float* boundsMax)
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		boundsMin[axis] = bounds[axis];
+		boundsMax[axis] = bounds[3 + axis];
+	}
+}
+
+void GltfModel::ClearModel()
+{
+	drawItems.clear();
+
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		delete meshes[i];
+	}
+	meshes.clear();
+
+	for (size_t i = 0; i < textures.size(); i++)
+	{
+		delete textures[i];
+	}
+	textures.clear();
+
+	if (!buffers.empty())
+	{
+		glDeleteBuffers((GLsizei)buffers.size(), &buffers[0]);
+		buffers.clear();
+	}
+
+	file.reset();
+	bufferBytes = 0;
+}
+
+GltfModel::~GltfModel()
+{
+	ClearModel();
+}
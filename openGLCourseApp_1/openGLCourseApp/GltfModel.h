@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+
+#include <GL\glew.h>
+
+#include "GltfFile.h"
+#include "Mesh.h"
+#include "Texture.h"
+#include "FramePacket.h"
+#include "ResourceLoader.h"
+#include "TextureLoader.h"
+
+struct GltfLoadStats
+{
+	// Parsing and setup on the calling thread, uploads and decodes finish later
+	double milliseconds;
+	unsigned int directViews;
+	unsigned int repackedAccessors;
+	unsigned int primitives;
+	unsigned int instances;
+	unsigned int images;
+	size_t bufferBytes;
+};
+
+// A glTF scene drawn from its own buffer views. Every view holding vertex or index data becomes one GL
+// buffer filled on the loader thread straight from the mapped file, and each primitive's VAO points its
+// attributes at those views with the accessor's offset, stride and component type, so nothing is re-packed
+// unless an accessor is sparse or has no storage. Base colour images are decoded on the worker pool in
+// parallel and streamed through the texture loader.
+class GltfModel
+{
+public:
+	GltfModel();
+
+	// Main thread with the GL context current, the model draws as soon as the loader thread has filled its
+	// buffers and with fallback textures until the images arrive
+	bool Load(const char* fileLocation, ResourceLoader* resourceLoader, TextureLoader* textureLoader, GltfLoadStats& stats);
+
+	// One item per primitive of every mesh instance, models in the asset's space and textures NULL when untextured
+	const std::vector<DrawItem>& GetDrawItems() { return drawItems; }
+	// Of every instance in the asset's space
+	void GetBounds(float* boundsMin, float* boundsMax);
+
+	size_t GetMemoryUsage() { return bufferBytes; }
+
+	void ClearModel();
+
+	~GltfModel();
+
+private:
+	std::shared_ptr<GltfFile> file;
+	std::vector<GLuint> buffers;
+	// One per primitive, NULL for primitives that cannot be drawn
+	std::vector<Mesh*> meshes;
+	// One per image
+	std::vector<Texture*> textures;
+	std::vector<DrawItem> drawItems;
+	float bounds[6];
+	size_t bufferBytes;
+};
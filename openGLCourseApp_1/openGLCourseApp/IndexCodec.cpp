@@ -0,0 +1,173 @@
+#include "IndexCodec.h"
+
+#include <string.h>
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define INDEX_TARGET_SSSE3
+#else
+#define INDEX_TARGET_SSSE3 __attribute__((target("ssse3")))
+#endif
+
+// Zero bytes after the value bytes so the last group can still be loaded 16 bytes wide
+static const size_t indexCodecPadding = 16;
+
+struct GroupTables
+{
+	// Bytes of value data behind each control byte, and the shuffle spreading them into four 32-bit lanes
+	unsigned char length[256];
+	unsigned char shuffle[256][16];
+
+	GroupTables()
+	{
+		for (int control = 0; control < 256; control++)
+		{
+			int source = 0;
+			for (int lane = 0; lane < 4; lane++)
+			{
+				int bytes = ((control >> (lane * 2)) & 3) + 1;
+				for (int b = 0; b < 4; b++)
+				{
+					// 0x80 makes pshufb write a zero
+					shuffle[control][lane * 4 + b] = b < bytes ? (unsigned char)(source + b) : 0x80;
+				}
+				source += bytes;
+			}
+			length[control] = (unsigned char)source;
+		}
+	}
+};
+
+static const GroupTables& Tables()
+{
+	static const GroupTables tables;
+	return tables;
+}
+
+static inline uint32_t ZigzagEncode(int32_t value)
+{
+	return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline uint32_t ZigzagDecode(uint32_t value)
+{
+	return (value >> 1) ^ (0u - (value & 1));
+}
+
+void IndexCodec::EncodeIndices(const uint32_t* indices, size_t count, std::vector<unsigned char>& encoded)
+{
+	size_t controlBytes = (count + 3) / 4;
+	size_t controlStart = encoded.size();
+	encoded.resize(controlStart + controlBytes, 0);
+
+	uint32_t previous = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		uint32_t value = ZigzagEncode((int32_t)(indices[i] - previous));
+		previous = indices[i];
+
+		int bytes = value < (1u << 8) ? 1 : value < (1u << 16) ? 2 : value < (1u << 24) ? 3 : 4;
+		encoded[controlStart + i / 4] |= (unsigned char)((bytes - 1) << ((i % 4) * 2));
+		for (int b = 0; b < bytes; b++)
+		{
+			encoded.push_back((unsigned char)(value >> (b * 8)));
+		}
+	}
+
+	encoded.resize(encoded.size() + indexCodecPadding, 0);
+}
+
+INDEX_TARGET_SSSE3 static void DecodeGroupsSSSE3(const unsigned char* control, const unsigned char* data, uint32_t* indices, size_t groups, uint32_t& previous)
+{
+	const GroupTables& tables = Tables();
+	__m128i last = _mm_set1_epi32((int)previous);
+	const __m128i one = _mm_set1_epi32(1);
+	const __m128i zero = _mm_setzero_si128();
+
+	for (size_t g = 0; g < groups; g++)
+	{
+		unsigned char c = control[g];
+		__m128i values = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)data), _mm_loadu_si128((const __m128i*)tables.shuffle[c]));
+		data += tables.length[c];
+
+		// Zigzag back to signed differences, then a running sum across the lanes and from the last group
+		values = _mm_xor_si128(_mm_srli_epi32(values, 1), _mm_sub_epi32(zero, _mm_and_si128(values, one)));
+		values = _mm_add_epi32(values, _mm_slli_si128(values, 4));
+		values = _mm_add_epi32(values, _mm_slli_si128(values, 8));
+		values = _mm_add_epi32(values, last);
+
+		_mm_storeu_si128((__m128i*)(indices + g * 4), values);
+		last = _mm_shuffle_epi32(values, _MM_SHUFFLE(3, 3, 3, 3));
+	}
+
+	previous = (uint32_t)_mm_cvtsi128_si32(last);
+}
+
+bool IndexCodec::DecodeIndices(const unsigned char* encoded, size_t encodedSize, uint32_t* indices, size_t count)
+{
+	const GroupTables& tables = Tables();
+	size_t controlBytes = (count + 3) / 4;
+	if (encodedSize < controlBytes + indexCodecPadding)
+	{
+		return false;
+	}
+
+	// The control bytes give the exact data length, checked once so the loops need no bounds tests
+	size_t dataBytes = 0;
+	for (size_t i = 0; i < count / 4; i++)
+	{
+		dataBytes += tables.length[encoded[i]];
+	}
+	for (size_t i = count / 4 * 4; i < count; i++)
+	{
+		dataBytes += ((encoded[i / 4] >> ((i % 4) * 2)) & 3) + 1;
+	}
+	if (dataBytes > encodedSize - controlBytes - indexCodecPadding)
+	{
+		return false;
+	}
+
+	const unsigned char* control = encoded;
+	const unsigned char* data = encoded + controlBytes;
+	size_t groups = count / 4;
+	uint32_t previous = 0;
+
+	static const bool useSSSE3 = HasSSSE3();
+	size_t decoded = 0;
+	if (useSSSE3)
+	{
+		DecodeGroupsSSSE3(control, data, indices, groups, previous);
+		for (size_t g = 0; g < groups; g++)
+		{
+			data += tables.length[control[g]];
+		}
+		decoded = groups * 4;
+	}
+
+	for (size_t i = decoded; i < count; i++)
+	{
+		int bytes = ((control[i / 4] >> ((i % 4) * 2)) & 3) + 1;
+		uint32_t value = 0;
+		for (int b = 0; b < bytes; b++)
+		{
+			value |= (uint32_t)data[b] << (b * 8);
+		}
+		data += bytes;
+
+		previous += ZigzagDecode(value);
+		indices[i] = previous;
+	}
+	return true;
+}
+
+bool IndexCodec::HasSSSE3()
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	return (info[2] & (1 << 9)) != 0;
+#else
+	return __builtin_cpu_supports("ssse3");
+#endif
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Compressed index buffers for the mesh format. Each index is stored as the zigzagged difference from the
+// one before, in the Stream VByte layout (Lemire et al.): one control byte holds the byte lengths of four
+// values and the value bytes follow all the control bytes, so four indices decode with one shuffle. After
+// MeshOptimizer has renumbered the vertices most differences fit a single byte.
+class IndexCodec
+{
+public:
+	// Appends to encoded, including the padding the decoder needs to read 16 bytes at a time
+	static void EncodeIndices(const uint32_t* indices, size_t count, std::vector<unsigned char>& encoded);
+
+	// Fails without reading past encodedSize when the stream is shorter than count indices need
+	static bool DecodeIndices(const unsigned char* encoded, size_t encodedSize, uint32_t* indices, size_t count);
+
+	static bool HasSSSE3();
+};
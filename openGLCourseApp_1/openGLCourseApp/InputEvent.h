@@ -0,0 +1,20 @@
+#pragma once
+
+#include <GL\glew.h>
+
+enum InputEventType
+{
+	INPUT_KEY,
+	INPUT_MOUSE_MOVE
+};
+
+// Raw input as delivered by the GLFW callbacks, stamped with glfwGetTime() on arrival
+struct InputEvent
+{
+	InputEventType type;
+	int key;
+	int action;
+	GLfloat xChange;
+	GLfloat yChange;
+	double timestamp;
+};
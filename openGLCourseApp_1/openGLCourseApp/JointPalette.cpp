@@ -0,0 +1,81 @@
+#include "JointPalette.h"
+
+#include <stdio.h>
+
+JointPalette::JointPalette()
+{
+	buffer = 0;
+	texture = 0;
+	capacity = 0;
+}
+
+bool JointPalette::CreatePalette(size_t capacityTexels)
+{
+	ClearPalette();
+
+	GLint maxTexels = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+	capacity = maxTexels > 0 && capacityTexels > (size_t)maxTexels ? (size_t)maxTexels : capacityTexels;
+	if (capacity < capacityTexels)
+	{
+		printf("Joint palette limited to %u texels by the driver\n", (unsigned int)capacity);
+	}
+	if (capacity == 0)
+	{
+		return false;
+	}
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+	glBufferData(GL_TEXTURE_BUFFER, capacity * sizeof(glm::vec4), NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_BUFFER, texture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	return true;
+}
+
+size_t JointPalette::Upload(const glm::vec4* texels, size_t count)
+{
+	count = count < capacity ? count : capacity;
+	if (buffer == 0 || count == 0)
+	{
+		return 0;
+	}
+
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+	glBufferData(GL_TEXTURE_BUFFER, capacity * sizeof(glm::vec4), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_TEXTURE_BUFFER, 0, count * sizeof(glm::vec4), texels);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	return count;
+}
+
+void JointPalette::UsePalette(GLuint unit)
+{
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_BUFFER, texture);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void JointPalette::ClearPalette()
+{
+	if (texture != 0)
+	{
+		glDeleteTextures(1, &texture);
+		texture = 0;
+	}
+
+	if (buffer != 0)
+	{
+		glDeleteBuffers(1, &buffer);
+		buffer = 0;
+	}
+	capacity = 0;
+}
+
+JointPalette::~JointPalette()
+{
+	ClearPalette();
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <GL\glew.h>
+
+#include <glm\glm.hpp>
+
+// Skinning palettes of every character drawn in a frame, one RGBA32F texture buffer the vertex shader fetches
+// its joints from. A texture buffer rather than a uniform block because a crowd needs far more than the 64KB
+// a block is guaranteed, and one buffer lets a whole crowd share a single instanced draw.
+class JointPalette
+{
+public:
+	JointPalette();
+
+	// Context thread, room for capacityTexels texels, fewer if the driver's texture buffer limit is lower
+	bool CreatePalette(size_t capacityTexels);
+
+	// Render thread: replace the contents with count texels, orphaning the storage the last frame's draws may
+	// still be reading. Returns the texels kept, count clamped to the capacity.
+	size_t Upload(const glm::vec4* texels, size_t count);
+	void UsePalette(GLuint unit);
+
+	size_t GetCapacity() { return capacity; }
+	size_t GetMemoryUsage() { return capacity * sizeof(glm::vec4); }
+
+	void ClearPalette();
+
+	~JointPalette();
+
+private:
+	GLuint buffer;
+	GLuint texture;
+	size_t capacity;
+};
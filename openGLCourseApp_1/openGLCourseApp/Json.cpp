@@ -0,0 +1,453 @@
+#include "Json.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <limits.h>
+
+// Deeper documents are rejected rather than risking the stack, glTF never comes close
+static const unsigned int maxJsonDepth = 256;
+
+// Largest size AsSize accepts, every integer up to it is exact in a double and fits in a size_t
+static const double maxJsonSize = sizeof(size_t) >= 8 ? 9007199254740992.0 : 4294967295.0;
+
+static const JsonValue nullJsonValue;
+static const std::string emptyJsonString;
+
+class JsonParser
+{
+public:
+	JsonParser(const char* text, size_t length)
+	{
+		begin = text;
+		current = text;
+		end = text + length;
+		failed = false;
+	}
+
+	bool ParseDocument(JsonValue& root)
+	{
+		SkipWhitespace();
+		ParseValue(root, 0);
+		SkipWhitespace();
+		if (!failed && current != end)
+		{
+			Fail("trailing characters");
+		}
+		return !failed;
+	}
+
+private:
+	const char* begin;
+	const char* current;
+	const char* end;
+	bool failed;
+
+	void Fail(const char* message)
+	{
+		if (!failed)
+		{
+			printf("JSON error at byte %u: %s\n", (unsigned int)(current - begin), message);
+		}
+		failed = true;
+		current = end;
+	}
+
+	void SkipWhitespace()
+	{
+		while (current < end && (*current == ' ' || *current == '\t' || *current == '\n' || *current == '\r'))
+		{
+			current++;
+		}
+	}
+
+	bool Expect(char c)
+	{
+		SkipWhitespace();
+		if (current < end && *current == c)
+		{
+			current++;
+			return true;
+		}
+		return false;
+	}
+
+	bool Literal(const char* word)
+	{
+		const char* at = current;
+		for (; *word; word++, at++)
+		{
+			if (at >= end || *at != *word)
+			{
+				return false;
+			}
+		}
+		current = at;
+		return true;
+	}
+
+	void ParseValue(JsonValue& value, unsigned int depth)
+	{
+		if (depth > maxJsonDepth)
+		{
+			Fail("nested too deeply");
+			return;
+		}
+
+		SkipWhitespace();
+		if (current >= end)
+		{
+			Fail("unexpected end");
+			return;
+		}
+
+		switch (*current)
+		{
+		case '{':
+			ParseObject(value, depth);
+			break;
+		case '[':
+			ParseArray(value, depth);
+			break;
+		case '"':
+			value.type = JSON_STRING;
+			ParseString(value.text);
+			break;
+		case 't':
+		case 'f':
+			value.type = JSON_BOOL;
+			value.boolean = *current == 't';
+			if (!Literal(value.boolean ? "true" : "false"))
+			{
+				Fail("invalid literal");
+			}
+			break;
+		case 'n':
+			value.type = JSON_NULL;
+			if (!Literal("null"))
+			{
+				Fail("invalid literal");
+			}
+			break;
+		default:
+			value.type = JSON_NUMBER;
+			ParseNumber(value.number);
+			break;
+		}
+	}
+
+	void ParseObject(JsonValue& value, unsigned int depth)
+	{
+		value.type = JSON_OBJECT;
+		current++;
+		if (Expect('}'))
+		{
+			return;
+		}
+
+		do
+		{
+			SkipWhitespace();
+			if (current >= end || *current != '"')
+			{
+				Fail("expected a member name");
+				return;
+			}
+
+			value.keys.push_back(std::string());
+			ParseString(value.keys.back());
+			if (!Expect(':'))
+			{
+				Fail("expected ':'");
+				return;
+			}
+
+			value.elements.push_back(JsonValue());
+			ParseValue(value.elements.back(), depth + 1);
+		} while (!failed && Expect(','));
+
+		if (!failed && !Expect('}'))
+		{
+			Fail("expected ',' or '}'");
+		}
+	}
+
+	void ParseArray(JsonValue& value, unsigned int depth)
+	{
+		value.type = JSON_ARRAY;
+		current++;
+		if (Expect(']'))
+		{
+			return;
+		}
+
+		do
+		{
+			value.elements.push_back(JsonValue());
+			ParseValue(value.elements.back(), depth + 1);
+		} while (!failed && Expect(','));
+
+		if (!failed && !Expect(']'))
+		{
+			Fail("expected ',' or ']'");
+		}
+	}
+
+	unsigned int ParseHex4()
+	{
+		if (end - current < 4)
+		{
+			Fail("truncated escape");
+			return 0;
+		}
+
+		unsigned int code = 0;
+		for (int i = 0; i < 4; i++, current++)
+		{
+			char c = *current;
+			unsigned int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : 16;
+			if (digit == 16)
+			{
+				Fail("invalid escape");
+				return 0;
+			}
+			code = code * 16 + digit;
+		}
+		return code;
+	}
+
+	void AppendUtf8(std::string& out, unsigned int code)
+	{
+		if (code < 0x80)
+		{
+			out += (char)code;
+		}
+		else if (code < 0x800)
+		{
+			out += (char)(0xC0 | (code >> 6));
+			out += (char)(0x80 | (code & 0x3F));
+		}
+		else if (code < 0x10000)
+		{
+			out += (char)(0xE0 | (code >> 12));
+			out += (char)(0x80 | ((code >> 6) & 0x3F));
+			out += (char)(0x80 | (code & 0x3F));
+		}
+		else
+		{
+			out += (char)(0xF0 | (code >> 18));
+			out += (char)(0x80 | ((code >> 12) & 0x3F));
+			out += (char)(0x80 | ((code >> 6) & 0x3F));
+			out += (char)(0x80 | (code & 0x3F));
+		}
+	}
+
+	void ParseString(std::string& out)
+	{
+		current++;
+		while (current < end && *current != '"')
+		{
+			// Runs without escapes, which is nearly every glTF string, are appended in one go
+			const char* run = current;
+			while (current < end && *current != '"' && *current != '\\')
+			{
+				current++;
+			}
+			out.append(run, current - run);
+
+			if (current < end && *current == '\\')
+			{
+				current++;
+				if (current >= end)
+				{
+					break;
+				}
+
+				char escape = *current++;
+				switch (escape)
+				{
+				case '"': out += '"'; break;
+				case '\\': out += '\\'; break;
+				case '/': out += '/'; break;
+				case 'b': out += '\b'; break;
+				case 'f': out += '\f'; break;
+				case 'n': out += '\n'; break;
+				case 'r': out += '\r'; break;
+				case 't': out += '\t'; break;
+				case 'u':
+				{
+					unsigned int code = ParseHex4();
+					// A surrogate pair spells one code point outside the basic plane
+					if (code >= 0xD800 && code < 0xDC00 && end - current >= 6 && current[0] == '\\' && current[1] == 'u')
+					{
+						current += 2;
+						unsigned int low = ParseHex4();
+						code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+					}
+					AppendUtf8(out, code);
+					break;
+				}
+				default:
+					Fail("invalid escape");
+					return;
+				}
+			}
+		}
+
+		if (current >= end)
+		{
+			Fail("unterminated string");
+			return;
+		}
+		current++;
+	}
+
+	void ParseNumber(double& number)
+	{
+		// Locale independent: the integer digits are exact up to 2^53, which covers every glTF offset
+		const char* start = current;
+		bool negative = current < end && *current == '-';
+		if (negative)
+		{
+			current++;
+		}
+
+		double mantissa = 0.0;
+		int exponent = 0;
+		bool digits = false;
+		for (; current < end && *current >= '0' && *current <= '9'; current++)
+		{
+			mantissa = mantissa * 10.0 + (*current - '0');
+			digits = true;
+		}
+
+		if (current < end && *current == '.')
+		{
+			current++;
+			for (; current < end && *current >= '0' && *current <= '9'; current++)
+			{
+				mantissa = mantissa * 10.0 + (*current - '0');
+				exponent--;
+				digits = true;
+			}
+		}
+
+		if (!digits)
+		{
+			current = start;
+			Fail("invalid value");
+			return;
+		}
+
+		if (current < end && (*current == 'e' || *current == 'E'))
+		{
+			current++;
+			bool negativeExponent = current < end && *current == '-';
+			if (current < end && (*current == '-' || *current == '+'))
+			{
+				current++;
+			}
+
+			int value = 0;
+			for (; current < end && *current >= '0' && *current <= '9'; current++)
+			{
+				value = value < 10000 ? value * 10 + (*current - '0') : value;
+			}
+			exponent += negativeExponent ? -value : value;
+		}
+
+		// Dividing by an exact power of ten keeps short decimals such as 0.1 correctly rounded
+		number = exponent >= 0 ? mantissa * pow(10.0, exponent) : mantissa / pow(10.0, -exponent);
+		number = negative ? -number : number;
+	}
+};
+
+JsonValue::JsonValue()
+{
+	type = JSON_NULL;
+	boolean = false;
+	number = 0.0;
+}
+
+bool JsonValue::Parse(const char* text, size_t length, JsonValue& root)
+{
+	root = JsonValue();
+	JsonParser parser(text, length);
+	return parser.ParseDocument(root);
+}
+
+bool JsonValue::AsBool(bool fallback) const
+{
+	return type == JSON_BOOL ? boolean : fallback;
+}
+
+double JsonValue::AsNumber(double fallback) const
+{
+	return type == JSON_NUMBER ? number : fallback;
+}
+
+int JsonValue::AsInt(int fallback) const
+{
+	// NaN fails both comparisons, so it falls back along with numbers out of range
+	if (type != JSON_NUMBER || !(number >= (double)INT_MIN && number <= (double)INT_MAX))
+	{
+		return fallback;
+	}
+	return (int)number;
+}
+
+bool JsonValue::AsSize(size_t fallback, size_t& value) const
+{
+	if (type == JSON_NULL)
+	{
+		value = fallback;
+		return true;
+	}
+
+	// NaN fails the range check like negative and oversized numbers do
+	if (type != JSON_NUMBER || !(number >= 0.0 && number <= maxJsonSize) || floor(number) != number)
+	{
+		return false;
+	}
+	value = (size_t)number;
+	return true;
+}
+
+const std::string& JsonValue::AsString() const
+{
+	return type == JSON_STRING ? text : emptyJsonString;
+}
+
+size_t JsonValue::GetSize() const
+{
+	return type == JSON_ARRAY || type == JSON_OBJECT ? elements.size() : 0;
+}
+
+const JsonValue& JsonValue::GetElement(size_t index) const
+{
+	return index < GetSize() ? elements[index] : nullJsonValue;
+}
+
+const JsonValue& JsonValue::GetMember(const char* key) const
+{
+	if (type == JSON_OBJECT)
+	{
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			if (keys[i] == key)
+			{
+				return elements[i];
+			}
+		}
+	}
+	return nullJsonValue;
+}
+
+bool JsonValue::Has(const char* key) const
+{
+	return !GetMember(key).IsNull();
+}
+
+const std::string& JsonValue::GetKey(size_t index) const
+{
+	return type == JSON_OBJECT && index < keys.size() ? keys[index] : emptyJsonString;
+}
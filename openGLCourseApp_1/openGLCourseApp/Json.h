@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+enum JsonType
+{
+	JSON_NULL,
+	JSON_BOOL,
+	JSON_NUMBER,
+	JSON_STRING,
+	JSON_ARRAY,
+	JSON_OBJECT
+};
+
+// A parsed JSON document, just enough for the glTF loader. Lookups of missing keys or indices return a
+// null value instead of failing, so optional properties read as their fallback.
+class JsonValue
+{
+public:
+	JsonValue();
+
+	// The whole text must be one value, errors are printed with their byte offset
+	static bool Parse(const char* text, size_t length, JsonValue& root);
+
+	JsonType GetType() const { return type; }
+	bool IsNull() const { return type == JSON_NULL; }
+
+	bool AsBool(bool fallback) const;
+	double AsNumber(double fallback) const;
+	int AsInt(int fallback) const;
+	// A count or byte offset: fallback when the value is null or missing, false for anything but a
+	// non-negative integral number that a size_t holds exactly
+	bool AsSize(size_t fallback, size_t& value) const;
+	// Empty unless the value is a string
+	const std::string& AsString() const;
+
+	// Elements of an array or members of an object
+	size_t GetSize() const;
+	const JsonValue& GetElement(size_t index) const;
+	const JsonValue& GetMember(const char* key) const;
+	bool Has(const char* key) const;
+	// Name of an object's member, in document order
+	const std::string& GetKey(size_t index) const;
+
+private:
+	JsonType type;
+	bool boolean;
+	double number;
+	std::string text;
+	std::vector<JsonValue> elements;
+	std::vector<std::string> keys;
+
+	friend class JsonParser;
+};
@@ -0,0 +1,132 @@
+#include "MappedFile.h"
+
+#include <stdio.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+	data = NULL;
+	size = 0;
+
+#ifdef _WIN32
+	fileHandle = NULL;
+	mappingHandle = NULL;
+#else
+	fileDescriptor = -1;
+#endif
+}
+
+bool MappedFile::Open(const char* fileLocation)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(fileLocation, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		printf("Failed to open %s\n", fileLocation);
+		return false;
+	}
+	fileHandle = file;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		printf("Failed to map %s, the file is empty\n", fileLocation);
+		Close();
+		return false;
+	}
+
+	mappingHandle = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mappingHandle)
+	{
+		printf("Failed to map %s\n", fileLocation);
+		Close();
+		return false;
+	}
+
+	data = (const unsigned char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	size = (size_t)fileSize.QuadPart;
+#else
+	fileDescriptor = open(fileLocation, O_RDONLY);
+	if (fileDescriptor < 0)
+	{
+		printf("Failed to open %s\n", fileLocation);
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(fileDescriptor, &info) != 0 || info.st_size == 0)
+	{
+		printf("Failed to map %s, the file is empty\n", fileLocation);
+		Close();
+		return false;
+	}
+
+	void* mapping = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	data = mapping != MAP_FAILED ? (const unsigned char*)mapping : NULL;
+	size = (size_t)info.st_size;
+
+	// Files are mostly read front to back, let the OS read ahead
+	if (data)
+	{
+		madvise(mapping, size, MADV_SEQUENTIAL);
+	}
+#endif
+
+	if (!data)
+	{
+		printf("Failed to map %s\n", fileLocation);
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (data)
+	{
+		UnmapViewOfFile(data);
+	}
+	if (mappingHandle)
+	{
+		CloseHandle(mappingHandle);
+		mappingHandle = NULL;
+	}
+	if (fileHandle)
+	{
+		CloseHandle(fileHandle);
+		fileHandle = NULL;
+	}
+#else
+	if (data)
+	{
+		munmap((void*)data, size);
+	}
+	if (fileDescriptor >= 0)
+	{
+		close(fileDescriptor);
+		fileDescriptor = -1;
+	}
+#endif
+
+	data = NULL;
+	size = 0;
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
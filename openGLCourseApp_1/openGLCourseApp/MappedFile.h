@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stddef.h>
+
+// A read-only view of a whole file mapped into memory, pages are read in by the OS as they are touched
+class MappedFile
+{
+public:
+	MappedFile();
+
+	bool Open(const char* fileLocation);
+	void Close();
+
+	const unsigned char* GetData() { return data; }
+	size_t GetSize() { return size; }
+
+	~MappedFile();
+
+private:
+	const unsigned char* data;
+	size_t size;
+
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+
+	// Owns the mapping
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+};
@@ -1,71 +1,699 @@
-#include "Mesh.h"
-
-Mesh::Mesh()
-{
-	VAO = 0;
-	VBO = 0;
-	IBO = 0;
-	indexCount = 0;
-}
-
-void Mesh::CreateMesh(GLfloat *vertices, unsigned int *indices, unsigned int numOfVertices, unsigned int numOfIndices)
-{
-	indexCount = numOfIndices;
-
-	glGenVertexArrays(1, &VAO);
-	glBindVertexArray(VAO);
-
-	glGenBuffers(1, &IBO);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices[0]) * numOfIndices, indices, GL_STATIC_DRAW);
-
-	glGenBuffers(1, &VBO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices[0]) * numOfVertices, vertices, GL_STATIC_DRAW);
-
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-	glEnableVertexAttribArray(0);
-
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-	glBindVertexArray(0);
-}
-
-void Mesh::RenderMesh()
-{
-	glBindVertexArray(VAO);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
-	glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
-}
-
-void Mesh::ClearMesh()
-{
-	if (IBO != 0)
-	{
-		glDeleteBuffers(1, &IBO);
-		IBO = 0;
-	}
-
-	if (VBO != 0)
-	{
-		glDeleteBuffers(1, &VBO);
-		VBO = 0;
-	}
-
-	if (VAO != 0)
-	{
-		glDeleteVertexArrays(1, &VAO);
-		VAO = 0;
-	}
-
-	indexCount = 0;
-}
-
-
-Mesh::~Mesh()
-{
-	ClearMesh();
-}
+#include "Mesh.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#include <memory>
+
+#include "UploadQueue.h"
+#include "ResourceLoader.h"
+#include "MeshFile.h"
+#include "VertexQuantizer.h"
+#include "FramePacket.h"
+
+// Draws a 16-bit mesh may be split into before its indices are kept at 32 bits instead
+static const size_t maxIndexSubmeshes = 16;
+
+Mesh::Mesh()
+{
+	VAO = 0;
+	VBO = 0;
+	IBO = 0;
+	indexCount = 0;
+	indexType = GL_UNSIGNED_INT;
+	indexOffset = 0;
+	ownsBuffers = true;
+	SetQuantized(false, NULL, NULL);
+	skinned = false;
+	bufferBytes = 0;
+	pendingUploads = 0;
+}
+
+void Mesh::CreateMesh(GLfloat *vertices, unsigned int *indices, unsigned int numOfVertices, unsigned int numOfIndices)
+{
+	indexCount = numOfIndices;
+	std::vector<unsigned char> shortIndices;
+	bool packed = PackIndices(indices, numOfIndices, shortIndices);
+	size_t indexBytes = packed ? shortIndices.size() : sizeof(indices[0]) * numOfIndices;
+	bufferBytes = indexBytes + sizeof(vertices[0]) * numOfVertices;
+
+	glGenVertexArrays(1, &VAO);
+	glBindVertexArray(VAO);
+
+	glGenBuffers(1, &IBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, packed ? (const void*)&shortIndices[0] : indices, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &VBO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices[0]) * numOfVertices, vertices, GL_STATIC_DRAW);
+
+	CreateVertexArray();
+}
+
+void Mesh::CreateMesh(GLfloat *vertices, unsigned int *indices, unsigned int numOfVertices, unsigned int numOfIndices, UploadQueue* uploadQueue)
+{
+	indexCount = numOfIndices;
+	std::vector<unsigned char> indexData;
+	if (!PackIndices(indices, numOfIndices, indexData))
+	{
+		indexData.assign((unsigned char*)indices, (unsigned char*)(indices + numOfIndices));
+	}
+	bufferBytes = indexData.size() + sizeof(vertices[0]) * numOfVertices;
+
+	glGenVertexArrays(1, &VAO);
+	glBindVertexArray(VAO);
+
+	glGenBuffers(1, &IBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexData.size(), NULL, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &VBO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices[0]) * numOfVertices, NULL, GL_STATIC_DRAW);
+
+	CreateVertexArray();
+
+	// Completion callbacks run on the thread processing the queue, which is the one rendering
+	pendingUploads = 2;
+
+	uploadQueue->QueueBufferUpload(IBO, 0, indexData, [this]() { pendingUploads--; });
+
+	std::vector<unsigned char> vertexData((unsigned char*)vertices, (unsigned char*)(vertices + numOfVertices));
+	uploadQueue->QueueBufferUpload(VBO, 0, vertexData, [this]() { pendingUploads--; });
+}
+
+void Mesh::CreateMesh(GLfloat *vertices, unsigned int *indices, unsigned int numOfVertices, unsigned int numOfIndices, ResourceLoader* resourceLoader)
+{
+	indexCount = numOfIndices;
+	pendingUploads = 1;
+
+	std::shared_ptr<std::vector<GLfloat>> vertexData = std::make_shared<std::vector<GLfloat>>(vertices, vertices + numOfVertices);
+	std::shared_ptr<std::vector<unsigned char>> indexData = std::make_shared<std::vector<unsigned char>>();
+	if (!PackIndices(indices, numOfIndices, *indexData))
+	{
+		indexData->assign((unsigned char*)indices, (unsigned char*)(indices + numOfIndices));
+	}
+	bufferBytes = indexData->size() + sizeof(GLfloat) * numOfVertices;
+
+	resourceLoader->Enqueue([this, vertexData, indexData]()
+	{
+		glGenBuffers(1, &IBO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexData->size(), &(*indexData)[0], GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+		glGenBuffers(1, &VBO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * vertexData->size(), &(*vertexData)[0], GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	},
+	[this]() { pendingUploads--; });
+}
+
+void Mesh::CreateMesh(const QuantizedVertex* vertices, const float* boundsMin, const float* boundsMax, unsigned int *indices, unsigned int vertexCount, unsigned int numOfIndices, ResourceLoader* resourceLoader)
+{
+	indexCount = numOfIndices;
+	SetQuantized(true, boundsMin, boundsMax);
+	pendingUploads = 1;
+
+	std::shared_ptr<std::vector<QuantizedVertex>> vertexData = std::make_shared<std::vector<QuantizedVertex>>(vertices, vertices + vertexCount);
+	std::shared_ptr<std::vector<unsigned char>> indexData = std::make_shared<std::vector<unsigned char>>();
+	if (!PackIndices(indices, numOfIndices, *indexData))
+	{
+		indexData->assign((unsigned char*)indices, (unsigned char*)(indices + numOfIndices));
+	}
+	bufferBytes = indexData->size() + sizeof(QuantizedVertex) * vertexCount;
+
+	resourceLoader->Enqueue([this, vertexData, indexData]()
+	{
+		glGenBuffers(1, &IBO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexData->size(), &(*indexData)[0], GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+		glGenBuffers(1, &VBO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(QuantizedVertex) * vertexData->size(), &(*vertexData)[0], GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	},
+	[this]() { pendingUploads--; });
+}
+
+void Mesh::CreateMesh(const SkinnedVertex* vertices, unsigned int *indices, unsigned int vertexCount, unsigned int numOfIndices, ResourceLoader* resourceLoader)
+{
+	indexCount = numOfIndices;
+	skinned = true;
+	pendingUploads = 1;
+
+	std::shared_ptr<std::vector<SkinnedVertex>> vertexData = std::make_shared<std::vector<SkinnedVertex>>(vertices, vertices + vertexCount);
+	std::shared_ptr<std::vector<unsigned char>> indexData = std::make_shared<std::vector<unsigned char>>();
+	if (!PackIndices(indices, numOfIndices, *indexData))
+	{
+		indexData->assign((unsigned char*)indices, (unsigned char*)(indices + numOfIndices));
+	}
+	bufferBytes = indexData->size() + sizeof(SkinnedVertex) * vertexCount;
+
+	resourceLoader->Enqueue([this, vertexData, indexData]()
+	{
+		glGenBuffers(1, &IBO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexData->size(), &(*indexData)[0], GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+		glGenBuffers(1, &VBO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(SkinnedVertex) * vertexData->size(), &(*vertexData)[0], GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	},
+	[this]() { pendingUploads--; });
+}
+
+void Mesh::CreateMesh(std::shared_ptr<MeshFile> meshFile, UploadQueue* uploadQueue)
+{
+	const MeshFileHeader& header = meshFile->GetHeader();
+	size_t vertexBytes = (size_t)header.vertexStride * header.vertexCount;
+	indexCount = header.indexCount;
+	SetQuantized(header.vertexFormat == MESH_VERTEX_QUANTIZED_POSITION_UV, header.boundsMin, header.boundsMax);
+	uint32_t lodCount;
+	const MeshFileLod* fileLods = meshFile->GetLods(lodCount);
+	SetLods(fileLods, fileLods ? lodCount : 0);
+
+	// Compressed indices are decoded here, plain ones are only copied when they shrink to 16 bits
+	std::vector<uint32_t> decodedIndices;
+	const uint32_t* indices = meshFile->GetIndices();
+	if (!indices)
+	{
+		if (!meshFile->ReadIndices(decodedIndices) || decodedIndices.empty())
+		{
+			printf("Mesh indices could not be decoded\n");
+			indexCount = 0;
+			return;
+		}
+		indices = &decodedIndices[0];
+	}
+
+	std::vector<unsigned char> indexData;
+	bool packed = PackIndices(indices, header.indexCount, indexData);
+	if (!packed && !decodedIndices.empty())
+	{
+		indexData.assign((unsigned char*)indices, (unsigned char*)(indices + header.indexCount));
+	}
+	size_t indexBytes = indexData.empty() ? sizeof(uint32_t) * header.indexCount : indexData.size();
+	bufferBytes = indexBytes + vertexBytes;
+
+	glGenVertexArrays(1, &VAO);
+	glBindVertexArray(VAO);
+
+	glGenBuffers(1, &IBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, NULL, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &VBO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, vertexBytes, NULL, GL_STATIC_DRAW);
+
+	CreateVertexArray();
+
+	// The staging copies read the mapped pages, no intermediate copy is made
+	pendingUploads = 2;
+	if (indexData.empty())
+	{
+		uploadQueue->QueueBufferUpload(IBO, 0, indices, indexBytes, meshFile, [this]() { pendingUploads--; });
+	}
+	else
+	{
+		uploadQueue->QueueBufferUpload(IBO, 0, indexData, [this]() { pendingUploads--; });
+	}
+	uploadQueue->QueueBufferUpload(VBO, 0, meshFile->GetVertexData(), vertexBytes, meshFile, [this]() { pendingUploads--; });
+}
+
+void Mesh::CreateMesh(std::shared_ptr<MeshFile> meshFile, std::shared_ptr<const std::vector<uint32_t>> readIndices, ResourceLoader* resourceLoader)
+{
+	const MeshFileHeader& header = meshFile->GetHeader();
+	indexCount = header.indexCount;
+	SetQuantized(header.vertexFormat == MESH_VERTEX_QUANTIZED_POSITION_UV, header.boundsMin, header.boundsMax);
+	uint32_t lodCount;
+	const MeshFileLod* fileLods = meshFile->GetLods(lodCount);
+	SetLods(fileLods, fileLods ? lodCount : 0);
+	bufferBytes = sizeof(uint32_t) * header.indexCount + (size_t)header.vertexStride * header.vertexCount;
+	pendingUploads = 1;
+
+	// glBufferData reads the mapped pages on the loader thread, the capture keeps the file mapped until then.
+	// Decoding and 16-bit packing happen there too, nothing draws the mesh before onReady.
+	std::shared_ptr<size_t> uploadedBytes = std::make_shared<size_t>(bufferBytes);
+	resourceLoader->Enqueue([this, meshFile, readIndices, uploadedBytes]()
+	{
+		const MeshFileHeader& header = meshFile->GetHeader();
+
+		std::vector<uint32_t> decodedIndices;
+		const uint32_t* indices = readIndices && readIndices->size() == header.indexCount ? &(*readIndices)[0] : meshFile->GetIndices();
+		if (!indices)
+		{
+			if (!meshFile->ReadIndices(decodedIndices) || decodedIndices.empty())
+			{
+				printf("Mesh indices could not be decoded\n");
+				indexCount = 0;
+				*uploadedBytes = 0;
+				return;
+			}
+			indices = &decodedIndices[0];
+		}
+
+		std::vector<unsigned char> shortIndices;
+		bool packed = PackIndices(indices, header.indexCount, shortIndices);
+		size_t indexBytes = packed ? shortIndices.size() : sizeof(uint32_t) * header.indexCount;
+		*uploadedBytes = indexBytes + (size_t)header.vertexStride * header.vertexCount;
+
+		glGenBuffers(1, &IBO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, packed ? (const void*)&shortIndices[0] : indices, GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+		glGenBuffers(1, &VBO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)header.vertexStride * header.vertexCount, meshFile->GetVertexData(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	},
+	[this, uploadedBytes]()
+	{
+		bufferBytes = *uploadedBytes;
+		pendingUploads--;
+	});
+}
+
+bool Mesh::PackIndices(const unsigned int* indices, size_t count, std::vector<unsigned char>& packed)
+{
+	// Levels from SetLods, or the whole buffer as the only one when they do not fit inside it
+	std::vector<MeshFileLod> ranges;
+	for (size_t l = 0; l < lodRanges.size(); l++)
+	{
+		if (lodRanges[l].firstIndex > count || lodRanges[l].indexCount > count - lodRanges[l].firstIndex)
+		{
+			ranges.clear();
+			break;
+		}
+		ranges.push_back(lodRanges[l]);
+	}
+	if (ranges.empty())
+	{
+		MeshFileLod whole = { 0, (uint32_t)count, 0.0f, 0 };
+		ranges.push_back(whole);
+	}
+
+	// Split each level wherever a triangle would take the run's vertex range past 16 bits. After MeshOptimizer
+	// has renumbered the vertices in use order the runs are long, anything needing more draws stays 32-bit.
+	submeshes.clear();
+	lods.clear();
+	packed.clear();
+	bool fits = true;
+	for (size_t l = 0; l < ranges.size() && fits; l++)
+	{
+		const unsigned int* levelIndices = indices + ranges[l].firstIndex;
+		size_t triangleIndices = ranges[l].indexCount - ranges[l].indexCount % 3;
+		Lod lod = { ranges[l].error, submeshes.size(), 0 };
+
+		size_t runStart = 0;
+		unsigned int low = 0xFFFFFFFFu, high = 0;
+		for (size_t i = 0; i <= triangleIndices && fits; i += 3)
+		{
+			unsigned int triangleLow = 0, triangleHigh = 0;
+			if (i < triangleIndices)
+			{
+				triangleLow = levelIndices[i];
+				triangleHigh = levelIndices[i];
+				for (int corner = 1; corner < 3; corner++)
+				{
+					triangleLow = levelIndices[i + corner] < triangleLow ? levelIndices[i + corner] : triangleLow;
+					triangleHigh = levelIndices[i + corner] > triangleHigh ? levelIndices[i + corner] : triangleHigh;
+				}
+				fits = triangleHigh - triangleLow <= 0xFFFF;
+			}
+
+			unsigned int newLow = triangleLow < low ? triangleLow : low;
+			unsigned int newHigh = triangleHigh > high ? triangleHigh : high;
+			if ((i == triangleIndices || newHigh - newLow > 0xFFFF) && i > runStart)
+			{
+				Submesh run = { (GLsizei)(i - runStart), packed.size(), (GLint)low };
+				packed.resize(packed.size() + (i - runStart) * sizeof(uint16_t));
+				uint16_t* output = (uint16_t*)&packed[run.indexOffset];
+				for (size_t k = runStart; k < i; k++)
+				{
+					*output++ = (uint16_t)(levelIndices[k] - low);
+				}
+				submeshes.push_back(run);
+				lod.submeshCount++;
+				fits = fits && lod.submeshCount <= maxIndexSubmeshes;
+
+				runStart = i;
+				newLow = triangleLow;
+				newHigh = triangleHigh;
+			}
+			low = newLow;
+			high = newHigh;
+		}
+		lods.push_back(lod);
+	}
+
+	if (fits && !packed.empty())
+	{
+		indexType = GL_UNSIGNED_SHORT;
+		indexCount = (GLsizei)(packed.size() / sizeof(uint16_t));
+		return true;
+	}
+
+	// One 32-bit draw per level straight from the original indices
+	packed.clear();
+	submeshes.clear();
+	lods.clear();
+	for (size_t l = 0; l < ranges.size(); l++)
+	{
+		Submesh draw = { (GLsizei)(ranges[l].indexCount - ranges[l].indexCount % 3), ranges[l].firstIndex * sizeof(uint32_t), 0 };
+		Lod lod = { ranges[l].error, submeshes.size(), 1 };
+		submeshes.push_back(draw);
+		lods.push_back(lod);
+	}
+	indexType = GL_UNSIGNED_INT;
+	return false;
+}
+
+void Mesh::SetLods(const MeshFileLod* meshLods, unsigned int lodCount)
+{
+	lodRanges.assign(meshLods, meshLods + lodCount);
+}
+
+unsigned int Mesh::SelectLod(float pixelsPerUnit, float maxPixelError)
+{
+	if (pendingUploads > 0)
+	{
+		return 0;
+	}
+
+	// The coarsest level whose error stays under the limit once projected
+	for (size_t l = lods.size(); l-- > 1; )
+	{
+		if (lods[l].error * pixelsPerUnit <= maxPixelError)
+		{
+			return (unsigned int)l;
+		}
+	}
+	return 0;
+}
+
+void Mesh::CreateMesh(const std::vector<MeshAttribute>& meshAttributes, GLuint indexBuffer, GLenum meshIndexType, size_t meshIndexOffset, GLsizei count, unsigned int pendingCount)
+{
+	attributes = meshAttributes;
+	IBO = indexBuffer;
+	indexType = meshIndexType;
+	indexOffset = meshIndexOffset;
+	indexCount = count;
+	ownsBuffers = false;
+	pendingUploads = pendingCount;
+}
+
+void Mesh::SetQuantized(bool isQuantized, const float* boundsMin, const float* boundsMax)
+{
+	quantized = isQuantized;
+	if (quantized)
+	{
+		VertexQuantizer::GetPositionTransform(boundsMin, boundsMax, positionScale, positionOffset);
+		return;
+	}
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		positionScale[axis] = 1.0f;
+		positionOffset[axis] = 0.0f;
+	}
+}
+
+void Mesh::CreateVertexArray()
+{
+	if (!attributes.empty())
+	{
+		for (size_t i = 0; i < attributes.size(); i++)
+		{
+			const MeshAttribute& attribute = attributes[i];
+			glBindBuffer(GL_ARRAY_BUFFER, attribute.buffer);
+			glVertexAttribPointer(attribute.location, attribute.size, attribute.type, attribute.normalized, attribute.stride, (void*)attribute.offset);
+			glEnableVertexAttribArray(attribute.location);
+		}
+
+		BindInstanceAttributes();
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindVertexArray(0);
+		return;
+	}
+
+	if (skinned)
+	{
+		// Joint indices stay integers for the palette lookup, weights arrive as 0..1
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(SkinnedVertex), (void*)offsetof(SkinnedVertex, position));
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(SkinnedVertex), (void*)offsetof(SkinnedVertex, uv));
+		glEnableVertexAttribArray(1);
+		glVertexAttribIPointer(3, 4, GL_UNSIGNED_BYTE, sizeof(SkinnedVertex), (void*)offsetof(SkinnedVertex, joints));
+		glEnableVertexAttribArray(3);
+		glVertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SkinnedVertex), (void*)offsetof(SkinnedVertex, weights));
+		glEnableVertexAttribArray(4);
+	}
+	else if (quantized)
+	{
+		// Normalized to 0..1 across the bounds, the shader applies positionScale and positionOffset
+		glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(QuantizedVertex), (void*)offsetof(QuantizedVertex, position));
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(QuantizedVertex), (void*)offsetof(QuantizedVertex, uv));
+		glEnableVertexAttribArray(1);
+	}
+	else
+	{
+		// Interleaved x, y, z, u, v
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 5, 0);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 5, (void*)(sizeof(GLfloat) * 3));
+		glEnableVertexAttribArray(1);
+	}
+
+	BindInstanceAttributes();
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	glBindVertexArray(0);
+}
+
+void Mesh::BindInstanceAttributes()
+{
+	for (size_t i = 0; i < instanceAttributes.size(); i++)
+	{
+		const MeshAttribute& attribute = instanceAttributes[i];
+		glBindBuffer(GL_ARRAY_BUFFER, attribute.buffer);
+		glVertexAttribPointer(attribute.location, attribute.size, attribute.type, attribute.normalized, attribute.stride, (void*)attribute.offset);
+		glEnableVertexAttribArray(attribute.location);
+		glVertexAttribDivisor(attribute.location, 1);
+	}
+}
+
+bool Mesh::BindVertexArray()
+{
+	if (pendingUploads > 0)
+	{
+		return false;
+	}
+
+	// Buffers made on another context arrive without a VAO, those are not shared
+	if (VAO == 0)
+	{
+		glGenVertexArrays(1, &VAO);
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		CreateVertexArray();
+	}
+
+	glBindVertexArray(VAO);
+	return true;
+}
+
+unsigned int Mesh::RenderMesh(unsigned int lod)
+{
+	if (!BindVertexArray())
+	{
+		return 0;
+	}
+
+	unsigned int triangles = 0;
+	if (IBO == 0)
+	{
+		glDrawArrays(GL_TRIANGLES, 0, indexCount);
+		triangles = indexCount / 3;
+	}
+	else if (lods.empty())
+	{
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+		glDrawElements(GL_TRIANGLES, indexCount, indexType, (void*)indexOffset);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		triangles = indexCount / 3;
+	}
+	else
+	{
+		const Lod& level = lods[lod < lods.size() ? lod : lods.size() - 1];
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+		for (size_t i = level.firstSubmesh; i < level.firstSubmesh + level.submeshCount; i++)
+		{
+			const Submesh& run = submeshes[i];
+			if (run.baseVertex == 0)
+			{
+				glDrawElements(GL_TRIANGLES, run.indexCount, indexType, (void*)(indexOffset + run.indexOffset));
+			}
+			else
+			{
+				glDrawElementsBaseVertex(GL_TRIANGLES, run.indexCount, indexType, (void*)(indexOffset + run.indexOffset), run.baseVertex);
+			}
+			triangles += run.indexCount / 3;
+		}
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+	glBindVertexArray(0);
+	return triangles;
+}
+
+unsigned int Mesh::RenderMeshlets(const MeshletRange* ranges, unsigned int rangeCount)
+{
+	// The buffer and levels are still being written by the loader thread until its uploads finish
+	if (pendingUploads > 0)
+	{
+		return 0;
+	}
+	if (IBO == 0 || lods.empty())
+	{
+		return RenderMesh(0);
+	}
+	if (!BindVertexArray())
+	{
+		return 0;
+	}
+
+	// Ranges are in the finest level's indices, clip each to the runs it spans
+	const Lod& level = lods[0];
+	size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+	size_t run = level.firstSubmesh;
+	size_t runEnd = level.firstSubmesh + level.submeshCount;
+	size_t runStart = 0;
+	unsigned int triangles = 0;
+	drawCounts.clear();
+	drawOffsets.clear();
+	drawBaseVertices.clear();
+	for (unsigned int r = 0; r < rangeCount; r++)
+	{
+		size_t first = ranges[r].firstIndex;
+		size_t last = first + ranges[r].indexCount;
+		while (run < runEnd && runStart + submeshes[run].indexCount <= first)
+		{
+			runStart += submeshes[run].indexCount;
+			run++;
+		}
+
+		size_t start = runStart;
+		for (size_t k = run; k < runEnd && start < last; start += submeshes[k].indexCount, k++)
+		{
+			size_t begin = first > start ? first : start;
+			size_t end = last < start + submeshes[k].indexCount ? last : start + submeshes[k].indexCount;
+			drawCounts.push_back((GLsizei)(end - begin));
+			drawOffsets.push_back((void*)(indexOffset + submeshes[k].indexOffset + (begin - start) * indexSize));
+			drawBaseVertices.push_back(submeshes[k].baseVertex);
+			triangles += (unsigned int)(end - begin) / 3;
+		}
+	}
+
+	if (!drawCounts.empty())
+	{
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+		glMultiDrawElementsBaseVertex(GL_TRIANGLES, &drawCounts[0], indexType, &drawOffsets[0], (GLsizei)drawCounts.size(), &drawBaseVertices[0]);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+	glBindVertexArray(0);
+	return triangles;
+}
+
+unsigned int Mesh::RenderMeshInstanced(GLsizei instanceCount)
+{
+	if (instanceCount <= 0 || !BindVertexArray())
+	{
+		return 0;
+	}
+
+	unsigned int triangles = 0;
+	if (IBO == 0)
+	{
+		glDrawArraysInstanced(GL_TRIANGLES, 0, indexCount, instanceCount);
+		triangles = indexCount / 3;
+	}
+	else if (lods.empty())
+	{
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+		glDrawElementsInstanced(GL_TRIANGLES, indexCount, indexType, (void*)indexOffset, instanceCount);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		triangles = indexCount / 3;
+	}
+	else
+	{
+		const Lod& level = lods[0];
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+		for (size_t i = level.firstSubmesh; i < level.firstSubmesh + level.submeshCount; i++)
+		{
+			const Submesh& run = submeshes[i];
+			glDrawElementsInstancedBaseVertex(GL_TRIANGLES, run.indexCount, indexType, (void*)(indexOffset + run.indexOffset), instanceCount, run.baseVertex);
+			triangles += run.indexCount / 3;
+		}
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+	glBindVertexArray(0);
+	return triangles * (unsigned int)instanceCount;
+}
+
+void Mesh::ClearMesh()
+{
+	// Borrowed buffers are released by their owner
+	if (!ownsBuffers)
+	{
+		IBO = 0;
+		attributes.clear();
+		ownsBuffers = true;
+	}
+
+	if (IBO != 0)
+	{
+		glDeleteBuffers(1, &IBO);
+		IBO = 0;
+	}
+
+	if (VBO != 0)
+	{
+		glDeleteBuffers(1, &VBO);
+		VBO = 0;
+	}
+
+	if (VAO != 0)
+	{
+		glDeleteVertexArrays(1, &VAO);
+		VAO = 0;
+	}
+
+	indexCount = 0;
+	indexType = GL_UNSIGNED_INT;
+	submeshes.clear();
+	lods.clear();
+	lodRanges.clear();
+	instanceAttributes.clear();
+	SetQuantized(false, NULL, NULL);
+	skinned = false;
+	bufferBytes = 0;
+}
+
+
+Mesh::~Mesh()
+{
+	ClearMesh();
+}
@@ -1,20 +1,137 @@
-#pragma once
-
-#include <GL\glew.h>
-
-class Mesh
-{
-public:
-	Mesh();
-
-	void CreateMesh(GLfloat *vertices, unsigned int *indices, unsigned int numOfVertices, unsigned int numOfIndices);
-	void RenderMesh();
-	void ClearMesh();
-
-	~Mesh();
-
-private:
-	GLuint VAO, VBO, IBO;
-	GLsizei indexCount;
-};
-
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <GL\glew.h>
+
+#include "MeshFormat.h"
+
+class UploadQueue;
+class ResourceLoader;
+class MeshFile;
+struct MeshletRange;
+
+// One vertex attribute read in place from a buffer the mesh does not own, such as a glTF buffer view
+struct MeshAttribute
+{
+	GLuint location;
+	GLuint buffer;
+	GLint size;
+	GLenum type;
+	GLboolean normalized;
+	GLsizei stride;
+	size_t offset;
+};
+
+// A vertex deformed by up to four joints of a skeleton, weights normalized to sum to 255
+struct SkinnedVertex
+{
+	float position[3];
+	float uv[2];
+	uint8_t joints[4];
+	uint8_t weights[4];
+};
+
+class Mesh
+{
+public:
+	Mesh();
+
+	void CreateMesh(GLfloat *vertices, unsigned int *indices, unsigned int numOfVertices, unsigned int numOfIndices);
+	// Allocate the buffers now and stream the data in through the upload queue, the mesh is skipped until it arrives
+	void CreateMesh(GLfloat *vertices, unsigned int *indices, unsigned int numOfVertices, unsigned int numOfIndices, UploadQueue* uploadQueue);
+	// Create the buffers on the loader thread's shared context, the VAO is built on first render
+	void CreateMesh(GLfloat *vertices, unsigned int *indices, unsigned int numOfVertices, unsigned int numOfIndices, ResourceLoader* resourceLoader);
+	// Upload straight from a mapped mesh file, which stays mapped until its data has reached the GPU
+	void CreateMesh(std::shared_ptr<MeshFile> meshFile, UploadQueue* uploadQueue);
+	// indices already read from the file are uploaded instead of reading them again, NULL has the loader do it
+	void CreateMesh(std::shared_ptr<MeshFile> meshFile, std::shared_ptr<const std::vector<uint32_t>> indices, ResourceLoader* resourceLoader);
+	// Quantized vertices (see VertexQuantizer) relative to the bounds they were quantized against
+	void CreateMesh(const QuantizedVertex* vertices, const float* boundsMin, const float* boundsMax, unsigned int *indices, unsigned int vertexCount, unsigned int numOfIndices, ResourceLoader* resourceLoader);
+	// Joints and weights go to attributes 3 and 4 next to the position and texture coordinate
+	void CreateMesh(const SkinnedVertex* vertices, unsigned int *indices, unsigned int vertexCount, unsigned int numOfIndices, ResourceLoader* resourceLoader);
+	// Draw from buffers owned elsewhere in whatever layout they already have, the VAO is built on first render.
+	// indexBuffer 0 draws count vertices without indices. The mesh is skipped until MarkUploaded has been
+	// called pendingCount times, once the buffers are filled.
+	void CreateMesh(const std::vector<MeshAttribute>& meshAttributes, GLuint indexBuffer, GLenum meshIndexType, size_t meshIndexOffset, GLsizei count, unsigned int pendingCount);
+	void MarkUploaded() { pendingUploads--; }
+	// Index ranges of coarser levels within the indices given to the next CreateMesh, finest first. Mesh files
+	// bring their own.
+	void SetLods(const MeshFileLod* meshLods, unsigned int lodCount);
+	// Per-instance attributes (divisor 1) from buffers owned elsewhere, added to the VAO built by the next CreateMesh
+	void SetInstanceAttributes(const std::vector<MeshAttribute>& meshInstanceAttributes) { instanceAttributes = meshInstanceAttributes; }
+	// The coarsest level whose error stays within maxPixelError pixels when an object unit covers pixelsPerUnit
+	unsigned int SelectLod(float pixelsPerUnit, float maxPixelError);
+	unsigned int GetLodCount() { return lods.empty() ? 1 : (unsigned int)lods.size(); }
+	// Returns the triangles drawn
+	unsigned int RenderMesh(unsigned int lod);
+	// Draw only these index ranges of the finest level, in ascending order, with one multi-draw
+	unsigned int RenderMeshlets(const MeshletRange* ranges, unsigned int rangeCount);
+	// Draw the finest level instanceCount times, returns the triangles drawn over every instance
+	unsigned int RenderMeshInstanced(GLsizei instanceCount);
+	void ClearMesh();
+
+	// Vertex and index buffer bytes
+	size_t GetMemoryUsage() { return bufferBytes; }
+	// Applied to the position by the vertex shader, identity unless the vertices are quantized
+	const GLfloat* GetPositionScale() { return positionScale; }
+	const GLfloat* GetPositionOffset() { return positionOffset; }
+	// GL_UNSIGNED_SHORT whenever the indices fit in 16 bits, possibly split into runs with their own base vertex
+	GLenum GetIndexType() { return indexType; }
+
+	~Mesh();
+
+private:
+	GLuint VAO, VBO, IBO;
+	GLsizei indexCount;
+	GLenum indexType;
+	size_t indexOffset;
+	// Empty for the interleaved x, y, z, u, v layout in VBO, or QuantizedVertex when quantized, or SkinnedVertex
+	// when skinned
+	std::vector<MeshAttribute> attributes;
+	std::vector<MeshAttribute> instanceAttributes;
+	bool quantized;
+	bool skinned;
+	GLfloat positionScale[3], positionOffset[3];
+	bool ownsBuffers;
+	size_t bufferBytes;
+	unsigned int pendingUploads;
+
+	// A run of indices drawn in one call, 16-bit ones relative to baseVertex so meshes past 65536 vertices can
+	// still use them
+	struct Submesh
+	{
+		GLsizei indexCount;
+		size_t indexOffset;
+		GLint baseVertex;
+	};
+	// A level of detail drawn as submeshCount runs, with its error in object units
+	struct Lod
+	{
+		float error;
+		size_t firstSubmesh;
+		size_t submeshCount;
+	};
+	std::vector<Submesh> submeshes;
+	// Empty when the whole index buffer is drawn in one call
+	std::vector<Lod> lods;
+	std::vector<MeshFileLod> lodRanges;
+
+	// Multi-draw arguments gathered by RenderMeshlets
+	std::vector<GLsizei> drawCounts;
+	std::vector<void*> drawOffsets;
+	std::vector<GLint> drawBaseVertices;
+
+	// Repack every level's whole triangles as 16-bit indices, setting the index type, count, submeshes and
+	// levels. Returns false and leaves the levels drawing the 32-bit indices when that would take more than a
+	// few draws per level.
+	bool PackIndices(const unsigned int* indices, size_t count, std::vector<unsigned char>& packed);
+	void SetQuantized(bool isQuantized, const float* boundsMin, const float* boundsMax);
+
+	void CreateVertexArray();
+	void BindInstanceAttributes();
+	// Bind the VAO, building it first if needed. False while uploads are pending.
+	bool BindVertexArray();
+};
+
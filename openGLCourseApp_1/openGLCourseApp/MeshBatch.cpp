@@ -0,0 +1,202 @@
+#include "MeshBatch.h"
+
+#include <stddef.h>
+
+MeshBatch::MeshBatch()
+{
+	VAO = 0;
+	VBO = 0;
+	IBO = 0;
+	instanceBuffer = 0;
+	indirectBuffer = 0;
+	bufferBytes = 0;
+}
+
+unsigned int MeshBatch::AddMesh(const GLfloat *vertices, const unsigned int *indices, unsigned int numOfVertices, unsigned int numOfIndices)
+{
+	BatchMesh mesh;
+	mesh.firstIndex = (GLuint)indexData.size();
+	mesh.indexCount = numOfIndices;
+	mesh.baseVertex = (GLint)(vertexData.size() / 5);
+	meshes.push_back(mesh);
+
+	vertexData.insert(vertexData.end(), vertices, vertices + numOfVertices);
+	indexData.insert(indexData.end(), indices, indices + numOfIndices);
+
+	return (unsigned int)meshes.size() - 1;
+}
+
+void MeshBatch::CreateBuffers()
+{
+	if (vertexData.empty() || indexData.empty())
+	{
+		return;
+	}
+
+	glGenBuffers(1, &IBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * indexData.size(), &indexData[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	glGenBuffers(1, &VBO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * vertexData.size(), &vertexData[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glGenBuffers(1, &instanceBuffer);
+	glGenBuffers(1, &indirectBuffer);
+
+	bufferBytes = sizeof(unsigned int) * indexData.size() + sizeof(GLfloat) * vertexData.size();
+
+	// The GPU copies are all that is needed from here on
+	std::vector<GLfloat>().swap(vertexData);
+	std::vector<unsigned int>().swap(indexData);
+}
+
+void MeshBatch::CreateVertexArray()
+{
+	glGenVertexArrays(1, &VAO);
+	glBindVertexArray(VAO);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+
+	// Interleaved x, y, z, u, v
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 5, 0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 5, (void*)(sizeof(GLfloat) * 3));
+	glEnableVertexAttribArray(1);
+
+	// Model matrix columns in 2-5, atlas transform in 6 and layer in 7, advanced once per instance
+	for (GLuint i = 2; i <= 7; i++)
+	{
+		glEnableVertexAttribArray(i);
+		glVertexAttribDivisor(i, 1);
+	}
+	SetInstanceAttributes(0);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void MeshBatch::SetInstanceAttributes(GLintptr offset)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	for (GLuint column = 0; column < 4; column++)
+	{
+		glVertexAttribPointer(2 + column, 4, GL_FLOAT, GL_FALSE, sizeof(BatchInstance), (void*)(offset + offsetof(BatchInstance, model) + sizeof(glm::vec4) * column));
+	}
+	glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(BatchInstance), (void*)(offset + offsetof(BatchInstance, uvTransform)));
+	glVertexAttribPointer(7, 1, GL_FLOAT, GL_FALSE, sizeof(BatchInstance), (void*)(offset + offsetof(BatchInstance, layer)));
+}
+
+unsigned int MeshBatch::RenderBatch(const std::vector<BatchItem>& items)
+{
+	if (IBO == 0 || items.empty())
+	{
+		return 0;
+	}
+
+	// Built on the rendering context, VAOs are not shared
+	if (VAO == 0)
+	{
+		CreateVertexArray();
+	}
+
+	instances.resize(items.size());
+	commands.resize(items.size());
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		const BatchItem& item = items[i];
+		const BatchMesh& mesh = meshes[item.mesh];
+
+		instances[i].model = item.model;
+		instances[i].uvTransform = item.uvTransform;
+		instances[i].layer = (GLfloat)item.layer;
+
+		commands[i].count = mesh.indexCount;
+		commands[i].instanceCount = 1;
+		commands[i].firstIndex = mesh.firstIndex;
+		commands[i].baseVertex = mesh.baseVertex;
+		commands[i].baseInstance = (GLuint)i;
+	}
+
+	// Orphaned every frame so the previous frame's draws can still read the old contents
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(BatchInstance) * instances.size(), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(BatchInstance) * instances.size(), &instances[0]);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindVertexArray(VAO);
+
+	unsigned int drawCalls;
+	if (GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance))
+	{
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawElementsIndirectCommand) * commands.size(), NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(DrawElementsIndirectCommand) * commands.size(), &commands[0]);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0, (GLsizei)commands.size(), 0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		drawCalls = 1;
+	}
+	else
+	{
+		// Without base instance the per draw stream is re-pointed at each entry instead
+		for (size_t i = 0; i < commands.size(); i++)
+		{
+			SetInstanceAttributes(sizeof(BatchInstance) * i);
+			glDrawElementsBaseVertex(GL_TRIANGLES, commands[i].count, GL_UNSIGNED_INT,
+				(void*)(sizeof(unsigned int) * commands[i].firstIndex), commands[i].baseVertex);
+		}
+		SetInstanceAttributes(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		drawCalls = (unsigned int)commands.size();
+	}
+
+	glBindVertexArray(0);
+	return drawCalls;
+}
+
+void MeshBatch::ClearBatch()
+{
+	if (IBO != 0)
+	{
+		glDeleteBuffers(1, &IBO);
+		IBO = 0;
+	}
+
+	if (VBO != 0)
+	{
+		glDeleteBuffers(1, &VBO);
+		VBO = 0;
+	}
+
+	if (instanceBuffer != 0)
+	{
+		glDeleteBuffers(1, &instanceBuffer);
+		instanceBuffer = 0;
+	}
+
+	if (indirectBuffer != 0)
+	{
+		glDeleteBuffers(1, &indirectBuffer);
+		indirectBuffer = 0;
+	}
+
+	if (VAO != 0)
+	{
+		glDeleteVertexArrays(1, &VAO);
+		VAO = 0;
+	}
+
+	meshes.clear();
+	bufferBytes = 0;
+	vertexData.clear();
+	indexData.clear();
+}
+
+MeshBatch::~MeshBatch()
+{
+	ClearBatch();
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+
+#include <GL\glew.h>
+
+#include <glm\glm.hpp>
+
+#include "FramePacket.h"
+
+// Many static meshes merged into one vertex and index buffer so a whole list of them is drawn with a single
+// glMultiDrawElementsIndirect. Per draw data (model matrix and atlas placement) is read from an instanced
+// attribute stream, each draw's base instance selecting its own entry.
+class MeshBatch
+{
+public:
+	MeshBatch();
+
+	// Same interleaved x, y, z, u, v layout as Mesh, returns the index to use in BatchItem::mesh
+	unsigned int AddMesh(const GLfloat *vertices, const unsigned int *indices, unsigned int numOfVertices, unsigned int numOfIndices);
+
+	// Upload the merged buffers, on any context sharing objects with the renderer. Meshes added later are ignored.
+	void CreateBuffers();
+
+	// Render thread: draw every item, returns the number of GL draw calls issued
+	unsigned int RenderBatch(const std::vector<BatchItem>& items);
+
+	void ClearBatch();
+
+	size_t GetMemoryUsage() { return bufferBytes; }
+
+	~MeshBatch();
+
+private:
+	struct BatchMesh
+	{
+		GLuint firstIndex;
+		GLsizei indexCount;
+		GLint baseVertex;
+	};
+
+	// Layout of one entry in the per draw attribute stream
+	struct BatchInstance
+	{
+		glm::mat4 model;
+		glm::vec4 uvTransform;
+		GLfloat layer;
+		GLfloat padding[3];
+	};
+
+	// Matches the GL indirect command layout
+	struct DrawElementsIndirectCommand
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	std::vector<GLfloat> vertexData;
+	std::vector<unsigned int> indexData;
+	std::vector<BatchMesh> meshes;
+
+	GLuint VAO, VBO, IBO, instanceBuffer, indirectBuffer;
+	size_t bufferBytes;
+
+	std::vector<BatchInstance> instances;
+	std::vector<DrawElementsIndirectCommand> commands;
+
+	void CreateVertexArray();
+	void SetInstanceAttributes(GLintptr offset);
+};
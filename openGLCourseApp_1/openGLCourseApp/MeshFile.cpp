@@ -0,0 +1,397 @@
+#include "MeshFile.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <float.h>
+
+#include "IndexCodec.h"
+#include "VertexQuantizer.h"
+
+MeshData::MeshData()
+{
+	vertexFormat = MESH_VERTEX_POSITION_UV;
+	vertexStride = sizeof(float) * 5;
+	compressIndices = true;
+	quantizeVertices = false;
+}
+
+MeshFile::MeshFile()
+{
+	header = NULL;
+	sections = NULL;
+}
+
+bool MeshFile::Open(const char* fileLocation)
+{
+	Close();
+
+	if (!file.Open(fileLocation))
+	{
+		return false;
+	}
+
+	const unsigned char* data = file.GetData();
+	size_t size = file.GetSize();
+	const MeshFileHeader* fileHeader = (const MeshFileHeader*)data;
+
+	if (size < sizeof(MeshFileHeader) || memcmp(fileHeader->identifier, meshFileIdentifier, sizeof(meshFileIdentifier)) != 0)
+	{
+		printf("%s is not a mesh file\n", fileLocation);
+		Close();
+		return false;
+	}
+
+	bool floatVertices = fileHeader->vertexFormat == MESH_VERTEX_POSITION_UV && fileHeader->vertexStride == sizeof(float) * 5;
+	bool quantizedVertices = fileHeader->vertexFormat == MESH_VERTEX_QUANTIZED_POSITION_UV && fileHeader->vertexStride == sizeof(QuantizedVertex);
+	if (fileHeader->version != meshFileVersion || !(floatVertices || quantizedVertices))
+	{
+		printf("%s: unsupported mesh version %u or vertex format %u\n", fileLocation, fileHeader->version, fileHeader->vertexFormat);
+		Close();
+		return false;
+	}
+
+	if (sizeof(MeshFileHeader) + (uint64_t)fileHeader->sectionCount * sizeof(MeshFileSection) > size)
+	{
+		printf("%s: truncated section table\n", fileLocation);
+		Close();
+		return false;
+	}
+
+	// Sections are read in place, so they must lie inside the file and keep their alignment
+	const MeshFileSection* fileSections = (const MeshFileSection*)(data + sizeof(MeshFileHeader));
+	for (uint32_t i = 0; i < fileHeader->sectionCount; i++)
+	{
+		const MeshFileSection& section = fileSections[i];
+		if (section.byteOffset % meshFileAlignment != 0 || section.byteOffset > size || section.byteLength > size - section.byteOffset)
+		{
+			printf("%s: section %u is outside the file\n", fileLocation, i);
+			Close();
+			return false;
+		}
+	}
+
+	header = fileHeader;
+	sections = fileSections;
+
+	// The counts in the header are what the upload trusts
+	uint32_t count;
+	uint64_t length;
+	bool indicesValid = GetSection(MESH_SECTION_COMPRESSED_INDICES, count, length) ? count == header->indexCount :
+		GetSection(MESH_SECTION_INDICES, count, length) && length == (uint64_t)header->indexCount * sizeof(uint32_t);
+	if (!GetSection(MESH_SECTION_VERTICES, count, length) || length != (uint64_t)header->vertexCount * header->vertexStride || !indicesValid)
+	{
+		printf("%s: vertex or index data does not match the header\n", fileLocation);
+		Close();
+		return false;
+	}
+
+	// Every index must name a vertex, or the GPU reads past the vertex buffer. Compressed indices are
+	// checked by ReadIndices as they are decoded.
+	const uint32_t* plainIndices = GetIndices();
+	for (uint32_t i = 0; plainIndices && i < header->indexCount; i++)
+	{
+		if (plainIndices[i] >= header->vertexCount)
+		{
+			printf("%s: index %u is past the %u vertices\n", fileLocation, i, header->vertexCount);
+			Close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+const void* MeshFile::GetSection(uint32_t type, uint32_t& count, uint64_t& byteLength)
+{
+	count = 0;
+	byteLength = 0;
+	if (!header)
+	{
+		return NULL;
+	}
+
+	for (uint32_t i = 0; i < header->sectionCount; i++)
+	{
+		if (sections[i].type == type)
+		{
+			count = sections[i].count;
+			byteLength = sections[i].byteLength;
+			return file.GetData() + sections[i].byteOffset;
+		}
+	}
+	return NULL;
+}
+
+const float* MeshFile::GetVertices()
+{
+	return header && header->vertexFormat == MESH_VERTEX_POSITION_UV ? (const float*)GetVertexData() : NULL;
+}
+
+const QuantizedVertex* MeshFile::GetQuantizedVertices()
+{
+	return header && header->vertexFormat == MESH_VERTEX_QUANTIZED_POSITION_UV ? (const QuantizedVertex*)GetVertexData() : NULL;
+}
+
+const void* MeshFile::GetVertexData()
+{
+	uint32_t count;
+	uint64_t length;
+	return GetSection(MESH_SECTION_VERTICES, count, length);
+}
+
+bool MeshFile::ReadVertices(std::vector<float>& vertices)
+{
+	const QuantizedVertex* quantized = GetQuantizedVertices();
+	if (quantized)
+	{
+		VertexQuantizer::DequantizeVertices(quantized, header->vertexCount, header->boundsMin, header->boundsMax, vertices);
+		return true;
+	}
+
+	const float* plain = GetVertices();
+	if (!plain)
+	{
+		return false;
+	}
+	vertices.assign(plain, plain + (size_t)header->vertexCount * 5);
+	return true;
+}
+
+const uint32_t* MeshFile::GetIndices()
+{
+	uint32_t count;
+	uint64_t length;
+	return (const uint32_t*)GetSection(MESH_SECTION_INDICES, count, length);
+}
+
+bool MeshFile::HasCompressedIndices()
+{
+	uint32_t count;
+	uint64_t length;
+	return GetSection(MESH_SECTION_COMPRESSED_INDICES, count, length) != NULL;
+}
+
+bool MeshFile::ReadIndices(std::vector<uint32_t>& indices)
+{
+	uint32_t count;
+	uint64_t length;
+	const unsigned char* compressed = (const unsigned char*)GetSection(MESH_SECTION_COMPRESSED_INDICES, count, length);
+	if (compressed)
+	{
+		indices.resize(count);
+		if (count > 0 && !IndexCodec::DecodeIndices(compressed, (size_t)length, &indices[0], count))
+		{
+			return false;
+		}
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (indices[i] >= header->vertexCount)
+			{
+				printf("Compressed index %u is past the %u vertices\n", i, header->vertexCount);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	const uint32_t* plain = GetIndices();
+	if (!plain)
+	{
+		return false;
+	}
+	indices.assign(plain, plain + header->indexCount);
+	return true;
+}
+
+const MeshFileLod* MeshFile::GetLods(uint32_t& count)
+{
+	uint64_t length;
+	const MeshFileLod* lods = (const MeshFileLod*)GetSection(MESH_SECTION_LODS, count, length);
+	count = length >= (uint64_t)count * sizeof(MeshFileLod) ? count : 0;
+	return lods;
+}
+
+const MeshFileMeshlet* MeshFile::GetMeshlets(uint32_t& count)
+{
+	uint64_t length;
+	const MeshFileMeshlet* meshlets = (const MeshFileMeshlet*)GetSection(MESH_SECTION_MESHLETS, count, length);
+	count = length >= (uint64_t)count * sizeof(MeshFileMeshlet) ? count : 0;
+	return meshlets;
+}
+
+const uint32_t* MeshFile::GetMeshletVertices(uint32_t& count)
+{
+	uint64_t length;
+	const uint32_t* vertices = (const uint32_t*)GetSection(MESH_SECTION_MESHLET_VERTICES, count, length);
+	count = length >= (uint64_t)count * sizeof(uint32_t) ? count : 0;
+	return vertices;
+}
+
+const uint8_t* MeshFile::GetMeshletTriangles(uint32_t& count)
+{
+	uint64_t length;
+	const uint8_t* triangles = (const uint8_t*)GetSection(MESH_SECTION_MESHLET_TRIANGLES, count, length);
+	count = length >= (uint64_t)count * 3 ? count : 0;
+	return triangles;
+}
+
+const int16_t* MeshFile::GetNormals(uint32_t& count)
+{
+	uint64_t length;
+	const int16_t* normals = (const int16_t*)GetSection(MESH_SECTION_NORMALS, count, length);
+	count = length >= (uint64_t)count * sizeof(int16_t) * 2 ? count : 0;
+	return normals;
+}
+
+const int16_t* MeshFile::GetTangents(uint32_t& count)
+{
+	uint64_t length;
+	const int16_t* tangents = (const int16_t*)GetSection(MESH_SECTION_TANGENTS, count, length);
+	count = length >= (uint64_t)count * sizeof(int16_t) * 4 ? count : 0;
+	return tangents;
+}
+
+bool MeshFile::WriteMeshFile(const char* fileLocation, const MeshData& mesh, VertexQuantizeStats& quantizeStats, uint64_t& indexBytes)
+{
+	memset(&quantizeStats, 0, sizeof(quantizeStats));
+	indexBytes = 0;
+	if (mesh.vertexStride == 0 || mesh.vertexStride % sizeof(float) != 0 || mesh.vertices.empty() || mesh.indices.empty())
+	{
+		printf("Nothing to write to %s\n", fileLocation);
+		return false;
+	}
+
+	struct PendingSection
+	{
+		uint32_t type;
+		uint32_t count;
+		const void* data;
+		uint64_t byteLength;
+	};
+
+	std::vector<PendingSection> pending;
+	PendingSection vertices = { MESH_SECTION_VERTICES, (uint32_t)(mesh.vertices.size() * sizeof(float) / mesh.vertexStride), &mesh.vertices[0], mesh.vertices.size() * sizeof(float) };
+	PendingSection indices = { MESH_SECTION_INDICES, (uint32_t)mesh.indices.size(), &mesh.indices[0], mesh.indices.size() * sizeof(uint32_t) };
+
+	std::vector<unsigned char> compressedIndices;
+	if (mesh.compressIndices)
+	{
+		IndexCodec::EncodeIndices(&mesh.indices[0], mesh.indices.size(), compressedIndices);
+		indices.type = MESH_SECTION_COMPRESSED_INDICES;
+		indices.data = &compressedIndices[0];
+		indices.byteLength = compressedIndices.size();
+	}
+	indexBytes = indices.byteLength;
+	pending.push_back(vertices);
+	pending.push_back(indices);
+
+	if (!mesh.lods.empty())
+	{
+		PendingSection lods = { MESH_SECTION_LODS, (uint32_t)mesh.lods.size(), &mesh.lods[0], mesh.lods.size() * sizeof(MeshFileLod) };
+		pending.push_back(lods);
+	}
+
+	if (!mesh.meshlets.empty())
+	{
+		PendingSection meshlets = { MESH_SECTION_MESHLETS, (uint32_t)mesh.meshlets.size(), &mesh.meshlets[0], mesh.meshlets.size() * sizeof(MeshFileMeshlet) };
+		PendingSection meshletVertices = { MESH_SECTION_MESHLET_VERTICES, (uint32_t)mesh.meshletVertices.size(), &mesh.meshletVertices[0], mesh.meshletVertices.size() * sizeof(uint32_t) };
+		PendingSection meshletTriangles = { MESH_SECTION_MESHLET_TRIANGLES, (uint32_t)(mesh.meshletTriangles.size() / 3), &mesh.meshletTriangles[0], mesh.meshletTriangles.size() };
+		pending.push_back(meshlets);
+		pending.push_back(meshletVertices);
+		pending.push_back(meshletTriangles);
+	}
+
+	if (!mesh.normals.empty())
+	{
+		PendingSection normals = { MESH_SECTION_NORMALS, (uint32_t)(mesh.normals.size() / 2), &mesh.normals[0], mesh.normals.size() * sizeof(int16_t) };
+		pending.push_back(normals);
+	}
+
+	if (!mesh.tangents.empty())
+	{
+		PendingSection tangents = { MESH_SECTION_TANGENTS, (uint32_t)(mesh.tangents.size() / 4), &mesh.tangents[0], mesh.tangents.size() * sizeof(int16_t) };
+		pending.push_back(tangents);
+	}
+
+	MeshFileHeader header;
+	memcpy(header.identifier, meshFileIdentifier, sizeof(header.identifier));
+	header.version = meshFileVersion;
+	header.vertexFormat = mesh.vertexFormat;
+	header.vertexStride = mesh.vertexStride;
+	header.vertexCount = vertices.count;
+	header.indexCount = indices.count;
+	header.sectionCount = (uint32_t)pending.size();
+
+	// Positions are the first three floats of every vertex
+	size_t floatsPerVertex = mesh.vertexStride / sizeof(float);
+	for (int axis = 0; axis < 3; axis++)
+	{
+		header.boundsMin[axis] = FLT_MAX;
+		header.boundsMax[axis] = -FLT_MAX;
+	}
+	for (size_t i = 0; i + floatsPerVertex <= mesh.vertices.size(); i += floatsPerVertex)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			header.boundsMin[axis] = mesh.vertices[i + axis] < header.boundsMin[axis] ? mesh.vertices[i + axis] : header.boundsMin[axis];
+			header.boundsMax[axis] = mesh.vertices[i + axis] > header.boundsMax[axis] ? mesh.vertices[i + axis] : header.boundsMax[axis];
+		}
+	}
+
+	// Quantized against the bounds just measured, which the loader turns back into the shader's transform
+	std::vector<QuantizedVertex> quantizedVertices;
+	if (mesh.quantizeVertices && floatsPerVertex >= 5)
+	{
+		VertexQuantizer::QuantizeVertices(&mesh.vertices[0], vertices.count, (unsigned int)floatsPerVertex, header.boundsMin, header.boundsMax, quantizedVertices, quantizeStats);
+		header.vertexFormat = MESH_VERTEX_QUANTIZED_POSITION_UV;
+		header.vertexStride = sizeof(QuantizedVertex);
+		pending[0].data = &quantizedVertices[0];
+		pending[0].byteLength = quantizedVertices.size() * sizeof(QuantizedVertex);
+	}
+
+	std::vector<MeshFileSection> sectionTable(pending.size());
+	uint64_t offset = sizeof(MeshFileHeader) + sizeof(MeshFileSection) * sectionTable.size();
+	for (size_t i = 0; i < pending.size(); i++)
+	{
+		offset = (offset + meshFileAlignment - 1) & ~(uint64_t)(meshFileAlignment - 1);
+		sectionTable[i].type = pending[i].type;
+		sectionTable[i].count = pending[i].count;
+		sectionTable[i].byteOffset = offset;
+		sectionTable[i].byteLength = pending[i].byteLength;
+		offset += pending[i].byteLength;
+	}
+
+	FILE* output = fopen(fileLocation, "wb");
+	if (!output)
+	{
+		printf("Failed to open %s for writing\n", fileLocation);
+		return false;
+	}
+
+	fwrite(&header, sizeof(header), 1, output);
+	fwrite(&sectionTable[0], sizeof(MeshFileSection), sectionTable.size(), output);
+
+	static const unsigned char padding[16] = { 0 };
+	bool written = true;
+	for (size_t i = 0; i < pending.size(); i++)
+	{
+		long position = ftell(output);
+		fwrite(padding, 1, (size_t)(sectionTable[i].byteOffset - position), output);
+		written = written && fwrite(pending[i].data, 1, (size_t)pending[i].byteLength, output) == pending[i].byteLength;
+	}
+
+	fclose(output);
+	return written;
+}
+
+void MeshFile::Close()
+{
+	file.Close();
+	header = NULL;
+	sections = NULL;
+}
+
+MeshFile::~MeshFile()
+{
+	Close();
+}
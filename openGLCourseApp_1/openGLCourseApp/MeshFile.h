@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include "MeshFormat.h"
+#include "MappedFile.h"
+#include "VertexQuantizer.h"
+
+// Geometry to be written out by MeshFile::WriteMeshFile, the converter's side of the format
+struct MeshData
+{
+	// Position and texture coordinate vertices, indices compressed, vertices stored as floats
+	MeshData();
+
+	uint32_t vertexFormat;
+	// Bytes per vertex
+	uint32_t vertexStride;
+	std::vector<float> vertices;
+	std::vector<uint32_t> indices;
+	// Write the indices with IndexCodec instead of as plain 32-bit values
+	bool compressIndices;
+	// Write x, y, z, u, v vertices as QuantizedVertex instead, relative to the header bounds
+	bool quantizeVertices;
+
+	// Optional sections, left out of the file when empty
+	std::vector<MeshFileLod> lods;
+	std::vector<MeshFileMeshlet> meshlets;
+	std::vector<uint32_t> meshletVertices;
+	std::vector<uint8_t> meshletTriangles;
+	// Two values per vertex for normals, four for tangents, as the sections store them
+	std::vector<int16_t> normals;
+	std::vector<int16_t> tangents;
+};
+
+// A mesh file mapped into memory. Opening checks the header, the section table and that plain indices stay
+// within the vertices, the vertex and index data are handed out as pointers into the mapping for the GPU
+// upload to read in place.
+class MeshFile
+{
+public:
+	MeshFile();
+
+	bool Open(const char* fileLocation);
+	void Close();
+
+	const MeshFileHeader& GetHeader() { return *header; }
+
+	// Pointers into the mapping, valid while the file is open, NULL if the section is absent.
+	// GetVertices is NULL for quantized vertices and GetIndices for compressed indices, which only
+	// ReadVertices and ReadIndices can return.
+	const float* GetVertices();
+	const QuantizedVertex* GetQuantizedVertices();
+	// The vertex section as stored, vertexStride bytes per vertex
+	const void* GetVertexData();
+	// The vertices dequantized or copied into vertices as x, y, z, u, v, any thread
+	bool ReadVertices(std::vector<float>& vertices);
+	const uint32_t* GetIndices();
+	bool HasCompressedIndices();
+	// The indices decoded or copied into indices, any thread. Fails on decoded indices past the vertices.
+	bool ReadIndices(std::vector<uint32_t>& indices);
+	const MeshFileLod* GetLods(uint32_t& count);
+	const MeshFileMeshlet* GetMeshlets(uint32_t& count);
+	const uint32_t* GetMeshletVertices(uint32_t& count);
+	const uint8_t* GetMeshletTriangles(uint32_t& count);
+	// Encoded per vertex, see MeshFormat.h
+	const int16_t* GetNormals(uint32_t& count);
+	const int16_t* GetTangents(uint32_t& count);
+
+	const void* GetSection(uint32_t type, uint32_t& count, uint64_t& byteLength);
+
+	// quantizeStats reports the vertex quantization, zeroed when the vertices are written as floats.
+	// indexBytes is the size of the index section as written, compressed or not.
+	static bool WriteMeshFile(const char* fileLocation, const MeshData& mesh, VertexQuantizeStats& quantizeStats, uint64_t& indexBytes);
+
+	~MeshFile();
+
+private:
+	MappedFile file;
+	const MeshFileHeader* header;
+	const MeshFileSection* sections;
+};
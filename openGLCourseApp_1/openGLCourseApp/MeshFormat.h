@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdint.h>
+
+// On-disk layout shared by the mesh converter and MeshFile: a fixed header, a table of MeshFileSection
+// entries and the section data, each section starting on a meshFileAlignment boundary so a mapped file
+// can be read in place. Vertices are stored in the exact layout Mesh uploads, either as floats or quantized by
+// VertexQuantizer relative to the header bounds. Indices are either 32-bit values or, in their own section
+// type, compressed with IndexCodec and decoded on load. Generated normals and tangents are kept in sections of
+// their own, octahedrally encoded per vertex, so the vertex layout stays the one Mesh uploads.
+
+static const char meshFileIdentifier[8] = { 'M', 'E', 'S', 'H', '\r', '\n', 0x1A, '\n' };
+static const uint32_t meshFileVersion = 1;
+static const uint32_t meshFileAlignment = 16;
+
+enum MeshVertexFormat
+{
+	MESH_VERTEX_POSITION_UV = 1,			// x, y, z, u, v floats
+	MESH_VERTEX_QUANTIZED_POSITION_UV = 2	// QuantizedVertex
+};
+
+enum MeshSectionType
+{
+	MESH_SECTION_VERTICES = 1,
+	MESH_SECTION_INDICES = 2,
+	MESH_SECTION_LODS = 3,				// MeshFileLod, finest first
+	MESH_SECTION_MESHLETS = 4,			// MeshFileMeshlet, in the order the finest level lists their triangles
+	MESH_SECTION_MESHLET_VERTICES = 5,	// uint32_t, indices into the vertex section
+	MESH_SECTION_MESHLET_TRIANGLES = 6,	// uint8_t triples, indices into the meshlet's vertices
+	MESH_SECTION_COMPRESSED_INDICES = 7,	// IndexCodec stream of every index, in place of MESH_SECTION_INDICES
+	MESH_SECTION_NORMALS = 8,			// int16_t pairs, a 16-bit octahedral unit normal per vertex
+	MESH_SECTION_TANGENTS = 9			// int16_t quadruples, a 16-bit octahedral tangent, the bitangent sign as +-32767, 0
+};
+
+// Position as 16-bit unsigned normalized values across the header bounds, texture coordinate as half floats
+struct QuantizedVertex
+{
+	uint16_t position[3];
+	// Keeps the texture coordinate 4-byte aligned
+	uint16_t reserved;
+	uint16_t uv[2];
+};
+
+struct MeshFileHeader
+{
+	char identifier[8];
+	uint32_t version;
+	uint32_t vertexFormat;
+	uint32_t vertexStride;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t sectionCount;
+	float boundsMin[3];
+	float boundsMax[3];
+};
+
+struct MeshFileSection
+{
+	uint32_t type;
+	// Elements in the section
+	uint32_t count;
+	uint64_t byteOffset;
+	uint64_t byteLength;
+};
+
+// A range of the index section drawing the mesh at one level of detail
+struct MeshFileLod
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	// Object space error of this level against the full mesh
+	float error;
+	uint32_t reserved;
+};
+
+// A small cluster of triangles with its own vertex list, bounds and normal cone for culling
+struct MeshFileMeshlet
+{
+	uint32_t vertexOffset;
+	uint32_t triangleOffset;
+	uint32_t vertexCount;
+	uint32_t triangleCount;
+	float center[3];
+	float radius;
+	float coneAxis[3];
+	float coneCutoff;
+};
@@ -0,0 +1,350 @@
+#include "MeshOptimizer.h"
+
+#include <math.h>
+#include <chrono>
+#include <algorithm>
+
+// Post-transform cache modelled for every GPU, a FIFO of this many vertices
+static const unsigned int vertexCacheSize = 16;
+
+// Clusters may lose up to 5% of their cache efficiency to give the overdraw sort more freedom
+static const float overdrawThreshold = 1.05f;
+
+void MeshOptimizer::OptimizeMesh(std::vector<float>& vertices, std::vector<unsigned int>& indices, unsigned int floatsPerVertex, MeshOptimizeStats& stats)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	size_t vertexCount = vertices.size() / floatsPerVertex;
+
+	AnalyzeVertexCache(indices.empty() ? NULL : &indices[0], indices.size(), vertexCount, vertexCacheSize, stats.acmrBefore, stats.atvrBefore);
+
+	std::vector<unsigned int> clusters;
+	OptimizeVertexCache(indices, vertexCount, vertexCacheSize, clusters);
+	if (!vertices.empty())
+	{
+		OptimizeOverdraw(indices, clusters, &vertices[0], floatsPerVertex, vertexCacheSize, overdrawThreshold);
+	}
+	size_t usedVertices = OptimizeVertexFetch(vertices, indices, floatsPerVertex);
+
+	AnalyzeVertexCache(indices.empty() ? NULL : &indices[0], indices.size(), usedVertices, vertexCacheSize, stats.acmrAfter, stats.atvrAfter);
+	stats.clusters = (unsigned int)clusters.size();
+	stats.removedVertices = (unsigned int)(vertexCount - usedVertices);
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize, std::vector<unsigned int>& clusters)
+{
+	clusters.clear();
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// Triangles around every vertex, as offsets into one shared list
+	std::vector<unsigned int> liveCount(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		liveCount[indices[i]]++;
+	}
+
+	std::vector<unsigned int> adjacencyOffset(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		adjacencyOffset[v + 1] = adjacencyOffset[v] + liveCount[v];
+	}
+
+	std::vector<unsigned int> adjacency(triangleCount * 3);
+	std::vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+	}
+
+	std::vector<unsigned int> cacheTime(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned int> deadEnd;
+	std::vector<unsigned int> candidates;
+	std::vector<unsigned int> output;
+	output.reserve(triangleCount * 3);
+
+	// Time starts past the cache size so every vertex begins as a miss
+	unsigned int time = cacheSize + 1;
+	size_t cursor = 0;
+	int fanning = (int)indices[0];
+	clusters.push_back(0);
+
+	while (fanning >= 0)
+	{
+		candidates.clear();
+
+		// Emit every live triangle around the fanning vertex
+		for (unsigned int a = adjacencyOffset[fanning]; a < adjacencyOffset[fanning + 1]; a++)
+		{
+			unsigned int triangle = adjacency[a];
+			if (emitted[triangle])
+			{
+				continue;
+			}
+
+			for (int corner = 0; corner < 3; corner++)
+			{
+				unsigned int v = indices[triangle * 3 + corner];
+				output.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				liveCount[v]--;
+
+				if (time - cacheTime[v] > cacheSize)
+				{
+					cacheTime[v] = time;
+					time++;
+				}
+			}
+			emitted[triangle] = true;
+		}
+
+		// Next fan from the candidate that will still be cached once its remaining triangles are drawn,
+		// preferring the one longest in the cache
+		int best = -1;
+		int bestPriority = -1;
+		for (size_t c = 0; c < candidates.size(); c++)
+		{
+			unsigned int v = candidates[c];
+			if (liveCount[v] == 0)
+			{
+				continue;
+			}
+
+			int priority = 0;
+			if (time - cacheTime[v] + 2 * liveCount[v] <= cacheSize)
+			{
+				priority = (int)(time - cacheTime[v]);
+			}
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				best = (int)v;
+			}
+		}
+
+		if (best < 0)
+		{
+			// Dead end: back up through recently used vertices, else scan for any vertex still live.
+			// Either way the new fan starts away from the last one, which makes it a cluster boundary.
+			while (!deadEnd.empty() && best < 0)
+			{
+				unsigned int v = deadEnd.back();
+				deadEnd.pop_back();
+				best = liveCount[v] > 0 ? (int)v : -1;
+			}
+			while (best < 0 && cursor < vertexCount)
+			{
+				best = liveCount[cursor] > 0 ? (int)cursor : -1;
+				cursor++;
+			}
+
+			if (best >= 0)
+			{
+				clusters.push_back((unsigned int)(output.size() / 3));
+			}
+		}
+
+		fanning = best;
+	}
+
+	// A trailing partial triangle is left where it was
+	output.insert(output.end(), indices.begin() + triangleCount * 3, indices.end());
+	indices.swap(output);
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<unsigned int>& indices, std::vector<unsigned int>& clusters, const float* vertices, unsigned int floatsPerVertex, unsigned int cacheSize, float threshold)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0 || clusters.empty())
+	{
+		return;
+	}
+
+	size_t vertexCount = 0;
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		vertexCount = indices[i] + 1 > vertexCount ? indices[i] + 1 : vertexCount;
+	}
+
+	// Split the fans wherever the cache cost so far is already near the cluster's own, each piece then
+	// starts with a cold cache which the threshold allows for
+	std::vector<unsigned int> cacheTime(vertexCount, 0);
+	unsigned int time = cacheSize + 1;
+	std::vector<unsigned int> splitClusters;
+
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		size_t first = clusters[c];
+		size_t last = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+		time += cacheSize + 1;
+		unsigned int clusterMisses = 0;
+		for (size_t t = first; t < last; t++)
+		{
+			for (int corner = 0; corner < 3; corner++)
+			{
+				unsigned int v = indices[t * 3 + corner];
+				if (time - cacheTime[v] > cacheSize)
+				{
+					cacheTime[v] = time++;
+					clusterMisses++;
+				}
+			}
+		}
+		float clusterAcmr = (float)clusterMisses / (last - first);
+
+		time += cacheSize + 1;
+		size_t pieceStart = first;
+		unsigned int pieceMisses = 0;
+		splitClusters.push_back((unsigned int)first);
+		for (size_t t = first; t < last; t++)
+		{
+			for (int corner = 0; corner < 3; corner++)
+			{
+				unsigned int v = indices[t * 3 + corner];
+				if (time - cacheTime[v] > cacheSize)
+				{
+					cacheTime[v] = time++;
+					pieceMisses++;
+				}
+			}
+
+			if (t + 1 < last && pieceMisses <= threshold * clusterAcmr * (t + 1 - pieceStart))
+			{
+				splitClusters.push_back((unsigned int)(t + 1));
+				pieceStart = t + 1;
+				pieceMisses = 0;
+				time += cacheSize + 1;
+			}
+		}
+	}
+	clusters.swap(splitClusters);
+
+	// Area weighted centroid of the whole mesh
+	double meshCentroid[3] = { 0.0, 0.0, 0.0 };
+	double meshArea = 0.0;
+	std::vector<float> clusterCentroid(clusters.size() * 3, 0.0f);
+	std::vector<float> clusterNormal(clusters.size() * 3, 0.0f);
+
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		size_t first = clusters[c];
+		size_t last = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+		float area = 0.0f;
+
+		for (size_t t = first; t < last; t++)
+		{
+			const float* a = vertices + (size_t)indices[t * 3 + 0] * floatsPerVertex;
+			const float* b = vertices + (size_t)indices[t * 3 + 1] * floatsPerVertex;
+			const float* d = vertices + (size_t)indices[t * 3 + 2] * floatsPerVertex;
+
+			float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			float e2[3] = { d[0] - a[0], d[1] - a[1], d[2] - a[2] };
+			float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			float triangleArea = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+			for (int axis = 0; axis < 3; axis++)
+			{
+				float centre = (a[axis] + b[axis] + d[axis]) / 3.0f;
+				clusterCentroid[c * 3 + axis] += centre * triangleArea;
+				clusterNormal[c * 3 + axis] += n[axis];
+				meshCentroid[axis] += centre * triangleArea;
+			}
+			area += triangleArea;
+		}
+
+		meshArea += area;
+		float invArea = area > 0.0f ? 1.0f / area : 0.0f;
+		float normalLength = sqrtf(clusterNormal[c * 3] * clusterNormal[c * 3] + clusterNormal[c * 3 + 1] * clusterNormal[c * 3 + 1] + clusterNormal[c * 3 + 2] * clusterNormal[c * 3 + 2]);
+		float invNormal = normalLength > 0.0f ? 1.0f / normalLength : 0.0f;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			clusterCentroid[c * 3 + axis] *= invArea;
+			clusterNormal[c * 3 + axis] *= invNormal;
+		}
+	}
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		meshCentroid[axis] = meshArea > 0.0 ? meshCentroid[axis] / meshArea : 0.0;
+	}
+
+	// Clusters facing out from the centre are likely in front of the rest from any view, so they go first
+	std::vector<float> sortKey(clusters.size());
+	std::vector<unsigned int> order(clusters.size());
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		float key = 0.0f;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			key += (clusterCentroid[c * 3 + axis] - (float)meshCentroid[axis]) * clusterNormal[c * 3 + axis];
+		}
+		sortKey[c] = key;
+		order[c] = (unsigned int)c;
+	}
+	std::stable_sort(order.begin(), order.end(), [&sortKey](unsigned int a, unsigned int b) { return sortKey[a] > sortKey[b]; });
+
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+	std::vector<unsigned int> sortedClusters;
+	sortedClusters.reserve(clusters.size());
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		size_t first = clusters[order[i]];
+		size_t last = order[i] + 1 < clusters.size() ? clusters[order[i] + 1] : triangleCount;
+		sortedClusters.push_back((unsigned int)(output.size() / 3));
+		output.insert(output.end(), indices.begin() + first * 3, indices.begin() + last * 3);
+	}
+	output.insert(output.end(), indices.begin() + triangleCount * 3, indices.end());
+
+	indices.swap(output);
+	clusters.swap(sortedClusters);
+}
+
+size_t MeshOptimizer::OptimizeVertexFetch(std::vector<float>& vertices, std::vector<unsigned int>& indices, unsigned int floatsPerVertex)
+{
+	size_t vertexCount = vertices.size() / floatsPerVertex;
+	std::vector<unsigned int> remap(vertexCount, ~0u);
+	std::vector<float> output;
+	output.reserve(vertices.size());
+
+	unsigned int next = 0;
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		unsigned int& target = remap[indices[i]];
+		if (target == ~0u)
+		{
+			target = next++;
+			output.insert(output.end(), vertices.begin() + (size_t)indices[i] * floatsPerVertex, vertices.begin() + ((size_t)indices[i] + 1) * floatsPerVertex);
+		}
+		indices[i] = target;
+	}
+
+	vertices.swap(output);
+	return next;
+}
+
+void MeshOptimizer::AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize, float& acmr, float& atvr)
+{
+	std::vector<unsigned int> cacheTime(vertexCount, 0);
+	unsigned int time = cacheSize + 1;
+	size_t misses = 0;
+
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int v = indices[i];
+		if (time - cacheTime[v] > cacheSize)
+		{
+			cacheTime[v] = time++;
+			misses++;
+		}
+	}
+
+	acmr = indexCount >= 3 ? (float)misses / (indexCount / 3) : 0.0f;
+	atvr = vertexCount > 0 ? (float)misses / vertexCount : 0.0f;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+struct MeshOptimizeStats
+{
+	double milliseconds;
+	// Average cache miss ratio, vertex shader runs per triangle (0.5 is ideal, 3 the worst)
+	float acmrBefore, acmrAfter;
+	// Average transform to vertex ratio, vertex shader runs per vertex (1 is ideal)
+	float atvrBefore, atvrAfter;
+	unsigned int clusters;
+	unsigned int removedVertices;
+};
+
+// Index and vertex reordering for the post-transform vertex cache, overdraw and vertex fetch, run on meshes
+// before they are written or uploaded. Triangles are ordered with Tipsify (Sander et al., "Fast Triangle
+// Reordering for Vertex Locality and Reduced Overdraw"), whose fans are then split into clusters that are
+// sorted so outward facing ones draw first. Vertices are finally renumbered in the order they are used.
+class MeshOptimizer
+{
+public:
+	// The whole pipeline on interleaved vertices with the position in the first three floats. Unused
+	// vertices are dropped, the vertex vector shrinks to match.
+	static void OptimizeMesh(std::vector<float>& vertices, std::vector<unsigned int>& indices, unsigned int floatsPerVertex, MeshOptimizeStats& stats);
+
+	// Tipsify for a FIFO cache of cacheSize entries. clusters receives the first triangle of every run that
+	// restarts away from the previous one, which is where the overdraw pass may reorder.
+	static void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize, std::vector<unsigned int>& clusters);
+
+	// Reorder the clusters from OptimizeVertexCache so those facing away from the mesh centre draw first.
+	// Clusters are split further wherever that costs less than threshold times their cache efficiency.
+	static void OptimizeOverdraw(std::vector<unsigned int>& indices, std::vector<unsigned int>& clusters, const float* vertices, unsigned int floatsPerVertex, unsigned int cacheSize, float threshold);
+
+	// Renumber vertices in first use order and drop those no index refers to, returns the new vertex count
+	static size_t OptimizeVertexFetch(std::vector<float>& vertices, std::vector<unsigned int>& indices, unsigned int floatsPerVertex);
+
+	// Simulate a FIFO post-transform cache of cacheSize entries
+	static void AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize, float& acmr, float& atvr);
+};
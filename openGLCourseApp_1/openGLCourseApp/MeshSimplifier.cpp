@@ -0,0 +1,458 @@
+#include "MeshSimplifier.h"
+
+#include <math.h>
+#include <float.h>
+#include <string.h>
+#include <stdint.h>
+#include <chrono>
+#include <algorithm>
+
+// Texture coordinates against positions normalized to the mesh extent, a full texture width counts as half of it
+static const double uvWeight = 0.5;
+
+// No single level may move the surface by more than this fraction of the mesh extent
+static const float lodMaxRelativeError = 0.05f;
+
+// Levels stop once they would have fewer triangles than this, or shed less than a tenth of the previous level
+static const size_t lodMinTriangles = 64;
+static const float lodMinReduction = 0.9f;
+
+// A collapse may not turn a triangle's normal by more than about 75 degrees
+static const double flipCosine = 0.25;
+
+// Position and weighted texture coordinate of a vertex
+struct SimplifyPoint
+{
+	double p[5];
+};
+
+// Symmetric 5x5 matrix A (upper triangle), vector b and constant c of v'Av + 2b'v + c, summed over triangles
+// weighted by their area. weight keeps the area total so the error reads as a squared distance.
+struct Quadric
+{
+	double a[15];
+	double b[5];
+	double c;
+	double weight;
+};
+
+static void AddQuadric(Quadric& to, const Quadric& from)
+{
+	for (int i = 0; i < 15; i++)
+	{
+		to.a[i] += from.a[i];
+	}
+	for (int i = 0; i < 5; i++)
+	{
+		to.b[i] += from.b[i];
+	}
+	to.c += from.c;
+	to.weight += from.weight;
+}
+
+static double EvaluateQuadric(const Quadric& q, const SimplifyPoint& v)
+{
+	double result = q.c;
+	int k = 0;
+	for (int i = 0; i < 5; i++)
+	{
+		result += 2.0 * q.b[i] * v.p[i];
+		for (int j = i; j < 5; j++)
+		{
+			double term = q.a[k++] * v.p[i] * v.p[j];
+			result += i == j ? term : 2.0 * term;
+		}
+	}
+	return result > 0.0 ? result : 0.0;
+}
+
+static double Dot5(const double* x, const double* y)
+{
+	return x[0] * y[0] + x[1] * y[1] + x[2] * y[2] + x[3] * y[3] + x[4] * y[4];
+}
+
+// Squared distance from the plane through the triangle in the five dimensional space
+static void TriangleQuadric(const SimplifyPoint& p0, const SimplifyPoint& p1, const SimplifyPoint& p2, Quadric& q)
+{
+	memset(&q, 0, sizeof(q));
+
+	double e1[5], e2[5];
+	for (int i = 0; i < 5; i++)
+	{
+		e1[i] = p1.p[i] - p0.p[i];
+		e2[i] = p2.p[i] - p0.p[i];
+	}
+
+	double length1 = sqrt(Dot5(e1, e1));
+	if (length1 <= 0.0)
+	{
+		return;
+	}
+	for (int i = 0; i < 5; i++)
+	{
+		e1[i] /= length1;
+	}
+
+	double along = Dot5(e2, e1);
+	for (int i = 0; i < 5; i++)
+	{
+		e2[i] -= along * e1[i];
+	}
+	double length2 = sqrt(Dot5(e2, e2));
+	if (length2 <= 0.0)
+	{
+		return;
+	}
+	for (int i = 0; i < 5; i++)
+	{
+		e2[i] /= length2;
+	}
+
+	double area = 0.5 * length1 * length2;
+	double d1 = Dot5(p0.p, e1);
+	double d2 = Dot5(p0.p, e2);
+
+	int k = 0;
+	for (int i = 0; i < 5; i++)
+	{
+		for (int j = i; j < 5; j++)
+		{
+			q.a[k++] = area * ((i == j ? 1.0 : 0.0) - e1[i] * e1[j] - e2[i] * e2[j]);
+		}
+		q.b[i] = area * (d1 * e1[i] + d2 * e2[i] - p0.p[i]);
+	}
+	q.c = area * (Dot5(p0.p, p0.p) - d1 * d1 - d2 * d2);
+	q.weight = area;
+}
+
+static void TriangleNormal(const SimplifyPoint& a, const SimplifyPoint& b, const SimplifyPoint& c, double* normal)
+{
+	double u[3] = { b.p[0] - a.p[0], b.p[1] - a.p[1], b.p[2] - a.p[2] };
+	double v[3] = { c.p[0] - a.p[0], c.p[1] - a.p[1], c.p[2] - a.p[2] };
+	normal[0] = u[1] * v[2] - u[2] * v[1];
+	normal[1] = u[2] * v[0] - u[0] * v[2];
+	normal[2] = u[0] * v[1] - u[1] * v[0];
+}
+
+struct Collapse
+{
+	double cost;
+	unsigned int source;
+	unsigned int target;
+
+	bool operator<(const Collapse& other) const { return cost < other.cost; }
+};
+
+float MeshSimplifier::SimplifyMesh(const float* vertices, size_t vertexCount, unsigned int floatsPerVertex, const unsigned int* indices, size_t indexCount, size_t targetIndexCount, float maxError, std::vector<unsigned int>& simplified)
+{
+	simplified.assign(indices, indices + indexCount - indexCount % 3);
+	if (vertexCount == 0 || simplified.size() <= targetIndexCount)
+	{
+		return 0.0f;
+	}
+
+	// Work in the unit box so the texture coordinate weight means the same for every mesh
+	float boundsMin[3] = { vertices[0], vertices[1], vertices[2] };
+	float boundsMax[3] = { vertices[0], vertices[1], vertices[2] };
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float value = vertices[v * floatsPerVertex + axis];
+			boundsMin[axis] = value < boundsMin[axis] ? value : boundsMin[axis];
+			boundsMax[axis] = value > boundsMax[axis] ? value : boundsMax[axis];
+		}
+	}
+	float extent = 0.0f;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		extent = boundsMax[axis] - boundsMin[axis] > extent ? boundsMax[axis] - boundsMin[axis] : extent;
+	}
+	if (extent <= 0.0f)
+	{
+		return 0.0f;
+	}
+
+	std::vector<SimplifyPoint> points(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		const float* vertex = vertices + v * floatsPerVertex;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			points[v].p[axis] = (vertex[axis] - boundsMin[axis]) / extent;
+		}
+		points[v].p[3] = floatsPerVertex >= 5 ? vertex[3] * uvWeight : 0.0;
+		points[v].p[4] = floatsPerVertex >= 5 ? vertex[4] * uvWeight : 0.0;
+	}
+
+	// Vertices sharing a position are split along a texture seam, one id per position finds them
+	std::vector<unsigned int> order(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		order[v] = (unsigned int)v;
+	}
+	std::sort(order.begin(), order.end(), [vertices, floatsPerVertex](unsigned int x, unsigned int y)
+	{
+		return memcmp(vertices + x * floatsPerVertex, vertices + y * floatsPerVertex, sizeof(float) * 3) < 0;
+	});
+
+	std::vector<unsigned int> positionId(vertexCount);
+	std::vector<bool> locked(vertexCount, false);
+	for (size_t i = 0; i < vertexCount; )
+	{
+		size_t end = i + 1;
+		while (end < vertexCount && memcmp(vertices + order[i] * floatsPerVertex, vertices + order[end] * floatsPerVertex, sizeof(float) * 3) == 0)
+		{
+			end++;
+		}
+		for (size_t k = i; k < end; k++)
+		{
+			positionId[order[k]] = order[i];
+			locked[order[k]] = end - i > 1;
+		}
+		i = end;
+	}
+
+	// Edges used once are open borders and those used more than twice are non-manifold, both keep their vertices
+	std::vector<uint64_t> edges;
+	edges.reserve(simplified.size());
+	for (size_t t = 0; t < simplified.size(); t += 3)
+	{
+		for (int corner = 0; corner < 3; corner++)
+		{
+			uint64_t a = positionId[simplified[t + corner]];
+			uint64_t b = positionId[simplified[t + (corner + 1) % 3]];
+			edges.push_back(a < b ? (a << 32) | b : (b << 32) | a);
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+	std::vector<bool> lockedPosition(vertexCount, false);
+	for (size_t i = 0; i < edges.size(); )
+	{
+		size_t end = i + 1;
+		while (end < edges.size() && edges[end] == edges[i])
+		{
+			end++;
+		}
+		if (end - i != 2)
+		{
+			lockedPosition[(size_t)(edges[i] >> 32)] = true;
+			lockedPosition[(size_t)(edges[i] & 0xFFFFFFFF)] = true;
+		}
+		i = end;
+	}
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		locked[v] = locked[v] || lockedPosition[positionId[v]];
+	}
+
+	std::vector<Quadric> quadrics(vertexCount);
+	memset(&quadrics[0], 0, sizeof(Quadric) * vertexCount);
+	for (size_t t = 0; t < simplified.size(); t += 3)
+	{
+		Quadric q;
+		TriangleQuadric(points[simplified[t]], points[simplified[t + 1]], points[simplified[t + 2]], q);
+		for (int corner = 0; corner < 3; corner++)
+		{
+			AddQuadric(quadrics[simplified[t + corner]], q);
+		}
+	}
+
+	double errorLimit = (double)maxError / extent;
+	errorLimit *= errorLimit;
+	double reachedError = 0.0;
+
+	std::vector<unsigned int> remap(vertexCount);
+	std::vector<unsigned int> adjacencyOffset(vertexCount + 1);
+	std::vector<unsigned int> adjacency;
+	std::vector<bool> touched(vertexCount);
+	std::vector<Collapse> collapses;
+
+	// Each pass collapses a set of edges far enough apart that none changes another's neighbourhood
+	while (simplified.size() > targetIndexCount)
+	{
+		size_t triangleCount = simplified.size() / 3;
+		std::fill(adjacencyOffset.begin(), adjacencyOffset.end(), 0);
+		for (size_t i = 0; i < simplified.size(); i++)
+		{
+			adjacencyOffset[simplified[i] + 1]++;
+		}
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			adjacencyOffset[v + 1] += adjacencyOffset[v];
+		}
+		adjacency.resize(simplified.size());
+		std::vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+		for (size_t i = 0; i < simplified.size(); i++)
+		{
+			adjacency[fill[simplified[i]]++] = (unsigned int)(i / 3);
+		}
+
+		// Every edge once, from the triangle that has it in ascending order, moving whichever end costs less.
+		// The summed quadric is evaluated where the moving vertex lands.
+		collapses.clear();
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			for (int corner = 0; corner < 3; corner++)
+			{
+				unsigned int a = simplified[t * 3 + corner];
+				unsigned int b = simplified[t * 3 + (corner + 1) % 3];
+				if (a > b || (locked[a] && locked[b]))
+				{
+					continue;
+				}
+
+				Quadric q = quadrics[a];
+				AddQuadric(q, quadrics[b]);
+				double costAB = locked[a] || q.weight <= 0.0 ? DBL_MAX : EvaluateQuadric(q, points[b]) / q.weight;
+				double costBA = locked[b] || q.weight <= 0.0 ? DBL_MAX : EvaluateQuadric(q, points[a]) / q.weight;
+				Collapse collapse = { costAB <= costBA ? costAB : costBA, costAB <= costBA ? a : b, costAB <= costBA ? b : a };
+				collapses.push_back(collapse);
+			}
+		}
+		std::sort(collapses.begin(), collapses.end());
+
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			remap[v] = (unsigned int)v;
+		}
+		std::fill(touched.begin(), touched.end(), false);
+
+		// A collapse removes the two triangles on its edge
+		size_t removable = (simplified.size() - targetIndexCount) / 3;
+		size_t removed = 0;
+		size_t applied = 0;
+		for (size_t c = 0; c < collapses.size() && removed < removable; c++)
+		{
+			const Collapse& collapse = collapses[c];
+			if (collapse.cost > errorLimit)
+			{
+				break;
+			}
+			if (touched[collapse.source] || touched[collapse.target])
+			{
+				continue;
+			}
+
+			// Reject the collapse if any triangle that keeps its area would turn over
+			bool flips = false;
+			unsigned int shared = 0;
+			for (unsigned int a = adjacencyOffset[collapse.source]; a < adjacencyOffset[collapse.source + 1] && !flips; a++)
+			{
+				const unsigned int* triangle = &simplified[adjacency[a] * 3];
+				if (triangle[0] == collapse.target || triangle[1] == collapse.target || triangle[2] == collapse.target)
+				{
+					shared++;
+					continue;
+				}
+
+				const SimplifyPoint* before[3];
+				const SimplifyPoint* after[3];
+				for (int corner = 0; corner < 3; corner++)
+				{
+					before[corner] = &points[triangle[corner]];
+					after[corner] = triangle[corner] == collapse.source ? &points[collapse.target] : before[corner];
+				}
+
+				double n0[3], n1[3];
+				TriangleNormal(*before[0], *before[1], *before[2], n0);
+				TriangleNormal(*after[0], *after[1], *after[2], n1);
+				double dot = n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2];
+				double lengths = sqrt((n0[0] * n0[0] + n0[1] * n0[1] + n0[2] * n0[2]) * (n1[0] * n1[0] + n1[1] * n1[1] + n1[2] * n1[2]));
+				flips = dot <= flipCosine * lengths;
+			}
+			if (flips)
+			{
+				continue;
+			}
+
+			remap[collapse.source] = collapse.target;
+			AddQuadric(quadrics[collapse.target], quadrics[collapse.source]);
+			reachedError = collapse.cost > reachedError ? collapse.cost : reachedError;
+			removed += shared;
+			applied++;
+
+			// The whole neighbourhood of the moved vertex waits for the next pass
+			for (unsigned int a = adjacencyOffset[collapse.source]; a < adjacencyOffset[collapse.source + 1]; a++)
+			{
+				const unsigned int* triangle = &simplified[adjacency[a] * 3];
+				touched[triangle[0]] = true;
+				touched[triangle[1]] = true;
+				touched[triangle[2]] = true;
+			}
+		}
+
+		if (applied == 0)
+		{
+			break;
+		}
+
+		size_t write = 0;
+		for (size_t t = 0; t < simplified.size(); t += 3)
+		{
+			unsigned int a = remap[simplified[t]];
+			unsigned int b = remap[simplified[t + 1]];
+			unsigned int c = remap[simplified[t + 2]];
+			if (a != b && b != c && c != a)
+			{
+				simplified[write++] = a;
+				simplified[write++] = b;
+				simplified[write++] = c;
+			}
+		}
+		simplified.resize(write);
+	}
+
+	return (float)sqrt(reachedError) * extent;
+}
+
+void MeshSimplifier::BuildLodChain(const std::vector<float>& vertices, unsigned int floatsPerVertex, std::vector<unsigned int>& indices, unsigned int maxLevels, std::vector<MeshFileLod>& lods, MeshSimplifyStats& stats)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	size_t vertexCount = vertices.size() / floatsPerVertex;
+	size_t fullCount = indices.size() - indices.size() % 3;
+
+	lods.clear();
+	MeshFileLod full = { 0, (uint32_t)fullCount, 0.0f, 0 };
+	lods.push_back(full);
+	stats.collapses = 0;
+	stats.trianglesBefore = (unsigned int)(fullCount / 3);
+
+	float extent = 0.0f;
+	for (int axis = 0; axis < 3 && vertexCount > 0; axis++)
+	{
+		float low = vertices[axis], high = vertices[axis];
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			float value = vertices[v * floatsPerVertex + axis];
+			low = value < low ? value : low;
+			high = value > high ? value : high;
+		}
+		extent = high - low > extent ? high - low : extent;
+	}
+
+	// Errors add up along the chain, each level measured against the one it was simplified from
+	std::vector<unsigned int> current(indices.begin(), indices.begin() + fullCount);
+	std::vector<unsigned int> next;
+	float error = 0.0f;
+	while (lods.size() < maxLevels && current.size() / 6 >= lodMinTriangles)
+	{
+		size_t target = current.size() / 6 * 3;
+		float levelError = SimplifyMesh(&vertices[0], vertexCount, floatsPerVertex, &current[0], current.size(), target, extent * lodMaxRelativeError, next);
+		if (next.size() > current.size() * lodMinReduction)
+		{
+			break;
+		}
+
+		stats.collapses += (unsigned int)((current.size() - next.size()) / 6);
+		error += levelError;
+		MeshFileLod lod = { (uint32_t)indices.size(), (uint32_t)next.size(), error, 0 };
+		lods.push_back(lod);
+		indices.insert(indices.end(), next.begin(), next.end());
+		current.swap(next);
+	}
+
+	stats.levels = (unsigned int)lods.size();
+	stats.trianglesAfter = (unsigned int)(current.size() / 3);
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
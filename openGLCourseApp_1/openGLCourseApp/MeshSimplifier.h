@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+#include "MeshFormat.h"
+
+struct MeshSimplifyStats
+{
+	double milliseconds;
+	unsigned int levels;
+	unsigned int collapses;
+	// Triangles of the finest and coarsest level
+	unsigned int trianglesBefore, trianglesAfter;
+};
+
+// Edge collapse simplification with quadric error metrics (Garland and Heckbert, "Simplifying Surfaces with
+// Color and Texture using Quadric Error Metrics"). Each vertex carries a quadric over its position and texture
+// coordinate, so collapses that would stretch the texture cost as much as those that move the surface. Vertices
+// on open borders, texture seams and non-manifold edges never move. A collapse moves a vertex onto one of its
+// neighbours, so every level indexes the original vertex buffer.
+class MeshSimplifier
+{
+public:
+	// Collapse the cheapest edges of the triangles in indices until at most targetIndexCount indices remain or
+	// the next collapse would move the surface further than maxError. Returns the error reached, in object units.
+	static float SimplifyMesh(const float* vertices, size_t vertexCount, unsigned int floatsPerVertex, const unsigned int* indices, size_t indexCount, size_t targetIndexCount, float maxError, std::vector<unsigned int>& simplified);
+
+	// Append up to maxLevels - 1 coarser levels to indices, each simplified from the one before to about half its
+	// triangles. lods receives every level's range finest first, the first one the original indices.
+	static void BuildLodChain(const std::vector<float>& vertices, unsigned int floatsPerVertex, std::vector<unsigned int>& indices, unsigned int maxLevels, std::vector<MeshFileLod>& lods, MeshSimplifyStats& stats);
+};
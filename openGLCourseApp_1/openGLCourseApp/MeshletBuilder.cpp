@@ -0,0 +1,344 @@
+#include "MeshletBuilder.h"
+
+#include <math.h>
+#include <float.h>
+#include <chrono>
+
+// Marks a vertex that is not in the meshlet being built
+static const uint8_t noSlot = 0xFF;
+
+// Normal cones wider than this (cosine of the widest normal against the axis) are not worth testing
+static const float coneMinCosine = 0.1f;
+
+struct MeshletInProgress
+{
+	std::vector<uint32_t> vertices;
+	std::vector<uint8_t> triangles;
+	std::vector<uint32_t> sourceTriangles;
+	float centroidSum[3];
+};
+
+// Triangles around each vertex, the first liveCount of them not yet in a meshlet
+struct MeshletAdjacency
+{
+	std::vector<unsigned int> offset;
+	std::vector<unsigned int> liveCount;
+	std::vector<unsigned int> triangles;
+};
+
+// The live triangle around the candidate vertices adding the fewest vertices to a meshlet of meshletVertexCount,
+// then the one closest to its centre. -1 when none fits.
+static long long FindNeighbour(const MeshletAdjacency& adjacency, const unsigned int* indices, const std::vector<uint8_t>& slots, const std::vector<float>& centroids,
+	const uint32_t* candidates, size_t candidateCount, size_t meshletVertexCount, const float* center)
+{
+	long long best = -1;
+	unsigned int bestNew = 4;
+	float bestDistance = FLT_MAX;
+	for (size_t i = 0; i < candidateCount; i++)
+	{
+		unsigned int v = candidates[i];
+		for (unsigned int k = 0; k < adjacency.liveCount[v]; k++)
+		{
+			unsigned int t = adjacency.triangles[adjacency.offset[v] + k];
+			unsigned int newVertices = (slots[indices[t * 3]] == noSlot) + (slots[indices[t * 3 + 1]] == noSlot) + (slots[indices[t * 3 + 2]] == noSlot);
+			if (meshletVertexCount + newVertices > meshletMaxVertices || newVertices > bestNew)
+			{
+				continue;
+			}
+
+			float dx = centroids[t * 3] - center[0];
+			float dy = centroids[t * 3 + 1] - center[1];
+			float dz = centroids[t * 3 + 2] - center[2];
+			float distance = dx * dx + dy * dy + dz * dz;
+			if (newVertices < bestNew || distance < bestDistance)
+			{
+				best = t;
+				bestNew = newVertices;
+				bestDistance = distance;
+			}
+		}
+	}
+	return best;
+}
+
+static void FlushMeshlet(const float* vertices, unsigned int floatsPerVertex, const unsigned int* sourceIndices, MeshletInProgress& current, std::vector<uint8_t>& slots,
+	std::vector<MeshFileMeshlet>& meshlets, std::vector<uint32_t>& meshletVertices, std::vector<uint8_t>& meshletTriangles, std::vector<unsigned int>& orderedIndices)
+{
+	if (current.sourceTriangles.empty())
+	{
+		return;
+	}
+
+	MeshFileMeshlet meshlet;
+	meshlet.vertexOffset = (uint32_t)meshletVertices.size();
+	meshlet.triangleOffset = (uint32_t)(meshletTriangles.size() / 3);
+	meshlet.vertexCount = (uint32_t)current.vertices.size();
+	meshlet.triangleCount = (uint32_t)current.sourceTriangles.size();
+	meshletVertices.insert(meshletVertices.end(), current.vertices.begin(), current.vertices.end());
+	meshletTriangles.insert(meshletTriangles.end(), current.triangles.begin(), current.triangles.end());
+	MeshletBuilder::ComputeMeshletBounds(vertices, floatsPerVertex, &meshletVertices[meshlet.vertexOffset], &meshletTriangles[meshlet.triangleOffset * 3], meshlet);
+	meshlets.push_back(meshlet);
+
+	for (size_t i = 0; i < current.sourceTriangles.size(); i++)
+	{
+		const unsigned int* triangle = sourceIndices + current.sourceTriangles[i] * 3;
+		orderedIndices.insert(orderedIndices.end(), triangle, triangle + 3);
+	}
+	for (size_t i = 0; i < current.vertices.size(); i++)
+	{
+		slots[current.vertices[i]] = noSlot;
+	}
+
+	current.vertices.clear();
+	current.triangles.clear();
+	current.sourceTriangles.clear();
+	current.centroidSum[0] = current.centroidSum[1] = current.centroidSum[2] = 0.0f;
+}
+
+void MeshletBuilder::BuildMeshlets(const float* vertices, size_t vertexCount, unsigned int floatsPerVertex, unsigned int* indices, size_t indexCount,
+	std::vector<MeshFileMeshlet>& meshlets, std::vector<uint32_t>& meshletVertices, std::vector<uint8_t>& meshletTriangles, MeshletBuildStats& stats)
+{
+	auto start = std::chrono::steady_clock::now();
+	meshlets.clear();
+	meshletVertices.clear();
+	meshletTriangles.clear();
+
+	size_t triangleCount = indexCount / 3;
+
+	// Triangles around each vertex
+	MeshletAdjacency adjacency;
+	adjacency.offset.assign(vertexCount + 1, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		adjacency.offset[indices[i] + 1]++;
+	}
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		adjacency.offset[v + 1] += adjacency.offset[v];
+	}
+	adjacency.liveCount.assign(vertexCount, 0);
+	adjacency.triangles.resize(triangleCount * 3);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		for (int corner = 0; corner < 3; corner++)
+		{
+			unsigned int v = indices[t * 3 + corner];
+			adjacency.triangles[adjacency.offset[v] + adjacency.liveCount[v]++] = (unsigned int)t;
+		}
+	}
+
+	std::vector<float> centroids(triangleCount * 3);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			centroids[t * 3 + axis] = (vertices[indices[t * 3] * floatsPerVertex + axis] + vertices[indices[t * 3 + 1] * floatsPerVertex + axis] +
+				vertices[indices[t * 3 + 2] * floatsPerVertex + axis]) / 3.0f;
+		}
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint8_t> slots(vertexCount, noSlot);
+	std::vector<unsigned int> orderedIndices;
+	orderedIndices.reserve(triangleCount * 3);
+
+	MeshletInProgress current;
+	current.centroidSum[0] = current.centroidSum[1] = current.centroidSum[2] = 0.0f;
+
+	size_t nextSeed = 0;
+	size_t emittedCount = 0;
+	while (emittedCount < triangleCount)
+	{
+		long long best = -1;
+		if (!current.sourceTriangles.empty())
+		{
+			float scale = 1.0f / current.sourceTriangles.size();
+			float center[3] = { current.centroidSum[0] * scale, current.centroidSum[1] * scale, current.centroidSum[2] * scale };
+			best = FindNeighbour(adjacency, indices, slots, centroids, &current.vertices[0], current.vertices.size(), current.vertices.size(), center);
+
+			// Pockets the previous meshlet left behind are gathered up before moving on
+			if (best < 0 && !meshlets.empty())
+			{
+				const MeshFileMeshlet& previous = meshlets.back();
+				best = FindNeighbour(adjacency, indices, slots, centroids, &meshletVertices[previous.vertexOffset], previous.vertexCount, current.vertices.size(), center);
+			}
+
+			// Full, or nothing nearby fits: start the next meshlet rather than jump across the mesh
+			if (best < 0)
+			{
+				FlushMeshlet(vertices, floatsPerVertex, indices, current, slots, meshlets, meshletVertices, meshletTriangles, orderedIndices);
+				continue;
+			}
+		}
+		else
+		{
+			// Seed next to the previous meshlet where the fewest triangles are left around, so corners are used
+			// up instead of being stranded as tiny meshlets later
+			if (!meshlets.empty())
+			{
+				const MeshFileMeshlet& previous = meshlets.back();
+				unsigned int bestLive = 0xFFFFFFFFu;
+				for (uint32_t i = previous.vertexOffset; i < previous.vertexOffset + previous.vertexCount; i++)
+				{
+					unsigned int v = meshletVertices[i];
+					for (unsigned int k = 0; k < adjacency.liveCount[v]; k++)
+					{
+						unsigned int t = adjacency.triangles[adjacency.offset[v] + k];
+						unsigned int live = adjacency.liveCount[indices[t * 3]] + adjacency.liveCount[indices[t * 3 + 1]] + adjacency.liveCount[indices[t * 3 + 2]];
+						if (live < bestLive)
+						{
+							best = t;
+							bestLive = live;
+						}
+					}
+				}
+			}
+
+			// Otherwise follow the index order, which MeshOptimizer has already made local
+			if (best < 0)
+			{
+				while (emitted[nextSeed])
+				{
+					nextSeed++;
+				}
+				best = (long long)nextSeed;
+			}
+		}
+
+		unsigned int t = (unsigned int)best;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			unsigned int v = indices[t * 3 + corner];
+			if (slots[v] == noSlot)
+			{
+				slots[v] = (uint8_t)current.vertices.size();
+				current.vertices.push_back(v);
+			}
+			current.triangles.push_back(slots[v]);
+
+			// Drop the triangle from the vertex's live list
+			unsigned int* around = &adjacency.triangles[adjacency.offset[v]];
+			for (unsigned int k = 0; k < adjacency.liveCount[v]; k++)
+			{
+				if (around[k] == t)
+				{
+					around[k] = around[--adjacency.liveCount[v]];
+					break;
+				}
+			}
+		}
+		for (int axis = 0; axis < 3; axis++)
+		{
+			current.centroidSum[axis] += centroids[t * 3 + axis];
+		}
+		current.sourceTriangles.push_back(t);
+		emitted[t] = true;
+		emittedCount++;
+
+		if (current.sourceTriangles.size() == meshletMaxTriangles)
+		{
+			FlushMeshlet(vertices, floatsPerVertex, indices, current, slots, meshlets, meshletVertices, meshletTriangles, orderedIndices);
+		}
+	}
+	FlushMeshlet(vertices, floatsPerVertex, indices, current, slots, meshlets, meshletVertices, meshletTriangles, orderedIndices);
+
+	// Trailing indices of an incomplete triangle stay where they are
+	for (size_t i = 0; i < orderedIndices.size(); i++)
+	{
+		indices[i] = orderedIndices[i];
+	}
+
+	stats.meshlets = (unsigned int)meshlets.size();
+	stats.averageVertices = meshlets.empty() ? 0.0f : (float)meshletVertices.size() / meshlets.size();
+	stats.averageTriangles = meshlets.empty() ? 0.0f : (float)triangleCount / meshlets.size();
+	stats.unconedMeshlets = 0;
+	for (size_t m = 0; m < meshlets.size(); m++)
+	{
+		stats.unconedMeshlets += meshlets[m].coneCutoff >= 1.0f ? 1 : 0;
+	}
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void MeshletBuilder::ComputeMeshletBounds(const float* vertices, unsigned int floatsPerVertex, const uint32_t* meshletVertices, const uint8_t* meshletTriangles, MeshFileMeshlet& meshlet)
+{
+	// Sphere around the centre of the box
+	float low[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float high[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+	{
+		const float* position = vertices + meshletVertices[i] * floatsPerVertex;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			low[axis] = position[axis] < low[axis] ? position[axis] : low[axis];
+			high[axis] = position[axis] > high[axis] ? position[axis] : high[axis];
+		}
+	}
+
+	float radiusSquared = 0.0f;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		meshlet.center[axis] = (low[axis] + high[axis]) * 0.5f;
+	}
+	for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+	{
+		const float* position = vertices + meshletVertices[i] * floatsPerVertex;
+		float dx = position[0] - meshlet.center[0];
+		float dy = position[1] - meshlet.center[1];
+		float dz = position[2] - meshlet.center[2];
+		float distance = dx * dx + dy * dy + dz * dz;
+		radiusSquared = distance > radiusSquared ? distance : radiusSquared;
+	}
+	meshlet.radius = sqrtf(radiusSquared);
+
+	// Unit normals of the counter-clockwise triangles, their average is the cone axis
+	std::vector<float> normals;
+	normals.reserve(meshlet.triangleCount * 3);
+	float axisSum[3] = { 0.0f, 0.0f, 0.0f };
+	for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+	{
+		const float* a = vertices + meshletVertices[meshletTriangles[t * 3]] * floatsPerVertex;
+		const float* b = vertices + meshletVertices[meshletTriangles[t * 3 + 1]] * floatsPerVertex;
+		const float* c = vertices + meshletVertices[meshletTriangles[t * 3 + 2]] * floatsPerVertex;
+		float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+		float normal[3] = { ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0] };
+		float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		if (length <= 0.0f)
+		{
+			continue;
+		}
+		for (int axis = 0; axis < 3; axis++)
+		{
+			normals.push_back(normal[axis] / length);
+			axisSum[axis] += normal[axis] / length;
+		}
+	}
+
+	meshlet.coneAxis[0] = 0.0f;
+	meshlet.coneAxis[1] = 0.0f;
+	meshlet.coneAxis[2] = 1.0f;
+	meshlet.coneCutoff = 1.0f;
+
+	float axisLength = sqrtf(axisSum[0] * axisSum[0] + axisSum[1] * axisSum[1] + axisSum[2] * axisSum[2]);
+	if (normals.empty() || axisLength <= 0.0f)
+	{
+		return;
+	}
+
+	float minCosine = 1.0f;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		meshlet.coneAxis[axis] = axisSum[axis] / axisLength;
+	}
+	for (size_t i = 0; i < normals.size(); i += 3)
+	{
+		float cosine = normals[i] * meshlet.coneAxis[0] + normals[i + 1] * meshlet.coneAxis[1] + normals[i + 2] * meshlet.coneAxis[2];
+		minCosine = cosine < minCosine ? cosine : minCosine;
+	}
+
+	// Stored as the sine of the widest angle, the test's margin once the eye is behind the cone's base
+	if (minCosine > coneMinCosine)
+	{
+		meshlet.coneCutoff = sqrtf(1.0f - minCosine * minCosine);
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "MeshFormat.h"
+
+// Limits of one meshlet, small enough for a mesh shader workgroup and for culling to be worth it
+static const unsigned int meshletMaxVertices = 64;
+static const unsigned int meshletMaxTriangles = 124;
+
+struct MeshletBuildStats
+{
+	double milliseconds;
+	unsigned int meshlets;
+	// Vertices and triangles per meshlet, against meshletMaxVertices and meshletMaxTriangles
+	float averageVertices, averageTriangles;
+	// Meshlets whose normal cone is too wide to ever be rejected as facing away
+	unsigned int unconedMeshlets;
+};
+
+// Splits a triangle list into meshlets for cluster culling. Each meshlet is grown from a seed triangle by
+// adding the neighbouring triangle that needs the fewest new vertices and lies closest to its centre, so
+// meshlets stay compact, then gets a bounding sphere and a cone bounding its triangle normals.
+class MeshletBuilder
+{
+public:
+	// Build meshlets over the triangles in indices, which are rewritten to list them meshlet by meshlet so a
+	// meshlet's first index is triangleOffset * 3. vertexOffset indexes meshletVertices, triangleOffset counts
+	// whole triangles (three bytes each) of meshletTriangles.
+	static void BuildMeshlets(const float* vertices, size_t vertexCount, unsigned int floatsPerVertex, unsigned int* indices, size_t indexCount,
+		std::vector<MeshFileMeshlet>& meshlets, std::vector<uint32_t>& meshletVertices, std::vector<uint8_t>& meshletTriangles, MeshletBuildStats& stats);
+
+	// Bounding sphere and normal cone of one meshlet's triangles. The cone rejects the meshlet for an eye at e when
+	// dot(center - e, coneAxis) >= coneCutoff * |center - e| + radius, a cutoff of 1 never does.
+	static void ComputeMeshletBounds(const float* vertices, unsigned int floatsPerVertex, const uint32_t* meshletVertices, const uint8_t* meshletTriangles, MeshFileMeshlet& meshlet);
+};
@@ -0,0 +1,205 @@
+#include "MeshletCuller.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <float.h>
+#include <chrono>
+#include <xmmintrin.h>
+
+#include "ThreadPool.h"
+
+// Groups of four meshlets per pool job, below two jobs' worth the calling thread tests them alone
+static const size_t cullGroupsPerJob = 1024;
+
+MeshletCuller::MeshletCuller()
+{
+	meshletCount = 0;
+}
+
+bool MeshletCuller::SetMeshlets(const MeshFileMeshlet* meshlets, size_t count, size_t indexCount)
+{
+	meshletCount = 0;
+	meshletRanges.clear();
+
+	size_t nextTriangle = 0;
+	for (size_t m = 0; m < count; m++)
+	{
+		if (meshlets[m].triangleOffset != nextTriangle)
+		{
+			printf("Meshlets do not follow the index order, culling disabled\n");
+			return false;
+		}
+		nextTriangle += meshlets[m].triangleCount;
+	}
+	if (count == 0 || nextTriangle * 3 != indexCount)
+	{
+		printf("Meshlets cover %u of %u indices, culling disabled\n", (unsigned int)(nextTriangle * 3), (unsigned int)indexCount);
+		return false;
+	}
+
+	size_t padded = (count + 3) & ~(size_t)3;
+	centerX.assign(padded, 0.0f);
+	centerY.assign(padded, 0.0f);
+	centerZ.assign(padded, 0.0f);
+	radius.assign(padded, -FLT_MAX);
+	axisX.assign(padded, 0.0f);
+	axisY.assign(padded, 0.0f);
+	axisZ.assign(padded, 1.0f);
+	cutoff.assign(padded, 1.0f);
+
+	for (size_t m = 0; m < count; m++)
+	{
+		centerX[m] = meshlets[m].center[0];
+		centerY[m] = meshlets[m].center[1];
+		centerZ[m] = meshlets[m].center[2];
+		radius[m] = meshlets[m].radius;
+		axisX[m] = meshlets[m].coneAxis[0];
+		axisY[m] = meshlets[m].coneAxis[1];
+		axisZ[m] = meshlets[m].coneAxis[2];
+		cutoff[m] = meshlets[m].coneCutoff;
+
+		MeshletRange range = { meshlets[m].triangleOffset * 3, meshlets[m].triangleCount * 3 };
+		meshletRanges.push_back(range);
+	}
+	meshletCount = count;
+	return true;
+}
+
+void MeshletCuller::CullGroups(size_t firstGroup, size_t lastGroup, const float* planes, const glm::vec3& eye, CullChunk& chunk)
+{
+	chunk.ranges.clear();
+	chunk.frustumCulled = 0;
+	chunk.backfaceCulled = 0;
+
+	__m128 eyeX = _mm_set1_ps(eye.x);
+	__m128 eyeY = _mm_set1_ps(eye.y);
+	__m128 eyeZ = _mm_set1_ps(eye.z);
+
+	for (size_t group = firstGroup; group < lastGroup; group++)
+	{
+		size_t m = group * 4;
+		__m128 x = _mm_loadu_ps(&centerX[m]);
+		__m128 y = _mm_loadu_ps(&centerY[m]);
+		__m128 z = _mm_loadu_ps(&centerZ[m]);
+		__m128 r = _mm_loadu_ps(&radius[m]);
+		__m128 negativeR = _mm_sub_ps(_mm_setzero_ps(), r);
+
+		// Outside when the sphere lies wholly behind any plane
+		__m128 outside = _mm_setzero_ps();
+		for (int p = 0; p < 6; p++)
+		{
+			const float* plane = planes + p * 4;
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane[0])), _mm_mul_ps(y, _mm_set1_ps(plane[1]))),
+				_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane[2])), _mm_set1_ps(plane[3])));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeR));
+		}
+
+		// Facing away when dot(center - eye, axis) >= cutoff * |center - eye| + radius
+		__m128 toX = _mm_sub_ps(x, eyeX);
+		__m128 toY = _mm_sub_ps(y, eyeY);
+		__m128 toZ = _mm_sub_ps(z, eyeZ);
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(toX, toX), _mm_mul_ps(toY, toY)), _mm_mul_ps(toZ, toZ)));
+		__m128 along = _mm_add_ps(_mm_add_ps(_mm_mul_ps(toX, _mm_loadu_ps(&axisX[m])), _mm_mul_ps(toY, _mm_loadu_ps(&axisY[m]))), _mm_mul_ps(toZ, _mm_loadu_ps(&axisZ[m])));
+		__m128 backface = _mm_cmpge_ps(along, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&cutoff[m]), length), r));
+
+		int outsideMask = _mm_movemask_ps(outside);
+		int backfaceMask = _mm_movemask_ps(_mm_andnot_ps(outside, backface));
+		int visibleMask = ~(outsideMask | backfaceMask) & 0xF;
+		for (int lane = 0; lane < 4 && m + lane < meshletCount; lane++)
+		{
+			chunk.frustumCulled += (outsideMask >> lane) & 1;
+			chunk.backfaceCulled += (backfaceMask >> lane) & 1;
+			if (((visibleMask >> lane) & 1) == 0)
+			{
+				continue;
+			}
+
+			// Meshlets that follow each other in the index buffer share a range
+			const MeshletRange& range = meshletRanges[m + lane];
+			if (!chunk.ranges.empty() && chunk.ranges.back().firstIndex + chunk.ranges.back().indexCount == range.firstIndex)
+			{
+				chunk.ranges.back().indexCount += range.indexCount;
+			}
+			else
+			{
+				chunk.ranges.push_back(range);
+			}
+		}
+	}
+}
+
+bool MeshletCuller::Cull(const glm::mat4& modelViewProjection, const glm::vec3& eye, ThreadPool* pool, std::vector<MeshletRange>& ranges, MeshletCullStats& stats)
+{
+	auto start = std::chrono::steady_clock::now();
+	stats.meshlets = (unsigned int)meshletCount;
+	stats.frustumCulled = 0;
+	stats.backfaceCulled = 0;
+	stats.ranges = 0;
+	if (meshletCount == 0)
+	{
+		stats.milliseconds = 0.0;
+		return false;
+	}
+
+	// Object space clip planes from the rows of the matrix (Gribb and Hartmann), normalized so distances are in
+	// object units: left, right, bottom, top, near, far
+	float planes[24];
+	for (int p = 0; p < 6; p++)
+	{
+		int row = p / 2;
+		float sign = p % 2 == 0 ? 1.0f : -1.0f;
+		glm::vec4 plane;
+		for (int column = 0; column < 4; column++)
+		{
+			plane[column] = modelViewProjection[column][3] + sign * modelViewProjection[column][row];
+		}
+		float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+		for (int k = 0; k < 4; k++)
+		{
+			planes[p * 4 + k] = length > 0.0f ? plane[k] / length : 0.0f;
+		}
+	}
+
+	size_t groups = (meshletCount + 3) / 4;
+	size_t chunkCount = pool && groups >= cullGroupsPerJob * 2 ? (groups + cullGroupsPerJob - 1) / cullGroupsPerJob : 1;
+	size_t chunkGroups = (groups + chunkCount - 1) / chunkCount;
+	chunks.resize(chunkCount);
+	if (chunkCount > 1)
+	{
+		pool->ParallelFor(chunkCount, 1, [this, chunkGroups, groups, &planes, &eye](size_t begin, size_t end)
+		{
+			for (size_t c = begin; c < end; c++)
+			{
+				size_t last = (c + 1) * chunkGroups < groups ? (c + 1) * chunkGroups : groups;
+				CullGroups(c * chunkGroups, last, planes, eye, chunks[c]);
+			}
+		});
+	}
+	else
+	{
+		CullGroups(0, groups, planes, eye, chunks[0]);
+	}
+
+	// Join the chunks in order, merging across their seams
+	size_t firstRange = ranges.size();
+	for (size_t c = 0; c < chunkCount; c++)
+	{
+		const CullChunk& chunk = chunks[c];
+		stats.frustumCulled += chunk.frustumCulled;
+		stats.backfaceCulled += chunk.backfaceCulled;
+		for (size_t r = 0; r < chunk.ranges.size(); r++)
+		{
+			if (r == 0 && ranges.size() > firstRange && ranges.back().firstIndex + ranges.back().indexCount == chunk.ranges[r].firstIndex)
+			{
+				ranges.back().indexCount += chunk.ranges[r].indexCount;
+			}
+			else
+			{
+				ranges.push_back(chunk.ranges[r]);
+			}
+		}
+	}
+	stats.ranges = (unsigned int)(ranges.size() - firstRange);
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return stats.ranges > 0;
+}
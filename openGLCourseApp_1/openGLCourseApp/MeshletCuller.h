@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+#include <glm\glm.hpp>
+
+#include "FramePacket.h"
+#include "MeshFormat.h"
+
+class ThreadPool;
+
+struct MeshletCullStats
+{
+	double milliseconds;
+	unsigned int meshlets;
+	unsigned int frustumCulled;
+	unsigned int backfaceCulled;
+	// Index ranges the surviving meshlets merged into, one multi-draw entry each
+	unsigned int ranges;
+};
+
+// Per-meshlet culling of one mesh's finest level on the CPU. The meshlets' spheres and normal cones are kept in
+// structure of arrays form and tested four at a time with SSE, large meshes split across a thread pool. The
+// survivors come out as index ranges, adjacent meshlets merged, ready for Mesh::RenderMeshlets.
+class MeshletCuller
+{
+public:
+	MeshletCuller();
+
+	// Meshlets listing the finest level's triangles in index order, as MeshletBuilder writes them. Returns false
+	// and keeps none if they do not cover exactly indexCount indices.
+	bool SetMeshlets(const MeshFileMeshlet* meshlets, size_t count, size_t indexCount);
+	size_t GetMeshletCount() { return meshletCount; }
+
+	// Append the visible meshlets' ranges for a mesh drawn with modelViewProjection, eye being the camera position
+	// in object space. Returns false when no meshlet survives. pool may be NULL to test on the calling thread.
+	bool Cull(const glm::mat4& modelViewProjection, const glm::vec3& eye, ThreadPool* pool, std::vector<MeshletRange>& ranges, MeshletCullStats& stats);
+
+private:
+	size_t meshletCount;
+
+	// Padded to a multiple of four, the padding is never reported
+	std::vector<float> centerX, centerY, centerZ, radius;
+	std::vector<float> axisX, axisY, axisZ, cutoff;
+	std::vector<MeshletRange> meshletRanges;
+
+	// Survivors of one pool job's groups, joined in order afterwards
+	struct CullChunk
+	{
+		std::vector<MeshletRange> ranges;
+		unsigned int frustumCulled;
+		unsigned int backfaceCulled;
+	};
+	std::vector<CullChunk> chunks;
+
+	void CullGroups(size_t firstGroup, size_t lastGroup, const float* planes, const glm::vec3& eye, CullChunk& chunk);
+};
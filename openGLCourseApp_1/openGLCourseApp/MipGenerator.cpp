@@ -0,0 +1,398 @@
+#include "MipGenerator.h"
+
+#include <math.h>
+#include <string.h>
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define MIP_TARGET_AVX2
+#else
+#define MIP_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// Linear values are re-encoded through a table indexed by linear * (linearEncodeSize - 1)
+static const int linearEncodeSize = 4096;
+
+struct ConversionTables
+{
+	// 0..255 sRGB colour to linear, 256..511 plain 8-bit (used for alpha)
+	float decode[512];
+	// 0..4095 linear colour to sRGB, 4096..4351 identity (used for alpha)
+	int encode[linearEncodeSize + 256];
+
+	ConversionTables()
+	{
+		for (int i = 0; i < 256; i++)
+		{
+			float c = i / 255.0f;
+			decode[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+			decode[256 + i] = c;
+			encode[linearEncodeSize + i] = i;
+		}
+
+		for (int i = 0; i < linearEncodeSize; i++)
+		{
+			float c = (float)i / (linearEncodeSize - 1);
+			float s = c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+			encode[i] = (int)(s * 255.0f + 0.5f);
+		}
+	}
+};
+
+static const ConversionTables& Tables()
+{
+	static const ConversionTables tables;
+	return tables;
+}
+
+static inline __m128 DecodePixel(const unsigned char* p, bool srgb, const ConversionTables& tables)
+{
+	const float* colour = srgb ? tables.decode : tables.decode + 256;
+	return _mm_set_ps(tables.decode[256 + p[3]], colour[p[2]], colour[p[1]], colour[p[0]]);
+}
+
+static inline void EncodePixel(__m128 v, bool srgb, const ConversionTables& tables, unsigned char* out)
+{
+	v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+
+	int values[4];
+	if (srgb)
+	{
+		_mm_storeu_si128((__m128i*)values, _mm_cvtps_epi32(_mm_mul_ps(v, _mm_set_ps(255.0f, 4095.0f, 4095.0f, 4095.0f))));
+		out[0] = (unsigned char)tables.encode[values[0]];
+		out[1] = (unsigned char)tables.encode[values[1]];
+		out[2] = (unsigned char)tables.encode[values[2]];
+	}
+	else
+	{
+		_mm_storeu_si128((__m128i*)values, _mm_cvtps_epi32(_mm_mul_ps(v, _mm_set1_ps(255.0f))));
+		out[0] = (unsigned char)values[0];
+		out[1] = (unsigned char)values[1];
+		out[2] = (unsigned char)values[2];
+	}
+	out[3] = (unsigned char)values[3];
+}
+
+// 2x2 box for one output row of plain 8-bit data, rounding to nearest
+static void DownsampleRowSSE2(const unsigned char* row0, const unsigned char* row1, unsigned char* out, int outWidth)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i two = _mm_set1_epi16(2);
+
+	int x = 0;
+	for (; x + 2 <= outWidth; x += 2)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)(row0 + x * 8));
+		__m128i b = _mm_loadu_si128((const __m128i*)(row1 + x * 8));
+
+		// Vertical sums of four source pixels, then fold neighbouring pixels together
+		__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+		__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+		lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+		hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+
+		__m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo, hi), two), 2);
+		_mm_storel_epi64((__m128i*)(out + x * 4), _mm_packus_epi16(sum, sum));
+	}
+
+	for (; x < outWidth; x++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			out[x * 4 + c] = (unsigned char)((row0[x * 8 + c] + row0[x * 8 + 4 + c] + row1[x * 8 + c] + row1[x * 8 + 4 + c] + 2) >> 2);
+		}
+	}
+}
+
+MIP_TARGET_AVX2 static void DownsampleRowAVX2(const unsigned char* row0, const unsigned char* row1, unsigned char* out, int outWidth)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i two = _mm256_set1_epi16(2);
+
+	int x = 0;
+	for (; x + 4 <= outWidth; x += 4)
+	{
+		__m256i a = _mm256_loadu_si256((const __m256i*)(row0 + x * 8));
+		__m256i b = _mm256_loadu_si256((const __m256i*)(row1 + x * 8));
+
+		// Same folding as the SSE2 kernel, independently in each 128-bit lane
+		__m256i lo = _mm256_add_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero));
+		__m256i hi = _mm256_add_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero));
+		lo = _mm256_add_epi16(lo, _mm256_srli_si256(lo, 8));
+		hi = _mm256_add_epi16(hi, _mm256_srli_si256(hi, 8));
+
+		__m256i sum = _mm256_srli_epi16(_mm256_add_epi16(_mm256_unpacklo_epi64(lo, hi), two), 2);
+		__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(sum, sum), 0x08);
+		_mm_storeu_si128((__m128i*)(out + x * 4), _mm256_castsi256_si128(packed));
+	}
+
+	DownsampleRowSSE2(row0 + x * 8, row1 + x * 8, out + x * 4, outWidth - x);
+}
+
+// 2x2 box for one output row of sRGB colour, averaged in linear light
+static void DownsampleRowSrgbSSE2(const unsigned char* row0, const unsigned char* row1, unsigned char* out, int outWidth)
+{
+	const ConversionTables& tables = Tables();
+	const __m128 quarter = _mm_set1_ps(0.25f);
+
+	for (int x = 0; x < outWidth; x++)
+	{
+		__m128 sum = _mm_add_ps(_mm_add_ps(DecodePixel(row0 + x * 8, true, tables), DecodePixel(row0 + x * 8 + 4, true, tables)),
+			_mm_add_ps(DecodePixel(row1 + x * 8, true, tables), DecodePixel(row1 + x * 8 + 4, true, tables)));
+		EncodePixel(_mm_mul_ps(sum, quarter), true, tables, out + x * 4);
+	}
+}
+
+MIP_TARGET_AVX2 static void DownsampleRowSrgbAVX2(const unsigned char* row0, const unsigned char* row1, unsigned char* out, int outWidth)
+{
+	const ConversionTables& tables = Tables();
+
+	// Alpha lanes read the plain half of each table
+	const __m256i decodeOffset = _mm256_setr_epi32(0, 0, 0, 256, 0, 0, 0, 256);
+	const __m256i encodeOffset = _mm256_setr_epi32(0, 0, 0, linearEncodeSize, 0, 0, 0, linearEncodeSize);
+	const __m256 encodeScale = _mm256_setr_ps(4095.0f, 4095.0f, 4095.0f, 255.0f, 4095.0f, 4095.0f, 4095.0f, 255.0f);
+	const __m256 quarter = _mm256_set1_ps(0.25f);
+	const __m256 one = _mm256_set1_ps(1.0f);
+
+	int x = 0;
+	for (; x + 2 <= outWidth; x += 2)
+	{
+		// Each gather decodes two source pixels
+		__m256 a0 = _mm256_i32gather_ps(tables.decode, _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(row0 + x * 8))), decodeOffset), 4);
+		__m256 a1 = _mm256_i32gather_ps(tables.decode, _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(row0 + x * 8 + 8))), decodeOffset), 4);
+		__m256 b0 = _mm256_i32gather_ps(tables.decode, _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(row1 + x * 8))), decodeOffset), 4);
+		__m256 b1 = _mm256_i32gather_ps(tables.decode, _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(row1 + x * 8 + 8))), decodeOffset), 4);
+
+		// [p0 p1] + [p2 p3] per row, then pair the horizontal neighbours into [out0 out1]
+		__m256 first = _mm256_add_ps(a0, b0);
+		__m256 second = _mm256_add_ps(a1, b1);
+		__m256 sum = _mm256_add_ps(_mm256_permute2f128_ps(first, second, 0x20), _mm256_permute2f128_ps(first, second, 0x31));
+		sum = _mm256_min_ps(_mm256_mul_ps(sum, quarter), one);
+
+		__m256i indices = _mm256_add_epi32(_mm256_cvtps_epi32(_mm256_mul_ps(sum, encodeScale)), encodeOffset);
+		__m256i encoded = _mm256_i32gather_epi32(tables.encode, indices, 4);
+		encoded = _mm256_packus_epi32(encoded, encoded);
+		encoded = _mm256_packus_epi16(encoded, encoded);
+
+		int pixel0 = _mm_cvtsi128_si32(_mm256_castsi256_si128(encoded));
+		int pixel1 = _mm_cvtsi128_si32(_mm256_extracti128_si256(encoded, 1));
+		memcpy(out + x * 4, &pixel0, 4);
+		memcpy(out + x * 4 + 4, &pixel1, 4);
+	}
+
+	DownsampleRowSrgbSSE2(row0 + x * 8, row1 + x * 8, out + x * 4, outWidth - x);
+}
+
+// Source taps for one output coordinate: a 2 tap box for even sizes, the exact-area 3 tap filter for odd ones
+static int BuildTaps(int srcSize, int dstSize, int d, int* indices, float* weights)
+{
+	if (srcSize == 1)
+	{
+		indices[0] = 0;
+		weights[0] = 1.0f;
+		return 1;
+	}
+
+	if (srcSize % 2 == 0)
+	{
+		indices[0] = d * 2;
+		indices[1] = d * 2 + 1;
+		weights[0] = weights[1] = 0.5f;
+		return 2;
+	}
+
+	float span = (float)srcSize;
+	indices[0] = d * 2;
+	indices[1] = d * 2 + 1;
+	indices[2] = d * 2 + 2;
+	weights[0] = (dstSize - d) / span;
+	weights[1] = dstSize / span;
+	weights[2] = (d + 1) / span;
+	return 3;
+}
+
+static void DownsampleGeneric(const unsigned char* src, int srcWidth, int srcHeight, bool srgb, unsigned char* dst, int dstWidth, int dstHeight)
+{
+	const ConversionTables& tables = Tables();
+
+	for (int y = 0; y < dstHeight; y++)
+	{
+		int rowIndices[3];
+		float rowWeights[3];
+		int rowTaps = BuildTaps(srcHeight, dstHeight, y, rowIndices, rowWeights);
+
+		for (int x = 0; x < dstWidth; x++)
+		{
+			int columnIndices[3];
+			float columnWeights[3];
+			int columnTaps = BuildTaps(srcWidth, dstWidth, x, columnIndices, columnWeights);
+
+			__m128 sum = _mm_setzero_ps();
+			for (int ty = 0; ty < rowTaps; ty++)
+			{
+				const unsigned char* row = src + (size_t)rowIndices[ty] * srcWidth * 4;
+				for (int tx = 0; tx < columnTaps; tx++)
+				{
+					__m128 weight = _mm_set1_ps(rowWeights[ty] * columnWeights[tx]);
+					sum = _mm_add_ps(sum, _mm_mul_ps(DecodePixel(row + columnIndices[tx] * 4, srgb, tables), weight));
+				}
+			}
+
+			EncodePixel(sum, srgb, tables, dst + ((size_t)y * dstWidth + x) * 4);
+		}
+	}
+}
+
+void MipGenerator::Downsample(const unsigned char* src, int srcWidth, int srcHeight, bool srgb, unsigned char* dst)
+{
+	int dstWidth = srcWidth > 1 ? srcWidth / 2 : 1;
+	int dstHeight = srcHeight > 1 ? srcHeight / 2 : 1;
+
+	// Odd sizes and 1 pixel wide/tall levels need the general filter
+	if (srcWidth % 2 != 0 || srcHeight % 2 != 0)
+	{
+		DownsampleGeneric(src, srcWidth, srcHeight, srgb, dst, dstWidth, dstHeight);
+		return;
+	}
+
+	static const bool useAVX2 = HasAVX2();
+	size_t srcStride = (size_t)srcWidth * 4;
+
+	for (int y = 0; y < dstHeight; y++)
+	{
+		const unsigned char* row0 = src + srcStride * y * 2;
+		const unsigned char* row1 = row0 + srcStride;
+		unsigned char* out = dst + (size_t)dstWidth * 4 * y;
+
+		if (srgb)
+		{
+			if (useAVX2)
+			{
+				DownsampleRowSrgbAVX2(row0, row1, out, dstWidth);
+			}
+			else
+			{
+				DownsampleRowSrgbSSE2(row0, row1, out, dstWidth);
+			}
+		}
+		else
+		{
+			if (useAVX2)
+			{
+				DownsampleRowAVX2(row0, row1, out, dstWidth);
+			}
+			else
+			{
+				DownsampleRowSSE2(row0, row1, out, dstWidth);
+			}
+		}
+	}
+}
+
+void MipGenerator::GenerateMipChain(const unsigned char* rgba, int width, int height, bool srgb, float alphaCutoff,
+	std::vector<unsigned char>& chain, std::vector<size_t>& levelOffsets)
+{
+	levelOffsets.clear();
+
+	size_t total = 0;
+	int levelWidth = width, levelHeight = height;
+	while (true)
+	{
+		levelOffsets.push_back(total);
+		total += (size_t)levelWidth * levelHeight * 4;
+		if (levelWidth == 1 && levelHeight == 1)
+		{
+			break;
+		}
+		levelWidth = levelWidth > 1 ? levelWidth / 2 : 1;
+		levelHeight = levelHeight > 1 ? levelHeight / 2 : 1;
+	}
+	levelOffsets.push_back(total);
+
+	chain.resize(total);
+	memcpy(&chain[0], rgba, (size_t)width * height * 4);
+
+	// Every level is filtered from the unscaled level above, coverage is fixed up afterwards
+	levelWidth = width;
+	levelHeight = height;
+	for (size_t level = 1; level + 1 < levelOffsets.size(); level++)
+	{
+		Downsample(&chain[levelOffsets[level - 1]], levelWidth, levelHeight, srgb, &chain[levelOffsets[level]]);
+		levelWidth = levelWidth > 1 ? levelWidth / 2 : 1;
+		levelHeight = levelHeight > 1 ? levelHeight / 2 : 1;
+	}
+
+	if (alphaCutoff > 0.0f)
+	{
+		float coverage = CalculateAlphaCoverage(&chain[0], (size_t)width * height, alphaCutoff, 1.0f);
+		for (size_t level = 1; level + 1 < levelOffsets.size(); level++)
+		{
+			PreserveAlphaCoverage(&chain[levelOffsets[level]], (levelOffsets[level + 1] - levelOffsets[level]) / 4, alphaCutoff, coverage);
+		}
+	}
+}
+
+float MipGenerator::CalculateAlphaCoverage(const unsigned char* rgba, size_t pixelCount, float alphaCutoff, float alphaScale)
+{
+	size_t covered = 0;
+	float threshold = alphaCutoff * 255.0f;
+	for (size_t i = 0; i < pixelCount; i++)
+	{
+		if (rgba[i * 4 + 3] * alphaScale > threshold)
+		{
+			covered++;
+		}
+	}
+	return pixelCount ? (float)covered / pixelCount : 0.0f;
+}
+
+void MipGenerator::PreserveAlphaCoverage(unsigned char* rgba, size_t pixelCount, float alphaCutoff, float targetCoverage)
+{
+	// Coverage only grows with the scale, so binary search for the one that matches the target
+	float low = 0.0f, high = 4.0f, scale = 1.0f;
+	for (int i = 0; i < 10; i++)
+	{
+		scale = (low + high) * 0.5f;
+		float coverage = CalculateAlphaCoverage(rgba, pixelCount, alphaCutoff, scale);
+		if (coverage < targetCoverage)
+		{
+			low = scale;
+		}
+		else if (coverage > targetCoverage)
+		{
+			high = scale;
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	for (size_t i = 0; i < pixelCount; i++)
+	{
+		float alpha = rgba[i * 4 + 3] * scale + 0.5f;
+		rgba[i * 4 + 3] = (unsigned char)(alpha > 255.0f ? 255.0f : alpha);
+	}
+}
+
+bool MipGenerator::HasAVX2()
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+	{
+		return false;
+	}
+
+	// The OS must also save the upper halves of the YMM registers
+	__cpuid(info, 1);
+	bool osSupport = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+
+	__cpuidex(info, 7, 0);
+	return osSupport && (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
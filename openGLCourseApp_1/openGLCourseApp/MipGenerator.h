@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+// CPU mip generation for RGBA8 images, so textures decoded on a worker arrive with every level ready
+// and the GL thread never has to run glGenerateMipmap. Even sized levels use SSE2/AVX2 2x2 box kernels,
+// odd sizes fall back to an exact-area 3 tap filter. sRGB colour is averaged in linear light.
+class MipGenerator
+{
+public:
+	// Build the full chain (largest first, tightly packed) from a level 0 image. levelOffsets receives
+	// levelCount + 1 entries, the last being the total size. When alphaCutoff is above zero the alpha
+	// of every level is rescaled so the fraction of texels passing the cutoff matches level 0.
+	static void GenerateMipChain(const unsigned char* rgba, int width, int height, bool srgb, float alphaCutoff,
+		std::vector<unsigned char>& chain, std::vector<size_t>& levelOffsets);
+
+	// Halve one level (rounding down, minimum 1), dst must hold the smaller level
+	static void Downsample(const unsigned char* src, int srcWidth, int srcHeight, bool srgb, unsigned char* dst);
+
+	// Fraction of texels whose alpha, multiplied by alphaScale, is above alphaCutoff (0..1)
+	static float CalculateAlphaCoverage(const unsigned char* rgba, size_t pixelCount, float alphaCutoff, float alphaScale);
+	static void PreserveAlphaCoverage(unsigned char* rgba, size_t pixelCount, float alphaCutoff, float targetCoverage);
+
+	static bool HasAVX2();
+};
@@ -0,0 +1,445 @@
+#include "ObjImporter.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <chrono>
+#include <unordered_map>
+
+#include "MappedFile.h"
+
+// Work is split into chunks of about this size, cut at the next line break
+static const size_t chunkBytes = 4 * 1024 * 1024;
+
+// Deduplication shards, each owned by one worker while it assigns indices
+static const size_t shardCount = 64;
+
+static inline bool IsBlank(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline const char* SkipBlanks(const char* text, const char* end)
+{
+	while (text < end && IsBlank(*text))
+	{
+		text++;
+	}
+	return text;
+}
+
+static inline bool StartsElement(const char* text, const char* end, const char* keyword, size_t length)
+{
+	return (size_t)(end - text) > length && memcmp(text, keyword, length) == 0 && IsBlank(text[length]);
+}
+
+static inline size_t ShardOf(unsigned long long key)
+{
+	return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 58) % shardCount;
+}
+
+static const char* ParseInteger(const char* text, const char* end, long long& value)
+{
+	bool negative = false;
+	if (text < end && (*text == '-' || *text == '+'))
+	{
+		negative = *text == '-';
+		text++;
+	}
+
+	long long result = 0;
+	while (text < end && *text >= '0' && *text <= '9')
+	{
+		result = result * 10 + (*text - '0');
+		text++;
+	}
+
+	value = negative ? -result : result;
+	return text;
+}
+
+const char* ObjImporter::ParseFloat(const char* text, const char* end, float& value)
+{
+	static const double powers[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	bool negative = false;
+	if (text < end && (*text == '-' || *text == '+'))
+	{
+		negative = *text == '-';
+		text++;
+	}
+
+	// Up to 18 significant digits are kept exactly, anything after only moves the exponent
+	unsigned long long mantissa = 0;
+	int exponent = 0;
+	while (text < end && *text >= '0' && *text <= '9')
+	{
+		if (mantissa < 100000000000000000ULL)
+		{
+			mantissa = mantissa * 10 + (*text - '0');
+		}
+		else
+		{
+			exponent++;
+		}
+		text++;
+	}
+
+	if (text < end && *text == '.')
+	{
+		text++;
+		while (text < end && *text >= '0' && *text <= '9')
+		{
+			if (mantissa < 100000000000000000ULL)
+			{
+				mantissa = mantissa * 10 + (*text - '0');
+				exponent--;
+			}
+			text++;
+		}
+	}
+
+	if (text < end && (*text == 'e' || *text == 'E'))
+	{
+		long long written;
+		const char* after = ParseInteger(text + 1, end, written);
+		if (after > text + 1 && (after[-1] >= '0' && after[-1] <= '9'))
+		{
+			exponent += (int)(written > 400 ? 400 : (written < -400 ? -400 : written));
+			text = after;
+		}
+	}
+
+	double result = (double)mantissa;
+	if (exponent < 0)
+	{
+		for (; exponent < -22; exponent += 22)
+		{
+			result /= 1e22;
+		}
+		result /= powers[-exponent];
+	}
+	else
+	{
+		for (; exponent > 22; exponent -= 22)
+		{
+			result *= 1e22;
+		}
+		result *= powers[exponent];
+	}
+
+	value = (float)(negative ? -result : result);
+	return text;
+}
+
+void ObjImporter::CountChunk(Chunk& chunk)
+{
+	chunk.positionCount = 0;
+	chunk.texCoordCount = 0;
+
+	for (const char* cursor = chunk.begin; cursor < chunk.end;)
+	{
+		const char* lineEnd = (const char*)memchr(cursor, '\n', chunk.end - cursor);
+		lineEnd = lineEnd ? lineEnd : chunk.end;
+
+		const char* text = SkipBlanks(cursor, lineEnd);
+		if (StartsElement(text, lineEnd, "v", 1))
+		{
+			chunk.positionCount++;
+		}
+		else if (StartsElement(text, lineEnd, "vt", 2))
+		{
+			chunk.texCoordCount++;
+		}
+
+		cursor = lineEnd + 1;
+	}
+}
+
+void ObjImporter::ParseChunk(Chunk& chunk, float* positions, float* texCoords, size_t totalPositions, size_t totalTexCoords)
+{
+	size_t positionIndex = chunk.positionBase;
+	size_t texCoordIndex = chunk.texCoordBase;
+	std::vector<unsigned long long> polygon;
+
+	for (const char* cursor = chunk.begin; cursor < chunk.end;)
+	{
+		const char* lineEnd = (const char*)memchr(cursor, '\n', chunk.end - cursor);
+		lineEnd = lineEnd ? lineEnd : chunk.end;
+
+		const char* text = SkipBlanks(cursor, lineEnd);
+		cursor = lineEnd + 1;
+
+		if (StartsElement(text, lineEnd, "v", 1))
+		{
+			// Missing components stay zero, trailing weights or colours are ignored
+			float* position = positions + positionIndex * 3;
+			position[0] = position[1] = position[2] = 0.0f;
+			text += 2;
+			for (int i = 0; i < 3; i++)
+			{
+				text = ParseFloat(SkipBlanks(text, lineEnd), lineEnd, position[i]);
+			}
+			positionIndex++;
+		}
+		else if (StartsElement(text, lineEnd, "vt", 2))
+		{
+			float* texCoord = texCoords + texCoordIndex * 2;
+			texCoord[0] = texCoord[1] = 0.0f;
+			text += 3;
+			for (int i = 0; i < 2; i++)
+			{
+				text = ParseFloat(SkipBlanks(text, lineEnd), lineEnd, texCoord[i]);
+			}
+			texCoordIndex++;
+		}
+		else if (StartsElement(text, lineEnd, "f", 1))
+		{
+			polygon.clear();
+			text += 2;
+			while (true)
+			{
+				text = SkipBlanks(text, lineEnd);
+				long long position = 0, texCoord = 0, normal = 0;
+				const char* after = ParseInteger(text, lineEnd, position);
+				if (after == text || position == 0)
+				{
+					break;
+				}
+				text = after;
+
+				if (text < lineEnd && *text == '/')
+				{
+					text++;
+					if (text < lineEnd && *text != '/')
+					{
+						text = ParseInteger(text, lineEnd, texCoord);
+					}
+					if (text < lineEnd && *text == '/')
+					{
+						text = ParseInteger(text + 1, lineEnd, normal);
+					}
+				}
+
+				// Negative indices count back from the elements defined so far, which the counting pass made global
+				long long resolvedPosition = position < 0 ? (long long)positionIndex + position : position - 1;
+				long long resolvedTexCoord = texCoord < 0 ? (long long)texCoordIndex + texCoord : texCoord - 1;
+				if (resolvedPosition < 0 || resolvedPosition >= (long long)totalPositions ||
+					(texCoord != 0 && (resolvedTexCoord < 0 || resolvedTexCoord >= (long long)totalTexCoords)))
+				{
+					chunk.failed = true;
+					return;
+				}
+
+				unsigned long long key = ((unsigned long long)resolvedPosition << 32) | (unsigned long long)(texCoord != 0 ? resolvedTexCoord + 1 : 0);
+				polygon.push_back(key);
+			}
+
+			for (size_t i = 2; i < polygon.size(); i++)
+			{
+				chunk.corners.push_back(polygon[0]);
+				chunk.corners.push_back(polygon[i - 1]);
+				chunk.corners.push_back(polygon[i]);
+			}
+		}
+	}
+}
+
+bool ObjImporter::ImportObj(const char* fileLocation, ThreadPool* pool, std::vector<float>& vertices, std::vector<unsigned int>& indices, ObjImportStats& stats)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	memset(&stats, 0, sizeof(stats));
+
+	MappedFile file;
+	if (!file.Open(fileLocation))
+	{
+		return false;
+	}
+
+	const char* data = (const char*)file.GetData();
+	const char* dataEnd = data + file.GetSize();
+
+	std::vector<Chunk> chunks;
+	for (const char* begin = data; begin < dataEnd;)
+	{
+		const char* end = (size_t)(dataEnd - begin) > chunkBytes ? begin + chunkBytes : dataEnd;
+		const char* lineEnd = end < dataEnd ? (const char*)memchr(end, '\n', dataEnd - end) : NULL;
+		end = lineEnd ? lineEnd + 1 : dataEnd;
+
+		Chunk chunk;
+		chunk.begin = begin;
+		chunk.end = end;
+		chunk.positionBase = chunk.texCoordBase = 0;
+		chunk.positionCount = chunk.texCoordCount = 0;
+		chunk.cornerBase = 0;
+		chunk.failed = false;
+		chunks.push_back(chunk);
+		begin = end;
+	}
+
+	pool->ParallelFor(chunks.size(), 1, [&chunks](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			CountChunk(chunks[i]);
+		}
+	});
+
+	size_t totalPositions = 0, totalTexCoords = 0;
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		chunks[i].positionBase = totalPositions;
+		chunks[i].texCoordBase = totalTexCoords;
+		totalPositions += chunks[i].positionCount;
+		totalTexCoords += chunks[i].texCoordCount;
+	}
+
+	if (totalPositions >= UINT_MAX || totalTexCoords >= UINT_MAX)
+	{
+		printf("%s: too many vertices\n", fileLocation);
+		return false;
+	}
+
+	std::vector<float> positions(totalPositions * 3);
+	std::vector<float> texCoords(totalTexCoords * 2 + 2);
+	float* positionData = positions.empty() ? NULL : &positions[0];
+	float* texCoordData = &texCoords[0];
+
+	pool->ParallelFor(chunks.size(), 1, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			ParseChunk(chunks[i], positionData, texCoordData, totalPositions, totalTexCoords);
+		}
+	});
+
+	size_t totalCorners = 0;
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		if (chunks[i].failed)
+		{
+			printf("%s: a face refers to a missing vertex\n", fileLocation);
+			return false;
+		}
+		chunks[i].cornerBase = totalCorners;
+		totalCorners += chunks[i].corners.size();
+	}
+
+	if (totalCorners == 0)
+	{
+		printf("%s: no faces\n", fileLocation);
+		return false;
+	}
+
+	// Every chunk sorts its corners into the shards, then each shard numbers its distinct corners
+	// walking the chunks in file order, so the result does not depend on scheduling
+	std::vector<std::vector<std::vector<unsigned long long>>> shardCorners(chunks.size(), std::vector<std::vector<unsigned long long>>(shardCount));
+	pool->ParallelFor(chunks.size(), 1, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			const std::vector<unsigned long long>& corners = chunks[i].corners;
+			for (size_t c = 0; c < corners.size(); c++)
+			{
+				shardCorners[i][ShardOf(corners[c])].push_back(corners[c]);
+			}
+		}
+	});
+
+	std::vector<std::unordered_map<unsigned long long, unsigned int>> shardLookup(shardCount);
+	std::vector<std::vector<unsigned long long>> shardVertices(shardCount);
+	pool->ParallelFor(shardCount, 1, [&](size_t begin, size_t end)
+	{
+		for (size_t s = begin; s < end; s++)
+		{
+			size_t expected = 0;
+			for (size_t i = 0; i < chunks.size(); i++)
+			{
+				expected += shardCorners[i][s].size();
+			}
+			shardLookup[s].reserve(expected / 4 + 16);
+
+			for (size_t i = 0; i < chunks.size(); i++)
+			{
+				const std::vector<unsigned long long>& corners = shardCorners[i][s];
+				for (size_t c = 0; c < corners.size(); c++)
+				{
+					if (shardLookup[s].insert(std::make_pair(corners[c], (unsigned int)shardVertices[s].size())).second)
+					{
+						shardVertices[s].push_back(corners[c]);
+					}
+				}
+				std::vector<unsigned long long>().swap(shardCorners[i][s]);
+			}
+		}
+	});
+
+	std::vector<size_t> shardBase(shardCount);
+	size_t totalVertices = 0;
+	for (size_t s = 0; s < shardCount; s++)
+	{
+		shardBase[s] = totalVertices;
+		totalVertices += shardVertices[s].size();
+	}
+
+	indices.resize(totalCorners);
+	pool->ParallelFor(chunks.size(), 1, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			const std::vector<unsigned long long>& corners = chunks[i].corners;
+			for (size_t c = 0; c < corners.size(); c++)
+			{
+				size_t s = ShardOf(corners[c]);
+				indices[chunks[i].cornerBase + c] = (unsigned int)(shardBase[s] + shardLookup[s].find(corners[c])->second);
+			}
+			std::vector<unsigned long long>().swap(chunks[i].corners);
+		}
+	});
+
+	// Shard order scatters neighbours, renumber in order of first use so nearby triangles share nearby vertices
+	std::vector<unsigned int> remap(totalVertices, UINT_MAX);
+	unsigned int nextVertex = 0;
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		unsigned int& index = remap[indices[i]];
+		if (index == UINT_MAX)
+		{
+			index = nextVertex++;
+		}
+		indices[i] = index;
+	}
+
+	vertices.resize(totalVertices * 5);
+	pool->ParallelFor(shardCount, 1, [&](size_t begin, size_t end)
+	{
+		for (size_t s = begin; s < end; s++)
+		{
+			for (size_t v = 0; v < shardVertices[s].size(); v++)
+			{
+				unsigned long long key = shardVertices[s][v];
+				const float* position = &positions[(size_t)(key >> 32) * 3];
+				const float* texCoord = (key & 0xFFFFFFFFULL) ? &texCoords[(size_t)((key & 0xFFFFFFFFULL) - 1) * 2] : NULL;
+
+				float* vertex = &vertices[(size_t)remap[shardBase[s] + v] * 5];
+				vertex[0] = position[0];
+				vertex[1] = position[1];
+				vertex[2] = position[2];
+				vertex[3] = texCoord ? texCoord[0] : 0.0f;
+				vertex[4] = texCoord ? texCoord[1] : 0.0f;
+			}
+		}
+	});
+
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	stats.fileBytes = file.GetSize();
+	stats.chunks = (unsigned int)chunks.size();
+	stats.positions = (unsigned int)totalPositions;
+	stats.texCoords = (unsigned int)totalTexCoords;
+	stats.vertices = (unsigned int)totalVertices;
+	stats.triangles = (unsigned int)(indices.size() / 3);
+	return true;
+}
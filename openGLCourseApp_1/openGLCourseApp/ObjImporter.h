@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+
+#include "ThreadPool.h"
+
+struct ObjImportStats
+{
+	double milliseconds;
+	size_t fileBytes;
+	unsigned int chunks;
+	unsigned int positions;
+	unsigned int texCoords;
+	unsigned int vertices;
+	unsigned int triangles;
+};
+
+// Wavefront OBJ import for large scans. The file is mapped and cut into chunks at line boundaries; one
+// pass counts the positions and texture coordinates in each chunk so every chunk knows where its
+// elements land globally, a second parses the chunks in parallel. Face corners are then deduplicated in
+// hash shards that each worker owns outright, and the vertices renumbered in first use order.
+class ObjImporter
+{
+public:
+	// Interleaved x, y, z, u, v vertices and triangle indices, as Mesh::CreateMesh takes them.
+	// Polygons are triangulated as fans, normals are not imported.
+	static bool ImportObj(const char* fileLocation, ThreadPool* pool, std::vector<float>& vertices, std::vector<unsigned int>& indices, ObjImportStats& stats);
+
+	// Locale independent, handles the decimal and exponent forms OBJ exporters write. Returns the
+	// character after the number.
+	static const char* ParseFloat(const char* text, const char* end, float& value);
+
+private:
+	struct Chunk
+	{
+		const char* begin;
+		const char* end;
+		size_t positionBase, texCoordBase;
+		size_t positionCount, texCoordCount;
+
+		// Position and texture coordinate pairs of every triangle corner, texture coordinate + 1 so 0 means none
+		std::vector<unsigned long long> corners;
+		size_t cornerBase;
+		bool failed;
+	};
+
+	static void CountChunk(Chunk& chunk);
+	static void ParseChunk(Chunk& chunk, float* positions, float* texCoords, size_t totalPositions, size_t totalTexCoords);
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <math.h>
+
+// Rotation (x, y, z, w) of an orthonormal 3x3 matrix given as nine floats, column after column. A basis with a
+// zero column, as a zero scale leaves behind, has no rotation to recover and gives the identity.
+static inline void MatrixToQuaternion(const float* columns, float* rotation)
+{
+	float m[3][3];
+	for (int column = 0; column < 3; column++)
+	{
+		for (int row = 0; row < 3; row++)
+		{
+			m[column][row] = columns[column * 3 + row];
+		}
+		if (m[column][0] * m[column][0] + m[column][1] * m[column][1] + m[column][2] * m[column][2] < 1e-12f)
+		{
+			rotation[0] = rotation[1] = rotation[2] = 0.0f;
+			rotation[3] = 1.0f;
+			return;
+		}
+	}
+
+	// Shepperd's method, the largest of the trace and diagonal picks the best conditioned formula
+	float trace = m[0][0] + m[1][1] + m[2][2];
+	if (trace > 0.0f)
+	{
+		float s = sqrtf(trace + 1.0f) * 2.0f;
+		rotation[3] = 0.25f * s;
+		rotation[0] = (m[1][2] - m[2][1]) / s;
+		rotation[1] = (m[2][0] - m[0][2]) / s;
+		rotation[2] = (m[0][1] - m[1][0]) / s;
+	}
+	else if (m[0][0] > m[1][1] && m[0][0] > m[2][2])
+	{
+		float s = sqrtf(1.0f + m[0][0] - m[1][1] - m[2][2]) * 2.0f;
+		rotation[3] = (m[1][2] - m[2][1]) / s;
+		rotation[0] = 0.25f * s;
+		rotation[1] = (m[1][0] + m[0][1]) / s;
+		rotation[2] = (m[2][0] + m[0][2]) / s;
+	}
+	else if (m[1][1] > m[2][2])
+	{
+		float s = sqrtf(1.0f + m[1][1] - m[0][0] - m[2][2]) * 2.0f;
+		rotation[3] = (m[2][0] - m[0][2]) / s;
+		rotation[0] = (m[1][0] + m[0][1]) / s;
+		rotation[1] = 0.25f * s;
+		rotation[2] = (m[2][1] + m[1][2]) / s;
+	}
+	else
+	{
+		float s = sqrtf(1.0f + m[2][2] - m[0][0] - m[1][1]) * 2.0f;
+		rotation[3] = (m[0][1] - m[1][0]) / s;
+		rotation[0] = (m[2][0] + m[0][2]) / s;
+		rotation[1] = (m[2][1] + m[1][2]) / s;
+		rotation[2] = 0.25f * s;
+	}
+}
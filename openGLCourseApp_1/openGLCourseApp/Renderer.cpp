@@ -0,0 +1,412 @@
+#include "Renderer.h"
+
+#include <glm\gtc\type_ptr.hpp>
+
+#include "Mesh.h"
+#include "Texture.h"
+
+Renderer::Renderer()
+{
+	window = NULL;
+	shader = NULL;
+	sampler = NULL;
+
+	textureLoader = NULL;
+	uploadBudgetMs = 0.0;
+	uploadQueue = NULL;
+	uploadBudgetBytes = 0;
+	resourceLoader = NULL;
+
+	batch = NULL;
+	atlas = NULL;
+	batchShader = NULL;
+
+	residency = NULL;
+
+	lodPixelError = 1.0f;
+
+	virtualTexture = NULL;
+	virtualShader = NULL;
+	feedbackShader = NULL;
+
+	terrain = NULL;
+	terrainShader = NULL;
+	terrainTexture = NULL;
+	terrainBudgetBytes = 0;
+
+	jointPalette = NULL;
+	skinnedShader = NULL;
+	uniformPalette = -1;
+	uniformFirstTexel = -1;
+	uniformTexelsPerInstance = -1;
+	uniformDualQuaternion = -1;
+
+	stats.drawCalls = 0;
+	stats.textureBinds = 0;
+	stats.batchedItems = 0;
+	stats.triangles = 0;
+
+	writeIndex = 0;
+	readyIndex = -1;
+	renderingIndex = -1;
+	frameNumber = 0;
+	running = false;
+}
+
+bool Renderer::Start(Window* window, Shader* shader, Sampler* sampler)
+{
+	if (running)
+	{
+		printf("Renderer already running!\n");
+		return false;
+	}
+
+	this->window = window;
+	this->shader = shader;
+	this->sampler = sampler;
+
+	writeIndex = 0;
+	readyIndex = -1;
+	renderingIndex = -1;
+	running = true;
+
+	renderThread = std::thread(&Renderer::RenderLoop, this);
+	return true;
+}
+
+void Renderer::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(packetMutex);
+		if (!running)
+		{
+			return;
+		}
+		running = false;
+	}
+	packetCondition.notify_all();
+
+	if (renderThread.joinable())
+	{
+		renderThread.join();
+	}
+}
+
+FramePacket& Renderer::BeginFrame()
+{
+	std::unique_lock<std::mutex> lock(packetMutex);
+	packetCondition.wait(lock, [this] { return renderingIndex != writeIndex || !running; });
+
+	FramePacket& packet = packets[writeIndex];
+	packet.frameNumber = frameNumber;
+	packet.drawList.clear();
+	packet.batchList.clear();
+	packet.virtualList.clear();
+	packet.meshletRanges.clear();
+	packet.terrainNodes.clear();
+	packet.skinnedList.clear();
+	packet.jointPalette.clear();
+	return packet;
+}
+
+void Renderer::SubmitFrame()
+{
+	{
+		std::unique_lock<std::mutex> lock(packetMutex);
+		packetCondition.wait(lock, [this] { return readyIndex == -1 || !running; });
+
+		readyIndex = writeIndex;
+		writeIndex ^= 1;
+		frameNumber++;
+	}
+	packetCondition.notify_all();
+}
+
+void Renderer::RenderLoop()
+{
+	window->makeContextCurrent();
+	window->applyPresentMode();
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(packetMutex);
+			packetCondition.wait(lock, [this] { return readyIndex != -1 || !running; });
+			if (!running)
+			{
+				break;
+			}
+
+			renderingIndex = readyIndex;
+			readyIndex = -1;
+		}
+		packetCondition.notify_all();
+
+		pacer.BeginFrame();
+		if (resourceLoader)
+		{
+			resourceLoader->ProcessCompleted();
+		}
+		if (textureLoader)
+		{
+			textureLoader->ProcessUploads(uploadBudgetMs);
+		}
+		if (uploadQueue)
+		{
+			uploadQueue->Process(uploadBudgetBytes);
+		}
+		if (residency)
+		{
+			residency->Update(packets[renderingIndex].frameNumber);
+		}
+		if (virtualTexture)
+		{
+			virtualTexture->Update(packets[renderingIndex].frameNumber);
+		}
+		if (terrain)
+		{
+			terrain->Update(terrainBudgetBytes);
+		}
+		RenderFrame(packets[renderingIndex]);
+		window->swapBuffers();
+		pacer.EndFrame();
+
+		{
+			std::lock_guard<std::mutex> lock(packetMutex);
+			renderingIndex = -1;
+		}
+		packetCondition.notify_all();
+	}
+
+	if (uploadQueue)
+	{
+		uploadQueue->ClearUploadQueue();
+	}
+	pacer.ClearFences();
+	window->releaseContext();
+}
+
+unsigned int Renderer::RenderItem(const DrawItem& item, const FramePacket& packet)
+{
+	// Culled meshlets only cover the finest level, coarser ones draw whole
+	unsigned int lod = item.mesh->SelectLod(item.lodScale, lodPixelError);
+	if (lod == 0 && item.firstRange >= 0)
+	{
+		return item.mesh->RenderMeshlets(item.rangeCount > 0 ? &packet.meshletRanges[item.firstRange] : NULL, item.rangeCount);
+	}
+	return item.mesh->RenderMesh(lod);
+}
+
+void Renderer::RenderMeshes(const std::vector<DrawItem>& items, Shader* program, const FramePacket& packet, RenderStats& frameStats)
+{
+	glUniformMatrix4fv(program->GetProjectionLocation(), 1, GL_FALSE, glm::value_ptr(packet.projection));
+	glUniformMatrix4fv(program->GetViewLocation(), 1, GL_FALSE, glm::value_ptr(packet.view));
+
+	GLuint uniformModel = program->GetModelLocation();
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(items[i].model));
+		glUniform3fv(program->GetPositionScaleLocation(), 1, items[i].mesh->GetPositionScale());
+		glUniform3fv(program->GetPositionOffsetLocation(), 1, items[i].mesh->GetPositionOffset());
+		frameStats.triangles += RenderItem(items[i], packet);
+	}
+	frameStats.drawCalls += (unsigned int)items.size();
+}
+
+void Renderer::RenderSkinned(const FramePacket& packet, RenderStats& frameStats)
+{
+	size_t texels = jointPalette->Upload(packet.jointPalette.empty() ? NULL : &packet.jointPalette[0], packet.jointPalette.size());
+
+	skinnedShader->UseShader();
+	glUniformMatrix4fv(skinnedShader->GetProjectionLocation(), 1, GL_FALSE, glm::value_ptr(packet.projection));
+	glUniformMatrix4fv(skinnedShader->GetViewLocation(), 1, GL_FALSE, glm::value_ptr(packet.view));
+	glUniform1i(skinnedShader->GetTextureLocation(), 0);
+	glUniform1i(uniformPalette, 1);
+
+	// The palette sits on a unit the sampler object does not cover, buffer textures ignore samplers anyway
+	jointPalette->UsePalette(1);
+	frameStats.textureBinds++;
+
+	for (size_t i = 0; i < packet.skinnedList.size(); i++)
+	{
+		const SkinnedItem& item = packet.skinnedList[i];
+
+		// Instances past the palette's capacity were cut off by the upload
+		size_t fitting = item.texelsPerInstance > 0 && item.firstTexel < texels ? (texels - item.firstTexel) / item.texelsPerInstance : 0;
+		GLsizei instanceCount = (GLsizei)(item.instanceCount < fitting ? item.instanceCount : fitting);
+		if (instanceCount == 0)
+		{
+			continue;
+		}
+
+		if (item.texture)
+		{
+			if (residency)
+			{
+				residency->MarkUsed(item.texture, packet.frameNumber);
+			}
+			item.texture->UseTexture(0);
+			frameStats.textureBinds++;
+		}
+
+		glUniform1i(uniformFirstTexel, (GLint)item.firstTexel);
+		glUniform1i(uniformTexelsPerInstance, (GLint)item.texelsPerInstance);
+		glUniform1i(uniformDualQuaternion, item.dualQuaternion ? 1 : 0);
+		frameStats.triangles += item.mesh->RenderMeshInstanced(instanceCount);
+		frameStats.drawCalls++;
+	}
+}
+
+void Renderer::RenderFrame(const FramePacket& packet)
+{
+	RenderStats frameStats;
+	frameStats.drawCalls = 0;
+	frameStats.textureBinds = 0;
+	frameStats.batchedItems = 0;
+	frameStats.triangles = 0;
+
+	bool virtualPass = virtualTexture && virtualShader && feedbackShader && !packet.virtualList.empty();
+
+	// Requested pages are rendered into the feedback target first, read back a few frames later
+	if (virtualPass)
+	{
+		feedbackShader->UseShader();
+		virtualTexture->BeginFeedback(feedbackShader);
+		RenderMeshes(packet.virtualList, feedbackShader, packet, frameStats);
+		virtualTexture->EndFeedback();
+	}
+
+	// Clear the window
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	shader->UseShader();
+	GLuint uniformModel = shader->GetModelLocation();
+	GLuint uniformProjection = shader->GetProjectionLocation();
+	GLuint uniformView = shader->GetViewLocation();
+	GLint uniformPositionScale = shader->GetPositionScaleLocation();
+	GLint uniformPositionOffset = shader->GetPositionOffsetLocation();
+
+	glUniformMatrix4fv(uniformProjection, 1, GL_FALSE, glm::value_ptr(packet.projection));
+	glUniformMatrix4fv(uniformView, 1, GL_FALSE, glm::value_ptr(packet.view));
+	glUniform1i(shader->GetTextureLocation(), 0);
+	sampler->UseSampler(0);
+
+	// Consecutive draws with the same texture skip the rebind
+	Texture* boundTexture = NULL;
+	for (size_t i = 0; i < packet.drawList.size(); i++)
+	{
+		const DrawItem& item = packet.drawList[i];
+		if (item.texture && residency)
+		{
+			residency->MarkUsed(item.texture, packet.frameNumber);
+		}
+
+		if (item.texture && item.texture != boundTexture)
+		{
+			item.texture->UseTexture(0);
+			boundTexture = item.texture;
+			frameStats.textureBinds++;
+		}
+
+		glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(item.model));
+		glUniform3fv(uniformPositionScale, 1, item.mesh->GetPositionScale());
+		glUniform3fv(uniformPositionOffset, 1, item.mesh->GetPositionOffset());
+		frameStats.triangles += RenderItem(item, packet);
+		frameStats.drawCalls++;
+	}
+
+	// The heightmap sits on a unit the sampler object does not cover, the ground texture on unit 0 uses it
+	if (terrain && terrainShader && !packet.terrainNodes.empty())
+	{
+		terrainShader->UseShader();
+		glUniformMatrix4fv(terrainShader->GetProjectionLocation(), 1, GL_FALSE, glm::value_ptr(packet.projection));
+		glUniformMatrix4fv(terrainShader->GetViewLocation(), 1, GL_FALSE, glm::value_ptr(packet.view));
+		glUniform1i(terrainShader->GetTextureLocation(), 0);
+		if (terrainTexture)
+		{
+			if (residency)
+			{
+				residency->MarkUsed(terrainTexture, packet.frameNumber);
+			}
+			terrainTexture->UseTexture(0);
+			frameStats.textureBinds++;
+		}
+
+		unsigned int terrainDraws = 0;
+		frameStats.triangles += terrain->RenderTerrain(1, packet.terrainNodes, packet.terrainModel, packet.terrainEye, terrainDraws);
+		frameStats.drawCalls += terrainDraws;
+		frameStats.textureBinds++;
+	}
+
+	if (jointPalette && skinnedShader && !packet.skinnedList.empty())
+	{
+		RenderSkinned(packet, frameStats);
+	}
+
+	// Every batched item shares one program, one atlas bind and (with indirect draws) one call
+	if (batch && atlas && batchShader && !packet.batchList.empty())
+	{
+		batchShader->UseShader();
+		glUniformMatrix4fv(batchShader->GetProjectionLocation(), 1, GL_FALSE, glm::value_ptr(packet.projection));
+		glUniformMatrix4fv(batchShader->GetViewLocation(), 1, GL_FALSE, glm::value_ptr(packet.view));
+		glUniform1i(batchShader->GetTextureLocation(), 0);
+
+		atlas->UseAtlas(0);
+		frameStats.textureBinds++;
+
+		frameStats.drawCalls += batch->RenderBatch(packet.batchList);
+		frameStats.batchedItems = (unsigned int)packet.batchList.size();
+	}
+
+	// The page table and cache sit on units the sampler object does not cover
+	if (virtualPass)
+	{
+		virtualShader->UseShader();
+		virtualTexture->UseVirtualTexture(virtualShader, 2, 1);
+		frameStats.textureBinds += 2;
+		RenderMeshes(packet.virtualList, virtualShader, packet, frameStats);
+	}
+
+	glBindSampler(0, 0);
+	glUseProgram(0);
+
+	std::lock_guard<std::mutex> lock(statsMutex);
+	stats = frameStats;
+}
+
+void Renderer::SetTerrain(Terrain* terrain, Shader* terrainShader, Texture* groundTexture, size_t streamBudgetBytes)
+{
+	this->terrain = terrain;
+	this->terrainShader = terrainShader;
+	terrainTexture = groundTexture;
+	terrainBudgetBytes = streamBudgetBytes;
+	if (terrain && terrainShader)
+	{
+		terrain->SetShader(terrainShader);
+	}
+}
+
+void Renderer::SetSkinning(JointPalette* palette, Shader* skinnedShader)
+{
+	jointPalette = palette;
+	this->skinnedShader = skinnedShader;
+	if (skinnedShader)
+	{
+		uniformPalette = skinnedShader->GetUniformLocation("palette");
+		uniformFirstTexel = skinnedShader->GetUniformLocation("firstTexel");
+		uniformTexelsPerInstance = skinnedShader->GetUniformLocation("texelsPerInstance");
+		uniformDualQuaternion = skinnedShader->GetUniformLocation("dualQuaternion");
+	}
+}
+
+RenderStats Renderer::GetRenderStats()
+{
+	std::lock_guard<std::mutex> lock(statsMutex);
+	return stats;
+}
+
+Renderer::~Renderer()
+{
+	Stop();
+}
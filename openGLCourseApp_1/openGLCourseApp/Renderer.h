@@ -0,0 +1,137 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <GL\glew.h>
+
+#include "FramePacket.h"
+#include "FramePacer.h"
+#include "Window.h"
+#include "Shader.h"
+#include "Sampler.h"
+#include "TextureLoader.h"
+#include "UploadQueue.h"
+#include "ResourceLoader.h"
+#include "MeshBatch.h"
+#include "TextureAtlas.h"
+#include "ResidencyManager.h"
+#include "VirtualTexture.h"
+#include "Terrain.h"
+#include "JointPalette.h"
+
+// Work submitted for the last rendered frame
+struct RenderStats
+{
+	unsigned int drawCalls;
+	unsigned int textureBinds;
+	unsigned int batchedItems;
+	// Drawn through individual meshes at their selected levels of detail, batched meshes are not counted
+	unsigned int triangles;
+};
+
+// Owns the GL context on a dedicated thread and draws the frame packets handed over by the main thread.
+// Packets are double buffered: while frame N is submitted to the GPU the main thread fills frame N+1.
+class Renderer
+{
+public:
+	Renderer();
+
+	// The window's context must not be current on the calling thread
+	bool Start(Window* window, Shader* shader, Sampler* sampler);
+	void Stop();
+
+	// Main thread: get the packet to fill for the next frame, blocks while the render thread still reads it
+	FramePacket& BeginFrame();
+	// Main thread: hand the filled packet over, blocks if the render thread has not picked up the previous one
+	void SubmitFrame();
+
+	// Configure before Start, statistics may be read from any thread
+	FramePacer& GetPacer() { return pacer; }
+
+	// Decoded textures are uploaded at the start of each frame for at most budgetMs
+	void SetTextureLoader(TextureLoader* loader, double budgetMs) { textureLoader = loader; uploadBudgetMs = budgetMs; }
+	// Staged uploads are advanced by up to budgetBytes per frame, the queue is cleared when the renderer stops
+	void SetUploadQueue(UploadQueue* queue, GLsizeiptr budgetBytes) { uploadQueue = queue; uploadBudgetBytes = budgetBytes; }
+	// Resources finished by the loader thread are handed over at the start of each frame
+	void SetResourceLoader(ResourceLoader* loader) { resourceLoader = loader; }
+	// Packet batch lists are drawn from this batch with the atlas bound once, using batchShader
+	void SetBatch(MeshBatch* meshBatch, TextureAtlas* textureAtlas, Shader* batchShader) { batch = meshBatch; atlas = textureAtlas; this->batchShader = batchShader; }
+
+	// Textures drawn are marked used and the budget is enforced at the start of each frame
+	void SetResidencyManager(ResidencyManager* manager) { residency = manager; }
+
+	// Meshes draw the coarsest level of detail whose error projects to at most this many pixels
+	void SetLodPixelError(float pixels) { lodPixelError = pixels; }
+
+	// Packet virtual lists are drawn with virtualShader after a feedback pass with feedbackShader,
+	// the texture's pages are streamed at the start of each frame
+	void SetVirtualTexture(VirtualTexture* texture, Shader* virtualShader, Shader* feedbackShader) { virtualTexture = texture; this->virtualShader = virtualShader; this->feedbackShader = feedbackShader; }
+
+	// Packet terrain nodes are drawn with terrainShader and groundTexture, up to streamBudgetBytes of the
+	// heightmap are streamed at the start of each frame. Context thread, before Start.
+	void SetTerrain(Terrain* terrain, Shader* terrainShader, Texture* groundTexture, size_t streamBudgetBytes);
+
+	// Packet skinned lists are drawn with skinnedShader, their joints uploaded into palette every frame.
+	// Context thread, before Start.
+	void SetSkinning(JointPalette* palette, Shader* skinnedShader);
+
+	RenderStats GetRenderStats();
+
+	~Renderer();
+
+private:
+	Window* window;
+	Shader* shader;
+	Sampler* sampler;
+	FramePacer pacer;
+
+	TextureLoader* textureLoader;
+	double uploadBudgetMs;
+	UploadQueue* uploadQueue;
+	GLsizeiptr uploadBudgetBytes;
+	ResourceLoader* resourceLoader;
+
+	MeshBatch* batch;
+	TextureAtlas* atlas;
+	Shader* batchShader;
+
+	ResidencyManager* residency;
+
+	float lodPixelError;
+
+	VirtualTexture* virtualTexture;
+	Shader* virtualShader;
+	Shader* feedbackShader;
+
+	Terrain* terrain;
+	Shader* terrainShader;
+	Texture* terrainTexture;
+	size_t terrainBudgetBytes;
+
+	JointPalette* jointPalette;
+	Shader* skinnedShader;
+	GLint uniformPalette, uniformFirstTexel, uniformTexelsPerInstance, uniformDualQuaternion;
+
+	std::mutex statsMutex;
+	RenderStats stats;
+
+	std::thread renderThread;
+	std::mutex packetMutex;
+	std::condition_variable packetCondition;
+
+	FramePacket packets[2];
+	int writeIndex;
+	int readyIndex;
+	int renderingIndex;
+	unsigned int frameNumber;
+	bool running;
+
+	void RenderLoop();
+	void RenderFrame(const FramePacket& packet);
+	// Draw an item's mesh at its level of detail, returns the triangles drawn
+	unsigned int RenderItem(const DrawItem& item, const FramePacket& packet);
+	void RenderMeshes(const std::vector<DrawItem>& items, Shader* program, const FramePacket& packet, RenderStats& frameStats);
+	void RenderSkinned(const FramePacket& packet, RenderStats& frameStats);
+};
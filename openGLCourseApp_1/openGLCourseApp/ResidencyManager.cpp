@@ -0,0 +1,274 @@
+#include "ResidencyManager.h"
+
+#include <string.h>
+#include <algorithm>
+
+// Mips are not dropped below this size, smaller textures are only ever evicted whole
+static const int minimumReducedSize = 32;
+
+// Reloads wait until the full texture fits under this fraction of the budget, so a restore does not
+// immediately push the next texture out again
+static const double restoreHeadroom = 0.9;
+
+// Frames to wait after a failed reload, doubled with each further failure up to maxReloadBackoff times
+static const unsigned int reloadRetryFrames = 60;
+static const unsigned int maxReloadBackoff = 6;
+
+ResidencyManager::ResidencyManager()
+{
+	budgetBytes = 0;
+	evictionAge = 600;
+	resourceLoader = NULL;
+	currentFrame = 0;
+
+	levelsDropped = 0;
+	texturesEvicted = 0;
+	texturesReloaded = 0;
+
+	memset(&report, 0, sizeof(report));
+}
+
+void ResidencyManager::RegisterTexture(Texture* texture, const char* cookedLocation, bool srgb)
+{
+	if (textureIndex.count(texture))
+	{
+		return;
+	}
+
+	TextureEntry entry;
+	entry.texture = texture;
+	entry.cookedLocation = cookedLocation;
+	entry.srgb = srgb;
+	entry.lastUsedFrame = 0;
+	entry.fullBytes = texture->GetMemoryUsage();
+	entry.droppedLevels = 0;
+	entry.evicted = false;
+	entry.reloading = false;
+	entry.failedReloads = 0;
+	entry.retryFrame = 0;
+
+	textureIndex[texture] = textures.size();
+	textures.push_back(entry);
+}
+
+void ResidencyManager::RegisterMesh(Mesh* mesh)
+{
+	meshes.push_back(mesh);
+}
+
+void ResidencyManager::RegisterMeshBatch(MeshBatch* batch)
+{
+	batches.push_back(batch);
+}
+
+void ResidencyManager::RegisterAtlas(TextureAtlas* atlas)
+{
+	atlases.push_back(atlas);
+}
+
+void ResidencyManager::MarkUsed(Texture* texture, unsigned int frameNumber)
+{
+	std::unordered_map<Texture*, size_t>::iterator found = textureIndex.find(texture);
+	if (found != textureIndex.end())
+	{
+		textures[found->second].lastUsedFrame = frameNumber;
+	}
+}
+
+size_t ResidencyManager::MeasureUsage(ResidencyReport& usage)
+{
+	memset(usage.categoryBytes, 0, sizeof(usage.categoryBytes));
+	memset(usage.categoryCount, 0, sizeof(usage.categoryCount));
+	usage.reducedTextures = 0;
+	usage.evictedTextures = 0;
+
+	for (size_t i = 0; i < textures.size(); i++)
+	{
+		TextureEntry& entry = textures[i];
+		size_t bytes = entry.texture->GetMemoryUsage();
+
+		// Finished loads (including ones from other loaders) update what a full reload costs
+		if (!entry.evicted && entry.droppedLevels == 0 && !entry.reloading)
+		{
+			entry.fullBytes = bytes;
+		}
+
+		usage.categoryBytes[RESIDENCY_TEXTURES] += bytes;
+		usage.categoryCount[RESIDENCY_TEXTURES]++;
+		usage.reducedTextures += entry.droppedLevels > 0 ? 1 : 0;
+		usage.evictedTextures += entry.evicted ? 1 : 0;
+	}
+
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		usage.categoryBytes[RESIDENCY_MESHES] += meshes[i]->GetMemoryUsage();
+		usage.categoryCount[RESIDENCY_MESHES]++;
+	}
+
+	for (size_t i = 0; i < batches.size(); i++)
+	{
+		usage.categoryBytes[RESIDENCY_MESHES] += batches[i]->GetMemoryUsage();
+		usage.categoryCount[RESIDENCY_MESHES]++;
+	}
+
+	for (size_t i = 0; i < atlases.size(); i++)
+	{
+		usage.categoryBytes[RESIDENCY_ATLASES] += atlases[i]->GetMemoryUsage();
+		usage.categoryCount[RESIDENCY_ATLASES]++;
+	}
+
+	size_t total = 0;
+	for (int c = 0; c < RESIDENCY_CATEGORY_COUNT; c++)
+	{
+		total += usage.categoryBytes[c];
+	}
+	return total;
+}
+
+size_t ResidencyManager::ReduceTexture(TextureEntry& entry, unsigned int frameNumber)
+{
+	Texture* texture = entry.texture;
+	size_t before = texture->GetMemoryUsage();
+	bool stale = frameNumber - entry.lastUsedFrame > evictionAge;
+
+	// Recently drawn textures give up detail one mip at a time
+	if (!stale && texture->GetLevels() > 1 && texture->GetWidth() / 2 >= minimumReducedSize && texture->GetHeight() / 2 >= minimumReducedSize)
+	{
+		if (texture->DropTopLevels(1))
+		{
+			entry.droppedLevels++;
+			levelsDropped++;
+			return before - texture->GetMemoryUsage();
+		}
+	}
+
+	if (!stale)
+	{
+		return 0;
+	}
+
+	texture->LoadFallback();
+	entry.evicted = true;
+	texturesEvicted++;
+
+	size_t after = texture->GetMemoryUsage();
+	return before > after ? before - after : 0;
+}
+
+void ResidencyManager::ReloadTexture(size_t index)
+{
+	TextureEntry& entry = textures[index];
+	entry.reloading = true;
+
+	// Called on the render thread, which also runs Update, once the load has finished however many frames later
+	std::function<void(bool)> onLoaded = [this, index](bool loaded)
+	{
+		TextureEntry& entry = textures[index];
+		entry.reloading = false;
+		if (loaded)
+		{
+			entry.evicted = false;
+			entry.droppedLevels = 0;
+			entry.failedReloads = 0;
+			texturesReloaded++;
+		}
+		else if (entry.cookedLocation)
+		{
+			// The source file may still be there, the next reload tries it straight away
+			entry.cookedLocation = NULL;
+		}
+		else
+		{
+			entry.retryFrame = currentFrame + (reloadRetryFrames << std::min(entry.failedReloads, maxReloadBackoff));
+			entry.failedReloads++;
+		}
+	};
+
+	if (entry.cookedLocation)
+	{
+		resourceLoader->LoadCookedTexture(entry.texture, entry.cookedLocation, 0, onLoaded);
+	}
+	else
+	{
+		resourceLoader->LoadTexture(entry.texture, entry.texture->GetFileLocation(), entry.srgb, onLoaded);
+	}
+}
+
+void ResidencyManager::Update(unsigned int frameNumber)
+{
+	currentFrame = frameNumber;
+
+	ResidencyReport usage;
+	size_t total = MeasureUsage(usage);
+
+	if (budgetBytes > 0 && total > budgetBytes)
+	{
+		// Least recently drawn first
+		std::vector<size_t> order;
+		for (size_t i = 0; i < textures.size(); i++)
+		{
+			if (!textures[i].evicted && !textures[i].reloading)
+			{
+				order.push_back(i);
+			}
+		}
+		std::sort(order.begin(), order.end(), [this](size_t a, size_t b) { return textures[a].lastUsedFrame < textures[b].lastUsedFrame; });
+
+		for (size_t i = 0; i < order.size() && total > budgetBytes; i++)
+		{
+			TextureEntry& entry = textures[order[i]];
+			while (total > budgetBytes && !entry.evicted)
+			{
+				size_t released = ReduceTexture(entry, frameNumber);
+				if (released == 0)
+				{
+					break;
+				}
+				total -= released;
+			}
+		}
+	}
+	else if (resourceLoader)
+	{
+		// Bring back reduced textures that were just drawn while there is room for their full size
+		size_t limit = budgetBytes > 0 ? (size_t)(budgetBytes * restoreHeadroom) : (size_t)-1;
+		for (size_t i = 0; i < textures.size(); i++)
+		{
+			TextureEntry& entry = textures[i];
+			if ((!entry.evicted && entry.droppedLevels == 0) || entry.reloading || entry.lastUsedFrame + 1 < frameNumber || frameNumber < entry.retryFrame)
+			{
+				continue;
+			}
+
+			size_t current = entry.texture->GetMemoryUsage();
+			size_t cost = entry.fullBytes > current ? entry.fullBytes - current : 0;
+			if (total + cost > limit)
+			{
+				continue;
+			}
+
+			ReloadTexture(i);
+			total += cost;
+		}
+	}
+
+	total = MeasureUsage(usage);
+	usage.budgetBytes = budgetBytes;
+	usage.totalBytes = total;
+	usage.levelsDropped = levelsDropped;
+	usage.texturesEvicted = texturesEvicted;
+	usage.texturesReloaded = texturesReloaded;
+
+	std::lock_guard<std::mutex> lock(reportMutex);
+	report = usage;
+}
+
+ResidencyReport ResidencyManager::GetReport()
+{
+	std::lock_guard<std::mutex> lock(reportMutex);
+	return report;
+}
+
+ResidencyManager::~ResidencyManager()
+{
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+
+#include <GL\glew.h>
+
+#include "Texture.h"
+#include "Mesh.h"
+#include "MeshBatch.h"
+#include "TextureAtlas.h"
+#include "ResourceLoader.h"
+
+enum ResidencyCategory
+{
+	RESIDENCY_TEXTURES,
+	RESIDENCY_MESHES,
+	RESIDENCY_ATLASES,
+	RESIDENCY_CATEGORY_COUNT
+};
+
+struct ResidencyReport
+{
+	size_t budgetBytes;
+	size_t totalBytes;
+	size_t categoryBytes[RESIDENCY_CATEGORY_COUNT];
+	unsigned int categoryCount[RESIDENCY_CATEGORY_COUNT];
+
+	// Textures currently running without their top mips, or replaced by the fallback
+	unsigned int reducedTextures;
+	unsigned int evictedTextures;
+
+	// Totals for the session
+	unsigned int levelsDropped;
+	unsigned int texturesEvicted;
+	unsigned int texturesReloaded;
+};
+
+// Keeps the GPU memory of registered resources under a budget. Textures are the only resources with a
+// source to reload from, so they absorb the pressure: the least recently drawn first lose their top mips,
+// and those not drawn for a while are swapped for the fallback entirely. Once a reduced texture is drawn
+// again and there is room, it is reloaded in full on the ResourceLoader, from the cooked file when it has one.
+// A cooked file that fails to load is dropped for the source file, and failing source loads are retried
+// ever less often.
+// Meshes, batches and atlases are tracked for the report.
+class ResidencyManager
+{
+public:
+	ResidencyManager();
+
+	// Zero disables enforcement, usage is still reported
+	void SetBudget(size_t bytes) { budgetBytes = bytes; }
+	// Textures unused for this many frames are evicted whole rather than losing mips
+	void SetEvictionAge(unsigned int frames) { evictionAge = frames; }
+	void SetResourceLoader(ResourceLoader* loader) { resourceLoader = loader; }
+
+	// Before the renderer starts. The texture reloads from cookedLocation when set, otherwise from its own file.
+	void RegisterTexture(Texture* texture, const char* cookedLocation, bool srgb);
+	void RegisterMesh(Mesh* mesh);
+	void RegisterMeshBatch(MeshBatch* batch);
+	void RegisterAtlas(TextureAtlas* atlas);
+
+	// Render thread
+	void MarkUsed(Texture* texture, unsigned int frameNumber);
+	void Update(unsigned int frameNumber);
+
+	// Any thread, as of the last Update
+	ResidencyReport GetReport();
+
+	~ResidencyManager();
+
+private:
+	struct TextureEntry
+	{
+		Texture* texture;
+		const char* cookedLocation;
+		bool srgb;
+		unsigned int lastUsedFrame;
+		size_t fullBytes;
+		GLsizei droppedLevels;
+		bool evicted;
+		bool reloading;
+		// Consecutive failed reloads, and the frame before which no further attempt is made
+		unsigned int failedReloads;
+		unsigned int retryFrame;
+	};
+
+	size_t budgetBytes;
+	unsigned int evictionAge;
+	ResourceLoader* resourceLoader;
+	// Frame of the latest Update, reload failures back off from it
+	unsigned int currentFrame;
+
+	std::vector<TextureEntry> textures;
+	std::unordered_map<Texture*, size_t> textureIndex;
+	std::vector<Mesh*> meshes;
+	std::vector<MeshBatch*> batches;
+	std::vector<TextureAtlas*> atlases;
+
+	unsigned int levelsDropped;
+	unsigned int texturesEvicted;
+	unsigned int texturesReloaded;
+
+	std::mutex reportMutex;
+	ResidencyReport report;
+
+	size_t MeasureUsage(ResidencyReport& usage);
+	size_t ReduceTexture(TextureEntry& entry, unsigned int frameNumber);
+	void ReloadTexture(size_t index);
+};
@@ -0,0 +1,244 @@
+#include "ResourceLoader.h"
+
+#include <stdio.h>
+#include <memory>
+
+#include "Texture.h"
+#include "stb_image.h"
+
+ResourceLoader::ResourceLoader()
+{
+	loaderWindow = NULL;
+	activeJobs = 0;
+	running = false;
+}
+
+bool ResourceLoader::Initialise(Window* window)
+{
+	// Match the main window's context so the two can share objects
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+	glfwWindowHint(GLFW_CONTEXT_CREATION_API, window->getUseEGL() ? GLFW_EGL_CONTEXT_API : GLFW_NATIVE_CONTEXT_API);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	loaderWindow = glfwCreateWindow(1, 1, "Loader", NULL, window->getGLFWWindow());
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+
+	if (!loaderWindow)
+	{
+		printf("Error creating shared loader context!\n");
+		return false;
+	}
+
+	running = true;
+	loaderThread = std::thread(&ResourceLoader::LoaderLoop, this);
+	return true;
+}
+
+void ResourceLoader::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		if (!running)
+		{
+			return;
+		}
+		running = false;
+	}
+	jobAvailable.notify_all();
+
+	if (loaderThread.joinable())
+	{
+		loaderThread.join();
+	}
+
+	// Callbacks for work that never got handed over are dropped with their fences
+	for (size_t i = 0; i < completed.size(); i++)
+	{
+		glDeleteSync(completed[i].fence);
+	}
+	completed.clear();
+
+	glfwDestroyWindow(loaderWindow);
+	loaderWindow = NULL;
+}
+
+void ResourceLoader::Enqueue(std::function<void()> create, std::function<void()> onReady)
+{
+	LoaderJob job;
+	job.create = create;
+	job.onReady = onReady;
+
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		jobs.push_back(job);
+	}
+	jobAvailable.notify_one();
+}
+
+void ResourceLoader::LoadTexture(Texture* texture, const char* fileLocation, bool srgb, std::function<void(bool)> onLoaded)
+{
+	struct LoadedTexture
+	{
+		GLuint textureID;
+		int width, height, channels;
+		GLsizei levels;
+		GLenum internalFormat;
+		bool immutable;
+	};
+
+	std::shared_ptr<LoadedTexture> loaded = std::make_shared<LoadedTexture>();
+	loaded->textureID = 0;
+
+	Enqueue([loaded, fileLocation, srgb]()
+	{
+		stbi_set_flip_vertically_on_load(1);
+		unsigned char* pixels = stbi_load(fileLocation, &loaded->width, &loaded->height, &loaded->channels, 0);
+		if (!pixels)
+		{
+			printf("Failed to find: %s\n", fileLocation);
+			return;
+		}
+
+		loaded->levels = Texture::CalculateMipLevels(loaded->width, loaded->height);
+		loaded->internalFormat = Texture::ChooseInternalFormat(loaded->channels, srgb);
+		loaded->textureID = Texture::CreateStorage(loaded->width, loaded->height, loaded->levels, loaded->internalFormat, loaded->channels, loaded->immutable);
+
+		glBindTexture(GL_TEXTURE_2D, loaded->textureID);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, loaded->width, loaded->height, Texture::ChoosePixelFormat(loaded->channels), GL_UNSIGNED_BYTE, pixels);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glGenerateMipmap(GL_TEXTURE_2D);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		stbi_image_free(pixels);
+	},
+	[loaded, texture, onLoaded]()
+	{
+		if (loaded->textureID != 0)
+		{
+			texture->AdoptStorage(loaded->textureID, loaded->width, loaded->height, loaded->channels, loaded->levels, loaded->internalFormat, loaded->immutable);
+		}
+
+		if (onLoaded)
+		{
+			onLoaded(loaded->textureID != 0);
+		}
+	});
+}
+
+void ResourceLoader::LoadCookedTexture(Texture* texture, const char* cookedFileLocation, GLsizei skipLevels, std::function<void(bool)> onLoaded)
+{
+	struct LoadedTexture
+	{
+		GLuint textureID;
+		int width, height, channels;
+		GLsizei levels;
+		GLenum internalFormat;
+		bool immutable;
+	};
+
+	std::shared_ptr<LoadedTexture> loaded = std::make_shared<LoadedTexture>();
+	loaded->textureID = 0;
+
+	Enqueue([loaded, cookedFileLocation, skipLevels]()
+	{
+		loaded->textureID = Texture::CreateCookedStorage(cookedFileLocation, skipLevels, loaded->width, loaded->height, loaded->channels,
+			loaded->levels, loaded->internalFormat, loaded->immutable);
+	},
+	[loaded, texture, onLoaded]()
+	{
+		if (loaded->textureID != 0)
+		{
+			texture->AdoptStorage(loaded->textureID, loaded->width, loaded->height, loaded->channels, loaded->levels, loaded->internalFormat, loaded->immutable);
+		}
+
+		if (onLoaded)
+		{
+			onLoaded(loaded->textureID != 0);
+		}
+	});
+}
+
+void ResourceLoader::LoaderLoop()
+{
+	glfwMakeContextCurrent(loaderWindow);
+
+	while (true)
+	{
+		LoaderJob job;
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			jobAvailable.wait(lock, [this] { return !jobs.empty() || !running; });
+			if (!running)
+			{
+				break;
+			}
+
+			job = jobs.front();
+			jobs.pop_front();
+			activeJobs++;
+		}
+
+		job.create();
+
+		// The flush makes sure the fence reaches the GPU so the render context can wait on it
+		CompletedJob done;
+		done.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		done.onReady = job.onReady;
+		glFlush();
+
+		{
+			std::lock_guard<std::mutex> lock(jobMutex);
+			completed.push_back(done);
+			activeJobs--;
+		}
+	}
+
+	glfwMakeContextCurrent(NULL);
+}
+
+unsigned int ResourceLoader::ProcessCompleted()
+{
+	std::vector<CompletedJob> ready;
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		for (size_t i = 0; i < completed.size(); )
+		{
+			GLenum result = glClientWaitSync(completed[i].fence, 0, 0);
+			if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED)
+			{
+				ready.push_back(completed[i]);
+				completed.erase(completed.begin() + i);
+			}
+			else
+			{
+				i++;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < ready.size(); i++)
+	{
+		glDeleteSync(ready[i].fence);
+		if (ready[i].onReady)
+		{
+			ready[i].onReady();
+		}
+	}
+
+	return (unsigned int)ready.size();
+}
+
+unsigned int ResourceLoader::GetPendingCount()
+{
+	std::lock_guard<std::mutex> lock(jobMutex);
+	return (unsigned int)(jobs.size() + completed.size()) + activeJobs;
+}
+
+ResourceLoader::~ResourceLoader()
+{
+	Stop();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <vector>
+
+#include <GL\glew.h>
+#include <GLFW\glfw3.h>
+
+#include "Window.h"
+
+class Texture;
+
+// Creates GL resources on a background thread with its own context shared with the Window's.
+// Each job is fenced once its commands are flushed and its completion callback only runs on the
+// render thread after that fence has signalled, so the render loop never waits on resource creation.
+// Container objects such as VAOs are not shared between contexts and must still be built on the render thread.
+class ResourceLoader
+{
+public:
+	ResourceLoader();
+
+	// Main thread, after the window is initialised. Uses the same context creation API as the window.
+	bool Initialise(Window* window);
+	// Main thread, joins the loader and destroys its hidden window
+	void Stop();
+
+	// Any thread: create runs on the loader thread, onReady on the render thread once the GPU sees the result
+	void Enqueue(std::function<void()> create, std::function<void()> onReady);
+
+	// Decode and upload a texture entirely on the loader thread, swapping it into texture when ready.
+	// onLoaded (may be empty) runs on the render thread afterwards and reports whether the load succeeded.
+	void LoadTexture(Texture* texture, const char* fileLocation, bool srgb, std::function<void(bool)> onLoaded);
+	// Same for a .ctex file from the TextureCooker, leaving out its first skipLevels mips
+	void LoadCookedTexture(Texture* texture, const char* cookedFileLocation, GLsizei skipLevels, std::function<void(bool)> onLoaded);
+
+	// Render thread: run the callbacks of every job whose fence has signalled
+	unsigned int ProcessCompleted();
+
+	unsigned int GetPendingCount();
+
+	~ResourceLoader();
+
+private:
+	struct LoaderJob
+	{
+		std::function<void()> create;
+		std::function<void()> onReady;
+	};
+
+	struct CompletedJob
+	{
+		GLsync fence;
+		std::function<void()> onReady;
+	};
+
+	GLFWwindow* loaderWindow;
+	std::thread loaderThread;
+
+	std::mutex jobMutex;
+	std::condition_variable jobAvailable;
+	std::deque<LoaderJob> jobs;
+	std::vector<CompletedJob> completed;
+	unsigned int activeJobs;
+	bool running;
+
+	void LoaderLoop();
+};
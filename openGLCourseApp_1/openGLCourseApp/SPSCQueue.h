@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stddef.h>
+#include <atomic>
+
+// Lock-free single producer / single consumer ring buffer. One thread may push while another pops,
+// Capacity must be a power of two and one slot is kept free to tell full from empty.
+template <typename T, size_t Capacity>
+class SPSCQueue
+{
+	static_assert((Capacity & (Capacity - 1)) == 0, "SPSCQueue capacity must be a power of two");
+
+public:
+	SPSCQueue() : head(0), tail(0) {}
+
+	SPSCQueue(const SPSCQueue&) = delete;
+	SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+	// Producer side
+	bool push(const T& item)
+	{
+		size_t currentTail = tail.load(std::memory_order_relaxed);
+		size_t nextTail = (currentTail + 1) & (Capacity - 1);
+		if (nextTail == head.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+
+		buffer[currentTail] = item;
+		tail.store(nextTail, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer side, front() peeks without removing so the consumer can stop at a timestamp
+	const T* front()
+	{
+		size_t currentHead = head.load(std::memory_order_relaxed);
+		if (currentHead == tail.load(std::memory_order_acquire))
+		{
+			return NULL;
+		}
+
+		return &buffer[currentHead];
+	}
+
+	bool pop(T& item)
+	{
+		size_t currentHead = head.load(std::memory_order_relaxed);
+		if (currentHead == tail.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+
+		item = buffer[currentHead];
+		head.store((currentHead + 1) & (Capacity - 1), std::memory_order_release);
+		return true;
+	}
+
+	bool empty()
+	{
+		return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+	}
+
+private:
+	// Producer and consumer indices live on separate cache lines to avoid false sharing
+	alignas(64) std::atomic<size_t> head;
+	alignas(64) std::atomic<size_t> tail;
+	alignas(64) T buffer[Capacity];
+};
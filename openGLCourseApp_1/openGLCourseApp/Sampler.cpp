@@ -0,0 +1,45 @@
+#include "Sampler.h"
+
+Sampler::Sampler()
+{
+	samplerID = 0;
+}
+
+void Sampler::CreateSampler(GLenum minFilter, GLenum magFilter, GLenum wrapMode, GLfloat maxAnisotropy)
+{
+	if (samplerID == 0)
+	{
+		glGenSamplers(1, &samplerID);
+	}
+
+	glSamplerParameteri(samplerID, GL_TEXTURE_MIN_FILTER, minFilter);
+	glSamplerParameteri(samplerID, GL_TEXTURE_MAG_FILTER, magFilter);
+	glSamplerParameteri(samplerID, GL_TEXTURE_WRAP_S, wrapMode);
+	glSamplerParameteri(samplerID, GL_TEXTURE_WRAP_T, wrapMode);
+
+	if (maxAnisotropy > 1.0f && GLEW_EXT_texture_filter_anisotropic)
+	{
+		GLfloat supported = 1.0f;
+		glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &supported);
+		glSamplerParameterf(samplerID, GL_TEXTURE_MAX_ANISOTROPY_EXT, maxAnisotropy < supported ? maxAnisotropy : supported);
+	}
+}
+
+void Sampler::UseSampler(GLuint unit)
+{
+	glBindSampler(unit, samplerID);
+}
+
+void Sampler::ClearSampler()
+{
+	if (samplerID != 0)
+	{
+		glDeleteSamplers(1, &samplerID);
+		samplerID = 0;
+	}
+}
+
+Sampler::~Sampler()
+{
+	ClearSampler();
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <GL\glew.h>
+
+// Filtering and wrap state kept separately from the texture so one sampler can serve many textures
+class Sampler
+{
+public:
+	Sampler();
+
+	void CreateSampler(GLenum minFilter, GLenum magFilter, GLenum wrapMode, GLfloat maxAnisotropy);
+
+	void UseSampler(GLuint unit);
+	void ClearSampler();
+
+	GLuint GetSamplerID() { return samplerID; }
+
+	~Sampler();
+
+private:
+	GLuint samplerID;
+};
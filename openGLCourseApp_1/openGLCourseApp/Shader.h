@@ -1,35 +1,42 @@
-#pragma once
-
-#include <stdio.h>
-#include <string>
-#include <iostream>
-#include <fstream>
-
-#include <GL\glew.h>
-
-class Shader
-{
-public:
-	Shader();
-
-	void CreateFromString(const char* vertexCode, const char* fragmentCode);
-	void CreateFromFiles(const char* vertexLocation, const char* fragmentLocation);
-
-	std::string ReadFile(const char* fileLocation);
-
-	GLuint GetProjectionLocation();
-	GLuint GetModelLocation();
-	GLuint GetViewLocation();
-
-	void UseShader();
-	void ClearShader();
-
-	~Shader();
-
-private:
-	GLuint shaderID, uniformProjection, uniformModel, uniformView;
-
-	void CompileShader(const char* vertexCode, const char* fragmentCode);
-	void AddShader(GLuint theProgram, const char* shaderCode, GLenum shaderType);
-};
-
+#pragma once
+
+#include <stdio.h>
+#include <string>
+#include <iostream>
+#include <fstream>
+
+#include <GL\glew.h>
+
+class Shader
+{
+public:
+	Shader();
+
+	void CreateFromString(const char* vertexCode, const char* fragmentCode);
+	void CreateFromFiles(const char* vertexLocation, const char* fragmentLocation);
+
+	std::string ReadFile(const char* fileLocation);
+
+	GLuint GetProjectionLocation();
+	GLuint GetModelLocation();
+	GLuint GetViewLocation();
+	GLuint GetTextureLocation();
+	// -1 in programs that do not dequantize positions
+	GLint GetPositionScaleLocation();
+	GLint GetPositionOffsetLocation();
+	// Uniforms used by only a few programs are looked up by name
+	GLint GetUniformLocation(const char* name);
+
+	void UseShader();
+	void ClearShader();
+
+	~Shader();
+
+private:
+	GLuint shaderID, uniformProjection, uniformModel, uniformView, uniformTexture;
+	GLint uniformPositionScale, uniformPositionOffset;
+
+	void CompileShader(const char* vertexCode, const char* fragmentCode);
+	void AddShader(GLuint theProgram, const char* shaderCode, GLenum shaderType);
+};
+
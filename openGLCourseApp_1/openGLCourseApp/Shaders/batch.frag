@@ -0,0 +1,12 @@
+#version 330
+
+in vec3 TexCoord;
+
+out vec4 colour;
+
+uniform sampler2DArray theTexture;
+
+void main()
+{
+	colour = texture(theTexture, TexCoord);
+}
\ No newline at end of file
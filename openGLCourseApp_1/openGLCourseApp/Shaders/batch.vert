@@ -0,0 +1,20 @@
+#version 330
+
+layout (location = 0) in vec3 pos;
+layout (location = 1) in vec2 tex;
+
+// Per draw, advanced once per instance starting at the draw's base instance
+layout (location = 2) in mat4 model;
+layout (location = 6) in vec4 atlasTransform;
+layout (location = 7) in float atlasLayer;
+
+out vec3 TexCoord;
+
+uniform mat4 projection;
+uniform mat4 view;
+
+void main()
+{
+	gl_Position = projection * view * model * vec4(pos, 1.0);
+	TexCoord = vec3(tex * atlasTransform.xy + atlasTransform.zw, atlasLayer);
+}
\ No newline at end of file
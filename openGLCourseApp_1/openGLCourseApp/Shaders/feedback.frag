@@ -0,0 +1,23 @@
+#version 330
+
+in vec2 TexCoord;
+
+out vec4 feedback;
+
+// Virtual size in texels, page size, page border, last level
+uniform vec4 vtParams;
+
+// Level offset for the feedback target being smaller than the screen
+uniform float feedbackBias;
+
+void main()
+{
+	vec2 texel = TexCoord * vtParams.x;
+	vec2 dx = dFdx(texel);
+	vec2 dy = dFdy(texel);
+	float level = clamp(floor(0.5 * log2(max(dot(dx, dx), dot(dy, dy))) + feedbackBias), 0.0, vtParams.w);
+
+	// The page this pixel samples, alpha marks the pixel as covered
+	vec2 page = floor(fract(TexCoord) * vtParams.x / vtParams.y / exp2(level));
+	feedback = vec4(page, level, 255.0) / 255.0;
+}
\ No newline at end of file
@@ -1,10 +1,12 @@
-#version 330
-
-in vec4 vCol;
-
-out vec4 colour;
-
-void main()
-{
-	colour = vCol;
+#version 330
+
+in vec2 TexCoord;
+
+out vec4 colour;
+
+uniform sampler2D theTexture;
+
+void main()
+{
+	colour = texture(theTexture, TexCoord);
 }
\ No newline at end of file
@@ -1,15 +1,20 @@
-#version 330
-
-layout (location = 0) in vec3 pos;
-
-out vec4 vCol;
-
-uniform mat4 model;
-uniform mat4 projection;
-uniform mat4 view;
-
-void main()
-{
-	gl_Position = projection * view * model * vec4(pos, 1.0);
-	vCol = vec4(clamp(pos, 0.0f, 1.0f), 1.0f);
+#version 330
+
+layout (location = 0) in vec3 pos;
+layout (location = 1) in vec2 tex;
+
+out vec2 TexCoord;
+
+uniform mat4 model;
+uniform mat4 projection;
+uniform mat4 view;
+
+// Quantized positions arrive normalized to the mesh bounds, the identity for float ones
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+
+void main()
+{
+	gl_Position = projection * view * model * vec4(pos * positionScale + positionOffset, 1.0);
+	TexCoord = tex;
 }
\ No newline at end of file
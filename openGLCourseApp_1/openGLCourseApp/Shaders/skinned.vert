@@ -0,0 +1,78 @@
+#version 330
+
+layout (location = 0) in vec3 pos;
+layout (location = 1) in vec2 tex;
+// Up to four joints per vertex, weights summing to one
+layout (location = 3) in uvec4 joints;
+layout (location = 4) in vec4 weights;
+
+out vec2 TexCoord;
+
+uniform mat4 projection;
+uniform mat4 view;
+
+// Per instance from firstTexel on: three rows of the model matrix, then per joint three rows of its skinning
+// matrix or the real and dual parts of its dual quaternion (see AnimationSampler)
+uniform samplerBuffer palette;
+uniform int firstTexel;
+uniform int texelsPerInstance;
+uniform bool dualQuaternion;
+
+vec3 TransformRows(vec4 row0, vec4 row1, vec4 row2, vec3 p)
+{
+	vec4 point = vec4(p, 1.0);
+	return vec3(dot(row0, point), dot(row1, point), dot(row2, point));
+}
+
+vec3 LinearBlend(int firstJoint, vec3 p)
+{
+	// The weighted sum of the joints' matrices, applied once
+	vec4 row0 = vec4(0.0);
+	vec4 row1 = vec4(0.0);
+	vec4 row2 = vec4(0.0);
+	for (int i = 0; i < 4; i++)
+	{
+		int texel = firstJoint + int(joints[i]) * 3;
+		row0 += texelFetch(palette, texel) * weights[i];
+		row1 += texelFetch(palette, texel + 1) * weights[i];
+		row2 += texelFetch(palette, texel + 2) * weights[i];
+	}
+	return TransformRows(row0, row1, row2, p);
+}
+
+vec3 DualQuaternionBlend(int firstJoint, vec3 p)
+{
+	// q and -q are the same rotation, so every joint is blended on the side of the first one (Kavan et al.,
+	// "Skinning with Dual Quaternions")
+	vec4 pivot = texelFetch(palette, firstJoint + int(joints[0]) * 2);
+	vec4 real = vec4(0.0);
+	vec4 dual = vec4(0.0);
+	for (int i = 0; i < 4; i++)
+	{
+		int texel = firstJoint + int(joints[i]) * 2;
+		vec4 jointReal = texelFetch(palette, texel);
+		float weight = dot(jointReal, pivot) < 0.0 ? -weights[i] : weights[i];
+		real += jointReal * weight;
+		dual += texelFetch(palette, texel + 1) * weight;
+	}
+
+	float norm = length(real);
+	real /= norm;
+	dual /= norm;
+
+	vec3 rotated = p + 2.0 * cross(real.xyz, cross(real.xyz, p) + real.w * p);
+	vec3 translation = 2.0 * (real.w * dual.xyz - dual.w * real.xyz + cross(real.xyz, dual.xyz));
+	return rotated + translation;
+}
+
+void main()
+{
+	int instanceTexel = firstTexel + gl_InstanceID * texelsPerInstance;
+	int firstJoint = instanceTexel + 3;
+
+	vec3 skinned = dualQuaternion ? DualQuaternionBlend(firstJoint, pos) : LinearBlend(firstJoint, pos);
+	vec3 world = TransformRows(texelFetch(palette, instanceTexel), texelFetch(palette, instanceTexel + 1), texelFetch(palette, instanceTexel + 2), skinned);
+
+	gl_Position = projection * view * vec4(world, 1.0);
+	TexCoord = tex;
+}
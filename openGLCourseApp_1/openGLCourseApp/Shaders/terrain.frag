@@ -0,0 +1,17 @@
+#version 330
+
+in vec2 TexCoord;
+in vec3 Normal;
+
+out vec4 colour;
+
+uniform sampler2D theTexture;
+
+// Fixed sun, the rest of the scene is unlit
+const vec3 lightDirection = vec3(0.4, 0.8, 0.3);
+
+void main()
+{
+	float diffuse = max(dot(normalize(Normal), normalize(lightDirection)), 0.0);
+	colour = texture(theTexture, TexCoord) * vec4(vec3(0.35 + 0.65 * diffuse), 1.0);
+}
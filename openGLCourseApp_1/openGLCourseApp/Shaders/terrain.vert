@@ -0,0 +1,57 @@
+#version 330
+
+// Grid position across the unit square in x and z
+layout (location = 0) in vec3 pos;
+
+// Per node: corner x and z, width, level of detail
+layout (location = 2) in vec4 node;
+
+out vec2 TexCoord;
+out vec3 Normal;
+
+uniform mat4 model;
+uniform mat4 projection;
+uniform mat4 view;
+
+uniform sampler2D heightmap;
+uniform float terrainSize;
+uniform float heightScale;
+// Quads across the grid being drawn
+uniform float gridSize;
+// Camera in terrain space
+uniform vec3 eye;
+// Distances each level's vertices start and finish morphing at
+uniform vec2 morphRanges[16];
+
+// World units the ground texture repeats over
+const float textureRepeat = 8.0;
+
+float SampleHeight(vec2 xz)
+{
+	return textureLod(heightmap, xz / terrainSize, 0.0).r * heightScale;
+}
+
+void main()
+{
+	// In grid quads, whole numbers at the vertices
+	vec2 gridPos = floor(pos.xz * gridSize + 0.5);
+	float quadSize = node.z / gridSize;
+	vec2 xz = node.xy + gridPos * quadSize;
+
+	// Odd vertices slide onto the next coarser grid as the range ends, matching the coarser neighbour there
+	vec2 range = morphRanges[int(node.w)];
+	float distance = length(vec3(xz.x, SampleHeight(xz), xz.y) - eye);
+	float morph = clamp((distance - range.x) / (range.y - range.x), 0.0, 1.0);
+	gridPos -= mod(gridPos, 2.0) * morph;
+	xz = node.xy + gridPos * quadSize;
+
+	float height = SampleHeight(xz);
+	float left = SampleHeight(xz - vec2(quadSize, 0.0));
+	float right = SampleHeight(xz + vec2(quadSize, 0.0));
+	float back = SampleHeight(xz - vec2(0.0, quadSize));
+	float front = SampleHeight(xz + vec2(0.0, quadSize));
+	Normal = mat3(model) * normalize(vec3(left - right, 2.0 * quadSize, back - front));
+
+	gl_Position = projection * view * model * vec4(xz.x, height, xz.y, 1.0);
+	TexCoord = xz / textureRepeat;
+}
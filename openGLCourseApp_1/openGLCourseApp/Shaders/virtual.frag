@@ -0,0 +1,32 @@
+#version 330
+
+in vec2 TexCoord;
+
+out vec4 colour;
+
+// Cache slot of the finest resident page in r, g and that page's level in b
+uniform sampler2D pageTable;
+uniform sampler2D pageCache;
+
+// Virtual size in texels, page size, page border, last level
+uniform vec4 vtParams;
+
+void main()
+{
+	vec2 texel = TexCoord * vtParams.x;
+	vec2 dx = dFdx(texel);
+	vec2 dy = dFdy(texel);
+	float level = clamp(floor(0.5 * log2(max(dot(dx, dx), dot(dy, dy)))), 0.0, vtParams.w);
+
+	vec2 uv = fract(TexCoord);
+	vec4 entry = textureLod(pageTable, uv, level) * 255.0;
+	float residentLevel = floor(entry.b + 0.5);
+
+	// Position inside the resident page, offset past the border of its slot
+	float pages = vtParams.x / vtParams.y / exp2(residentLevel);
+	vec2 inPage = fract(uv * pages);
+	float slotSize = vtParams.y + 2.0 * vtParams.z;
+	vec2 cacheTexel = floor(entry.rg + 0.5) * slotSize + vtParams.z + inPage * vtParams.y;
+
+	colour = textureLod(pageCache, cacheTexel / vec2(textureSize(pageCache, 0)), 0.0);
+}
\ No newline at end of file
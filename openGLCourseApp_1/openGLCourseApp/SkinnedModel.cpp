@@ -0,0 +1,508 @@
+#include "SkinnedModel.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+#include <chrono>
+
+#include "GltfFile.h"
+#include "ResourceLoader.h"
+#include "ThreadPool.h"
+
+// Joint indices are stored in a byte per influence
+static const unsigned int maxSkinnedJoints = 256;
+
+static const float identityMatrix[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+SkinnedModel::SkinnedModel()
+{
+	for (int i = 0; i < 6; i++)
+	{
+		bounds[i] = 0.0f;
+	}
+}
+
+void SkinnedModel::SetJointCount(unsigned int jointCount)
+{
+	skeleton.parents.assign(jointCount, -1);
+	skeleton.rootTransforms.resize((size_t)jointCount * 16);
+	skeleton.inverseBindMatrices.resize((size_t)jointCount * 16);
+	for (unsigned int j = 0; j < jointCount; j++)
+	{
+		memcpy(&skeleton.rootTransforms[(size_t)j * 16], identityMatrix, sizeof(identityMatrix));
+		memcpy(&skeleton.inverseBindMatrices[(size_t)j * 16], identityMatrix, sizeof(identityMatrix));
+	}
+
+	// Padding lanes past the last joint hold the identity too, so blending them stays well defined
+	SoaTransform identity;
+	memset(&identity, 0, sizeof(identity));
+	for (int lane = 0; lane < 4; lane++)
+	{
+		identity.rotation[3][lane] = 1.0f;
+		identity.scale[0][lane] = 1.0f;
+		identity.scale[1][lane] = 1.0f;
+		identity.scale[2][lane] = 1.0f;
+	}
+	skeleton.restPose.assign((jointCount + 3) / 4, identity);
+}
+
+void SkinnedModel::SetRestTransform(unsigned int joint, const float* translation, const float* rotation, const float* scale)
+{
+	SoaTransform& group = skeleton.restPose[joint / 4];
+	unsigned int lane = joint % 4;
+	for (int c = 0; c < 3; c++)
+	{
+		group.translation[c][lane] = translation[c];
+		group.scale[c][lane] = scale[c];
+	}
+	for (int c = 0; c < 4; c++)
+	{
+		group.rotation[c][lane] = rotation[c];
+	}
+}
+
+void SkinnedModel::CreateMesh(std::vector<SkinnedVertex>& vertices, const std::vector<float>& weights, std::vector<unsigned int>& indices, ResourceLoader* resourceLoader, SkinnedLoadStats& stats)
+{
+	stats.repairedVertices = 0;
+	for (size_t v = 0; v < vertices.size(); v++)
+	{
+		SkinnedVertex& vertex = vertices[v];
+		const float* influence = &weights[v * 4];
+		float sum = 0.0f;
+		for (int i = 0; i < 4; i++)
+		{
+			sum += influence[i] > 0.0f ? influence[i] : 0.0f;
+		}
+		if (sum <= 0.0f)
+		{
+			memset(vertex.joints, 0, sizeof(vertex.joints));
+			vertex.weights[0] = 255;
+			vertex.weights[1] = vertex.weights[2] = vertex.weights[3] = 0;
+			stats.repairedVertices++;
+			continue;
+		}
+
+		// Rounded to 8 bits, whatever rounding lost or added goes to the strongest influence so they sum to 255
+		int total = 0;
+		int strongest = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			float weight = influence[i] > 0.0f ? influence[i] / sum : 0.0f;
+			vertex.weights[i] = (uint8_t)(weight * 255.0f + 0.5f);
+			total += vertex.weights[i];
+			strongest = vertex.weights[i] > vertex.weights[strongest] ? i : strongest;
+		}
+		vertex.weights[strongest] = (uint8_t)(vertex.weights[strongest] + 255 - total);
+	}
+
+	// Bounds of the rest pose as drawn, each vertex moved by its strongest joint, so scale carried by the
+	// skeleton (an armature in centimetres, say) is accounted for
+	std::vector<float> matrices((size_t)skeleton.GetJointCount() * 16);
+	std::vector<float> palette((size_t)AnimationSampler::GetPaletteTexels(skeleton, false) * 4);
+	if (!skeleton.restPose.empty())
+	{
+		AnimationSampler::LocalToModel(skeleton, &skeleton.restPose[0], &matrices[0]);
+		AnimationSampler::WritePalette(skeleton, &matrices[0], identityMatrix, false, &palette[0]);
+	}
+	for (int axis = 0; axis < 3; axis++)
+	{
+		bounds[axis] = vertices.empty() ? 0.0f : FLT_MAX;
+		bounds[3 + axis] = vertices.empty() ? 0.0f : -FLT_MAX;
+	}
+	for (size_t v = 0; v < vertices.size(); v++)
+	{
+		const SkinnedVertex& vertex = vertices[v];
+		int strongest = 0;
+		for (int i = 1; i < 4; i++)
+		{
+			strongest = vertex.weights[i] > vertex.weights[strongest] ? i : strongest;
+		}
+
+		const float* rows = &palette[(paletteModelTexels + (size_t)vertex.joints[strongest] * paletteMatrixTexels) * 4];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			const float* row = &rows[axis * 4];
+			float position = row[0] * vertex.position[0] + row[1] * vertex.position[1] + row[2] * vertex.position[2] + row[3];
+			bounds[axis] = std::min(bounds[axis], position);
+			bounds[3 + axis] = std::max(bounds[3 + axis], position);
+		}
+	}
+
+	stats.vertices = (unsigned int)vertices.size();
+	stats.triangles = (unsigned int)(indices.size() / 3);
+	if (!vertices.empty() && !indices.empty())
+	{
+		mesh.CreateMesh(&vertices[0], &indices[0], (unsigned int)vertices.size(), (unsigned int)indices.size(), resourceLoader);
+	}
+}
+
+bool SkinnedModel::LoadModel(const char* fileLocation, float sampleRate, ThreadPool* pool, ResourceLoader* resourceLoader, SkinnedLoadStats& stats)
+{
+	ClearModel();
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	memset(&stats, 0, sizeof(stats));
+
+	GltfFile file;
+	if (!file.Open(fileLocation))
+	{
+		return false;
+	}
+
+	const std::vector<GltfInstance>& instances = file.GetInstances();
+	const std::vector<GltfNode>& nodes = file.GetNodes();
+	const std::vector<GltfPrimitive>& primitives = file.GetPrimitives();
+	const GltfInstance* instance = NULL;
+	for (size_t i = 0; i < instances.size() && !instance; i++)
+	{
+		instance = instances[i].skin >= 0 && !file.GetSkins()[instances[i].skin].joints.empty() ? &instances[i] : NULL;
+	}
+	if (!instance)
+	{
+		printf("%s has no skinned mesh\n", fileLocation);
+		return false;
+	}
+
+	const GltfSkin& skin = file.GetSkins()[instance->skin];
+	unsigned int jointCount = (unsigned int)skin.joints.size();
+	if (jointCount > maxSkinnedJoints)
+	{
+		printf("%s: %u joints, at most %u are supported\n", fileLocation, jointCount, maxSkinnedJoints);
+		return false;
+	}
+
+	// Each joint's parent is its nearest ancestor in the skin, the walk bounded in case the parents form a cycle
+	std::vector<int> skinIndex(nodes.size(), -1);
+	for (unsigned int j = 0; j < jointCount; j++)
+	{
+		skinIndex[skin.joints[j]] = (int)j;
+	}
+	std::vector<int> skinParents(jointCount, -1);
+	std::vector<unsigned int> depths(jointCount, 0);
+	for (unsigned int j = 0; j < jointCount; j++)
+	{
+		int node = nodes[skin.joints[j]].parent;
+		for (size_t steps = 0; node >= 0 && steps < nodes.size(); steps++)
+		{
+			if (skinIndex[node] >= 0)
+			{
+				skinParents[j] = skinIndex[node];
+				break;
+			}
+			node = nodes[node].parent;
+		}
+	}
+	for (unsigned int j = 0; j < jointCount; j++)
+	{
+		int parent = skinParents[j];
+		for (unsigned int steps = 0; parent >= 0 && steps < jointCount; steps++)
+		{
+			depths[j]++;
+			parent = skinParents[parent];
+		}
+	}
+
+	// Parents first: ordered by depth, the skin's order kept among equals
+	std::vector<unsigned int> order(jointCount);
+	for (unsigned int j = 0; j < jointCount; j++)
+	{
+		order[j] = j;
+	}
+	std::stable_sort(order.begin(), order.end(), [&depths](unsigned int a, unsigned int b) { return depths[a] < depths[b]; });
+	std::vector<unsigned int> remap(jointCount);
+	for (unsigned int j = 0; j < jointCount; j++)
+	{
+		remap[order[j]] = j;
+	}
+
+	std::vector<float> inverseBinds;
+	if (skin.inverseBindMatrices >= 0 && (!file.ReadFloats((uint32_t)skin.inverseBindMatrices, 16, inverseBinds) || inverseBinds.size() < (size_t)jointCount * 16))
+	{
+		printf("%s: inverse bind matrices could not be read\n", fileLocation);
+		return false;
+	}
+
+	SetJointCount(jointCount);
+	for (unsigned int j = 0; j < jointCount; j++)
+	{
+		unsigned int source = order[j];
+		const GltfNode& node = nodes[skin.joints[source]];
+		skeleton.parents[j] = skinParents[source] >= 0 ? (int)remap[skinParents[source]] : -1;
+		SetRestTransform(j, node.translation, node.rotation, node.scale);
+		if (!inverseBinds.empty())
+		{
+			memcpy(&skeleton.inverseBindMatrices[(size_t)j * 16], &inverseBinds[(size_t)source * 16], sizeof(float) * 16);
+		}
+
+		// Scene nodes above a root joint place the whole skeleton, they are taken as they stand in the scene
+		if (skeleton.parents[j] < 0 && node.parent >= 0)
+		{
+			memcpy(&skeleton.rootTransforms[(size_t)j * 16], nodes[node.parent].world, sizeof(float) * 16);
+		}
+	}
+
+	// Every skinned triangle primitive of the mesh merged into one, positions already in the skin's bind space
+	std::vector<SkinnedVertex> vertices;
+	std::vector<float> weights;
+	std::vector<unsigned int> indices;
+	const GltfMesh& gltfMesh = file.GetMeshes()[instance->mesh];
+	for (uint32_t p = gltfMesh.firstPrimitive; p < gltfMesh.firstPrimitive + gltfMesh.primitiveCount; p++)
+	{
+		const GltfPrimitive& primitive = primitives[p];
+		std::vector<float> positions, texCoords, joints, primitiveWeights;
+		std::vector<uint32_t> primitiveIndices;
+		if (primitive.mode != gltfTriangles || primitive.position < 0 || primitive.joints < 0 ||
+			!file.ReadFloats(primitive.position, 3, positions) ||
+			!file.ReadFloats(primitive.joints, 4, joints) ||
+			!file.ReadFloats(primitive.weights, 4, primitiveWeights) ||
+			(primitive.texCoord >= 0 && !file.ReadFloats(primitive.texCoord, 2, texCoords)) ||
+			(primitive.indices >= 0 && !file.ReadIndices(primitive.indices, primitiveIndices)))
+		{
+			continue;
+		}
+
+		size_t vertexCount = positions.size() / 3;
+		if (joints.size() < vertexCount * 4 || primitiveWeights.size() < vertexCount * 4)
+		{
+			continue;
+		}
+		if (primitive.indices < 0)
+		{
+			primitiveIndices.resize(vertexCount);
+			for (size_t i = 0; i < vertexCount; i++)
+			{
+				primitiveIndices[i] = (uint32_t)i;
+			}
+		}
+
+		// Whole triangles with indices inside the primitive only
+		bool valid = true;
+		for (size_t i = 0; i < primitiveIndices.size() && valid; i++)
+		{
+			valid = primitiveIndices[i] < vertexCount;
+		}
+		if (!valid)
+		{
+			printf("%s: primitive %u indexes past its vertices\n", fileLocation, p);
+			continue;
+		}
+
+		unsigned int baseVertex = (unsigned int)vertices.size();
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			SkinnedVertex vertex;
+			memcpy(vertex.position, &positions[i * 3], sizeof(vertex.position));
+			vertex.uv[0] = texCoords.empty() ? 0.0f : texCoords[i * 2];
+			vertex.uv[1] = texCoords.empty() ? 0.0f : 1.0f - texCoords[i * 2 + 1];
+			for (int k = 0; k < 4; k++)
+			{
+				unsigned int joint = (unsigned int)joints[i * 4 + k];
+				bool inSkeleton = joint < jointCount;
+				vertex.joints[k] = (uint8_t)(inSkeleton ? remap[joint] : 0);
+				weights.push_back(inSkeleton ? primitiveWeights[i * 4 + k] : 0.0f);
+			}
+			vertex.weights[0] = vertex.weights[1] = vertex.weights[2] = vertex.weights[3] = 0;
+			vertices.push_back(vertex);
+		}
+		size_t triangleIndices = primitiveIndices.size() - primitiveIndices.size() % 3;
+		for (size_t i = 0; i < triangleIndices; i++)
+		{
+			indices.push_back(baseVertex + primitiveIndices[i]);
+		}
+	}
+
+	if (indices.empty())
+	{
+		printf("%s: the skinned mesh has no drawable triangles\n", fileLocation);
+		ClearModel();
+		return false;
+	}
+
+	// Clips from every animation that moves a joint, cubic splines keeping only their values
+	const std::vector<GltfAnimation>& animations = file.GetAnimations();
+	for (size_t a = 0; a < animations.size(); a++)
+	{
+		std::vector<AnimationTrack> tracks;
+		float duration = 0.0f;
+		for (size_t c = 0; c < animations[a].channels.size(); c++)
+		{
+			const GltfChannel& channel = animations[a].channels[c];
+			int joint = skinIndex[channel.node];
+			if (joint < 0)
+			{
+				continue;
+			}
+
+			AnimationTrack track;
+			track.joint = remap[joint];
+			track.property = channel.path == gltfRotation ? ANIMATION_ROTATION : channel.path == gltfScale ? ANIMATION_SCALE : ANIMATION_TRANSLATION;
+			track.step = channel.interpolation == gltfStep;
+			unsigned int components = track.property == ANIMATION_ROTATION ? 4 : 3;
+			if (!file.ReadFloats(channel.input, 1, track.times) || !file.ReadFloats(channel.output, components, track.values) || track.times.empty())
+			{
+				continue;
+			}
+			if (channel.interpolation == gltfCubicSpline)
+			{
+				for (size_t k = 0; k < track.times.size() && (k * 3 + 2) * components <= track.values.size(); k++)
+				{
+					memmove(&track.values[k * components], &track.values[(k * 3 + 1) * components], sizeof(float) * components);
+				}
+			}
+			track.values.resize(std::min(track.values.size(), track.times.size() * components));
+			duration = std::max(duration, track.times.back());
+			tracks.push_back(track);
+		}
+
+		if (!tracks.empty())
+		{
+			clips.push_back(AnimationClip());
+			AnimationSampler::BakeClip(skeleton, tracks, duration, sampleRate, pool, clips.back());
+		}
+	}
+
+	CreateMesh(vertices, weights, indices, resourceLoader, stats);
+	stats.joints = jointCount;
+	stats.clips = (unsigned int)clips.size();
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return true;
+}
+
+void SkinnedModel::CreateGenerated(unsigned int jointCount, ThreadPool* pool, ResourceLoader* resourceLoader, SkinnedLoadStats& stats)
+{
+	ClearModel();
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	memset(&stats, 0, sizeof(stats));
+
+	const float height = 2.0f;
+	const float radius = 0.2f;
+	const unsigned int ringsPerJoint = 4;
+	const unsigned int segments = 16;
+	const float pi = 3.14159265f;
+
+	jointCount = std::max(1u, std::min(jointCount, maxSkinnedJoints));
+	float jointLength = height / (float)jointCount;
+
+	// A chain straight up the y axis, each joint at the bottom of its segment
+	SetJointCount(jointCount);
+	const float noRotation[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+	const float unitScale[3] = { 1.0f, 1.0f, 1.0f };
+	for (unsigned int j = 0; j < jointCount; j++)
+	{
+		const float translation[3] = { 0.0f, j == 0 ? 0.0f : jointLength, 0.0f };
+		skeleton.parents[j] = (int)j - 1;
+		SetRestTransform(j, translation, noRotation, unitScale);
+		skeleton.inverseBindMatrices[(size_t)j * 16 + 13] = -jointLength * (float)j;
+	}
+
+	// Rings up the column, each vertex blended between the two joints whose segment centres it lies between
+	unsigned int rings = jointCount * ringsPerJoint;
+	std::vector<SkinnedVertex> vertices;
+	std::vector<float> weights;
+	for (unsigned int r = 0; r <= rings; r++)
+	{
+		float y = height * (float)r / (float)rings;
+		float along = std::max(0.0f, std::min(y / jointLength - 0.5f, (float)(jointCount - 1)));
+		unsigned int lower = std::min((unsigned int)along, jointCount - 1);
+		unsigned int upper = std::min(lower + 1, jointCount - 1);
+		float blend = along - (float)lower;
+
+		for (unsigned int s = 0; s <= segments; s++)
+		{
+			float angle = 2.0f * pi * (float)s / (float)segments;
+			SkinnedVertex vertex;
+			vertex.position[0] = cosf(angle) * radius;
+			vertex.position[1] = y;
+			vertex.position[2] = -sinf(angle) * radius;
+			vertex.uv[0] = (float)s / (float)segments;
+			vertex.uv[1] = y / height;
+			vertex.joints[0] = (uint8_t)lower;
+			vertex.joints[1] = (uint8_t)upper;
+			vertex.joints[2] = vertex.joints[3] = 0;
+			vertices.push_back(vertex);
+
+			weights.push_back(1.0f - blend);
+			weights.push_back(blend);
+			weights.push_back(0.0f);
+			weights.push_back(0.0f);
+		}
+	}
+
+	std::vector<unsigned int> indices;
+	for (unsigned int r = 0; r < rings; r++)
+	{
+		for (unsigned int s = 0; s < segments; s++)
+		{
+			unsigned int a = r * (segments + 1) + s;
+			unsigned int b = a + segments + 1;
+			unsigned int quad[6] = { a, a + 1, b, b, a + 1, b + 1 };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+
+	// Two second loops: a sway bending the column back and forth in a travelling wave, and a twist turning each
+	// joint further about the column than the one below, which linear blending visibly collapses
+	const unsigned int keys = 32;
+	const float duration = 2.0f;
+	for (int clip = 0; clip < 2; clip++)
+	{
+		std::vector<AnimationTrack> tracks(jointCount);
+		for (unsigned int j = 0; j < jointCount; j++)
+		{
+			AnimationTrack& track = tracks[j];
+			track.joint = j;
+			track.property = ANIMATION_ROTATION;
+			track.step = false;
+			for (unsigned int k = 0; k <= keys; k++)
+			{
+				float time = duration * (float)k / (float)keys;
+				float phase = 2.0f * pi * time / duration;
+				float angle = clip == 0 ? 0.35f * sinf(phase - (float)j * 0.5f) : (j == 0 ? 0.0f : 0.6f * sinf(phase));
+				float half = angle * 0.5f;
+				float rotation[4] = { 0.0f, 0.0f, 0.0f, cosf(half) };
+				rotation[clip == 0 ? 2 : 1] = sinf(half);
+
+				track.times.push_back(time);
+				track.values.insert(track.values.end(), rotation, rotation + 4);
+			}
+		}
+		clips.push_back(AnimationClip());
+		AnimationSampler::BakeClip(skeleton, tracks, duration, 30.0f, pool, clips.back());
+	}
+
+	CreateMesh(vertices, weights, indices, resourceLoader, stats);
+	stats.joints = jointCount;
+	stats.clips = (unsigned int)clips.size();
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void SkinnedModel::GetBounds(float* boundsMin, float* boundsMax)
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		boundsMin[axis] = bounds[axis];
+		boundsMax[axis] = bounds[3 + axis];
+	}
+}
+
+void SkinnedModel::ClearModel()
+{
+	mesh.ClearMesh();
+	skeleton.parents.clear();
+	skeleton.rootTransforms.clear();
+	skeleton.inverseBindMatrices.clear();
+	skeleton.restPose.clear();
+	clips.clear();
+	for (int i = 0; i < 6; i++)
+	{
+		bounds[i] = 0.0f;
+	}
+}
+
+SkinnedModel::~SkinnedModel()
+{
+	ClearModel();
+}
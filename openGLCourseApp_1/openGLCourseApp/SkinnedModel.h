@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+
+#include <GL\glew.h>
+
+#include "Mesh.h"
+#include "AnimationSampler.h"
+
+class ThreadPool;
+class ResourceLoader;
+
+struct SkinnedLoadStats
+{
+	// Parsing, skeleton setup and clip baking on the calling thread, the upload finishes later
+	double milliseconds;
+	unsigned int vertices;
+	unsigned int triangles;
+	unsigned int joints;
+	unsigned int clips;
+	// Vertices left without a usable weight, joints past the skeleton's included, bound to the first joint
+	unsigned int repairedVertices;
+};
+
+// A skinned mesh with its skeleton and animation clips, the shared asset behind any number of animated
+// characters. Loaded from the first skinned mesh of a glTF asset, every animation moving one of its joints
+// becoming a clip baked for AnimationSampler, or generated as a segmented column that sways and twists for
+// testing without assets. Textures are left to the caller.
+class SkinnedModel
+{
+public:
+	SkinnedModel();
+
+	// Main thread with the GL context current, the mesh uploads through the loader thread. Clips are resampled
+	// at sampleRate frames per second.
+	bool LoadModel(const char* fileLocation, float sampleRate, ThreadPool* pool, ResourceLoader* resourceLoader, SkinnedLoadStats& stats);
+	// jointCount joints stacked two units high, with a sway and a twist clip
+	void CreateGenerated(unsigned int jointCount, ThreadPool* pool, ResourceLoader* resourceLoader, SkinnedLoadStats& stats);
+
+	Mesh* GetMesh() { return &mesh; }
+	const Skeleton& GetSkeleton() { return skeleton; }
+	const std::vector<AnimationClip>& GetClips() { return clips; }
+	// Of the mesh in the skeleton's rest pose
+	void GetBounds(float* boundsMin, float* boundsMax);
+
+	void ClearModel();
+
+	~SkinnedModel();
+
+private:
+	Mesh mesh;
+	Skeleton skeleton;
+	std::vector<AnimationClip> clips;
+	float bounds[6];
+
+	void SetJointCount(unsigned int jointCount);
+	void SetRestTransform(unsigned int joint, const float* translation, const float* rotation, const float* scale);
+	// Normalize each vertex's weights to 8 bits, measure the rest pose bounds and create the mesh. The skeleton
+	// must be set up first.
+	void CreateMesh(std::vector<SkinnedVertex>& vertices, const std::vector<float>& weights, std::vector<unsigned int>& indices, ResourceLoader* resourceLoader, SkinnedLoadStats& stats);
+};
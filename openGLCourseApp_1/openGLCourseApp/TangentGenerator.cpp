@@ -0,0 +1,609 @@
+#include "TangentGenerator.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <functional>
+#include <xmmintrin.h>
+
+#include "ThreadPool.h"
+
+// Partial sums kept at most, each as large as the vertices it accumulates into
+static const size_t tangentMaxPartials = 8;
+
+// Triangles worth giving a partial sum of their own
+static const size_t tangentTrianglesPerPartial = 16384;
+
+// Vertices per pool job when reducing the partial sums, a multiple of four
+static const size_t tangentReduceGrain = 16384;
+
+// Orientation of a triangle's texture mapping, the bitangent sign its vertices get
+static const uint8_t TRIANGLE_MIRRORED = 0;
+static const uint8_t TRIANGLE_PRESERVING = 1;
+static const uint8_t TRIANGLE_DEGENERATE = 2;
+
+// One job's sums, kept as structure of arrays so the reduction reads four slots at once
+struct PartialSums
+{
+	std::vector<float> x, y, z;
+	unsigned int degenerate;
+};
+
+static size_t PartialCount(ThreadPool* pool, size_t triangles)
+{
+	size_t count = pool ? pool->GetThreadCount() + 1 : 1;
+	size_t useful = (triangles + tangentTrianglesPerPartial - 1) / tangentTrianglesPerPartial;
+	count = count < tangentMaxPartials ? count : tangentMaxPartials;
+	count = count < useful ? count : useful;
+	return count > 0 ? count : 1;
+}
+
+// body(partial, firstTriangle, lastTriangle) over each partial's share, shares being whole groups of four
+static void ForEachPartial(ThreadPool* pool, size_t partialCount, size_t triangles, const std::function<void(size_t, size_t, size_t)>& body)
+{
+	size_t share = ((triangles + 3) / 4 + partialCount - 1) / partialCount * 4;
+	auto run = [&body, share, triangles](size_t begin, size_t end)
+	{
+		for (size_t p = begin; p < end; p++)
+		{
+			size_t first = p * share < triangles ? p * share : triangles;
+			size_t last = first + share < triangles ? first + share : triangles;
+			body(p, first, last);
+		}
+	};
+
+	if (pool && partialCount > 1)
+	{
+		pool->ParallelFor(partialCount, 1, run);
+	}
+	else
+	{
+		run(0, partialCount);
+	}
+}
+
+static void ForEachRange(ThreadPool* pool, size_t count, size_t grain, const std::function<void(size_t, size_t)>& body)
+{
+	if (pool && count > grain)
+	{
+		pool->ParallelFor(count, grain, body);
+	}
+	else
+	{
+		body(0, count);
+	}
+}
+
+// Lanes of a group past its last triangle repeat that triangle, their results are ignored
+static void GatherCorners(const unsigned int* indices, size_t firstTriangle, size_t count, unsigned int corners[3][4])
+{
+	for (int lane = 0; lane < 4; lane++)
+	{
+		size_t triangle = firstTriangle + ((size_t)lane < count ? lane : count - 1);
+		for (int c = 0; c < 3; c++)
+		{
+			corners[c][lane] = indices[triangle * 3 + c];
+		}
+	}
+}
+
+static void Gather3(const float* data, size_t stride, const unsigned int* lanes, __m128& x, __m128& y, __m128& z)
+{
+	const float* a = data + lanes[0] * stride;
+	const float* b = data + lanes[1] * stride;
+	const float* c = data + lanes[2] * stride;
+	const float* d = data + lanes[3] * stride;
+	x = _mm_setr_ps(a[0], b[0], c[0], d[0]);
+	y = _mm_setr_ps(a[1], b[1], c[1], d[1]);
+	z = _mm_setr_ps(a[2], b[2], c[2], d[2]);
+}
+
+static void Gather2(const float* data, size_t stride, const unsigned int* lanes, __m128& x, __m128& y)
+{
+	const float* a = data + lanes[0] * stride;
+	const float* b = data + lanes[1] * stride;
+	const float* c = data + lanes[2] * stride;
+	const float* d = data + lanes[3] * stride;
+	x = _mm_setr_ps(a[0], b[0], c[0], d[0]);
+	y = _mm_setr_ps(a[1], b[1], c[1], d[1]);
+}
+
+static inline __m128 Dot(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz)
+{
+	return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+}
+
+static inline void Cross(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz, __m128& x, __m128& y, __m128& z)
+{
+	x = _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(az, by));
+	y = _mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(ax, bz));
+	z = _mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(ay, bx));
+}
+
+// Zero length vectors stay zero
+static inline void Normalize(__m128& x, __m128& y, __m128& z)
+{
+	__m128 lengthSquared = Dot(x, y, z, x, y, z);
+	__m128 tiny = _mm_set1_ps(1e-30f);
+	__m128 inverse = _mm_and_ps(_mm_cmpgt_ps(lengthSquared, tiny), _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(_mm_max_ps(lengthSquared, tiny))));
+	x = _mm_mul_ps(x, inverse);
+	y = _mm_mul_ps(y, inverse);
+	z = _mm_mul_ps(z, inverse);
+}
+
+// Abramowitz and Stegun 4.4.45, within 7e-5 radians over [-1, 1]
+static inline __m128 Acos(__m128 value)
+{
+	value = _mm_max_ps(_mm_min_ps(value, _mm_set1_ps(1.0f)), _mm_set1_ps(-1.0f));
+	__m128 absolute = _mm_andnot_ps(_mm_set1_ps(-0.0f), value);
+	__m128 polynomial = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-0.0187293f), absolute), _mm_set1_ps(0.0742610f));
+	polynomial = _mm_add_ps(_mm_mul_ps(polynomial, absolute), _mm_set1_ps(-0.2121144f));
+	polynomial = _mm_add_ps(_mm_mul_ps(polynomial, absolute), _mm_set1_ps(1.5707288f));
+	__m128 angle = _mm_mul_ps(polynomial, _mm_sqrt_ps(_mm_sub_ps(_mm_set1_ps(1.0f), absolute)));
+	__m128 negative = _mm_cmplt_ps(value, _mm_setzero_ps());
+	return _mm_or_ps(_mm_and_ps(negative, _mm_sub_ps(_mm_set1_ps(3.14159265f), angle)), _mm_andnot_ps(negative, angle));
+}
+
+// Sum every partial into the first and normalize, four slots at a time
+static void ReducePartials(ThreadPool* pool, std::vector<PartialSums>& partials, size_t slots)
+{
+	ForEachRange(pool, slots, tangentReduceGrain, [&partials, slots](size_t begin, size_t end)
+	{
+		PartialSums& total = partials[0];
+		size_t s = begin;
+		for (; s + 4 <= end; s += 4)
+		{
+			__m128 x = _mm_loadu_ps(&total.x[s]);
+			__m128 y = _mm_loadu_ps(&total.y[s]);
+			__m128 z = _mm_loadu_ps(&total.z[s]);
+			for (size_t p = 1; p < partials.size(); p++)
+			{
+				x = _mm_add_ps(x, _mm_loadu_ps(&partials[p].x[s]));
+				y = _mm_add_ps(y, _mm_loadu_ps(&partials[p].y[s]));
+				z = _mm_add_ps(z, _mm_loadu_ps(&partials[p].z[s]));
+			}
+			Normalize(x, y, z);
+			_mm_storeu_ps(&total.x[s], x);
+			_mm_storeu_ps(&total.y[s], y);
+			_mm_storeu_ps(&total.z[s], z);
+		}
+
+		for (; s < end; s++)
+		{
+			float x = total.x[s];
+			float y = total.y[s];
+			float z = total.z[s];
+			for (size_t p = 1; p < partials.size(); p++)
+			{
+				x += partials[p].x[s];
+				y += partials[p].y[s];
+				z += partials[p].z[s];
+			}
+			float length = sqrtf(x * x + y * y + z * z);
+			float inverse = length > 0.0f ? 1.0f / length : 0.0f;
+			total.x[s] = x * inverse;
+			total.y[s] = y * inverse;
+			total.z[s] = z * inverse;
+		}
+	});
+}
+
+// Some unit vector at right angles to normal, for vertices nothing gave a tangent
+static void Perpendicular(const float* normal, float* tangent)
+{
+	float axis[3] = { 1.0f, 0.0f, 0.0f };
+	if (fabsf(normal[0]) > 0.9f)
+	{
+		axis[0] = 0.0f;
+		axis[1] = 1.0f;
+	}
+	float along = axis[0] * normal[0] + axis[1] * normal[1] + axis[2] * normal[2];
+	float length = 0.0f;
+	for (int k = 0; k < 3; k++)
+	{
+		tangent[k] = axis[k] - along * normal[k];
+		length += tangent[k] * tangent[k];
+	}
+	length = sqrtf(length);
+	for (int k = 0; k < 3; k++)
+	{
+		tangent[k] = length > 0.0f ? tangent[k] / length : axis[k];
+	}
+}
+
+// The first vertex at each vertex's position, through an open addressing table. Adding zero folds -0 into 0.
+static void WeldPositions(const float* vertices, size_t vertexCount, unsigned int floatsPerVertex, std::vector<unsigned int>& canonical)
+{
+	size_t tableSize = 16;
+	while (tableSize < vertexCount * 2)
+	{
+		tableSize *= 2;
+	}
+	std::vector<unsigned int> table(tableSize, 0xFFFFFFFF);
+	canonical.resize(vertexCount);
+
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		const float* position = vertices + v * floatsPerVertex;
+		float key[3] = { position[0] + 0.0f, position[1] + 0.0f, position[2] + 0.0f };
+		uint32_t bits[3];
+		memcpy(bits, key, sizeof(bits));
+		uint32_t hash = bits[0] * 0x9e3779b1u ^ bits[1] * 0x85ebca6bu ^ bits[2] * 0xc2b2ae35u;
+		hash ^= hash >> 16;
+
+		size_t slot = hash & (tableSize - 1);
+		while (true)
+		{
+			unsigned int existing = table[slot];
+			if (existing == 0xFFFFFFFF)
+			{
+				table[slot] = (unsigned int)v;
+				canonical[v] = (unsigned int)v;
+				break;
+			}
+
+			const float* other = vertices + (size_t)existing * floatsPerVertex;
+			if (other[0] == key[0] && other[1] == key[1] && other[2] == key[2])
+			{
+				canonical[v] = existing;
+				break;
+			}
+			slot = (slot + 1) & (tableSize - 1);
+		}
+	}
+}
+
+void TangentGenerator::GenerateSmoothNormals(const float* vertices, size_t vertexCount, unsigned int floatsPerVertex, const unsigned int* indices, size_t indexCount, ThreadPool* pool, std::vector<float>& normals, TangentGenerateStats& stats)
+{
+	auto start = std::chrono::steady_clock::now();
+	size_t triangles = indexCount / 3;
+	stats.triangles = (unsigned int)triangles;
+	stats.addedVertices = 0;
+	stats.degenerateTriangles = 0;
+
+	// Vertices split only by their texture coordinate share one sum
+	std::vector<unsigned int> canonical;
+	WeldPositions(vertices, vertexCount, floatsPerVertex, canonical);
+
+	// Unnormalized face normals, so each counts in proportion to its area
+	size_t partialCount = PartialCount(pool, triangles);
+	std::vector<PartialSums> partials(partialCount);
+	ForEachPartial(pool, partialCount, triangles, [&](size_t p, size_t first, size_t last)
+	{
+		PartialSums& sums = partials[p];
+		sums.x.assign(vertexCount, 0.0f);
+		sums.y.assign(vertexCount, 0.0f);
+		sums.z.assign(vertexCount, 0.0f);
+		sums.degenerate = 0;
+
+		for (size_t t = first; t < last; t += 4)
+		{
+			size_t count = last - t < 4 ? last - t : 4;
+			unsigned int corners[3][4];
+			GatherCorners(indices, t, count, corners);
+
+			__m128 x0, y0, z0, x1, y1, z1, x2, y2, z2;
+			Gather3(vertices, floatsPerVertex, corners[0], x0, y0, z0);
+			Gather3(vertices, floatsPerVertex, corners[1], x1, y1, z1);
+			Gather3(vertices, floatsPerVertex, corners[2], x2, y2, z2);
+
+			__m128 nx, ny, nz;
+			Cross(_mm_sub_ps(x1, x0), _mm_sub_ps(y1, y0), _mm_sub_ps(z1, z0), _mm_sub_ps(x2, x0), _mm_sub_ps(y2, y0), _mm_sub_ps(z2, z0), nx, ny, nz);
+			float faceX[4], faceY[4], faceZ[4];
+			_mm_storeu_ps(faceX, nx);
+			_mm_storeu_ps(faceY, ny);
+			_mm_storeu_ps(faceZ, nz);
+
+			for (size_t lane = 0; lane < count; lane++)
+			{
+				if (faceX[lane] == 0.0f && faceY[lane] == 0.0f && faceZ[lane] == 0.0f)
+				{
+					sums.degenerate++;
+					continue;
+				}
+				for (int c = 0; c < 3; c++)
+				{
+					unsigned int slot = canonical[corners[c][lane]];
+					sums.x[slot] += faceX[lane];
+					sums.y[slot] += faceY[lane];
+					sums.z[slot] += faceZ[lane];
+				}
+			}
+		}
+	});
+
+	ReducePartials(pool, partials, vertexCount);
+
+	normals.resize(vertexCount * 3);
+	const PartialSums& total = partials[0];
+	ForEachRange(pool, vertexCount, tangentReduceGrain, [&](size_t begin, size_t end)
+	{
+		for (size_t v = begin; v < end; v++)
+		{
+			unsigned int slot = canonical[v];
+			float* normal = &normals[v * 3];
+			normal[0] = total.x[slot];
+			normal[1] = total.y[slot];
+			normal[2] = total.z[slot];
+
+			// Vertices on nothing but degenerate triangles point up
+			if (normal[0] == 0.0f && normal[1] == 0.0f && normal[2] == 0.0f)
+			{
+				normal[1] = 1.0f;
+			}
+		}
+	});
+
+	for (size_t p = 0; p < partialCount; p++)
+	{
+		stats.degenerateTriangles += partials[p].degenerate;
+	}
+	stats.partials = (unsigned int)partialCount;
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void TangentGenerator::GenerateFlatNormals(std::vector<float>& vertices, unsigned int floatsPerVertex, std::vector<unsigned int>& indices, ThreadPool* pool, std::vector<float>& normals, TangentGenerateStats& stats)
+{
+	auto start = std::chrono::steady_clock::now();
+	size_t vertexCount = vertices.size() / floatsPerVertex;
+	size_t triangles = indices.size() / 3;
+	stats.triangles = (unsigned int)triangles;
+	stats.addedVertices = triangles * 3 > vertexCount ? (unsigned int)(triangles * 3 - vertexCount) : 0;
+	stats.degenerateTriangles = 0;
+
+	std::vector<float> unwelded(triangles * 3 * floatsPerVertex);
+	normals.resize(triangles * 3 * 3);
+
+	size_t partialCount = PartialCount(pool, triangles);
+	std::vector<unsigned int> degenerate(partialCount, 0);
+	const float* source = vertices.empty() ? NULL : &vertices[0];
+	ForEachPartial(pool, partialCount, triangles, [&](size_t p, size_t first, size_t last)
+	{
+		for (size_t t = first; t < last; t += 4)
+		{
+			size_t count = last - t < 4 ? last - t : 4;
+			unsigned int corners[3][4];
+			GatherCorners(&indices[0], t, count, corners);
+
+			__m128 x0, y0, z0, x1, y1, z1, x2, y2, z2;
+			Gather3(source, floatsPerVertex, corners[0], x0, y0, z0);
+			Gather3(source, floatsPerVertex, corners[1], x1, y1, z1);
+			Gather3(source, floatsPerVertex, corners[2], x2, y2, z2);
+
+			__m128 nx, ny, nz;
+			Cross(_mm_sub_ps(x1, x0), _mm_sub_ps(y1, y0), _mm_sub_ps(z1, z0), _mm_sub_ps(x2, x0), _mm_sub_ps(y2, y0), _mm_sub_ps(z2, z0), nx, ny, nz);
+			Normalize(nx, ny, nz);
+			float faceX[4], faceY[4], faceZ[4];
+			_mm_storeu_ps(faceX, nx);
+			_mm_storeu_ps(faceY, ny);
+			_mm_storeu_ps(faceZ, nz);
+
+			for (size_t lane = 0; lane < count; lane++)
+			{
+				float face[3] = { faceX[lane], faceY[lane], faceZ[lane] };
+				if (face[0] == 0.0f && face[1] == 0.0f && face[2] == 0.0f)
+				{
+					face[1] = 1.0f;
+					degenerate[p]++;
+				}
+
+				size_t corner = (t + lane) * 3;
+				for (int c = 0; c < 3; c++)
+				{
+					memcpy(&unwelded[(corner + c) * floatsPerVertex], source + (size_t)corners[c][lane] * floatsPerVertex, sizeof(float) * floatsPerVertex);
+					memcpy(&normals[(corner + c) * 3], face, sizeof(face));
+				}
+			}
+		}
+	});
+
+	vertices.swap(unwelded);
+	indices.resize(triangles * 3);
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		indices[i] = (unsigned int)i;
+	}
+
+	for (size_t p = 0; p < partialCount; p++)
+	{
+		stats.degenerateTriangles += degenerate[p];
+	}
+	stats.partials = (unsigned int)partialCount;
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void TangentGenerator::GenerateTangents(std::vector<float>& vertices, unsigned int floatsPerVertex, std::vector<unsigned int>& indices, std::vector<float>& normals, ThreadPool* pool, std::vector<float>& tangents, TangentGenerateStats& stats)
+{
+	auto start = std::chrono::steady_clock::now();
+	size_t vertexCount = vertices.size() / floatsPerVertex;
+	size_t triangles = indices.size() / 3;
+	stats.triangles = (unsigned int)triangles;
+	stats.addedVertices = 0;
+	stats.degenerateTriangles = 0;
+
+	// Two sums per vertex, one for each texture orientation
+	std::vector<uint8_t> orientation(triangles);
+	size_t partialCount = PartialCount(pool, triangles);
+	std::vector<PartialSums> partials(partialCount);
+	const float* source = vertices.empty() ? NULL : &vertices[0];
+	const float* normalData = normals.empty() ? NULL : &normals[0];
+	ForEachPartial(pool, partialCount, triangles, [&](size_t p, size_t first, size_t last)
+	{
+		PartialSums& sums = partials[p];
+		sums.x.assign(vertexCount * 2, 0.0f);
+		sums.y.assign(vertexCount * 2, 0.0f);
+		sums.z.assign(vertexCount * 2, 0.0f);
+		sums.degenerate = 0;
+
+		for (size_t t = first; t < last; t += 4)
+		{
+			size_t count = last - t < 4 ? last - t : 4;
+			unsigned int corners[3][4];
+			GatherCorners(&indices[0], t, count, corners);
+
+			__m128 px[3], py[3], pz[3], u[3], v[3], nx[3], ny[3], nz[3];
+			for (int c = 0; c < 3; c++)
+			{
+				Gather3(source, floatsPerVertex, corners[c], px[c], py[c], pz[c]);
+				Gather2(source + 3, floatsPerVertex, corners[c], u[c], v[c]);
+				Gather3(normalData, 3, corners[c], nx[c], ny[c], nz[c]);
+			}
+
+			// The triangle's texture space s direction, facing along +s whichever way the mapping winds
+			__m128 d1x = _mm_sub_ps(px[1], px[0]), d1y = _mm_sub_ps(py[1], py[0]), d1z = _mm_sub_ps(pz[1], pz[0]);
+			__m128 d2x = _mm_sub_ps(px[2], px[0]), d2y = _mm_sub_ps(py[2], py[0]), d2z = _mm_sub_ps(pz[2], pz[0]);
+			__m128 t21x = _mm_sub_ps(u[1], u[0]), t21y = _mm_sub_ps(v[1], v[0]);
+			__m128 t31x = _mm_sub_ps(u[2], u[0]), t31y = _mm_sub_ps(v[2], v[0]);
+			__m128 area = _mm_sub_ps(_mm_mul_ps(t21x, t31y), _mm_mul_ps(t21y, t31x));
+			__m128 sign = _mm_or_ps(_mm_and_ps(area, _mm_set1_ps(-0.0f)), _mm_set1_ps(1.0f));
+			__m128 sx = _mm_mul_ps(sign, _mm_sub_ps(_mm_mul_ps(t31y, d1x), _mm_mul_ps(t21y, d2x)));
+			__m128 sy = _mm_mul_ps(sign, _mm_sub_ps(_mm_mul_ps(t31y, d1y), _mm_mul_ps(t21y, d2y)));
+			__m128 sz = _mm_mul_ps(sign, _mm_sub_ps(_mm_mul_ps(t31y, d1z), _mm_mul_ps(t21y, d2z)));
+			Normalize(sx, sy, sz);
+
+			int preserving = _mm_movemask_ps(_mm_cmpgt_ps(area, _mm_setzero_ps()));
+			int degenerate = _mm_movemask_ps(_mm_or_ps(_mm_cmpeq_ps(area, _mm_setzero_ps()), _mm_cmpeq_ps(Dot(sx, sy, sz, sx, sy, sz), _mm_setzero_ps())));
+
+			float weightedX[3][4], weightedY[3][4], weightedZ[3][4];
+			for (int c = 0; c < 3; c++)
+			{
+				int next = (c + 1) % 3;
+				int previous = (c + 2) % 3;
+
+				// Corner angle between the edges flattened onto the normal's plane
+				__m128 ax = _mm_sub_ps(px[next], px[c]), ay = _mm_sub_ps(py[next], py[c]), az = _mm_sub_ps(pz[next], pz[c]);
+				__m128 bx = _mm_sub_ps(px[previous], px[c]), by = _mm_sub_ps(py[previous], py[c]), bz = _mm_sub_ps(pz[previous], pz[c]);
+				__m128 along = Dot(nx[c], ny[c], nz[c], ax, ay, az);
+				ax = _mm_sub_ps(ax, _mm_mul_ps(along, nx[c]));
+				ay = _mm_sub_ps(ay, _mm_mul_ps(along, ny[c]));
+				az = _mm_sub_ps(az, _mm_mul_ps(along, nz[c]));
+				along = Dot(nx[c], ny[c], nz[c], bx, by, bz);
+				bx = _mm_sub_ps(bx, _mm_mul_ps(along, nx[c]));
+				by = _mm_sub_ps(by, _mm_mul_ps(along, ny[c]));
+				bz = _mm_sub_ps(bz, _mm_mul_ps(along, nz[c]));
+				Normalize(ax, ay, az);
+				Normalize(bx, by, bz);
+				__m128 angle = Acos(Dot(ax, ay, az, bx, by, bz));
+
+				// The triangle's direction made perpendicular to this vertex's normal
+				along = Dot(nx[c], ny[c], nz[c], sx, sy, sz);
+				__m128 tx = _mm_sub_ps(sx, _mm_mul_ps(along, nx[c]));
+				__m128 ty = _mm_sub_ps(sy, _mm_mul_ps(along, ny[c]));
+				__m128 tz = _mm_sub_ps(sz, _mm_mul_ps(along, nz[c]));
+				Normalize(tx, ty, tz);
+				_mm_storeu_ps(weightedX[c], _mm_mul_ps(tx, angle));
+				_mm_storeu_ps(weightedY[c], _mm_mul_ps(ty, angle));
+				_mm_storeu_ps(weightedZ[c], _mm_mul_ps(tz, angle));
+			}
+
+			for (size_t lane = 0; lane < count; lane++)
+			{
+				if (degenerate & (1 << lane))
+				{
+					orientation[t + lane] = TRIANGLE_DEGENERATE;
+					sums.degenerate++;
+					continue;
+				}
+
+				uint8_t orient = (preserving & (1 << lane)) ? TRIANGLE_PRESERVING : TRIANGLE_MIRRORED;
+				orientation[t + lane] = orient;
+				for (int c = 0; c < 3; c++)
+				{
+					size_t slot = (size_t)corners[c][lane] * 2 + orient;
+					sums.x[slot] += weightedX[c][lane];
+					sums.y[slot] += weightedY[c][lane];
+					sums.z[slot] += weightedZ[c][lane];
+				}
+			}
+		}
+	});
+
+	ReducePartials(pool, partials, vertexCount * 2);
+
+	// Vertices used both ways get a copy for their mirrored triangles
+	std::vector<uint8_t> used(vertexCount, 0);
+	for (size_t t = 0; t < triangles; t++)
+	{
+		if (orientation[t] != TRIANGLE_DEGENERATE)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				used[indices[t * 3 + c]] |= (uint8_t)(1 << orientation[t]);
+			}
+		}
+	}
+
+	std::vector<unsigned int> mirroredCopy(vertexCount, 0);
+	size_t copies = 0;
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		if (used[v] == 3)
+		{
+			mirroredCopy[v] = (unsigned int)(vertexCount + copies);
+			copies++;
+		}
+	}
+
+	vertices.resize((vertexCount + copies) * floatsPerVertex);
+	normals.resize((vertexCount + copies) * 3);
+	tangents.resize((vertexCount + copies) * 4);
+	const PartialSums& total = partials[0];
+	ForEachRange(pool, vertexCount, tangentReduceGrain, [&](size_t begin, size_t end)
+	{
+		for (size_t v = begin; v < end; v++)
+		{
+			// Unmirrored use wins the original vertex
+			uint8_t orient = (used[v] & (1 << TRIANGLE_PRESERVING)) ? TRIANGLE_PRESERVING : TRIANGLE_MIRRORED;
+			unsigned int targets[2] = { (unsigned int)v, mirroredCopy[v] };
+			uint8_t orients[2] = { orient, TRIANGLE_MIRRORED };
+			for (int k = 0; k < (used[v] == 3 ? 2 : 1); k++)
+			{
+				unsigned int target = targets[k];
+				if (target != v)
+				{
+					memcpy(&vertices[(size_t)target * floatsPerVertex], &vertices[v * floatsPerVertex], sizeof(float) * floatsPerVertex);
+					memcpy(&normals[(size_t)target * 3], &normals[v * 3], sizeof(float) * 3);
+				}
+
+				size_t slot = v * 2 + orients[k];
+				float* tangent = &tangents[(size_t)target * 4];
+				tangent[0] = total.x[slot];
+				tangent[1] = total.y[slot];
+				tangent[2] = total.z[slot];
+				tangent[3] = orients[k] == TRIANGLE_PRESERVING ? 1.0f : -1.0f;
+				if (tangent[0] == 0.0f && tangent[1] == 0.0f && tangent[2] == 0.0f)
+				{
+					Perpendicular(&normals[v * 3], tangent);
+				}
+			}
+		}
+	});
+
+	if (copies > 0)
+	{
+		ForEachRange(pool, triangles, tangentReduceGrain, [&](size_t begin, size_t end)
+		{
+			for (size_t t = begin; t < end; t++)
+			{
+				if (orientation[t] != TRIANGLE_MIRRORED)
+				{
+					continue;
+				}
+				for (int c = 0; c < 3; c++)
+				{
+					unsigned int& index = indices[t * 3 + c];
+					index = used[index] == 3 ? mirroredCopy[index] : index;
+				}
+			}
+		});
+	}
+
+	for (size_t p = 0; p < partialCount; p++)
+	{
+		stats.degenerateTriangles += partials[p].degenerate;
+	}
+	stats.addedVertices = (unsigned int)copies;
+	stats.partials = (unsigned int)partialCount;
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+class ThreadPool;
+
+struct TangentGenerateStats
+{
+	double milliseconds;
+	unsigned int triangles;
+	// Corners unwelded for flat normals, or vertices split where mirrored texture coordinates meet
+	unsigned int addedVertices;
+	// Triangles without area (or without texture coordinate area, for tangents) that contributed nothing
+	unsigned int degenerateTriangles;
+	// Pool jobs the triangles were divided between, each summing into partial arrays of its own
+	unsigned int partials;
+};
+
+// Normals and tangent frames for meshes imported without them. Smooth normals are the area weighted face normals
+// around a position, shared by every vertex there so texture seams stay invisible; flat normals unweld every
+// corner instead. Tangents follow MikkTSpace (Mikkelsen, "Simulation of Wrinkled Surfaces Revisited"): each
+// triangle's texture space direction is projected onto the vertex normal and weighted by the corner angle, and
+// triangles with mirrored texture coordinates are kept apart, splitting the vertices where both kinds meet.
+// Triangles are divided between pool jobs that each accumulate into their own partial sums, reduced per vertex
+// afterwards, so no atomics are needed; cross products and normalization run four triangles at a time with SSE.
+class TangentGenerator
+{
+public:
+	// normals receives x, y, z per vertex. Positions are the first three floats of every vertex. pool may be NULL
+	// to run on the calling thread.
+	static void GenerateSmoothNormals(const float* vertices, size_t vertexCount, unsigned int floatsPerVertex, const unsigned int* indices, size_t indexCount, ThreadPool* pool, std::vector<float>& normals, TangentGenerateStats& stats);
+
+	// Give every corner a vertex of its own carrying the face normal, vertices and indices are rewritten
+	static void GenerateFlatNormals(std::vector<float>& vertices, unsigned int floatsPerVertex, std::vector<unsigned int>& indices, ThreadPool* pool, std::vector<float>& normals, TangentGenerateStats& stats);
+
+	// tangents receives x, y, z and the bitangent sign w per vertex, the bitangent being w * cross(normal, tangent).
+	// The texture coordinate follows the position. Vertices shared by mirrored and unmirrored triangles are
+	// duplicated, appended to vertices and normals with the mirrored triangles' indices pointing at the copies.
+	static void GenerateTangents(std::vector<float>& vertices, unsigned int floatsPerVertex, std::vector<unsigned int>& indices, std::vector<float>& normals, ThreadPool* pool, std::vector<float>& tangents, TangentGenerateStats& stats);
+};
@@ -0,0 +1,640 @@
+#include "Terrain.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <float.h>
+#include <string.h>
+#include <chrono>
+
+#include <glm\gtc\type_ptr.hpp>
+
+#include "ThreadPool.h"
+
+// Quads across the grid every node is drawn with, a leaf node's quads are one heightmap texel each
+static const int terrainGridSize = 32;
+
+// Levels the shader's morph range array holds
+static const unsigned int terrainMaxLods = 16;
+
+// Nodes drawn per frame at most, the instance buffers are sized for it
+static const size_t terrainMaxNodes = 4096;
+
+// The finest level is drawn out to this many leaf node widths from the eye, every coarser level twice as far
+static const float terrainLeafRanges = 4.0f;
+
+// Vertices start morphing this far across their level's band of distances
+static const float terrainMorphStart = 0.7f;
+
+// Mips at most this wide are uploaded at creation, finer ones are streamed
+static const int terrainInitialLevelSize = 256;
+
+// Octaves summed by the generated heightmap
+static const int terrainNoiseOctaves = 9;
+
+Terrain::Terrain()
+{
+	worldSize = 0.0f;
+	heightScale = 0.0f;
+	heights = NULL;
+	heightmapSize = 0;
+	lodCount = 0;
+	leafSize = 0.0f;
+	instanceBuffers[0] = 0;
+	instanceBuffers[1] = 0;
+	heightmapTexture = 0;
+	shader = NULL;
+	uniformEye = -1;
+	uniformTerrainSize = -1;
+	uniformHeightScale = -1;
+	uniformMorphRanges = -1;
+	uniformHeightmap = -1;
+	uniformGridSize = -1;
+	residentLevel = 0;
+	streamRow = 0;
+}
+
+bool Terrain::CreateTerrain(ThreadPool* pool, const char* heightmapLocation, int generatedSize, float newWorldSize, float newHeightScale)
+{
+	ClearTerrain();
+	auto start = std::chrono::steady_clock::now();
+
+	if (heightmapLocation)
+	{
+		if (!LoadHeightmap(heightmapLocation))
+		{
+			return false;
+		}
+	}
+	else
+	{
+		if (generatedSize < terrainGridSize || (generatedSize & (generatedSize - 1)) != 0)
+		{
+			printf("Generated terrain size %d must be a power of two of at least %d\n", generatedSize, terrainGridSize);
+			return false;
+		}
+		GenerateHeightmap(pool, generatedSize);
+	}
+
+	// One level per halving of the node size, the root covering the whole map
+	lodCount = 1;
+	while ((terrainGridSize << lodCount) <= heightmapSize)
+	{
+		lodCount++;
+	}
+	if (lodCount > terrainMaxLods)
+	{
+		printf("Terrain heightmap of %d texels needs more than %u levels\n", heightmapSize, terrainMaxLods);
+		ClearTerrain();
+		return false;
+	}
+
+	worldSize = newWorldSize;
+	heightScale = newHeightScale;
+	leafSize = worldSize * terrainGridSize / heightmapSize;
+
+	// The coarsest level covers everything, so it never morphs
+	lodRanges.resize(lodCount);
+	morphRanges.resize(lodCount * 2);
+	float previous = 0.0f;
+	for (unsigned int lod = 0; lod < lodCount; lod++)
+	{
+		bool coarsest = lod + 1 == lodCount;
+		lodRanges[lod] = coarsest ? FLT_MAX : leafSize * terrainLeafRanges * (float)(1 << lod);
+		morphRanges[lod * 2] = coarsest ? FLT_MAX * 0.5f : previous + (lodRanges[lod] - previous) * terrainMorphStart;
+		morphRanges[lod * 2 + 1] = lodRanges[lod];
+		previous = lodRanges[lod];
+	}
+
+	BuildMips(pool);
+	BuildNodeBounds(pool);
+
+	glGenBuffers(2, instanceBuffers);
+	CreateGrid(grids[0], terrainGridSize, instanceBuffers[0]);
+	CreateGrid(grids[1], terrainGridSize / 2, instanceBuffers[1]);
+	CreateHeightmapTexture();
+
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	printf("Terrain of %dx%d heights ready in %.1f ms: %u levels, %g unit leaf nodes, %dx%d uploaded\n",
+		heightmapSize, heightmapSize, milliseconds, lodCount, leafSize, LevelSize(residentLevel), LevelSize(residentLevel));
+	return true;
+}
+
+bool Terrain::LoadHeightmap(const char* heightmapLocation)
+{
+	if (!heightmapFile.Open(heightmapLocation))
+	{
+		printf("Failed to open heightmap %s\n", heightmapLocation);
+		return false;
+	}
+
+	size_t count = heightmapFile.GetSize() / sizeof(uint16_t);
+	int size = (int)sqrt((double)count);
+	if ((size_t)size * size * sizeof(uint16_t) != heightmapFile.GetSize() || size < terrainGridSize || (size & (size - 1)) != 0)
+	{
+		printf("Heightmap %s is not a square of 16-bit heights with a power of two side of at least %d\n", heightmapLocation, terrainGridSize);
+		heightmapFile.Close();
+		return false;
+	}
+
+	heights = (const uint16_t*)heightmapFile.GetData();
+	heightmapSize = size;
+	return true;
+}
+
+// Lattice value in [0, 1] for a cell corner of one octave
+static float LatticeValue(int x, int y, int octave)
+{
+	uint32_t hash = (uint32_t)x * 0x8da6b343u ^ (uint32_t)y * 0xd8163841u ^ (uint32_t)octave * 0xcb1ab31fu;
+	hash ^= hash >> 13;
+	hash *= 0x5bd1e995u;
+	hash ^= hash >> 15;
+	return (float)(hash & 0xFFFFFF) / 16777215.0f;
+}
+
+static float ValueNoise(float x, float y, int octave)
+{
+	float cellX = floorf(x);
+	float cellY = floorf(y);
+	float fx = x - cellX;
+	float fy = y - cellY;
+	fx = fx * fx * (3.0f - 2.0f * fx);
+	fy = fy * fy * (3.0f - 2.0f * fy);
+
+	int ix = (int)cellX;
+	int iy = (int)cellY;
+	float top = LatticeValue(ix, iy, octave) + (LatticeValue(ix + 1, iy, octave) - LatticeValue(ix, iy, octave)) * fx;
+	float bottom = LatticeValue(ix, iy + 1, octave) + (LatticeValue(ix + 1, iy + 1, octave) - LatticeValue(ix, iy + 1, octave)) * fx;
+	return top + (bottom - top) * fy;
+}
+
+void Terrain::GenerateHeightmap(ThreadPool* pool, int size)
+{
+	generatedHeights.resize((size_t)size * size);
+	uint16_t* output = &generatedHeights[0];
+
+	// Fractal value noise, four cells across the map at the lowest octave
+	auto generateRows = [output, size](size_t begin, size_t end)
+	{
+		for (size_t y = begin; y < end; y++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				float frequency = 4.0f / size;
+				float amplitude = 1.0f;
+				float sum = 0.0f;
+				float total = 0.0f;
+				for (int octave = 0; octave < terrainNoiseOctaves; octave++)
+				{
+					sum += ValueNoise(x * frequency, y * frequency, octave) * amplitude;
+					total += amplitude;
+					frequency *= 2.0f;
+					amplitude *= 0.5f;
+				}
+
+				// Stretch the middle of the range and flatten the lows into valleys
+				float height = (sum / total - 0.2f) / 0.6f;
+				height = height < 0.0f ? 0.0f : (height > 1.0f ? 1.0f : height);
+				output[y * size + x] = (uint16_t)(height * height * 65535.0f + 0.5f);
+			}
+		}
+	};
+
+	if (pool)
+	{
+		pool->ParallelFor(size, 16, generateRows);
+	}
+	else
+	{
+		generateRows(0, size);
+	}
+
+	heights = output;
+	heightmapSize = size;
+}
+
+void Terrain::BuildMips(ThreadPool* pool)
+{
+	mipLevels.clear();
+	for (int level = 1; LevelSize(level - 1) > 1; level++)
+	{
+		int size = LevelSize(level);
+		int sourceSize = size * 2;
+		mipLevels.push_back(std::vector<uint16_t>((size_t)size * size));
+		const uint16_t* source = LevelData(level - 1);
+		uint16_t* output = &mipLevels.back()[0];
+
+		auto averageRows = [source, sourceSize, output, size](size_t begin, size_t end)
+		{
+			for (size_t y = begin; y < end; y++)
+			{
+				const uint16_t* row = source + y * 2 * sourceSize;
+				for (int x = 0; x < size; x++)
+				{
+					uint32_t sum = (uint32_t)row[x * 2] + row[x * 2 + 1] + row[sourceSize + x * 2] + row[sourceSize + x * 2 + 1];
+					output[y * size + x] = (uint16_t)((sum + 2) / 4);
+				}
+			}
+		};
+
+		if (pool && size >= 256)
+		{
+			pool->ParallelFor(size, 32, averageRows);
+		}
+		else
+		{
+			averageRows(0, size);
+		}
+	}
+}
+
+void Terrain::BuildNodeBounds(ThreadPool* pool)
+{
+	minHeights.resize(lodCount);
+	maxHeights.resize(lodCount);
+
+	// Leaves from the texels their bilinear samples can reach, one texel beyond each edge
+	int leaves = heightmapSize / terrainGridSize;
+	minHeights[0].resize((size_t)leaves * leaves);
+	maxHeights[0].resize((size_t)leaves * leaves);
+	uint16_t* leafMin = &minHeights[0][0];
+	uint16_t* leafMax = &maxHeights[0][0];
+	const uint16_t* source = heights;
+	int size = heightmapSize;
+
+	auto boundLeaves = [source, size, leaves, leafMin, leafMax](size_t begin, size_t end)
+	{
+		for (size_t nodeZ = begin; nodeZ < end; nodeZ++)
+		{
+			int firstZ = (int)nodeZ * terrainGridSize - 1;
+			int lastZ = (int)(nodeZ + 1) * terrainGridSize;
+			firstZ = firstZ < 0 ? 0 : firstZ;
+			lastZ = lastZ >= size ? size - 1 : lastZ;
+			for (int nodeX = 0; nodeX < leaves; nodeX++)
+			{
+				int firstX = nodeX * terrainGridSize - 1;
+				int lastX = (nodeX + 1) * terrainGridSize;
+				firstX = firstX < 0 ? 0 : firstX;
+				lastX = lastX >= size ? size - 1 : lastX;
+
+				uint16_t low = 0xFFFF;
+				uint16_t high = 0;
+				for (int z = firstZ; z <= lastZ; z++)
+				{
+					const uint16_t* row = source + (size_t)z * size;
+					for (int x = firstX; x <= lastX; x++)
+					{
+						low = row[x] < low ? row[x] : low;
+						high = row[x] > high ? row[x] : high;
+					}
+				}
+				leafMin[nodeZ * leaves + nodeX] = low;
+				leafMax[nodeZ * leaves + nodeX] = high;
+			}
+		}
+	};
+
+	if (pool)
+	{
+		pool->ParallelFor(leaves, 4, boundLeaves);
+	}
+	else
+	{
+		boundLeaves(0, leaves);
+	}
+
+	// Every coarser node bounds its four children
+	for (unsigned int lod = 1; lod < lodCount; lod++)
+	{
+		int nodes = leaves >> lod;
+		int children = nodes * 2;
+		minHeights[lod].resize((size_t)nodes * nodes);
+		maxHeights[lod].resize((size_t)nodes * nodes);
+		for (int z = 0; z < nodes; z++)
+		{
+			for (int x = 0; x < nodes; x++)
+			{
+				uint16_t low = 0xFFFF;
+				uint16_t high = 0;
+				for (int child = 0; child < 4; child++)
+				{
+					size_t index = (size_t)(z * 2 + child / 2) * children + x * 2 + child % 2;
+					low = minHeights[lod - 1][index] < low ? minHeights[lod - 1][index] : low;
+					high = maxHeights[lod - 1][index] > high ? maxHeights[lod - 1][index] : high;
+				}
+				minHeights[lod][(size_t)z * nodes + x] = low;
+				maxHeights[lod][(size_t)z * nodes + x] = high;
+			}
+		}
+	}
+}
+
+void Terrain::CreateGrid(Mesh& mesh, int quads, GLuint instanceBuffer)
+{
+	// x, 0, z, u, v across the unit square, the shader places and raises it
+	std::vector<GLfloat> vertices;
+	for (int z = 0; z <= quads; z++)
+	{
+		for (int x = 0; x <= quads; x++)
+		{
+			GLfloat u = (GLfloat)x / quads;
+			GLfloat v = (GLfloat)z / quads;
+			GLfloat vertex[] = { u, 0.0f, v, u, v };
+			vertices.insert(vertices.end(), vertex, vertex + 5);
+		}
+	}
+
+	// Counter-clockwise seen from above
+	std::vector<unsigned int> indices;
+	for (int z = 0; z < quads; z++)
+	{
+		for (int x = 0; x < quads; x++)
+		{
+			unsigned int corner = z * (quads + 1) + x;
+			unsigned int quad[] = { corner, corner + quads + 1, corner + 1, corner + 1, corner + quads + 1, corner + quads + 2 };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, terrainMaxNodes * sizeof(TerrainNode), NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	std::vector<MeshAttribute> instanceAttributes;
+	MeshAttribute node = { 2, instanceBuffer, 4, GL_FLOAT, GL_FALSE, sizeof(TerrainNode), 0 };
+	instanceAttributes.push_back(node);
+	mesh.SetInstanceAttributes(instanceAttributes);
+	mesh.CreateMesh(&vertices[0], &indices[0], (unsigned int)vertices.size(), (unsigned int)indices.size());
+}
+
+void Terrain::CreateHeightmapTexture()
+{
+	int levels = (int)mipLevels.size() + 1;
+	int uploaded = 0;
+	while (LevelSize(uploaded) > terrainInitialLevelSize)
+	{
+		uploaded++;
+	}
+
+	glGenTextures(1, &heightmapTexture);
+	glBindTexture(GL_TEXTURE_2D, heightmapTexture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+	for (int level = 0; level < levels; level++)
+	{
+		glTexImage2D(GL_TEXTURE_2D, level, GL_R16, LevelSize(level), LevelSize(level), 0, GL_RED, GL_UNSIGNED_SHORT, level >= uploaded ? LevelData(level) : NULL);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	// Not mipmapped: the vertex shader reads the base level, which moves down as finer mips arrive
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, uploaded);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	residentLevel = uploaded;
+	streamRow = 0;
+}
+
+void Terrain::SelectNodes(const glm::vec3& eye, const glm::mat4& modelViewProjection, std::vector<TerrainNode>& nodes, TerrainStats& stats)
+{
+	auto start = std::chrono::steady_clock::now();
+	stats.nodes = 0;
+	stats.frustumCulled = 0;
+	stats.finestLod = lodCount > 0 ? lodCount - 1 : 0;
+	stats.heightmapSize = heightmapSize;
+	stats.residentLevel = GetResidentLevel();
+	if (lodCount == 0)
+	{
+		stats.milliseconds = 0.0;
+		return;
+	}
+
+	// Terrain space clip planes from the rows of the matrix (Gribb and Hartmann): left, right, bottom, top,
+	// near, far
+	float planes[24];
+	for (int p = 0; p < 6; p++)
+	{
+		int row = p / 2;
+		float sign = p % 2 == 0 ? 1.0f : -1.0f;
+		for (int column = 0; column < 4; column++)
+		{
+			planes[p * 4 + column] = modelViewProjection[column][3] + sign * modelViewProjection[column][row];
+		}
+	}
+
+	SelectNode(lodCount - 1, 0, 0, eye, planes, nodes, stats);
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Whether any point of the box lies within range of the eye
+static bool BoxInRange(const glm::vec3& boxMin, const glm::vec3& boxMax, const glm::vec3& eye, float range)
+{
+	float distance = 0.0f;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float nearest = eye[axis] < boxMin[axis] ? boxMin[axis] : (eye[axis] > boxMax[axis] ? boxMax[axis] : eye[axis]);
+		distance += (eye[axis] - nearest) * (eye[axis] - nearest);
+	}
+	return distance <= range * range;
+}
+
+bool Terrain::SelectNode(unsigned int lod, int nodeX, int nodeZ, const glm::vec3& eye, const float* planes, std::vector<TerrainNode>& nodes, TerrainStats& stats)
+{
+	float size = leafSize * (float)(1 << lod);
+	size_t bounds = (size_t)nodeZ * ((heightmapSize / terrainGridSize) >> lod) + nodeX;
+	glm::vec3 boxMin(nodeX * size, minHeights[lod][bounds] * heightScale / 65535.0f, nodeZ * size);
+	glm::vec3 boxMax(boxMin.x + size, maxHeights[lod][bounds] * heightScale / 65535.0f, boxMin.z + size);
+
+	// Culled nodes count as handled, their parent must not draw them either
+	for (int p = 0; p < 6; p++)
+	{
+		const float* plane = planes + p * 4;
+		float x = plane[0] >= 0.0f ? boxMax.x : boxMin.x;
+		float y = plane[1] >= 0.0f ? boxMax.y : boxMin.y;
+		float z = plane[2] >= 0.0f ? boxMax.z : boxMin.z;
+		if (plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0.0f)
+		{
+			stats.frustumCulled++;
+			return true;
+		}
+	}
+
+	if (!BoxInRange(boxMin, boxMax, eye, lodRanges[lod]))
+	{
+		return false;
+	}
+
+	if (lod == 0 || !BoxInRange(boxMin, boxMax, eye, lodRanges[lod - 1]))
+	{
+		AddNode(boxMin.x, boxMin.z, size, lod, nodes, stats);
+		return true;
+	}
+
+	// Children beyond the finer range are drawn by this node, a quarter at a time
+	for (int child = 0; child < 4; child++)
+	{
+		int childX = nodeX * 2 + child % 2;
+		int childZ = nodeZ * 2 + child / 2;
+		if (!SelectNode(lod - 1, childX, childZ, eye, planes, nodes, stats))
+		{
+			AddNode(childX * size * 0.5f, childZ * size * 0.5f, size * 0.5f, lod, nodes, stats);
+		}
+	}
+	return true;
+}
+
+void Terrain::AddNode(float x, float z, float size, unsigned int lod, std::vector<TerrainNode>& nodes, TerrainStats& stats)
+{
+	if (stats.nodes >= terrainMaxNodes)
+	{
+		return;
+	}
+
+	TerrainNode node = { x, z, size, (float)lod };
+	nodes.push_back(node);
+	stats.nodes++;
+	stats.finestLod = lod < stats.finestLod ? lod : stats.finestLod;
+}
+
+void Terrain::Update(size_t budgetBytes)
+{
+	int level = residentLevel - 1;
+	if (heightmapTexture == 0 || level < 0)
+	{
+		return;
+	}
+
+	// Whole rows of the next finer mip, the base level drops to it once every row is in
+	int size = LevelSize(level);
+	size_t rowBytes = (size_t)size * sizeof(uint16_t);
+	int rows = (int)(budgetBytes / rowBytes);
+	rows = rows < 1 ? 1 : (rows > size - streamRow ? size - streamRow : rows);
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D, heightmapTexture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+	glTexSubImage2D(GL_TEXTURE_2D, level, 0, streamRow, size, rows, GL_RED, GL_UNSIGNED_SHORT, LevelData(level) + (size_t)streamRow * size);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	streamRow += rows;
+	if (streamRow >= size)
+	{
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+		residentLevel = level;
+		streamRow = 0;
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Terrain::SetShader(Shader* terrainShader)
+{
+	shader = terrainShader;
+	uniformEye = shader->GetUniformLocation("eye");
+	uniformTerrainSize = shader->GetUniformLocation("terrainSize");
+	uniformHeightScale = shader->GetUniformLocation("heightScale");
+	uniformMorphRanges = shader->GetUniformLocation("morphRanges");
+	uniformHeightmap = shader->GetUniformLocation("heightmap");
+	uniformGridSize = shader->GetUniformLocation("gridSize");
+}
+
+unsigned int Terrain::RenderTerrain(GLuint heightmapUnit, const std::vector<TerrainNode>& nodes, const glm::mat4& model, const glm::vec3& eye, unsigned int& drawCalls)
+{
+	drawCalls = 0;
+	if (heightmapTexture == 0 || !shader || nodes.empty())
+	{
+		return 0;
+	}
+
+	// Quarters drawn by a coarser node are half the size of that level's nodes
+	gridNodes[0].clear();
+	gridNodes[1].clear();
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		bool quarter = nodes[i].size < leafSize * (float)(1 << (unsigned int)nodes[i].lod) * 0.75f;
+		gridNodes[quarter ? 1 : 0].push_back(nodes[i]);
+	}
+
+	glUniformMatrix4fv(shader->GetModelLocation(), 1, GL_FALSE, glm::value_ptr(model));
+	glUniform3fv(uniformEye, 1, glm::value_ptr(eye));
+	glUniform1f(uniformTerrainSize, worldSize);
+	glUniform1f(uniformHeightScale, heightScale);
+	glUniform2fv(uniformMorphRanges, (GLsizei)lodCount, &morphRanges[0]);
+	glUniform1i(uniformHeightmap, heightmapUnit);
+
+	glActiveTexture(GL_TEXTURE0 + heightmapUnit);
+	glBindTexture(GL_TEXTURE_2D, heightmapTexture);
+	glActiveTexture(GL_TEXTURE0);
+
+	unsigned int triangles = 0;
+	for (int g = 0; g < 2; g++)
+	{
+		if (gridNodes[g].empty())
+		{
+			continue;
+		}
+
+		// Orphan the last frame's instances rather than wait for the GPU to finish with them
+		glBindBuffer(GL_ARRAY_BUFFER, instanceBuffers[g]);
+		glBufferData(GL_ARRAY_BUFFER, terrainMaxNodes * sizeof(TerrainNode), NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, gridNodes[g].size() * sizeof(TerrainNode), &gridNodes[g][0]);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		glUniform1f(uniformGridSize, (GLfloat)(g == 0 ? terrainGridSize : terrainGridSize / 2));
+		triangles += grids[g].RenderMeshInstanced((GLsizei)gridNodes[g].size());
+		drawCalls++;
+	}
+	return triangles;
+}
+
+size_t Terrain::GetMemoryUsage()
+{
+	if (heightmapTexture == 0)
+	{
+		return 0;
+	}
+
+	// Every mip is allocated up front, streamed or not
+	size_t bytes = (size_t)heightmapSize * heightmapSize * sizeof(uint16_t);
+	for (size_t i = 0; i < mipLevels.size(); i++)
+	{
+		bytes += mipLevels[i].size() * sizeof(uint16_t);
+	}
+	return bytes + grids[0].GetMemoryUsage() + grids[1].GetMemoryUsage() + 2 * terrainMaxNodes * sizeof(TerrainNode);
+}
+
+void Terrain::ClearTerrain()
+{
+	grids[0].ClearMesh();
+	grids[1].ClearMesh();
+	if (instanceBuffers[0] != 0)
+	{
+		glDeleteBuffers(2, instanceBuffers);
+		instanceBuffers[0] = 0;
+		instanceBuffers[1] = 0;
+	}
+	if (heightmapTexture != 0)
+	{
+		glDeleteTextures(1, &heightmapTexture);
+		heightmapTexture = 0;
+	}
+
+	heightmapFile.Close();
+	generatedHeights.clear();
+	heights = NULL;
+	heightmapSize = 0;
+	mipLevels.clear();
+	lodCount = 0;
+	minHeights.clear();
+	maxHeights.clear();
+	lodRanges.clear();
+	morphRanges.clear();
+	residentLevel = 0;
+	streamRow = 0;
+}
+
+Terrain::~Terrain()
+{
+	ClearTerrain();
+}
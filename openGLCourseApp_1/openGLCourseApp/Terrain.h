@@ -0,0 +1,119 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+#include <GL\glew.h>
+
+#include <glm\glm.hpp>
+
+#include "FramePacket.h"
+#include "MappedFile.h"
+#include "Mesh.h"
+#include "Shader.h"
+
+class ThreadPool;
+
+struct TerrainStats
+{
+	double milliseconds;
+	// Selected nodes, each drawn as one instance of the grid
+	unsigned int nodes;
+	unsigned int frustumCulled;
+	// Deepest quadtree level reached, 0 being the finest
+	unsigned int finestLod;
+	unsigned int heightmapSize;
+	// Finest heightmap mip uploaded so far, 0 once streaming is done
+	unsigned int residentLevel;
+};
+
+// Heightmap terrain drawn with continuous distance-dependent level of detail (Strugar, "Continuous
+// Distance-Dependent Level of Detail for Rendering Heightmaps"). A quadtree of nodes is selected on the CPU
+// every frame by distance from the eye, each node drawn as an instance of one shared grid mesh whose heights
+// are read from the heightmap texture in the vertex shader. Vertices morph into the next coarser grid as they
+// approach the end of their level's range, so levels meet without cracks or popping. The cost follows the
+// screen rather than the map: every level adds a ring of about the same node count whatever the map size.
+// The heightmap's coarse mips are uploaded at creation, finer ones are streamed in afterwards a band of rows
+// at a time.
+class Terrain
+{
+public:
+	Terrain();
+
+	// Context thread. heightmapLocation is a square raw file of 16-bit heights with a power of two side, NULL
+	// generates generatedSize squared heights instead. The map spans worldSize units on x and z, heights run
+	// from 0 to heightScale.
+	bool CreateTerrain(ThreadPool* pool, const char* heightmapLocation, int generatedSize, float worldSize, float heightScale);
+
+	// Main thread: append the nodes to draw for an eye in terrain space (the heightmap's corner at the origin)
+	// and a matrix taking terrain space to clip space. Nodes past a few thousand are dropped.
+	void SelectNodes(const glm::vec3& eye, const glm::mat4& modelViewProjection, std::vector<TerrainNode>& nodes, TerrainStats& stats);
+
+	// Render thread, at the start of a frame: upload up to budgetBytes of the next finer heightmap mip
+	void Update(size_t budgetBytes);
+
+	// Context thread: the shader RenderTerrain draws with, its uniform locations are looked up here once
+	void SetShader(Shader* shader);
+
+	// Render thread: draw the nodes with the shader (in use), the heightmap bound to heightmapUnit. Returns the
+	// triangles drawn, drawCalls receives the instanced draws made.
+	unsigned int RenderTerrain(GLuint heightmapUnit, const std::vector<TerrainNode>& nodes, const glm::mat4& model, const glm::vec3& eye, unsigned int& drawCalls);
+
+	float GetWorldSize() { return worldSize; }
+	float GetHeightScale() { return heightScale; }
+	unsigned int GetResidentLevel() { return (unsigned int)residentLevel.load(); }
+	// Heightmap texture, grid and instance buffer bytes
+	size_t GetMemoryUsage();
+
+	void ClearTerrain();
+
+	~Terrain();
+
+private:
+	float worldSize, heightScale;
+
+	// The heightmap, mapped from its file or generated, then its mips down to 1x1 (level 0 is heights)
+	MappedFile heightmapFile;
+	std::vector<uint16_t> generatedHeights;
+	const uint16_t* heights;
+	int heightmapSize;
+	std::vector<std::vector<uint16_t>> mipLevels;
+
+	// Quadtree levels, 0 holding the smallest nodes, and the node bounds per level in row-major order
+	unsigned int lodCount;
+	float leafSize;
+	std::vector<std::vector<uint16_t>> minHeights, maxHeights;
+	// Distance each level's nodes are drawn to, and where its vertices start and finish morphing
+	std::vector<float> lodRanges;
+	std::vector<float> morphRanges;
+
+	// The full grid for nodes drawn at their own level, a half resolution one for the quarters of a node drawn
+	// in place of children beyond their range. Each has its own instance buffer.
+	Mesh grids[2];
+	GLuint instanceBuffers[2];
+	std::vector<TerrainNode> gridNodes[2];
+	GLuint heightmapTexture;
+
+	Shader* shader;
+	GLint uniformEye, uniformTerrainSize, uniformHeightScale, uniformMorphRanges, uniformHeightmap, uniformGridSize;
+
+	// Render thread, apart from reads of residentLevel for statistics
+	std::atomic<int> residentLevel;
+	int streamRow;
+
+	int LevelSize(int level) { return heightmapSize >> level; }
+	const uint16_t* LevelData(int level) { return level == 0 ? heights : &mipLevels[level - 1][0]; }
+
+	bool LoadHeightmap(const char* heightmapLocation);
+	void GenerateHeightmap(ThreadPool* pool, int size);
+	void BuildMips(ThreadPool* pool);
+	void BuildNodeBounds(ThreadPool* pool);
+	void CreateGrid(Mesh& mesh, int quads, GLuint instanceBuffer);
+	void CreateHeightmapTexture();
+
+	// Returns false when the node is beyond its level's range and its parent has to cover it
+	bool SelectNode(unsigned int lod, int nodeX, int nodeZ, const glm::vec3& eye, const float* planes, std::vector<TerrainNode>& nodes, TerrainStats& stats);
+	void AddNode(float x, float z, float size, unsigned int lod, std::vector<TerrainNode>& nodes, TerrainStats& stats);
+};
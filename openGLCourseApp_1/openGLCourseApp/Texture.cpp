@@ -0,0 +1,487 @@
+#include "Texture.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "CookedTextureFormat.h"
+
+Texture::Texture()
+{
+	textureID = 0;
+	width = 0;
+	height = 0;
+	channels = 0;
+	levels = 0;
+	internalFormat = 0;
+	immutable = false;
+	fileLocation = "";
+}
+
+Texture::Texture(const char* fileLoc)
+{
+	textureID = 0;
+	width = 0;
+	height = 0;
+	channels = 0;
+	levels = 0;
+	internalFormat = 0;
+	immutable = false;
+	fileLocation = fileLoc;
+}
+
+bool Texture::LoadTexture(bool srgb)
+{
+	int newWidth, newHeight, newChannels;
+
+	// GL expects the first row at the bottom
+	stbi_set_flip_vertically_on_load(1);
+	unsigned char* texData = stbi_load(fileLocation, &newWidth, &newHeight, &newChannels, 0);
+	if (!texData)
+	{
+		printf("Failed to find: %s (%s)\n", fileLocation, stbi_failure_reason());
+		return false;
+	}
+
+	bool result = Upload(texData, newWidth, newHeight, newChannels, srgb, true);
+
+	stbi_image_free(texData);
+	return result;
+}
+
+bool Texture::LoadCookedTexture(const char* cookedFileLoc)
+{
+	int newWidth, newHeight, newChannels;
+	GLsizei newLevels;
+	GLenum newInternalFormat;
+	bool newImmutable;
+
+	GLuint newTextureID = CreateCookedStorage(cookedFileLoc, 0, newWidth, newHeight, newChannels, newLevels, newInternalFormat, newImmutable);
+	if (newTextureID == 0)
+	{
+		return false;
+	}
+
+	AdoptStorage(newTextureID, newWidth, newHeight, newChannels, newLevels, newInternalFormat, newImmutable);
+	return true;
+}
+
+GLuint Texture::CreateCookedStorage(const char* cookedFileLoc, GLsizei skipLevels, int& width, int& height, int& channels, GLsizei& levels, GLenum& internalFormat, bool& immutable)
+{
+	FILE* file = fopen(cookedFileLoc, "rb");
+	if (!file)
+	{
+		return 0;
+	}
+
+	fseek(file, 0, SEEK_END);
+	long fileSize = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	std::vector<unsigned char> data(fileSize > 0 ? fileSize : 0);
+	size_t bytesRead = data.empty() ? 0 : fread(&data[0], 1, data.size(), file);
+	fclose(file);
+
+	CookedTextureHeader header;
+	if (bytesRead < sizeof(header))
+	{
+		printf("Cooked texture %s is truncated\n", cookedFileLoc);
+		return 0;
+	}
+
+	memcpy(&header, &data[0], sizeof(header));
+	if (memcmp(header.identifier, cookedTextureIdentifier, sizeof(header.identifier)) != 0 || header.version != cookedTextureVersion || header.levelCount == 0)
+	{
+		printf("%s is not a cooked texture this build can read\n", cookedFileLoc);
+		return 0;
+	}
+
+	size_t levelTableEnd = sizeof(header) + sizeof(CookedTextureLevel) * header.levelCount;
+	if (bytesRead < levelTableEnd)
+	{
+		printf("Cooked texture %s is truncated\n", cookedFileLoc);
+		return 0;
+	}
+
+	std::vector<CookedTextureLevel> levelTable(header.levelCount);
+	memcpy(&levelTable[0], &data[sizeof(header)], sizeof(CookedTextureLevel) * header.levelCount);
+	for (size_t i = 0; i < levelTable.size(); i++)
+	{
+		if (levelTable[i].byteOffset + levelTable[i].byteLength > bytesRead)
+		{
+			printf("Cooked texture %s is truncated\n", cookedFileLoc);
+			return 0;
+		}
+	}
+
+	GLenum compressedFormat = ChooseCompressedFormat(header.encoding, (header.flags & COOKED_FLAG_SRGB) != 0);
+	if (compressedFormat == 0)
+	{
+		printf("Cooked texture %s uses an encoding this GPU cannot sample\n", cookedFileLoc);
+		return 0;
+	}
+
+	// The smallest level is always kept
+	GLsizei firstLevel = skipLevels < (GLsizei)header.levelCount ? skipLevels : (GLsizei)header.levelCount - 1;
+
+	GLuint newTextureID = 0;
+	glGenTextures(1, &newTextureID);
+	glBindTexture(GL_TEXTURE_2D, newTextureID);
+
+	width = levelTable[firstLevel].width;
+	height = levelTable[firstLevel].height;
+	channels = header.encoding == COOKED_BC5 ? 2 : (header.encoding == COOKED_ETC2_RGB ? 3 : 4);
+	levels = header.levelCount - firstLevel;
+	internalFormat = compressedFormat;
+
+	// Compressed levels are uploaded as is, no decode and no glGenerateMipmap
+	if (GLEW_VERSION_4_2 || GLEW_ARB_texture_storage)
+	{
+		glTexStorage2D(GL_TEXTURE_2D, levels, internalFormat, width, height);
+		for (GLint i = 0; i < levels; i++)
+		{
+			const CookedTextureLevel& level = levelTable[firstLevel + i];
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, level.width, level.height, internalFormat, (GLsizei)level.byteLength, &data[(size_t)level.byteOffset]);
+		}
+		immutable = true;
+	}
+	else
+	{
+		for (GLint i = 0; i < levels; i++)
+		{
+			const CookedTextureLevel& level = levelTable[firstLevel + i];
+			glCompressedTexImage2D(GL_TEXTURE_2D, i, internalFormat, level.width, level.height, 0, (GLsizei)level.byteLength, &data[(size_t)level.byteOffset]);
+		}
+		immutable = false;
+	}
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return newTextureID;
+}
+
+bool Texture::Upload(const unsigned char* pixels, int newWidth, int newHeight, int newChannels, bool srgb, bool generateMips)
+{
+	if (newChannels < 1 || newChannels > 4)
+	{
+		printf("Unsupported texture channel count %d in %s\n", newChannels, fileLocation);
+		return false;
+	}
+
+	GLenum newInternalFormat = ChooseInternalFormat(newChannels, srgb);
+	GLsizei newLevels = generateMips ? CalculateMipLevels(newWidth, newHeight) : 1;
+
+	if (textureID == 0)
+	{
+		glGenTextures(1, &textureID);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, textureID);
+
+	channels = newChannels;
+
+	// Matching storage is refilled in place, anything else needs a new allocation
+	if (newWidth != width || newHeight != height || newInternalFormat != internalFormat || newLevels != levels)
+	{
+		AllocateStorage(newWidth, newHeight, newLevels, newInternalFormat);
+	}
+
+	// Rows of 1 and 3 channel images are not 4 byte aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, ChoosePixelFormat(channels), GL_UNSIGNED_BYTE, pixels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	if (levels > 1)
+	{
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return true;
+}
+
+bool Texture::UploadMipChain(const unsigned char* chain, const std::vector<size_t>& levelOffsets, int newWidth, int newHeight, bool srgb)
+{
+	GLenum newInternalFormat = ChooseInternalFormat(4, srgb);
+	GLsizei newLevels = (GLsizei)levelOffsets.size() - 1;
+
+	if (textureID == 0)
+	{
+		glGenTextures(1, &textureID);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, textureID);
+
+	channels = 4;
+
+	if (newWidth != width || newHeight != height || newInternalFormat != internalFormat || newLevels != levels)
+	{
+		AllocateStorage(newWidth, newHeight, newLevels, newInternalFormat);
+	}
+
+	for (GLint level = 0; level < levels; level++)
+	{
+		int levelWidth = width >> level > 0 ? width >> level : 1;
+		int levelHeight = height >> level > 0 ? height >> level : 1;
+		glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, levelWidth, levelHeight, GL_RGBA, GL_UNSIGNED_BYTE, chain + levelOffsets[level]);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return true;
+}
+
+void Texture::AllocateStorage(int newWidth, int newHeight, GLsizei newLevels, GLenum newInternalFormat)
+{
+	// Immutable storage cannot be resized, it needs a fresh name
+	if (immutable)
+	{
+		glDeleteTextures(1, &textureID);
+		glGenTextures(1, &textureID);
+		glBindTexture(GL_TEXTURE_2D, textureID);
+	}
+
+	width = newWidth;
+	height = newHeight;
+	levels = newLevels;
+	internalFormat = newInternalFormat;
+
+	immutable = AllocateBoundStorage(width, height, levels, internalFormat, channels);
+}
+
+bool Texture::AllocateBoundStorage(int width, int height, GLsizei levels, GLenum internalFormat, int channels)
+{
+	bool immutable;
+	if (GLEW_VERSION_4_2 || GLEW_ARB_texture_storage)
+	{
+		glTexStorage2D(GL_TEXTURE_2D, levels, internalFormat, width, height);
+		immutable = true;
+	}
+	else
+	{
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, ChoosePixelFormat(channels), GL_UNSIGNED_BYTE, NULL);
+		immutable = false;
+	}
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	return immutable;
+}
+
+GLuint Texture::CreateStorage(int width, int height, GLsizei levels, GLenum internalFormat, int channels, bool& immutable)
+{
+	GLuint newTextureID = 0;
+	glGenTextures(1, &newTextureID);
+	glBindTexture(GL_TEXTURE_2D, newTextureID);
+	immutable = AllocateBoundStorage(width, height, levels, internalFormat, channels);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return newTextureID;
+}
+
+void Texture::AdoptStorage(GLuint newTextureID, int newWidth, int newHeight, int newChannels, GLsizei newLevels, GLenum newInternalFormat, bool newImmutable)
+{
+	if (textureID != 0 && textureID != newTextureID)
+	{
+		glDeleteTextures(1, &textureID);
+	}
+
+	textureID = newTextureID;
+	width = newWidth;
+	height = newHeight;
+	channels = newChannels;
+	levels = newLevels;
+	internalFormat = newInternalFormat;
+	immutable = newImmutable;
+}
+
+bool Texture::DropTopLevels(GLsizei count)
+{
+	if (textureID == 0 || !immutable || count <= 0 || count >= levels || !(GLEW_VERSION_4_3 || GLEW_ARB_copy_image))
+	{
+		return false;
+	}
+
+	int newWidth = width >> count > 0 ? width >> count : 1;
+	int newHeight = height >> count > 0 ? height >> count : 1;
+	GLsizei newLevels = levels - count;
+
+	// The smaller mips move down into a new texture entirely on the GPU, compressed formats included
+	bool newImmutable;
+	GLuint newTextureID = CreateStorage(newWidth, newHeight, newLevels, internalFormat, channels, newImmutable);
+	for (GLint level = 0; level < newLevels; level++)
+	{
+		int levelWidth = newWidth >> level > 0 ? newWidth >> level : 1;
+		int levelHeight = newHeight >> level > 0 ? newHeight >> level : 1;
+		glCopyImageSubData(textureID, GL_TEXTURE_2D, level + count, 0, 0, 0, newTextureID, GL_TEXTURE_2D, level, 0, 0, 0, levelWidth, levelHeight, 1);
+	}
+
+	AdoptStorage(newTextureID, newWidth, newHeight, channels, newLevels, internalFormat, newImmutable);
+	return true;
+}
+
+size_t Texture::GetMemoryUsage()
+{
+	if (textureID == 0)
+	{
+		return 0;
+	}
+
+	// Block compressed formats store 4x4 texel blocks, RGB8 is padded to 4 bytes by most drivers
+	size_t blockBytes = 0;
+	switch (internalFormat)
+	{
+	case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_RGB8_ETC2:
+	case GL_COMPRESSED_SRGB8_ETC2:
+		blockBytes = 8;
+		break;
+	case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+	case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+	case GL_COMPRESSED_RG_RGTC2:
+	case GL_COMPRESSED_RGBA_BPTC_UNORM:
+	case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+		blockBytes = 16;
+		break;
+	}
+
+	size_t texelBytes = channels == 3 ? 4 : channels;
+	size_t total = 0;
+	for (GLint level = 0; level < levels; level++)
+	{
+		size_t levelWidth = width >> level > 0 ? width >> level : 1;
+		size_t levelHeight = height >> level > 0 ? height >> level : 1;
+		if (blockBytes)
+		{
+			total += ((levelWidth + 3) / 4) * ((levelHeight + 3) / 4) * blockBytes;
+		}
+		else
+		{
+			total += levelWidth * levelHeight * texelBytes;
+		}
+	}
+	return total;
+}
+
+void Texture::LoadFallback()
+{
+	const unsigned char checker[] = {
+		255, 0, 255, 255,	0, 0, 0, 255,
+		0, 0, 0, 255,		255, 0, 255, 255
+	};
+
+	Upload(checker, 2, 2, 4, false, false);
+}
+
+void Texture::UseTexture(GLuint unit)
+{
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+}
+
+void Texture::ClearTexture()
+{
+	if (textureID != 0)
+	{
+		glDeleteTextures(1, &textureID);
+		textureID = 0;
+	}
+
+	width = 0;
+	height = 0;
+	channels = 0;
+	levels = 0;
+	internalFormat = 0;
+	immutable = false;
+}
+
+void Texture::ReserveHandles(std::vector<Texture*>& textures)
+{
+	std::vector<GLuint> handles;
+	for (size_t i = 0; i < textures.size(); i++)
+	{
+		if (textures[i]->textureID == 0)
+		{
+			handles.push_back(0);
+		}
+	}
+
+	if (handles.empty())
+	{
+		return;
+	}
+
+	glGenTextures((GLsizei)handles.size(), &handles[0]);
+
+	size_t next = 0;
+	for (size_t i = 0; i < textures.size(); i++)
+	{
+		if (textures[i]->textureID == 0)
+		{
+			textures[i]->textureID = handles[next++];
+		}
+	}
+}
+
+GLsizei Texture::CalculateMipLevels(int width, int height)
+{
+	GLsizei count = 1;
+	int size = width > height ? width : height;
+	while (size > 1)
+	{
+		size >>= 1;
+		count++;
+	}
+	return count;
+}
+
+GLenum Texture::ChooseInternalFormat(int channels, bool srgb)
+{
+	switch (channels)
+	{
+	case 1: return GL_R8;
+	case 2: return GL_RG8;
+	case 3: return srgb ? GL_SRGB8 : GL_RGB8;
+	default: return srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+	}
+}
+
+GLenum Texture::ChoosePixelFormat(int channels)
+{
+	switch (channels)
+	{
+	case 1: return GL_RED;
+	case 2: return GL_RG;
+	case 3: return GL_RGB;
+	default: return GL_RGBA;
+	}
+}
+
+GLenum Texture::ChooseCompressedFormat(uint32_t encoding, bool srgb)
+{
+	switch (encoding)
+	{
+	case COOKED_BC1:
+		if (!GLEW_EXT_texture_compression_s3tc) return 0;
+		return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+	case COOKED_BC3:
+		if (!GLEW_EXT_texture_compression_s3tc) return 0;
+		return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case COOKED_BC5:
+		// RGTC is core since GL 3.0
+		return GL_COMPRESSED_RG_RGTC2;
+	case COOKED_BC7:
+		if (!GLEW_VERSION_4_2 && !GLEW_ARB_texture_compression_bptc) return 0;
+		return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+	case COOKED_ETC2_RGB:
+		if (!GLEW_VERSION_4_3 && !GLEW_ARB_ES3_compatibility) return 0;
+		return srgb ? GL_COMPRESSED_SRGB8_ETC2 : GL_COMPRESSED_RGB8_ETC2;
+	default:
+		return 0;
+	}
+}
+
+Texture::~Texture()
+{
+	ClearTexture();
+}
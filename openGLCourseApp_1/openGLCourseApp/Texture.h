@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include <GL\glew.h>
+
+class Texture
+{
+public:
+	Texture();
+	Texture(const char* fileLoc);
+
+	// Decode the file with stb_image and upload it, sRGB should be set for colour data
+	bool LoadTexture(bool srgb);
+
+	// Load a .ctex produced by the TextureCooker, every mip level goes straight to the GPU still block-compressed.
+	// Fails without touching the current texture when the file or its encoding is not supported.
+	bool LoadCookedTexture(const char* cookedFileLoc);
+
+	// Upload already decoded pixels. Reuses the existing GL storage with glTexSubImage2D when the
+	// size and format match, so the same handle can be refilled without reallocating.
+	bool Upload(const unsigned char* pixels, int width, int height, int channels, bool srgb, bool generateMips);
+
+	// Upload an RGBA8 chain built by MipGenerator, one glTexSubImage2D per level and no glGenerateMipmap
+	bool UploadMipChain(const unsigned char* chain, const std::vector<size_t>& levelOffsets, int width, int height, bool srgb);
+
+	// Take ownership of a texture filled elsewhere (e.g. by the UploadQueue), releasing the current one
+	void AdoptStorage(GLuint newTextureID, int newWidth, int newHeight, int newChannels, GLsizei newLevels, GLenum newInternalFormat, bool newImmutable);
+
+	// Release the largest count mips by copying the rest into a smaller texture (needs GL 4.3 or ARB_copy_image)
+	bool DropTopLevels(GLsizei count);
+
+	// Magenta/black checkerboard used when a texture fails to load
+	void LoadFallback();
+
+	void UseTexture(GLuint unit);
+	void ClearTexture();
+
+	GLuint GetTextureID() { return textureID; }
+	int GetWidth() { return width; }
+	int GetHeight() { return height; }
+	GLsizei GetLevels() { return levels; }
+	GLenum GetInternalFormat() { return internalFormat; }
+	const char* GetFileLocation() { return fileLocation; }
+
+	// Estimated GPU memory of every level
+	size_t GetMemoryUsage();
+
+	// Create the GL names for many textures with a single glGenTextures call ahead of a batch of uploads
+	static void ReserveHandles(std::vector<Texture*>& textures);
+
+	// Generate a texture name with uninitialised storage, immutable reports whether glTexStorage2D was used
+	static GLuint CreateStorage(int width, int height, GLsizei levels, GLenum internalFormat, int channels, bool& immutable);
+
+	static GLsizei CalculateMipLevels(int width, int height);
+	static GLenum ChooseInternalFormat(int channels, bool srgb);
+	static GLenum ChoosePixelFormat(int channels);
+	static GLenum ChooseCompressedFormat(uint32_t encoding, bool srgb);
+
+	// Create a texture from a .ctex file without its first skipLevels mips, returns 0 on failure
+	static GLuint CreateCookedStorage(const char* cookedFileLoc, GLsizei skipLevels, int& width, int& height, int& channels, GLsizei& levels, GLenum& internalFormat, bool& immutable);
+
+	~Texture();
+
+private:
+	GLuint textureID;
+	int width, height, channels;
+	GLsizei levels;
+	GLenum internalFormat;
+	bool immutable;
+
+	const char* fileLocation;
+
+	void AllocateStorage(int newWidth, int newHeight, GLsizei newLevels, GLenum newInternalFormat);
+	static bool AllocateBoundStorage(int width, int height, GLsizei levels, GLenum internalFormat, int channels);
+};
@@ -0,0 +1,302 @@
+#include "TextureAtlas.h"
+
+#include <stdio.h>
+#include <limits.h>
+
+#include "stb_image.h"
+
+#include "MipGenerator.h"
+#include "Texture.h"
+
+TextureAtlas::TextureAtlas()
+{
+	textureID = 0;
+	pageSize = 0;
+	maxLayers = 0;
+	levels = 0;
+	padding = 0;
+	srgb = false;
+	entryCount = 0;
+	imageTexels = 0;
+	paddedTexels = 0;
+}
+
+bool TextureAtlas::CreateAtlas(GLsizei newPageSize, GLsizei newMaxLayers, GLsizei newLevels, bool newSrgb)
+{
+	ClearAtlas();
+
+	pageSize = newPageSize;
+	maxLayers = newMaxLayers;
+	levels = newLevels > 0 ? newLevels : 1;
+	padding = 1 << (levels - 1);
+	srgb = newSrgb;
+
+	GLenum internalFormat = Texture::ChooseInternalFormat(4, srgb);
+
+	// Layers cannot be added to immutable storage later, so every layer is allocated up front
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+	if (GLEW_VERSION_4_2 || GLEW_ARB_texture_storage)
+	{
+		glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, internalFormat, pageSize, pageSize, maxLayers);
+	}
+	else
+	{
+		for (GLint level = 0; level < levels; level++)
+		{
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, level, internalFormat, pageSize >> level, pageSize >> level, maxLayers, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		}
+	}
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	return true;
+}
+
+bool TextureAtlas::AddImage(const unsigned char* rgba, int width, int height, AtlasRegion& region)
+{
+	if (textureID == 0)
+	{
+		printf("Atlas has not been created!\n");
+		return false;
+	}
+
+	// Padded sizes and positions are multiples of the gutter so every mip level lands on whole texels
+	int paddedWidth = (width + padding * 2 + padding - 1) / padding * padding;
+	int paddedHeight = (height + padding * 2 + padding - 1) / padding * padding;
+
+	int x = 0, y = 0;
+	size_t node = 0;
+	GLint layerIndex = -1;
+	for (size_t i = 0; i < layers.size(); i++)
+	{
+		if (FindPosition(layers[i], paddedWidth, paddedHeight, x, y, node))
+		{
+			layerIndex = (GLint)i;
+			break;
+		}
+	}
+
+	if (layerIndex < 0)
+	{
+		Layer layer;
+		SkylineNode root = { 0, 0, pageSize };
+		layer.skyline.push_back(root);
+
+		if ((GLsizei)layers.size() >= maxLayers || !FindPosition(layer, paddedWidth, paddedHeight, x, y, node))
+		{
+			return false;
+		}
+
+		layers.push_back(layer);
+		layerIndex = (GLint)layers.size() - 1;
+	}
+
+	AddSkylineLevel(layers[layerIndex], node, x, y, paddedWidth, paddedHeight);
+
+	// Extend the edges into the gutter, the padding on the right and top also absorbs the rounding
+	std::vector<unsigned char> padded((size_t)paddedWidth * paddedHeight * 4);
+	for (int py = 0; py < paddedHeight; py++)
+	{
+		int sy = py - padding;
+		sy = sy < 0 ? 0 : (sy >= height ? height - 1 : sy);
+		for (int px = 0; px < paddedWidth; px++)
+		{
+			int sx = px - padding;
+			sx = sx < 0 ? 0 : (sx >= width ? width - 1 : sx);
+			const unsigned char* source = rgba + ((size_t)sy * width + sx) * 4;
+			unsigned char* destination = &padded[((size_t)py * paddedWidth + px) * 4];
+			destination[0] = source[0];
+			destination[1] = source[1];
+			destination[2] = source[2];
+			destination[3] = source[3];
+		}
+	}
+
+	std::vector<unsigned char> chain;
+	std::vector<size_t> levelOffsets;
+	MipGenerator::GenerateMipChain(&padded[0], paddedWidth, paddedHeight, srgb, 0.0f, chain, levelOffsets);
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+	for (GLint level = 0; level < levels && level + 1 < (GLint)levelOffsets.size(); level++)
+	{
+		int levelWidth = paddedWidth >> level > 0 ? paddedWidth >> level : 1;
+		int levelHeight = paddedHeight >> level > 0 ? paddedHeight >> level : 1;
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, x >> level, y >> level, layerIndex, levelWidth, levelHeight, 1,
+			GL_RGBA, GL_UNSIGNED_BYTE, &chain[levelOffsets[level]]);
+	}
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	region.layer = layerIndex;
+	region.width = width;
+	region.height = height;
+	region.uvTransform = glm::vec4((float)width / pageSize, (float)height / pageSize,
+		(float)(x + padding) / pageSize, (float)(y + padding) / pageSize);
+
+	entryCount++;
+	imageTexels += (size_t)width * height;
+	paddedTexels += (size_t)paddedWidth * paddedHeight;
+	return true;
+}
+
+bool TextureAtlas::AddFile(const char* fileLocation, AtlasRegion& region)
+{
+	int width, height, channels;
+	stbi_set_flip_vertically_on_load(1);
+	unsigned char* pixels = stbi_load(fileLocation, &width, &height, &channels, 4);
+	if (!pixels)
+	{
+		printf("Failed to find: %s (%s)\n", fileLocation, stbi_failure_reason());
+		return false;
+	}
+
+	bool result = AddImage(pixels, width, height, region);
+	stbi_image_free(pixels);
+	return result;
+}
+
+bool TextureAtlas::FindPosition(const Layer& layer, int width, int height, int& x, int& y, size_t& node)
+{
+	// Bottom-left: the lowest resting place, ties broken by the narrowest top edge left behind
+	int bestTop = INT_MAX;
+	int bestWaste = INT_MAX;
+	bool found = false;
+
+	for (size_t i = 0; i < layer.skyline.size(); i++)
+	{
+		int left = layer.skyline[i].x;
+		if (left + width > pageSize)
+		{
+			break;
+		}
+
+		int top = 0;
+		int waste = 0;
+		int covered = 0;
+		for (size_t j = i; covered < width; j++)
+		{
+			top = layer.skyline[j].y > top ? layer.skyline[j].y : top;
+			covered += layer.skyline[j].width;
+		}
+
+		if (top + height > pageSize)
+		{
+			continue;
+		}
+
+		covered = 0;
+		for (size_t j = i; covered < width; j++)
+		{
+			int span = layer.skyline[j].width < width - covered ? layer.skyline[j].width : width - covered;
+			waste += (top - layer.skyline[j].y) * span;
+			covered += layer.skyline[j].width;
+		}
+
+		if (top + height < bestTop || (top + height == bestTop && waste < bestWaste))
+		{
+			bestTop = top + height;
+			bestWaste = waste;
+			x = left;
+			y = top;
+			node = i;
+			found = true;
+		}
+	}
+
+	return found;
+}
+
+void TextureAtlas::AddSkylineLevel(Layer& layer, size_t node, int x, int y, int width, int height)
+{
+	SkylineNode level = { x, y + height, width };
+	layer.skyline.insert(layer.skyline.begin() + node, level);
+
+	// Trim or remove the nodes now hidden under the new one
+	for (size_t i = node + 1; i < layer.skyline.size();)
+	{
+		SkylineNode& previous = layer.skyline[i - 1];
+		SkylineNode& current = layer.skyline[i];
+		int overlap = previous.x + previous.width - current.x;
+		if (overlap <= 0)
+		{
+			break;
+		}
+
+		if (current.width <= overlap)
+		{
+			layer.skyline.erase(layer.skyline.begin() + i);
+			continue;
+		}
+
+		current.x += overlap;
+		current.width -= overlap;
+		break;
+	}
+
+	for (size_t i = 0; i + 1 < layer.skyline.size();)
+	{
+		if (layer.skyline[i].y == layer.skyline[i + 1].y)
+		{
+			layer.skyline[i].width += layer.skyline[i + 1].width;
+			layer.skyline.erase(layer.skyline.begin() + i + 1);
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+void TextureAtlas::UseAtlas(GLuint unit)
+{
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+}
+
+AtlasStats TextureAtlas::GetStats()
+{
+	AtlasStats stats;
+	stats.entryCount = entryCount;
+	stats.layerCount = (unsigned int)layers.size();
+	stats.imageTexels = imageTexels;
+	stats.paddedTexels = paddedTexels;
+	stats.layerTexels = (size_t)pageSize * pageSize * layers.size();
+	stats.occupancy = stats.layerTexels ? (float)paddedTexels / stats.layerTexels : 0.0f;
+	stats.efficiency = stats.layerTexels ? (float)imageTexels / stats.layerTexels : 0.0f;
+	return stats;
+}
+
+size_t TextureAtlas::GetMemoryUsage()
+{
+	if (textureID == 0)
+	{
+		return 0;
+	}
+
+	size_t total = 0;
+	for (GLint level = 0; level < levels; level++)
+	{
+		size_t levelSize = pageSize >> level > 0 ? pageSize >> level : 1;
+		total += levelSize * levelSize * 4 * maxLayers;
+	}
+	return total;
+}
+
+void TextureAtlas::ClearAtlas()
+{
+	if (textureID != 0)
+	{
+		glDeleteTextures(1, &textureID);
+		textureID = 0;
+	}
+
+	layers.clear();
+	entryCount = 0;
+	imageTexels = 0;
+	paddedTexels = 0;
+}
+
+TextureAtlas::~TextureAtlas()
+{
+	ClearAtlas();
+}
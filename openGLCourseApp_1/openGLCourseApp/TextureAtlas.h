@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+
+#include <GL\glew.h>
+
+#include <glm\glm.hpp>
+
+// Where an image ended up inside the atlas. Mesh UVs in 0..1 map to uv * uvTransform.xy + uvTransform.zw
+// on the given array layer, so atlased textures cannot rely on GL_REPEAT.
+struct AtlasRegion
+{
+	GLint layer;
+	glm::vec4 uvTransform;
+	int width, height;
+};
+
+struct AtlasStats
+{
+	unsigned int entryCount;
+	unsigned int layerCount;
+	// Texels of the packed images, of the images plus their gutters, and of every layer in use
+	size_t imageTexels;
+	size_t paddedTexels;
+	size_t layerTexels;
+	float occupancy;
+	float efficiency;
+};
+
+// Packs many small RGBA8 images into the layers of one GL_TEXTURE_2D_ARRAY with a skyline packer, so draws
+// using different images can share a single bind (and a single multi-draw). Each image is surrounded by a
+// gutter of repeated edge texels wide enough to survive every mip level, and its mips are built with
+// MipGenerator from the padded image so neighbours never bleed into each other.
+class TextureAtlas
+{
+public:
+	TextureAtlas();
+
+	// GL thread. levels also sets the gutter: 2^(levels - 1) texels, one texel on the smallest level.
+	bool CreateAtlas(GLsizei pageSize, GLsizei maxLayers, GLsizei levels, bool srgb);
+
+	// GL thread. Fails when the image does not fit in any layer, the caller should keep it as its own texture.
+	bool AddImage(const unsigned char* rgba, int width, int height, AtlasRegion& region);
+	// Decode a file with stb_image (first row at the bottom) and add it
+	bool AddFile(const char* fileLocation, AtlasRegion& region);
+
+	void UseAtlas(GLuint unit);
+	void ClearAtlas();
+
+	GLuint GetTextureID() { return textureID; }
+	AtlasStats GetStats();
+	// Every layer is allocated up front, so this is the whole array whether used or not
+	size_t GetMemoryUsage();
+
+	~TextureAtlas();
+
+private:
+	struct SkylineNode
+	{
+		int x, y, width;
+	};
+
+	struct Layer
+	{
+		std::vector<SkylineNode> skyline;
+	};
+
+	GLuint textureID;
+	GLsizei pageSize, maxLayers, levels;
+	int padding;
+	bool srgb;
+
+	std::vector<Layer> layers;
+	unsigned int entryCount;
+	size_t imageTexels, paddedTexels;
+
+	bool FindPosition(const Layer& layer, int width, int height, int& x, int& y, size_t& node);
+	void AddSkylineLevel(Layer& layer, size_t node, int x, int y, int width, int height);
+};
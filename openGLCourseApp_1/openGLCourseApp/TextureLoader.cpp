@@ -0,0 +1,171 @@
+#include "TextureLoader.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "stb_image.h"
+
+#include "MipGenerator.h"
+
+TextureLoader::TextureLoader()
+{
+	pool = NULL;
+	uploadQueue = NULL;
+	cpuMipGeneration = true;
+	pendingCount = 0;
+}
+
+void TextureLoader::Initialise(ThreadPool* pool)
+{
+	this->pool = pool;
+
+	// Global stb_image state, set once before any worker starts decoding
+	stbi_set_flip_vertically_on_load(1);
+}
+
+void TextureLoader::QueueTexture(Texture* texture, const char* fileLocation, bool srgb, float alphaCutoff)
+{
+	pendingCount++;
+	pool->Enqueue([this, texture, fileLocation, srgb, alphaCutoff]() { DecodeImage(texture, fileLocation, srgb, alphaCutoff); });
+}
+
+void TextureLoader::QueueTexture(Texture* texture, const unsigned char* source, size_t size, std::shared_ptr<void> sourceOwner, bool srgb, float alphaCutoff, bool topRowFirst)
+{
+	pendingCount++;
+	pool->Enqueue([this, texture, source, size, sourceOwner, srgb, alphaCutoff, topRowFirst]() { DecodeMemory(texture, source, size, "embedded image", srgb, alphaCutoff, topRowFirst); });
+}
+
+void TextureLoader::DecodeImage(Texture* texture, const char* fileLocation, bool srgb, float alphaCutoff)
+{
+	// Read the whole file up front so the decoder works from memory without stdio callbacks
+	std::vector<unsigned char> fileData;
+	FILE* file = fopen(fileLocation, "rb");
+	if (file)
+	{
+		fseek(file, 0, SEEK_END);
+		long size = ftell(file);
+		fseek(file, 0, SEEK_SET);
+
+		if (size > 0)
+		{
+			fileData.resize(size);
+			fileData.resize(fread(&fileData[0], 1, size, file));
+		}
+		fclose(file);
+	}
+
+	if (fileData.empty())
+	{
+		printf("Failed to find: %s\n", fileLocation);
+		pendingCount--;
+		return;
+	}
+
+	DecodeMemory(texture, &fileData[0], fileData.size(), fileLocation, srgb, alphaCutoff, false);
+}
+
+void TextureLoader::DecodeMemory(Texture* texture, const unsigned char* source, size_t size, const char* name, bool srgb, float alphaCutoff, bool topRowFirst)
+{
+	DecodedImage image;
+	image.texture = texture;
+	image.srgb = srgb;
+	bool generateMips = cpuMipGeneration;
+	unsigned char* pixels = stbi_load_from_memory(source, (int)size, &image.width, &image.height, &image.channels, generateMips ? 4 : 0);
+
+	if (!pixels)
+	{
+		printf("Failed to decode: %s\n", name);
+		pendingCount--;
+		return;
+	}
+
+	int channels = generateMips ? 4 : image.channels;
+	if (topRowFirst)
+	{
+		// stb_image flips every load once enabled, so undo it here rather than toggling the global flag
+		// while other workers are decoding
+		size_t rowBytes = (size_t)image.width * channels;
+		std::vector<unsigned char> row(rowBytes);
+		for (int y = 0; y < image.height / 2; y++)
+		{
+			unsigned char* top = pixels + y * rowBytes;
+			unsigned char* bottom = pixels + (image.height - 1 - y) * rowBytes;
+			memcpy(&row[0], top, rowBytes);
+			memcpy(top, bottom, rowBytes);
+			memcpy(bottom, &row[0], rowBytes);
+		}
+	}
+
+	// Owned by a vector so it can be handed straight to the upload queue
+	if (generateMips)
+	{
+		image.channels = 4;
+		MipGenerator::GenerateMipChain(pixels, image.width, image.height, srgb, alphaCutoff, image.pixels, image.levelOffsets);
+	}
+	else
+	{
+		image.pixels.assign(pixels, pixels + (size_t)image.width * image.height * image.channels);
+	}
+	stbi_image_free(pixels);
+
+	std::lock_guard<std::mutex> lock(decodedMutex);
+	decoded.push_back(std::move(image));
+}
+
+unsigned int TextureLoader::ProcessUploads(double budgetMs)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	unsigned int uploaded = 0;
+
+	while (true)
+	{
+		DecodedImage image;
+		{
+			std::lock_guard<std::mutex> lock(decodedMutex);
+			if (decoded.empty())
+			{
+				break;
+			}
+
+			image = std::move(decoded.front());
+			decoded.pop_front();
+		}
+
+		if (!image.levelOffsets.empty())
+		{
+			if (uploadQueue)
+			{
+				uploadQueue->QueueTextureUpload(image.texture, image.pixels, image.levelOffsets, image.width, image.height, image.srgb, NULL);
+			}
+			else
+			{
+				image.texture->UploadMipChain(&image.pixels[0], image.levelOffsets, image.width, image.height, image.srgb);
+			}
+		}
+		else if (uploadQueue)
+		{
+			uploadQueue->QueueTextureUpload(image.texture, image.pixels, image.width, image.height, image.channels, image.srgb, true, NULL);
+		}
+		else
+		{
+			image.texture->Upload(&image.pixels[0], image.width, image.height, image.channels, image.srgb, true);
+		}
+
+		pendingCount--;
+		uploaded++;
+
+		double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (elapsedMs >= budgetMs)
+		{
+			break;
+		}
+	}
+
+	return uploaded;
+}
+
+TextureLoader::~TextureLoader()
+{
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <vector>
+#include <memory>
+
+#include "Texture.h"
+#include "ThreadPool.h"
+#include "UploadQueue.h"
+
+// Reads and decodes images on a thread pool, the GL thread then uploads the results under a time budget
+class TextureLoader
+{
+public:
+	TextureLoader();
+
+	void Initialise(ThreadPool* pool);
+
+	// When set, decoded images are streamed through the staging queue instead of uploaded directly
+	void SetUploadQueue(UploadQueue* queue) { uploadQueue = queue; }
+
+	// Build mip chains on the decoding worker with MipGenerator instead of glGenerateMipmap on the GL thread.
+	// On by default, images are then always expanded to RGBA.
+	void SetCPUMipGeneration(bool enabled) { cpuMipGeneration = enabled; }
+
+	// Any thread: schedule a file to be decoded into texture, the texture keeps its current contents until uploaded.
+	// A non-zero alphaCutoff keeps the alpha tested coverage of every CPU generated mip equal to level 0.
+	void QueueTexture(Texture* texture, const char* fileLocation, bool srgb, float alphaCutoff);
+	// Any thread: the same for an encoded image already in memory, such as one embedded in a glTF file.
+	// sourceOwner keeps source alive until it is decoded. topRowFirst uploads the image's first row at t = 0
+	// as glTF texture coordinates expect, instead of flipping it like every file loaded from disk.
+	void QueueTexture(Texture* texture, const unsigned char* source, size_t size, std::shared_ptr<void> sourceOwner, bool srgb, float alphaCutoff, bool topRowFirst);
+
+	// GL thread: upload decoded images until budgetMs is spent, at least one upload is always made
+	unsigned int ProcessUploads(double budgetMs);
+
+	// Textures still being decoded or waiting for upload
+	unsigned int GetPendingCount() { return pendingCount; }
+
+	~TextureLoader();
+
+private:
+	struct DecodedImage
+	{
+		Texture* texture;
+		std::vector<unsigned char> pixels;
+		int width, height, channels;
+		bool srgb;
+		// Empty unless the mips were generated on the CPU
+		std::vector<size_t> levelOffsets;
+	};
+
+	ThreadPool* pool;
+	UploadQueue* uploadQueue;
+	bool cpuMipGeneration;
+
+	std::mutex decodedMutex;
+	std::deque<DecodedImage> decoded;
+	std::atomic<unsigned int> pendingCount;
+
+	void DecodeImage(Texture* texture, const char* fileLocation, bool srgb, float alphaCutoff);
+	void DecodeMemory(Texture* texture, const unsigned char* source, size_t size, const char* name, bool srgb, float alphaCutoff, bool topRowFirst);
+};
@@ -0,0 +1,159 @@
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool()
+{
+	activeJobs = 0;
+	running = false;
+}
+
+void ThreadPool::Start(unsigned int threadCount)
+{
+	if (running)
+	{
+		return;
+	}
+
+	if (threadCount == 0)
+	{
+		unsigned int cores = std::thread::hardware_concurrency();
+		threadCount = cores > 1 ? cores - 1 : 1;
+	}
+
+	running = true;
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		workers.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+	}
+}
+
+void ThreadPool::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		running = false;
+	}
+	jobAvailable.notify_all();
+
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+	workers.clear();
+}
+
+void ThreadPool::Enqueue(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		jobs.push_back(job);
+	}
+	jobAvailable.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+	std::unique_lock<std::mutex> lock(jobMutex);
+	jobsFinished.wait(lock, [this] { return jobs.empty() && activeJobs == 0; });
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& body)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	if (grainSize == 0)
+	{
+		grainSize = 1;
+	}
+
+	size_t chunkCount = (count + grainSize - 1) / grainSize;
+	if (chunkCount == 1 || workers.empty())
+	{
+		body(0, count);
+		return;
+	}
+
+	// Helpers and the caller pull chunk indices from a shared counter until the range is used up.
+	// Only claimed chunks are waited on, so helpers still sitting in the queue never hold the caller up.
+	struct ForState
+	{
+		std::atomic<size_t> nextChunk;
+		std::atomic<size_t> chunksDone;
+		std::mutex doneMutex;
+		std::condition_variable done;
+	};
+
+	std::shared_ptr<ForState> state = std::make_shared<ForState>();
+	state->nextChunk = 0;
+	state->chunksDone = 0;
+
+	const std::function<void(size_t, size_t)>* bodyPtr = &body;
+	auto runChunks = [state, count, grainSize, chunkCount, bodyPtr]()
+	{
+		size_t chunk;
+		while ((chunk = state->nextChunk.fetch_add(1)) < chunkCount)
+		{
+			size_t begin = chunk * grainSize;
+			size_t end = begin + grainSize < count ? begin + grainSize : count;
+			(*bodyPtr)(begin, end);
+
+			if (state->chunksDone.fetch_add(1) + 1 == chunkCount)
+			{
+				std::lock_guard<std::mutex> lock(state->doneMutex);
+				state->done.notify_all();
+			}
+		}
+	};
+
+	size_t helperCount = chunkCount - 1 < workers.size() ? chunkCount - 1 : workers.size();
+	for (size_t i = 0; i < helperCount; i++)
+	{
+		Enqueue(runChunks);
+	}
+
+	runChunks();
+
+	std::unique_lock<std::mutex> lock(state->doneMutex);
+	state->done.wait(lock, [&state, chunkCount] { return state->chunksDone == chunkCount; });
+}
+
+void ThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			jobAvailable.wait(lock, [this] { return !jobs.empty() || !running; });
+			if (!running && jobs.empty())
+			{
+				return;
+			}
+
+			job = jobs.front();
+			jobs.pop_front();
+			activeJobs++;
+		}
+
+		job();
+
+		{
+			std::lock_guard<std::mutex> lock(jobMutex);
+			activeJobs--;
+			if (jobs.empty() && activeJobs == 0)
+			{
+				jobsFinished.notify_all();
+			}
+		}
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	Stop();
+}
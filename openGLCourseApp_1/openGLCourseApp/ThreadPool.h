@@ -0,0 +1,44 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <vector>
+
+class ThreadPool
+{
+public:
+	ThreadPool();
+
+	// 0 picks one thread per hardware core, leaving one for the main thread
+	void Start(unsigned int threadCount);
+	void Stop();
+
+	void Enqueue(std::function<void()> job);
+
+	// Block until every queued job has finished
+	void Wait();
+
+	// Split [0, count) into chunks of at most grainSize and run body(begin, end) on the pool.
+	// The calling thread works on chunks as well, so this is safe to call from inside a job.
+	void ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& body);
+
+	unsigned int GetThreadCount() { return (unsigned int)workers.size(); }
+
+	~ThreadPool();
+
+private:
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> jobs;
+
+	std::mutex jobMutex;
+	std::condition_variable jobAvailable;
+	std::condition_variable jobsFinished;
+
+	unsigned int activeJobs;
+	bool running;
+
+	void WorkerLoop();
+};
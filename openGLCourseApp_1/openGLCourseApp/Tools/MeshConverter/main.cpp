@@ -0,0 +1,260 @@
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "../../MeshFile.h"
+#include "../../ObjImporter.h"
+#include "../../ThreadPool.h"
+#include "../../GltfFile.h"
+#include "../../MeshOptimizer.h"
+#include "../../VertexQuantizer.h"
+#include "../../MeshSimplifier.h"
+#include "../../MeshletBuilder.h"
+#include "../../TangentGenerator.h"
+
+// Offline converter: reads a model and writes it as a mesh file (see MeshFormat.h) that the runtime maps
+// and uploads without parsing. OBJ vertices are deduplicated on their position and texture coordinate,
+// a glTF scene is flattened into one mesh with every node transform applied. Triangles and vertices are then
+// reordered for the vertex cache, overdraw and fetch locality unless --no-optimize is given, and the indices
+// are stored compressed (see IndexCodec.h) unless --raw-indices is given. --quantize stores 12-byte vertices
+// (see VertexQuantizer.h) instead of 20-byte float ones. Coarser levels of detail are simplified from the
+// result and stored after it unless --no-lods is given. The full level is split into meshlets for cluster culling
+// (see MeshletBuilder.h), its triangles listed meshlet by meshlet, unless --no-meshlets is given. --normals and
+// --tangents generate normals and tangent frames right after import (see TangentGenerator.h), carried through the
+// other steps inside the vertices and stored in sections of their own.
+// Usage: MeshConverter <input.obj|input.gltf|input.glb> <output.mesh> [--no-optimize] [--raw-indices] [--quantize] [--no-lods] [--no-meshlets] [--normals smooth|flat] [--tangents]
+
+static bool ImportGltf(const char* inputPath, MeshData& mesh)
+{
+	GltfFile file;
+	if (!file.Open(inputPath))
+	{
+		return false;
+	}
+
+	const std::vector<GltfInstance>& instances = file.GetInstances();
+	unsigned int skipped = 0;
+	for (size_t i = 0; i < instances.size(); i++)
+	{
+		const GltfMesh& gltfMesh = file.GetMeshes()[instances[i].mesh];
+		for (uint32_t p = gltfMesh.firstPrimitive; p < gltfMesh.firstPrimitive + gltfMesh.primitiveCount; p++)
+		{
+			skipped += file.AppendPrimitive(p, instances[i].transform, mesh.vertices, mesh.indices) ? 0 : 1;
+		}
+	}
+
+	printf("Imported %s: %u instances, %u primitives skipped\n", inputPath, (unsigned int)instances.size(), skipped);
+	return !mesh.indices.empty();
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		printf("Usage: MeshConverter <input.obj|input.gltf|input.glb> <output.mesh> [--no-optimize] [--raw-indices] [--quantize] [--no-lods] [--no-meshlets] [--normals smooth|flat] [--tangents]\n");
+		return 1;
+	}
+
+	const char* inputPath = argv[1];
+	const char* outputPath = argv[2];
+	bool optimize = true;
+	bool compressIndices = true;
+	bool quantize = false;
+	bool generateLods = true;
+	bool buildMeshlets = true;
+	bool generateNormals = false;
+	bool flatNormals = false;
+	bool generateTangents = false;
+	for (int i = 3; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--no-optimize") == 0)
+		{
+			optimize = false;
+		}
+		else if (strcmp(argv[i], "--raw-indices") == 0)
+		{
+			compressIndices = false;
+		}
+		else if (strcmp(argv[i], "--quantize") == 0)
+		{
+			quantize = true;
+		}
+		else if (strcmp(argv[i], "--no-lods") == 0)
+		{
+			generateLods = false;
+		}
+		else if (strcmp(argv[i], "--no-meshlets") == 0)
+		{
+			buildMeshlets = false;
+		}
+		else if (strcmp(argv[i], "--normals") == 0 && i + 1 < argc && (strcmp(argv[i + 1], "smooth") == 0 || strcmp(argv[i + 1], "flat") == 0))
+		{
+			generateNormals = true;
+			flatNormals = strcmp(argv[++i], "flat") == 0;
+		}
+		else if (strcmp(argv[i], "--tangents") == 0)
+		{
+			generateTangents = true;
+		}
+		else
+		{
+			printf("Unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	// Tangents are built against normals, smooth ones unless asked otherwise
+	generateNormals = generateNormals || generateTangents;
+
+	ThreadPool pool;
+	pool.Start(0);
+
+	MeshData mesh;
+	mesh.compressIndices = compressIndices;
+	mesh.quantizeVertices = quantize;
+	mesh.vertexFormat = MESH_VERTEX_POSITION_UV;
+	mesh.vertexStride = sizeof(float) * 5;
+
+	const char* extension = strrchr(inputPath, '.');
+	if (extension && (strcmp(extension, ".gltf") == 0 || strcmp(extension, ".glb") == 0))
+	{
+		if (!ImportGltf(inputPath, mesh))
+		{
+			return 1;
+		}
+	}
+	else if (extension && (strcmp(extension, ".obj") == 0 || strcmp(extension, ".OBJ") == 0))
+	{
+		ObjImportStats stats;
+		bool imported = ObjImporter::ImportObj(inputPath, &pool, mesh.vertices, mesh.indices, stats);
+		if (!imported)
+		{
+			return 1;
+		}
+		printf("Imported %s in %.1f ms (%u chunks)\n", inputPath, stats.milliseconds, stats.chunks);
+	}
+	else
+	{
+		printf("Unsupported input %s\n", inputPath);
+		return 1;
+	}
+
+	// Generated attributes ride along after x, y, z, u, v until the vertex order is final
+	unsigned int floatsPerVertex = 5;
+	if (generateNormals)
+	{
+		std::vector<float> normals;
+		TangentGenerateStats normalStats;
+		if (flatNormals)
+		{
+			TangentGenerator::GenerateFlatNormals(mesh.vertices, 5, mesh.indices, &pool, normals, normalStats);
+		}
+		else
+		{
+			TangentGenerator::GenerateSmoothNormals(&mesh.vertices[0], mesh.vertices.size() / 5, 5, &mesh.indices[0], mesh.indices.size(), &pool, normals, normalStats);
+		}
+		printf("Generated %s normals in %.1f ms: %u triangles, %u partials, %u vertices added, %u degenerate triangles\n", flatNormals ? "flat" : "smooth",
+			normalStats.milliseconds, normalStats.triangles, normalStats.partials, normalStats.addedVertices, normalStats.degenerateTriangles);
+
+		std::vector<float> tangents;
+		if (generateTangents)
+		{
+			TangentGenerateStats tangentStats;
+			TangentGenerator::GenerateTangents(mesh.vertices, 5, mesh.indices, normals, &pool, tangents, tangentStats);
+			printf("Generated tangents in %.1f ms: %u partials, %u vertices split for mirrored texture coordinates, %u degenerate triangles\n",
+				tangentStats.milliseconds, tangentStats.partials, tangentStats.addedVertices, tangentStats.degenerateTriangles);
+		}
+
+		floatsPerVertex = generateTangents ? 12 : 8;
+		size_t vertexCount = mesh.vertices.size() / 5;
+		std::vector<float> interleaved(vertexCount * floatsPerVertex);
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			float* vertex = &interleaved[v * floatsPerVertex];
+			memcpy(vertex, &mesh.vertices[v * 5], sizeof(float) * 5);
+			memcpy(vertex + 5, &normals[v * 3], sizeof(float) * 3);
+			if (generateTangents)
+			{
+				memcpy(vertex + 8, &tangents[v * 4], sizeof(float) * 4);
+			}
+		}
+		mesh.vertices.swap(interleaved);
+	}
+	pool.Stop();
+
+	if (optimize)
+	{
+		MeshOptimizeStats stats;
+		MeshOptimizer::OptimizeMesh(mesh.vertices, mesh.indices, floatsPerVertex, stats);
+		printf("Optimised in %.1f ms: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %u clusters, %u unused vertices removed\n",
+			stats.milliseconds, stats.acmrBefore, stats.acmrAfter, stats.atvrBefore, stats.atvrAfter, stats.clusters, stats.removedVertices);
+	}
+
+	// Meshlets reorder the full level's triangles, the coarser levels are simplified from them afterwards
+	if (buildMeshlets)
+	{
+		MeshletBuildStats stats;
+		MeshletBuilder::BuildMeshlets(&mesh.vertices[0], mesh.vertices.size() / floatsPerVertex, floatsPerVertex, &mesh.indices[0], mesh.indices.size(), mesh.meshlets, mesh.meshletVertices, mesh.meshletTriangles, stats);
+		printf("Built %u meshlets in %.1f ms: %.1f vertices and %.1f triangles each, %u without a normal cone\n",
+			stats.meshlets, stats.milliseconds, stats.averageVertices, stats.averageTriangles, stats.unconedMeshlets);
+	}
+
+	// Every level shares the vertices, so they are simplified after the vertex order is final
+	if (generateLods)
+	{
+		MeshSimplifyStats stats;
+		MeshSimplifier::BuildLodChain(mesh.vertices, floatsPerVertex, mesh.indices, 8, mesh.lods, stats);
+		printf("Simplified in %.1f ms: %u levels, %u -> %u triangles\n", stats.milliseconds, stats.levels, stats.trianglesBefore, stats.trianglesAfter);
+		for (size_t l = 0; l < mesh.lods.size(); l++)
+		{
+			printf("  level %u: %u triangles, error %g\n", (unsigned int)l, mesh.lods[l].indexCount / 3, mesh.lods[l].error);
+		}
+	}
+	else
+	{
+		MeshFileLod lod = { 0, (uint32_t)mesh.indices.size(), 0.0f, 0 };
+		mesh.lods.push_back(lod);
+	}
+
+	// Split the generated attributes out into their encoded sections
+	if (floatsPerVertex > 5)
+	{
+		size_t vertexCount = mesh.vertices.size() / floatsPerVertex;
+		mesh.normals.resize(vertexCount * 2);
+		mesh.tangents.resize(generateTangents ? vertexCount * 4 : 0);
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			const float* vertex = &mesh.vertices[v * floatsPerVertex];
+			VertexQuantizer::EncodeOctahedral(vertex + 5, 16, &mesh.normals[v * 2]);
+			if (generateTangents)
+			{
+				VertexQuantizer::EncodeOctahedral(vertex + 8, 16, &mesh.tangents[v * 4]);
+				mesh.tangents[v * 4 + 2] = vertex[11] < 0.0f ? -32767 : 32767;
+				mesh.tangents[v * 4 + 3] = 0;
+			}
+			memmove(&mesh.vertices[v * 5], vertex, sizeof(float) * 5);
+		}
+		mesh.vertices.resize(vertexCount * 5);
+	}
+
+	VertexQuantizeStats stats;
+	uint64_t indexBytes;
+	if (!MeshFile::WriteMeshFile(outputPath, mesh, stats, indexBytes))
+	{
+		return 1;
+	}
+
+	if (quantize)
+	{
+		printf("Vertices quantized from %.2f to %.2f MB: position error up to %g, texture coordinate error up to %g\n",
+			stats.bytesBefore / 1048576.0, stats.bytesAfter / 1048576.0, stats.maxPositionError, stats.maxUvError);
+	}
+
+	if (compressIndices)
+	{
+		printf("Indices compressed to %.2f bytes each\n", (double)indexBytes / mesh.indices.size());
+	}
+
+	printf("Converted %s: %u vertices, %u triangles in the full level\n", outputPath, (unsigned int)(mesh.vertices.size() / 5), mesh.lods[0].indexCount / 3);
+	return 0;
+}
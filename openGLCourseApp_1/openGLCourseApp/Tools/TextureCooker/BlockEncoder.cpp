@@ -0,0 +1,641 @@
+#include "BlockEncoder.h"
+
+#include <string.h>
+#include <math.h>
+
+#include "../../CookedTextureFormat.h"
+#include "../../ThreadPool.h"
+
+static int Clamp255(int v)
+{
+	return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+// Principal axis of the block's colours (first 'channels' components) by power iteration
+static void PrincipalAxis(const unsigned char* rgba, int channels, float* mean, float* axis)
+{
+	for (int c = 0; c < 4; c++)
+	{
+		mean[c] = 0.0f;
+		axis[c] = 0.0f;
+	}
+
+	for (int i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < channels; c++)
+		{
+			mean[c] += rgba[i * 4 + c];
+		}
+	}
+	for (int c = 0; c < channels; c++)
+	{
+		mean[c] /= 16.0f;
+	}
+
+	float covariance[4][4] = { { 0.0f } };
+	for (int i = 0; i < 16; i++)
+	{
+		float d[4];
+		for (int c = 0; c < channels; c++)
+		{
+			d[c] = rgba[i * 4 + c] - mean[c];
+		}
+		for (int a = 0; a < channels; a++)
+		{
+			for (int b = 0; b < channels; b++)
+			{
+				covariance[a][b] += d[a] * d[b];
+			}
+		}
+	}
+
+	float v[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	for (int iteration = 0; iteration < 8; iteration++)
+	{
+		float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		float length = 0.0f;
+		for (int a = 0; a < channels; a++)
+		{
+			for (int b = 0; b < channels; b++)
+			{
+				next[a] += covariance[a][b] * v[b];
+			}
+			length += next[a] * next[a];
+		}
+
+		if (length < 1e-6f)
+		{
+			return;
+		}
+
+		length = sqrtf(length);
+		for (int a = 0; a < channels; a++)
+		{
+			v[a] = next[a] / length;
+		}
+	}
+
+	for (int c = 0; c < channels; c++)
+	{
+		axis[c] = v[c];
+	}
+}
+
+// Project the block onto its principal axis and return the extreme colours
+static void AxisEndpoints(const unsigned char* rgba, int channels, float* low, float* high)
+{
+	float mean[4], axis[4];
+	PrincipalAxis(rgba, channels, mean, axis);
+
+	float minT = 0.0f, maxT = 0.0f;
+	for (int i = 0; i < 16; i++)
+	{
+		float t = 0.0f;
+		for (int c = 0; c < channels; c++)
+		{
+			t += (rgba[i * 4 + c] - mean[c]) * axis[c];
+		}
+		minT = t < minT ? t : minT;
+		maxT = t > maxT ? t : maxT;
+	}
+
+	for (int c = 0; c < channels; c++)
+	{
+		low[c] = mean[c] + axis[c] * minT;
+		high[c] = mean[c] + axis[c] * maxT;
+	}
+}
+
+static uint16_t PackRGB565(const float* color)
+{
+	int r = Clamp255((int)(color[0] + 0.5f));
+	int g = Clamp255((int)(color[1] + 0.5f));
+	int b = Clamp255((int)(color[2] + 0.5f));
+	return (uint16_t)(((r * 31 + 127) / 255) << 11 | ((g * 63 + 127) / 255) << 5 | ((b * 31 + 127) / 255));
+}
+
+static void UnpackRGB565(uint16_t packed, int* color)
+{
+	int r = (packed >> 11) & 31;
+	int g = (packed >> 5) & 63;
+	int b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+static void EncodeColorBlock(const unsigned char* rgba, bool allowTransparent, unsigned char* out)
+{
+	bool transparent = false;
+	if (allowTransparent)
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			transparent |= rgba[i * 4 + 3] < 128;
+		}
+	}
+
+	float low[4], high[4];
+	AxisEndpoints(rgba, 3, low, high);
+
+	uint16_t color0 = PackRGB565(high);
+	uint16_t color1 = PackRGB565(low);
+
+	// color0 > color1 selects the four colour mode, color0 <= color1 the three colour + transparent mode
+	if ((!transparent && color0 < color1) || (transparent && color0 > color1))
+	{
+		uint16_t swap = color0;
+		color0 = color1;
+		color1 = swap;
+	}
+
+	int palette[4][3];
+	UnpackRGB565(color0, palette[0]);
+	UnpackRGB565(color1, palette[1]);
+	int paletteSize = 4;
+	for (int c = 0; c < 3; c++)
+	{
+		if (transparent)
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			paletteSize = 3;
+		}
+		else
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+	}
+
+	uint32_t indices = 0;
+	if (color0 != color1 || transparent)
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			const unsigned char* pixel = rgba + i * 4;
+			uint32_t best = 0;
+
+			if (transparent && pixel[3] < 128)
+			{
+				best = 3;
+			}
+			else
+			{
+				int bestError = 0x7FFFFFFF;
+				for (int p = 0; p < paletteSize; p++)
+				{
+					int dr = pixel[0] - palette[p][0];
+					int dg = pixel[1] - palette[p][1];
+					int db = pixel[2] - palette[p][2];
+					int error = dr * dr + dg * dg + db * db;
+					if (error < bestError)
+					{
+						bestError = error;
+						best = p;
+					}
+				}
+			}
+
+			indices |= best << (i * 2);
+		}
+	}
+
+	out[0] = color0 & 0xFF;
+	out[1] = color0 >> 8;
+	out[2] = color1 & 0xFF;
+	out[3] = color1 >> 8;
+	out[4] = indices & 0xFF;
+	out[5] = (indices >> 8) & 0xFF;
+	out[6] = (indices >> 16) & 0xFF;
+	out[7] = indices >> 24;
+}
+
+void EncodeBC1Block(const unsigned char* rgba, unsigned char* out)
+{
+	EncodeColorBlock(rgba, true, out);
+}
+
+void EncodeBC4Block(const unsigned char* values, unsigned char* out)
+{
+	int minValue = 255, maxValue = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		minValue = values[i] < minValue ? values[i] : minValue;
+		maxValue = values[i] > maxValue ? values[i] : maxValue;
+	}
+
+	// endpoint0 > endpoint1 selects the eight value mode
+	int palette[8];
+	palette[0] = maxValue;
+	palette[1] = minValue;
+	for (int i = 2; i < 8; i++)
+	{
+		palette[i] = ((8 - i) * maxValue + (i - 1) * minValue) / 7;
+	}
+
+	uint64_t indices = 0;
+	if (maxValue != minValue)
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			uint64_t best = 0;
+			int bestError = 256;
+			for (int p = 0; p < 8; p++)
+			{
+				int error = values[i] > palette[p] ? values[i] - palette[p] : palette[p] - values[i];
+				if (error < bestError)
+				{
+					bestError = error;
+					best = p;
+				}
+			}
+			indices |= best << (i * 3);
+		}
+	}
+
+	out[0] = (unsigned char)maxValue;
+	out[1] = (unsigned char)minValue;
+	for (int i = 0; i < 6; i++)
+	{
+		out[2 + i] = (indices >> (i * 8)) & 0xFF;
+	}
+}
+
+static void EncodeChannelBlock(const unsigned char* rgba, int channel, unsigned char* out)
+{
+	unsigned char values[16];
+	for (int i = 0; i < 16; i++)
+	{
+		values[i] = rgba[i * 4 + channel];
+	}
+	EncodeBC4Block(values, out);
+}
+
+void EncodeBC3Block(const unsigned char* rgba, unsigned char* out)
+{
+	EncodeChannelBlock(rgba, 3, out);
+	EncodeColorBlock(rgba, false, out + 8);
+}
+
+void EncodeBC5Block(const unsigned char* rgba, unsigned char* out)
+{
+	EncodeChannelBlock(rgba, 0, out);
+	EncodeChannelBlock(rgba, 1, out + 8);
+}
+
+// Appends bits least significant first into a 128 bit block
+struct BitWriter
+{
+	unsigned char* out;
+	int position;
+
+	void Write(uint32_t value, int bits)
+	{
+		for (int i = 0; i < bits; i++, position++)
+		{
+			if (value & (1u << i))
+			{
+				out[position >> 3] |= (unsigned char)(1 << (position & 7));
+			}
+		}
+	}
+};
+
+void EncodeBC7Block(const unsigned char* rgba, unsigned char* out)
+{
+	// Mode 6: one subset, RGBA 7.7.7.7 endpoints with a unique p-bit each, 4-bit indices
+	static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	float low[4], high[4];
+	AxisEndpoints(rgba, 4, low, high);
+
+	int endpoints[2][4];
+	int quantized[2][4];
+	int pbits[2];
+	const float* sources[2] = { low, high };
+
+	for (int e = 0; e < 2; e++)
+	{
+		int bestError = 0x7FFFFFFF;
+		for (int p = 0; p < 2; p++)
+		{
+			int error = 0;
+			int candidate[4];
+			for (int c = 0; c < 4; c++)
+			{
+				int q = (int)floorf((sources[e][c] - p) * 0.5f + 0.5f);
+				q = q < 0 ? 0 : (q > 127 ? 127 : q);
+				candidate[c] = q;
+				int value = (q << 1) | p;
+				int d = value - (int)(sources[e][c] + 0.5f);
+				error += d * d;
+			}
+
+			if (error < bestError)
+			{
+				bestError = error;
+				pbits[e] = p;
+				for (int c = 0; c < 4; c++)
+				{
+					quantized[e][c] = candidate[c];
+					endpoints[e][c] = (candidate[c] << 1) | p;
+				}
+			}
+		}
+	}
+
+	int palette[16][4];
+	for (int i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			palette[i][c] = ((64 - weights[i]) * endpoints[0][c] + weights[i] * endpoints[1][c] + 32) >> 6;
+		}
+	}
+
+	int indices[16];
+	for (int i = 0; i < 16; i++)
+	{
+		const unsigned char* pixel = rgba + i * 4;
+		int bestError = 0x7FFFFFFF;
+		indices[i] = 0;
+		for (int p = 0; p < 16; p++)
+		{
+			int error = 0;
+			for (int c = 0; c < 4; c++)
+			{
+				int d = pixel[c] - palette[p][c];
+				error += d * d;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				indices[i] = p;
+			}
+		}
+	}
+
+	// The anchor index is stored without its top bit, so it must be below 8
+	if (indices[0] >= 8)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			int swap = quantized[0][c];
+			quantized[0][c] = quantized[1][c];
+			quantized[1][c] = swap;
+		}
+		int swap = pbits[0];
+		pbits[0] = pbits[1];
+		pbits[1] = swap;
+
+		for (int i = 0; i < 16; i++)
+		{
+			indices[i] = 15 - indices[i];
+		}
+	}
+
+	memset(out, 0, 16);
+	BitWriter writer = { out, 0 };
+	writer.Write(1 << 6, 7);
+	for (int c = 0; c < 4; c++)
+	{
+		writer.Write(quantized[0][c], 7);
+		writer.Write(quantized[1][c], 7);
+	}
+	writer.Write(pbits[0], 1);
+	writer.Write(pbits[1], 1);
+	writer.Write(indices[0], 3);
+	for (int i = 1; i < 16; i++)
+	{
+		writer.Write(indices[i], 4);
+	}
+}
+
+static const int etcModifiers[8][2] = {
+	{ 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+};
+
+// Pick the best modifier table and per-pixel selectors for one 8 pixel half block
+static int EncodeETCSubblock(const unsigned char* rgba, const int* pixels, const int* base, int* table, int* selectors)
+{
+	int bestTotal = 0x7FFFFFFF;
+	for (int t = 0; t < 8; t++)
+	{
+		int modifiers[4] = { etcModifiers[t][0], etcModifiers[t][1], -etcModifiers[t][0], -etcModifiers[t][1] };
+		int total = 0;
+		int chosen[8];
+
+		for (int i = 0; i < 8; i++)
+		{
+			const unsigned char* pixel = rgba + pixels[i] * 4;
+			int bestError = 0x7FFFFFFF;
+			for (int m = 0; m < 4; m++)
+			{
+				int error = 0;
+				for (int c = 0; c < 3; c++)
+				{
+					int d = Clamp255(base[c] + modifiers[m]) - pixel[c];
+					error += d * d;
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					chosen[i] = m;
+				}
+			}
+			total += bestError;
+		}
+
+		if (total < bestTotal)
+		{
+			bestTotal = total;
+			*table = t;
+			memcpy(selectors, chosen, sizeof(chosen));
+		}
+	}
+	return bestTotal;
+}
+
+void EncodeETC2RGBBlock(const unsigned char* rgba, unsigned char* out)
+{
+	// Written in the ETC1 individual/differential modes, which every ETC2 decoder accepts as long as
+	// the differential colours stay in range
+	uint64_t bestBlock = 0;
+	int bestError = 0x7FFFFFFF;
+
+	for (int flip = 0; flip < 2; flip++)
+	{
+		int pixels[2][8];
+		int average[2][3];
+		for (int s = 0; s < 2; s++)
+		{
+			int sum[3] = { 0, 0, 0 };
+			int n = 0;
+			for (int y = 0; y < 4; y++)
+			{
+				for (int x = 0; x < 4; x++)
+				{
+					int half = flip ? (y >= 2) : (x >= 2);
+					if (half == s)
+					{
+						int index = y * 4 + x;
+						pixels[s][n++] = index;
+						for (int c = 0; c < 3; c++)
+						{
+							sum[c] += rgba[index * 4 + c];
+						}
+					}
+				}
+			}
+			for (int c = 0; c < 3; c++)
+			{
+				average[s][c] = (sum[c] + 4) / 8;
+			}
+		}
+
+		for (int differential = 0; differential < 2; differential++)
+		{
+			int stored[2][3];
+			int base[2][3];
+			bool valid = true;
+
+			for (int s = 0; s < 2; s++)
+			{
+				for (int c = 0; c < 3; c++)
+				{
+					if (differential)
+					{
+						int q = (average[s][c] * 31 + 127) / 255;
+						stored[s][c] = q;
+						base[s][c] = (q << 3) | (q >> 2);
+					}
+					else
+					{
+						int q = (average[s][c] * 15 + 127) / 255;
+						stored[s][c] = q;
+						base[s][c] = q * 17;
+					}
+				}
+			}
+
+			if (differential)
+			{
+				for (int c = 0; c < 3; c++)
+				{
+					int delta = stored[1][c] - stored[0][c];
+					valid &= delta >= -4 && delta <= 3;
+				}
+			}
+
+			if (!valid)
+			{
+				continue;
+			}
+
+			int tables[2];
+			int selectors[2][8];
+			int error = EncodeETCSubblock(rgba, pixels[0], base[0], &tables[0], selectors[0])
+				+ EncodeETCSubblock(rgba, pixels[1], base[1], &tables[1], selectors[1]);
+
+			if (error >= bestError)
+			{
+				continue;
+			}
+
+			uint64_t block = 0;
+			if (differential)
+			{
+				block |= (uint64_t)stored[0][0] << 59;
+				block |= (uint64_t)((stored[1][0] - stored[0][0]) & 7) << 56;
+				block |= (uint64_t)stored[0][1] << 51;
+				block |= (uint64_t)((stored[1][1] - stored[0][1]) & 7) << 48;
+				block |= (uint64_t)stored[0][2] << 43;
+				block |= (uint64_t)((stored[1][2] - stored[0][2]) & 7) << 40;
+			}
+			else
+			{
+				block |= (uint64_t)stored[0][0] << 60;
+				block |= (uint64_t)stored[1][0] << 56;
+				block |= (uint64_t)stored[0][1] << 52;
+				block |= (uint64_t)stored[1][1] << 48;
+				block |= (uint64_t)stored[0][2] << 44;
+				block |= (uint64_t)stored[1][2] << 40;
+			}
+			block |= (uint64_t)tables[0] << 37;
+			block |= (uint64_t)tables[1] << 34;
+			block |= (uint64_t)differential << 33;
+			block |= (uint64_t)flip << 32;
+
+			// Selectors are stored column major, most significant bits in the upper half
+			for (int s = 0; s < 2; s++)
+			{
+				for (int i = 0; i < 8; i++)
+				{
+					int index = pixels[s][i];
+					int bit = (index % 4) * 4 + index / 4;
+					block |= (uint64_t)(selectors[s][i] >> 1) << (16 + bit);
+					block |= (uint64_t)(selectors[s][i] & 1) << bit;
+				}
+			}
+
+			bestError = error;
+			bestBlock = block;
+		}
+	}
+
+	for (int i = 0; i < 8; i++)
+	{
+		out[i] = (bestBlock >> (56 - i * 8)) & 0xFF;
+	}
+}
+
+bool EncodeImage(const unsigned char* rgba, int width, int height, uint32_t encoding, ThreadPool* pool, std::vector<unsigned char>& out)
+{
+	void (*encodeBlock)(const unsigned char*, unsigned char*);
+	switch (encoding)
+	{
+	case COOKED_BC1: encodeBlock = EncodeBC1Block; break;
+	case COOKED_BC3: encodeBlock = EncodeBC3Block; break;
+	case COOKED_BC5: encodeBlock = EncodeBC5Block; break;
+	case COOKED_BC7: encodeBlock = EncodeBC7Block; break;
+	case COOKED_ETC2_RGB: encodeBlock = EncodeETC2RGBBlock; break;
+	default: return false;
+	}
+
+	int blocksX = (width + 3) / 4;
+	int blocksY = (height + 3) / 4;
+	size_t blockSize = CookedBlockSize(encoding);
+	out.resize(blocksX * blocksY * blockSize);
+
+	auto encodeRows = [&](size_t firstRow, size_t lastRow)
+	{
+		unsigned char block[64];
+		for (size_t by = firstRow; by < lastRow; by++)
+		{
+			for (int bx = 0; bx < blocksX; bx++)
+			{
+				for (int y = 0; y < 4; y++)
+				{
+					int sy = (int)by * 4 + y < height ? (int)by * 4 + y : height - 1;
+					for (int x = 0; x < 4; x++)
+					{
+						int sx = bx * 4 + x < width ? bx * 4 + x : width - 1;
+						memcpy(block + (y * 4 + x) * 4, rgba + ((size_t)sy * width + sx) * 4, 4);
+					}
+				}
+				encodeBlock(block, &out[(by * blocksX + bx) * blockSize]);
+			}
+		}
+	};
+
+	if (pool)
+	{
+		pool->ParallelFor(blocksY, 1, encodeRows);
+	}
+	else
+	{
+		encodeRows(0, blocksY);
+	}
+
+	return true;
+}
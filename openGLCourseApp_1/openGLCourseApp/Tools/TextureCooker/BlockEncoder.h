@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+class ThreadPool;
+
+// Block compressors for 4x4 tiles of RGBA8 pixels (64 bytes, row major)
+void EncodeBC1Block(const unsigned char* rgba, unsigned char* out);
+void EncodeBC3Block(const unsigned char* rgba, unsigned char* out);
+void EncodeBC4Block(const unsigned char* values, unsigned char* out);
+void EncodeBC5Block(const unsigned char* rgba, unsigned char* out);
+void EncodeBC7Block(const unsigned char* rgba, unsigned char* out);
+void EncodeETC2RGBBlock(const unsigned char* rgba, unsigned char* out);
+
+// Compress a whole RGBA8 level with one of the CookedTextureEncoding values, edge blocks repeat the border.
+// Rows of blocks are spread over the pool when one is given.
+bool EncodeImage(const unsigned char* rgba, int width, int height, uint32_t encoding, ThreadPool* pool, std::vector<unsigned char>& out);
@@ -0,0 +1,224 @@
+#include "MipChain.h"
+
+#include <math.h>
+#include <emmintrin.h>
+
+static const double pi = 3.14159265358979323846;
+
+// Kaiser windowed sinc, radius in destination pixels and window shape
+static const double kaiserRadius = 3.0;
+static const double kaiserAlpha = 4.0;
+
+struct FilterTap
+{
+	int index;
+	float weight;
+};
+
+// Taps for one destination coordinate
+struct FilterRow
+{
+	std::vector<FilterTap> taps;
+};
+
+static float SrgbToLinear(float c)
+{
+	return c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static float LinearToSrgb(float c)
+{
+	return c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+}
+
+static double BesselI0(double x)
+{
+	// Power series, converges quickly for the small arguments used here
+	double sum = 1.0;
+	double term = 1.0;
+	double halfX = x * 0.5;
+	for (int k = 1; k < 32; k++)
+	{
+		term *= (halfX / k) * (halfX / k);
+		sum += term;
+		if (term < sum * 1e-12)
+		{
+			break;
+		}
+	}
+	return sum;
+}
+
+static double KaiserSinc(double t)
+{
+	if (fabs(t) >= kaiserRadius)
+	{
+		return 0.0;
+	}
+
+	double sinc = t == 0.0 ? 1.0 : sin(pi * t) / (pi * t);
+	double ratio = t / kaiserRadius;
+	double window = BesselI0(kaiserAlpha * sqrt(1.0 - ratio * ratio)) / BesselI0(kaiserAlpha);
+	return sinc * window;
+}
+
+static int ClampIndex(int i, int size)
+{
+	return i < 0 ? 0 : (i >= size ? size - 1 : i);
+}
+
+static std::vector<FilterRow> BuildFilter(int sourceSize, int destSize, MipFilter filter)
+{
+	std::vector<FilterRow> rows(destSize);
+	double scale = (double)sourceSize / destSize;
+
+	for (int d = 0; d < destSize; d++)
+	{
+		FilterRow& row = rows[d];
+		double start = d * scale;
+		double end = start + scale;
+
+		if (filter == MIP_FILTER_BOX)
+		{
+			// Exact area coverage of the destination footprint, handles odd sizes without shifting
+			for (int s = (int)floor(start); s < (int)ceil(end); s++)
+			{
+				double overlap = (s + 1 < end ? s + 1 : end) - (s > start ? s : start);
+				if (overlap > 0.0)
+				{
+					FilterTap tap = { ClampIndex(s, sourceSize), (float)(overlap / scale) };
+					row.taps.push_back(tap);
+				}
+			}
+			continue;
+		}
+
+		double center = (start + end) * 0.5;
+		double support = kaiserRadius * scale;
+		double total = 0.0;
+		for (int s = (int)floor(center - support); s <= (int)ceil(center + support); s++)
+		{
+			double weight = KaiserSinc((s + 0.5 - center) / scale);
+			if (weight != 0.0)
+			{
+				FilterTap tap = { ClampIndex(s, sourceSize), (float)weight };
+				row.taps.push_back(tap);
+				total += weight;
+			}
+		}
+
+		for (size_t i = 0; i < row.taps.size(); i++)
+		{
+			row.taps[i].weight = (float)(row.taps[i].weight / total);
+		}
+	}
+
+	return rows;
+}
+
+FloatImage ImageFromRGBA8(const unsigned char* rgba, int width, int height, bool srgb)
+{
+	float toLinear[256];
+	for (int i = 0; i < 256; i++)
+	{
+		toLinear[i] = srgb ? SrgbToLinear(i / 255.0f) : i / 255.0f;
+	}
+
+	FloatImage image;
+	image.width = width;
+	image.height = height;
+	image.pixels.resize((size_t)width * height * 4);
+
+	for (size_t i = 0; i < (size_t)width * height; i++)
+	{
+		image.pixels[i * 4 + 0] = toLinear[rgba[i * 4 + 0]];
+		image.pixels[i * 4 + 1] = toLinear[rgba[i * 4 + 1]];
+		image.pixels[i * 4 + 2] = toLinear[rgba[i * 4 + 2]];
+		image.pixels[i * 4 + 3] = rgba[i * 4 + 3] / 255.0f;
+	}
+
+	return image;
+}
+
+void ImageToRGBA8(const FloatImage& image, bool srgb, std::vector<unsigned char>& rgba)
+{
+	size_t pixelCount = (size_t)image.width * image.height;
+	rgba.resize(pixelCount * 4);
+
+	for (size_t i = 0; i < pixelCount * 4; i++)
+	{
+		// Negative lobes of the Kaiser filter can overshoot
+		float c = image.pixels[i];
+		c = c < 0.0f ? 0.0f : (c > 1.0f ? 1.0f : c);
+		if (srgb && (i & 3) != 3)
+		{
+			c = LinearToSrgb(c);
+		}
+		rgba[i] = (unsigned char)(c * 255.0f + 0.5f);
+	}
+}
+
+FloatImage DownsampleImage(const FloatImage& source, MipFilter filter)
+{
+	int destWidth = source.width > 1 ? source.width / 2 : 1;
+	int destHeight = source.height > 1 ? source.height / 2 : 1;
+
+	std::vector<FilterRow> filterX = BuildFilter(source.width, destWidth, filter);
+	std::vector<FilterRow> filterY = BuildFilter(source.height, destHeight, filter);
+
+	// Separable: horizontal pass into a temporary, then vertical. Each RGBA pixel is one SSE register.
+	std::vector<float> horizontal((size_t)destWidth * source.height * 4);
+	for (int y = 0; y < source.height; y++)
+	{
+		const float* sourceRow = &source.pixels[(size_t)y * source.width * 4];
+		float* destRow = &horizontal[(size_t)y * destWidth * 4];
+
+		for (int x = 0; x < destWidth; x++)
+		{
+			const std::vector<FilterTap>& taps = filterX[x].taps;
+			__m128 sum = _mm_setzero_ps();
+			for (size_t t = 0; t < taps.size(); t++)
+			{
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(sourceRow + taps[t].index * 4), _mm_set1_ps(taps[t].weight)));
+			}
+			_mm_storeu_ps(destRow + x * 4, sum);
+		}
+	}
+
+	FloatImage dest;
+	dest.width = destWidth;
+	dest.height = destHeight;
+	dest.pixels.resize((size_t)destWidth * destHeight * 4);
+
+	for (int y = 0; y < destHeight; y++)
+	{
+		const std::vector<FilterTap>& taps = filterY[y].taps;
+		float* destRow = &dest.pixels[(size_t)y * destWidth * 4];
+
+		for (int x = 0; x < destWidth; x++)
+		{
+			__m128 sum = _mm_setzero_ps();
+			for (size_t t = 0; t < taps.size(); t++)
+			{
+				const float* sourcePixel = &horizontal[((size_t)taps[t].index * destWidth + x) * 4];
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(sourcePixel), _mm_set1_ps(taps[t].weight)));
+			}
+			_mm_storeu_ps(destRow + x * 4, sum);
+		}
+	}
+
+	return dest;
+}
+
+std::vector<FloatImage> BuildMipChain(const FloatImage& base, MipFilter filter)
+{
+	std::vector<FloatImage> chain;
+	chain.push_back(base);
+
+	while (chain.back().width > 1 || chain.back().height > 1)
+	{
+		chain.push_back(DownsampleImage(chain.back(), filter));
+	}
+
+	return chain;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+
+enum MipFilter
+{
+	MIP_FILTER_BOX,
+	MIP_FILTER_KAISER
+};
+
+// RGBA float image in linear light, 4 floats per pixel
+struct FloatImage
+{
+	int width;
+	int height;
+	std::vector<float> pixels;
+};
+
+// Convert 8-bit RGBA to linear floats, colour channels are decoded from sRGB when srgb is set
+FloatImage ImageFromRGBA8(const unsigned char* rgba, int width, int height, bool srgb);
+void ImageToRGBA8(const FloatImage& image, bool srgb, std::vector<unsigned char>& rgba);
+
+// Halve the image (rounding down, minimum 1) with the given filter, any size is supported
+FloatImage DownsampleImage(const FloatImage& source, MipFilter filter);
+
+// Level 0 is a copy of base, the chain ends at 1x1
+std::vector<FloatImage> BuildMipChain(const FloatImage& base, MipFilter filter);
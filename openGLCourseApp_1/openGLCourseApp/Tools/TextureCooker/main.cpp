@@ -0,0 +1,312 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <string>
+#include <atomic>
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "../../stb_image.h"
+
+#include "../../CookedTextureFormat.h"
+#include "../../VirtualTextureFormat.h"
+#include "../../ThreadPool.h"
+
+#include "MipChain.h"
+#include "BlockEncoder.h"
+
+// Offline cooker: decodes a source image, builds the full mip chain in linear light and writes every
+// level block-compressed so the runtime can hand it straight to glCompressedTexSubImage2D.
+// Usage: TextureCooker <input> <output> [--format bc1|bc3|bc5|bc7|etc2] [--srgb] [--filter box|kaiser]
+//        [--vt-tiles <page size>] [--vt-border <texels>]
+// With --vt-tiles the output is a directory of virtual texture pages instead (see VirtualTextureFormat.h).
+
+static uint32_t ParseEncoding(const char* name)
+{
+	if (strcmp(name, "bc1") == 0) return COOKED_BC1;
+	if (strcmp(name, "bc3") == 0) return COOKED_BC3;
+	if (strcmp(name, "bc5") == 0) return COOKED_BC5;
+	if (strcmp(name, "bc7") == 0) return COOKED_BC7;
+	if (strcmp(name, "etc2") == 0) return COOKED_ETC2_RGB;
+	return 0;
+}
+
+static bool MakeDirectory(const char* path)
+{
+#ifdef _WIN32
+	_mkdir(path);
+#else
+	mkdir(path, 0755);
+#endif
+	struct stat info;
+	return stat(path, &info) == 0 && (info.st_mode & S_IFDIR) != 0;
+}
+
+// Uncompressed 32-bit TGA stored bottom row first, which is also the order the rows are in here
+static bool WriteTile(const char* path, const unsigned char* rgba, int size)
+{
+	FILE* file = fopen(path, "wb");
+	if (!file)
+	{
+		return false;
+	}
+
+	unsigned char header[18] = { 0 };
+	header[2] = 2;
+	header[12] = (unsigned char)(size & 0xFF);
+	header[13] = (unsigned char)(size >> 8);
+	header[14] = (unsigned char)(size & 0xFF);
+	header[15] = (unsigned char)(size >> 8);
+	header[16] = 32;
+	header[17] = 8;
+	fwrite(header, 1, sizeof(header), file);
+
+	std::vector<unsigned char> bgra((size_t)size * size * 4);
+	for (size_t i = 0; i < (size_t)size * size; i++)
+	{
+		bgra[i * 4 + 0] = rgba[i * 4 + 2];
+		bgra[i * 4 + 1] = rgba[i * 4 + 1];
+		bgra[i * 4 + 2] = rgba[i * 4 + 0];
+		bgra[i * 4 + 3] = rgba[i * 4 + 3];
+	}
+	bool written = fwrite(&bgra[0], 1, bgra.size(), file) == bgra.size();
+	fclose(file);
+	return written;
+}
+
+// Split every level down to a single page into bordered tiles, borders clamped at the texture edge
+static int WriteVirtualTiles(const std::vector<FloatImage>& chain, bool srgb, const char* directory, int pageSize, int border, ThreadPool* pool)
+{
+	int size = chain[0].width;
+	int pages = pageSize > 0 ? size / pageSize : 0;
+	if (chain[0].height != size || pages <= 0 || pages * pageSize != size || (pages & (pages - 1)) != 0 || pages > 256)
+	{
+		printf("Virtual textures must be square, a power of two multiple of the page size and at most 256 pages across\n");
+		return 1;
+	}
+
+	if (!MakeDirectory(directory))
+	{
+		printf("Failed to create %s\n", directory);
+		return 1;
+	}
+
+	int slotSize = pageSize + border * 2;
+	uint32_t levelCount = 0;
+	unsigned int tileCount = 0;
+	// Set by any worker whose tile could not be written
+	std::atomic<bool> failed(false);
+
+	for (int level = 0; (pages >> level) > 0; level++)
+	{
+		std::vector<unsigned char> rgba;
+		ImageToRGBA8(chain[level], srgb, rgba);
+		int levelSize = chain[level].width;
+		int levelPages = pages >> level;
+
+		pool->ParallelFor((size_t)levelPages * levelPages, 1, [&](size_t begin, size_t end)
+		{
+			std::vector<unsigned char> tile((size_t)slotSize * slotSize * 4);
+			for (size_t t = begin; t < end; t++)
+			{
+				int pageX = (int)(t % levelPages);
+				int pageY = (int)(t / levelPages);
+				for (int py = 0; py < slotSize; py++)
+				{
+					int sy = pageY * pageSize - border + py;
+					sy = sy < 0 ? 0 : (sy >= levelSize ? levelSize - 1 : sy);
+					for (int px = 0; px < slotSize; px++)
+					{
+						int sx = pageX * pageSize - border + px;
+						sx = sx < 0 ? 0 : (sx >= levelSize ? levelSize - 1 : sx);
+						memcpy(&tile[((size_t)py * slotSize + px) * 4], &rgba[((size_t)sy * levelSize + sx) * 4], 4);
+					}
+				}
+
+				char path[1024];
+				snprintf(path, sizeof(path), "%s/%d_%d_%d.tga", directory, level, pageX, pageY);
+				if (!WriteTile(path, &tile[0], slotSize))
+				{
+					printf("Failed to write %s\n", path);
+					failed = true;
+				}
+			}
+		});
+
+		levelCount++;
+		tileCount += levelPages * levelPages;
+	}
+
+	if (failed)
+	{
+		return 1;
+	}
+
+	VirtualTextureHeader header;
+	memcpy(header.identifier, virtualTextureIdentifier, sizeof(header.identifier));
+	header.version = virtualTextureVersion;
+	header.flags = srgb ? VIRTUAL_FLAG_SRGB : 0;
+	header.virtualSize = size;
+	header.pageSize = pageSize;
+	header.border = border;
+	header.levelCount = levelCount;
+
+	std::string headerPath = std::string(directory) + "/" + virtualTextureHeaderName;
+	FILE* file = fopen(headerPath.c_str(), "wb");
+	if (!file)
+	{
+		printf("Failed to open %s for writing\n", headerPath.c_str());
+		return 1;
+	}
+	fwrite(&header, sizeof(header), 1, file);
+	fclose(file);
+
+	printf("Cooked %s: %dx%d virtual texture, %u levels, %u pages of %d texels\n", directory, size, size, levelCount, tileCount, pageSize);
+	return 0;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		printf("Usage: TextureCooker <input> <output> [--format bc1|bc3|bc5|bc7|etc2] [--srgb] [--filter box|kaiser] [--vt-tiles <page size>] [--vt-border <texels>]\n");
+		return 1;
+	}
+
+	const char* inputPath = argv[1];
+	const char* outputPath = argv[2];
+	uint32_t encoding = COOKED_BC7;
+	bool srgb = false;
+	MipFilter filter = MIP_FILTER_KAISER;
+	int tilePageSize = 0;
+	int tileBorder = 4;
+
+	for (int i = 3; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+
+		if (strcmp(argv[i], "--srgb") == 0)
+		{
+			srgb = true;
+		}
+		else if (!hasValue)
+		{
+			printf("Missing value for %s\n", argv[i]);
+		}
+		else if (strcmp(argv[i], "--format") == 0)
+		{
+			encoding = ParseEncoding(argv[++i]);
+			if (!encoding)
+			{
+				printf("Unknown format %s\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--filter") == 0)
+		{
+			filter = strcmp(argv[++i], "box") == 0 ? MIP_FILTER_BOX : MIP_FILTER_KAISER;
+		}
+		else if (strcmp(argv[i], "--vt-tiles") == 0)
+		{
+			tilePageSize = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--vt-border") == 0)
+		{
+			tileBorder = atoi(argv[++i]);
+		}
+	}
+
+	// BC5 stores data (normals), never colour
+	if (encoding == COOKED_BC5)
+	{
+		srgb = false;
+	}
+
+	// Match the runtime loaders, GL expects the first row at the bottom
+	stbi_set_flip_vertically_on_load(1);
+
+	int width, height, sourceChannels;
+	unsigned char* pixels = stbi_load(inputPath, &width, &height, &sourceChannels, 4);
+	if (!pixels)
+	{
+		printf("Failed to load %s: %s\n", inputPath, stbi_failure_reason());
+		return 1;
+	}
+
+	FloatImage base = ImageFromRGBA8(pixels, width, height, srgb);
+	stbi_image_free(pixels);
+
+	ThreadPool pool;
+	pool.Start(0);
+
+	std::vector<FloatImage> chain = BuildMipChain(base, filter);
+
+	// Pages are uploaded uncompressed, the cache is filled one page at a time
+	if (tilePageSize > 0)
+	{
+		int result = WriteVirtualTiles(chain, srgb, outputPath, tilePageSize, tileBorder, &pool);
+		pool.Stop();
+		return result;
+	}
+
+	std::vector<std::vector<unsigned char>> levelData(chain.size());
+
+	for (size_t i = 0; i < chain.size(); i++)
+	{
+		std::vector<unsigned char> rgba;
+		ImageToRGBA8(chain[i], srgb, rgba);
+		EncodeImage(&rgba[0], chain[i].width, chain[i].height, encoding, &pool, levelData[i]);
+	}
+
+	pool.Stop();
+
+	CookedTextureHeader header;
+	memcpy(header.identifier, cookedTextureIdentifier, sizeof(header.identifier));
+	header.version = cookedTextureVersion;
+	header.encoding = encoding;
+	header.flags = srgb ? COOKED_FLAG_SRGB : 0;
+	header.width = width;
+	header.height = height;
+	header.levelCount = (uint32_t)chain.size();
+
+	std::vector<CookedTextureLevel> levels(chain.size());
+	uint64_t offset = sizeof(CookedTextureHeader) + sizeof(CookedTextureLevel) * levels.size();
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		offset = (offset + cookedTextureAlignment - 1) & ~(uint64_t)(cookedTextureAlignment - 1);
+		levels[i].byteOffset = offset;
+		levels[i].byteLength = levelData[i].size();
+		levels[i].width = chain[i].width;
+		levels[i].height = chain[i].height;
+		offset += levelData[i].size();
+	}
+
+	FILE* file = fopen(outputPath, "wb");
+	if (!file)
+	{
+		printf("Failed to open %s for writing\n", outputPath);
+		return 1;
+	}
+
+	fwrite(&header, sizeof(header), 1, file);
+	fwrite(&levels[0], sizeof(CookedTextureLevel), levels.size(), file);
+
+	static const unsigned char padding[16] = { 0 };
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		long position = ftell(file);
+		fwrite(padding, 1, (size_t)(levels[i].byteOffset - position), file);
+		fwrite(&levelData[i][0], 1, levelData[i].size(), file);
+	}
+
+	fclose(file);
+
+	printf("Cooked %s: %dx%d, %u levels, %llu bytes\n", outputPath, width, height, header.levelCount, (unsigned long long)offset);
+
+	return 0;
+}
@@ -0,0 +1,407 @@
+#include "UploadQueue.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Staging offsets are kept aligned for the copy source
+static const GLintptr stagingAlignment = 16;
+// Below this a copy is not worth handing to the worker pool
+static const size_t parallelCopyThreshold = 1024 * 1024;
+static const size_t parallelCopyGrain = 256 * 1024;
+
+UploadQueue::UploadQueue()
+{
+	stagingSize = 0;
+	currentStaging = 0;
+	inFlightCount = 0;
+	workerPool = NULL;
+}
+
+void UploadQueue::Initialise(GLsizeiptr stagingBufferSize, unsigned int stagingBufferCount)
+{
+	stagingSize = stagingBufferSize;
+	stagingBuffers.resize(stagingBufferCount);
+
+	for (size_t i = 0; i < stagingBuffers.size(); i++)
+	{
+		glGenBuffers(1, &stagingBuffers[i].buffer);
+		glBindBuffer(GL_COPY_READ_BUFFER, stagingBuffers[i].buffer);
+		glBufferData(GL_COPY_READ_BUFFER, stagingSize, NULL, GL_STREAM_DRAW);
+		stagingBuffers[i].fence = 0;
+	}
+
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	currentStaging = 0;
+}
+
+void UploadQueue::QueueBufferUpload(GLuint buffer, GLintptr offset, std::vector<unsigned char>& data, std::function<void()> onComplete)
+{
+	std::shared_ptr<UploadRequest> request = std::make_shared<UploadRequest>();
+	request->isTexture = false;
+	request->data.swap(data);
+	request->source = request->data.empty() ? NULL : &request->data[0];
+	request->sourceSize = request->data.size();
+	request->bytesSubmitted = 0;
+	request->onComplete = onComplete;
+	request->buffer = buffer;
+	request->offset = offset;
+	request->texture = NULL;
+	request->stagingTexture = 0;
+
+	std::lock_guard<std::mutex> lock(requestMutex);
+	requests.push_back(request);
+}
+
+void UploadQueue::QueueBufferUpload(GLuint buffer, GLintptr offset, const void* source, size_t size, std::shared_ptr<void> sourceOwner, std::function<void()> onComplete)
+{
+	std::shared_ptr<UploadRequest> request = std::make_shared<UploadRequest>();
+	request->isTexture = false;
+	request->source = (const unsigned char*)source;
+	request->sourceSize = size;
+	request->sourceOwner = sourceOwner;
+	request->bytesSubmitted = 0;
+	request->onComplete = onComplete;
+	request->buffer = buffer;
+	request->offset = offset;
+	request->texture = NULL;
+	request->stagingTexture = 0;
+
+	std::lock_guard<std::mutex> lock(requestMutex);
+	requests.push_back(request);
+}
+
+void UploadQueue::QueueTextureUpload(Texture* texture, std::vector<unsigned char>& pixels, int width, int height, int channels, bool srgb, bool generateMips, std::function<void()> onComplete)
+{
+	std::shared_ptr<UploadRequest> request = std::make_shared<UploadRequest>();
+	request->isTexture = true;
+	request->data.swap(pixels);
+	request->source = request->data.empty() ? NULL : &request->data[0];
+	request->sourceSize = request->data.size();
+	request->bytesSubmitted = 0;
+	request->onComplete = onComplete;
+	request->buffer = 0;
+	request->offset = 0;
+	request->texture = texture;
+	request->stagingTexture = 0;
+	request->width = width;
+	request->height = height;
+	request->channels = channels;
+	request->srgb = srgb;
+	request->generateMips = generateMips;
+	request->immutable = false;
+	request->levels = generateMips ? Texture::CalculateMipLevels(width, height) : 1;
+	request->internalFormat = Texture::ChooseInternalFormat(channels, srgb);
+	request->levelOffsets.push_back(0);
+	request->levelOffsets.push_back(request->sourceSize);
+
+	std::lock_guard<std::mutex> lock(requestMutex);
+	requests.push_back(request);
+}
+
+void UploadQueue::QueueTextureUpload(Texture* texture, std::vector<unsigned char>& chain, const std::vector<size_t>& levelOffsets, int width, int height, bool srgb, std::function<void()> onComplete)
+{
+	std::shared_ptr<UploadRequest> request = std::make_shared<UploadRequest>();
+	request->isTexture = true;
+	request->data.swap(chain);
+	request->source = request->data.empty() ? NULL : &request->data[0];
+	request->sourceSize = request->data.size();
+	request->bytesSubmitted = 0;
+	request->onComplete = onComplete;
+	request->buffer = 0;
+	request->offset = 0;
+	request->texture = texture;
+	request->stagingTexture = 0;
+	request->width = width;
+	request->height = height;
+	request->channels = 4;
+	request->srgb = srgb;
+	request->generateMips = false;
+	request->immutable = false;
+	request->levels = (GLsizei)levelOffsets.size() - 1;
+	request->internalFormat = Texture::ChooseInternalFormat(4, srgb);
+	request->levelOffsets = levelOffsets;
+
+	std::lock_guard<std::mutex> lock(requestMutex);
+	requests.push_back(request);
+}
+
+void UploadQueue::Process(GLsizeiptr budgetBytes)
+{
+	RetireCompleted(false);
+
+	GLsizeiptr budgetRemaining = budgetBytes;
+	for (size_t attempt = 0; attempt < stagingBuffers.size() && budgetRemaining > 0; attempt++)
+	{
+		StagingBuffer& staging = stagingBuffers[currentStaging];
+
+		// Still being read by the GPU, try again next frame rather than stall
+		if (staging.fence)
+		{
+			break;
+		}
+
+		std::vector<StagingCopy> copies;
+		GLintptr stagingOffset = 0;
+		unsigned char* mapped = NULL;
+
+		while (stagingOffset < stagingSize && budgetRemaining > 0)
+		{
+			std::shared_ptr<UploadRequest> request;
+			{
+				std::lock_guard<std::mutex> lock(requestMutex);
+				if (requests.empty())
+				{
+					break;
+				}
+				request = requests.front();
+			}
+
+			size_t remaining = request->sourceSize - request->bytesSubmitted;
+			size_t space = (size_t)(stagingSize - stagingOffset);
+			size_t chunk = remaining < space ? remaining : space;
+
+			// The budget may be exceeded by the first chunk of a frame so progress is always made
+			if (stagingOffset > 0 && chunk > (size_t)budgetRemaining)
+			{
+				chunk = (size_t)budgetRemaining;
+			}
+
+			if (request->isTexture)
+			{
+				// Textures are streamed in whole rows of one level at a time
+				GLint level = FindLevel(*request, request->bytesSubmitted);
+				size_t levelEnd = request->levelOffsets[level + 1] - request->bytesSubmitted;
+				chunk = chunk < levelEnd ? chunk : levelEnd;
+
+				int levelWidth = request->width >> level > 0 ? request->width >> level : 1;
+				size_t rowSize = (size_t)levelWidth * request->channels;
+				if (rowSize > (size_t)stagingSize)
+				{
+					printf("Texture rows of %u bytes do not fit in the %u byte staging buffers!\n", (unsigned int)rowSize, (unsigned int)stagingSize);
+					std::lock_guard<std::mutex> lock(requestMutex);
+					requests.pop_front();
+					continue;
+				}
+				chunk -= chunk % rowSize;
+			}
+
+			if (chunk == 0)
+			{
+				break;
+			}
+
+			if (!mapped)
+			{
+				glBindBuffer(GL_COPY_WRITE_BUFFER, staging.buffer);
+				mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, stagingSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+				if (!mapped)
+				{
+					printf("Failed to map staging buffer!\n");
+					glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+					return;
+				}
+			}
+
+			CopyToStaging(mapped + stagingOffset, request->source + request->bytesSubmitted, chunk);
+
+			StagingCopy copy;
+			copy.request = request;
+			copy.stagingOffset = stagingOffset;
+			copy.dataOffset = request->bytesSubmitted;
+			copy.size = chunk;
+			copies.push_back(copy);
+
+			request->bytesSubmitted += chunk;
+			budgetRemaining -= (GLsizeiptr)chunk;
+			stagingOffset += ((GLintptr)chunk + stagingAlignment - 1) & ~(stagingAlignment - 1);
+
+			if (request->bytesSubmitted == request->sourceSize)
+			{
+				staging.retiring.push_back(request);
+
+				std::lock_guard<std::mutex> lock(requestMutex);
+				requests.pop_front();
+				inFlightCount++;
+			}
+		}
+
+		if (!mapped)
+		{
+			break;
+		}
+
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+		for (size_t i = 0; i < copies.size(); i++)
+		{
+			glBindBuffer(GL_COPY_READ_BUFFER, staging.buffer);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.buffer);
+			IssueCopy(copies[i]);
+		}
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+		staging.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		currentStaging = (currentStaging + 1) % stagingBuffers.size();
+	}
+}
+
+void UploadQueue::CopyToStaging(unsigned char* destination, const unsigned char* source, size_t size)
+{
+	if (!workerPool || size < parallelCopyThreshold)
+	{
+		memcpy(destination, source, size);
+		return;
+	}
+
+	workerPool->ParallelFor(size, parallelCopyGrain, [destination, source](size_t begin, size_t end)
+	{
+		memcpy(destination + begin, source + begin, end - begin);
+	});
+}
+
+void UploadQueue::IssueCopy(const StagingCopy& copy)
+{
+	UploadRequest& request = *copy.request;
+
+	if (!request.isTexture)
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, request.buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, copy.stagingOffset, request.offset + copy.dataOffset, copy.size);
+		return;
+	}
+
+	// The destination is a fresh texture so the old contents stay visible until the upload completes
+	if (request.stagingTexture == 0)
+	{
+		request.stagingTexture = Texture::CreateStorage(request.width, request.height, request.levels, request.internalFormat, request.channels, request.immutable);
+	}
+
+	GLint level = FindLevel(request, copy.dataOffset);
+	int levelWidth = request.width >> level > 0 ? request.width >> level : 1;
+	size_t rowSize = (size_t)levelWidth * request.channels;
+
+	glBindTexture(GL_TEXTURE_2D, request.stagingTexture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, level, 0, (GLint)((copy.dataOffset - request.levelOffsets[level]) / rowSize), levelWidth, (GLsizei)(copy.size / rowSize),
+		Texture::ChoosePixelFormat(request.channels), GL_UNSIGNED_BYTE, (void*)copy.stagingOffset);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+GLint UploadQueue::FindLevel(const UploadRequest& request, size_t dataOffset)
+{
+	GLint level = 0;
+	while (level + 2 < (GLint)request.levelOffsets.size() && dataOffset >= request.levelOffsets[level + 1])
+	{
+		level++;
+	}
+	return level;
+}
+
+void UploadQueue::RetireCompleted(bool wait)
+{
+	for (size_t i = 0; i < stagingBuffers.size(); i++)
+	{
+		StagingBuffer& staging = stagingBuffers[i];
+		if (!staging.fence)
+		{
+			continue;
+		}
+
+		GLenum result = glClientWaitSync(staging.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000 : 0);
+		if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+		{
+			continue;
+		}
+
+		glDeleteSync(staging.fence);
+		staging.fence = 0;
+
+		for (size_t j = 0; j < staging.retiring.size(); j++)
+		{
+			FinishRequest(*staging.retiring[j]);
+			inFlightCount--;
+		}
+		staging.retiring.clear();
+	}
+}
+
+void UploadQueue::FinishRequest(UploadRequest& request)
+{
+	if (request.isTexture && request.stagingTexture != 0)
+	{
+		if (request.generateMips && request.levels > 1)
+		{
+			glBindTexture(GL_TEXTURE_2D, request.stagingTexture);
+			glGenerateMipmap(GL_TEXTURE_2D);
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+
+		request.texture->AdoptStorage(request.stagingTexture, request.width, request.height, request.channels, request.levels, request.internalFormat, request.immutable);
+		request.stagingTexture = 0;
+	}
+
+	std::vector<unsigned char>().swap(request.data);
+	request.source = NULL;
+	request.sourceOwner.reset();
+
+	if (request.onComplete)
+	{
+		request.onComplete();
+	}
+}
+
+unsigned int UploadQueue::GetPendingCount()
+{
+	std::lock_guard<std::mutex> lock(requestMutex);
+	return (unsigned int)requests.size() + inFlightCount;
+}
+
+void UploadQueue::ClearUploadQueue()
+{
+	RetireCompleted(true);
+
+	// Copies whose fence timed out are dropped like queued requests, without completing them
+	for (size_t i = 0; i < stagingBuffers.size(); i++)
+	{
+		StagingBuffer& staging = stagingBuffers[i];
+		if (staging.fence)
+		{
+			glDeleteSync(staging.fence);
+		}
+		for (size_t j = 0; j < staging.retiring.size(); j++)
+		{
+			UploadRequest& request = *staging.retiring[j];
+			if (request.stagingTexture != 0)
+			{
+				glDeleteTextures(1, &request.stagingTexture);
+				request.stagingTexture = 0;
+			}
+			std::vector<unsigned char>().swap(request.data);
+			request.source = NULL;
+			request.sourceOwner.reset();
+		}
+		staging.retiring.clear();
+		glDeleteBuffers(1, &staging.buffer);
+	}
+	stagingBuffers.clear();
+
+	std::lock_guard<std::mutex> lock(requestMutex);
+	for (size_t i = 0; i < requests.size(); i++)
+	{
+		if (requests[i]->stagingTexture != 0)
+		{
+			glDeleteTextures(1, &requests[i]->stagingTexture);
+		}
+	}
+	requests.clear();
+	inFlightCount = 0;
+}
+
+UploadQueue::~UploadQueue()
+{
+}
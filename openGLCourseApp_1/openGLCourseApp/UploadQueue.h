@@ -0,0 +1,106 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <functional>
+
+#include <GL\glew.h>
+
+#include "Texture.h"
+#include "ThreadPool.h"
+
+// Streams buffer and texture data to the GPU through a ring of staging buffers. Payloads are copied
+// into mapped staging memory a budget's worth at a time and then moved with glCopyBufferSubData or
+// glTexSubImage2D from the bound pixel unpack buffer, so large uploads spread over several frames.
+// Each staging buffer is fenced and only reused once the GPU has consumed it.
+class UploadQueue
+{
+public:
+	UploadQueue();
+
+	// GL thread
+	void Initialise(GLsizeiptr stagingBufferSize, unsigned int stagingBufferCount);
+
+	// Large staging copies are split across the pool's workers
+	void SetWorkerPool(ThreadPool* pool) { workerPool = pool; }
+
+	// Any thread. The destination buffer must already have storage for offset + data.size() bytes.
+	void QueueBufferUpload(GLuint buffer, GLintptr offset, std::vector<unsigned char>& data, std::function<void()> onComplete);
+	// Any thread. Streams straight from source without taking a copy, sourceOwner (a mapped file) is held
+	// until the upload completes.
+	void QueueBufferUpload(GLuint buffer, GLintptr offset, const void* source, size_t size, std::shared_ptr<void> sourceOwner, std::function<void()> onComplete);
+	// Any thread. The pixels are streamed into a new texture that replaces the current one once complete.
+	void QueueTextureUpload(Texture* texture, std::vector<unsigned char>& pixels, int width, int height, int channels, bool srgb, bool generateMips, std::function<void()> onComplete);
+	// Any thread. An RGBA8 chain from MipGenerator, every level is streamed so no glGenerateMipmap is needed.
+	void QueueTextureUpload(Texture* texture, std::vector<unsigned char>& chain, const std::vector<size_t>& levelOffsets, int width, int height, bool srgb, std::function<void()> onComplete);
+
+	// GL thread: retire finished uploads and copy up to budgetBytes of new data, never blocks on the GPU
+	void Process(GLsizeiptr budgetBytes);
+
+	unsigned int GetPendingCount();
+
+	// GL thread: wait for everything in flight and release the staging buffers
+	void ClearUploadQueue();
+
+	~UploadQueue();
+
+private:
+	struct UploadRequest
+	{
+		bool isTexture;
+		std::vector<unsigned char> data;
+		// What is streamed, data itself unless the request reads from memory kept alive by sourceOwner
+		const unsigned char* source;
+		size_t sourceSize;
+		std::shared_ptr<void> sourceOwner;
+		size_t bytesSubmitted;
+		std::function<void()> onComplete;
+
+		// Buffer uploads
+		GLuint buffer;
+		GLintptr offset;
+
+		// Texture uploads
+		Texture* texture;
+		GLuint stagingTexture;
+		int width, height, channels;
+		bool srgb, generateMips, immutable;
+		GLsizei levels;
+		GLenum internalFormat;
+		// Start of each level in data, plus the end
+		std::vector<size_t> levelOffsets;
+	};
+
+	struct StagingBuffer
+	{
+		GLuint buffer;
+		GLsync fence;
+		std::vector<std::shared_ptr<UploadRequest>> retiring;
+	};
+
+	struct StagingCopy
+	{
+		std::shared_ptr<UploadRequest> request;
+		GLintptr stagingOffset;
+		size_t dataOffset;
+		size_t size;
+	};
+
+	std::vector<StagingBuffer> stagingBuffers;
+	GLsizeiptr stagingSize;
+	unsigned int currentStaging;
+
+	std::mutex requestMutex;
+	std::deque<std::shared_ptr<UploadRequest>> requests;
+	unsigned int inFlightCount;
+
+	ThreadPool* workerPool;
+
+	void RetireCompleted(bool wait);
+	void FinishRequest(UploadRequest& request);
+	void CopyToStaging(unsigned char* destination, const unsigned char* source, size_t size);
+	void IssueCopy(const StagingCopy& copy);
+	static GLint FindLevel(const UploadRequest& request, size_t dataOffset);
+};
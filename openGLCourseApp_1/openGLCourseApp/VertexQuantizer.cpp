@@ -0,0 +1,190 @@
+#include "VertexQuantizer.h"
+
+#include <math.h>
+#include <string.h>
+#include <chrono>
+
+// Largest value of a 16-bit unsigned normalized component
+static const float positionSteps = 65535.0f;
+
+void VertexQuantizer::QuantizeVertices(const float* vertices, size_t vertexCount, unsigned int floatsPerVertex, const float* boundsMin, const float* boundsMax, std::vector<QuantizedVertex>& quantized, VertexQuantizeStats& stats)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	stats.maxPositionError = 0.0f;
+	stats.maxUvError = 0.0f;
+	stats.bytesBefore = sizeof(float) * floatsPerVertex * vertexCount;
+	stats.bytesAfter = sizeof(QuantizedVertex) * vertexCount;
+
+	float scale[3], offset[3], inverse[3];
+	GetPositionTransform(boundsMin, boundsMax, scale, offset);
+	for (int axis = 0; axis < 3; axis++)
+	{
+		// A flat axis stores zeros and dequantizes to the offset exactly
+		inverse[axis] = scale[axis] > 0.0f ? positionSteps / scale[axis] : 0.0f;
+	}
+
+	quantized.resize(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		const float* vertex = vertices + v * floatsPerVertex;
+		QuantizedVertex& output = quantized[v];
+
+		float errorSquared = 0.0f;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float value = (vertex[axis] - offset[axis]) * inverse[axis];
+			value = value < 0.0f ? 0.0f : (value > positionSteps ? positionSteps : value);
+			output.position[axis] = (uint16_t)(value + 0.5f);
+
+			// Measured the way the shader reconstructs it
+			float error = (output.position[axis] / positionSteps) * scale[axis] + offset[axis] - vertex[axis];
+			errorSquared += error * error;
+		}
+		output.reserved = 0;
+
+		float positionError = sqrtf(errorSquared);
+		stats.maxPositionError = positionError > stats.maxPositionError ? positionError : stats.maxPositionError;
+
+		for (int c = 0; c < 2; c++)
+		{
+			output.uv[c] = FloatToHalf(vertex[3 + c]);
+			float uvError = fabsf(HalfToFloat(output.uv[c]) - vertex[3 + c]);
+			stats.maxUvError = uvError > stats.maxUvError ? uvError : stats.maxUvError;
+		}
+	}
+
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void VertexQuantizer::DequantizeVertices(const QuantizedVertex* quantized, size_t vertexCount, const float* boundsMin, const float* boundsMax, std::vector<float>& vertices)
+{
+	float scale[3], offset[3];
+	GetPositionTransform(boundsMin, boundsMax, scale, offset);
+
+	vertices.resize(vertexCount * 5);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		float* vertex = &vertices[v * 5];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			vertex[axis] = (quantized[v].position[axis] / positionSteps) * scale[axis] + offset[axis];
+		}
+		vertex[3] = HalfToFloat(quantized[v].uv[0]);
+		vertex[4] = HalfToFloat(quantized[v].uv[1]);
+	}
+}
+
+void VertexQuantizer::GetPositionTransform(const float* boundsMin, const float* boundsMax, float* scale, float* offset)
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		scale[axis] = boundsMax[axis] > boundsMin[axis] ? boundsMax[axis] - boundsMin[axis] : 0.0f;
+		offset[axis] = boundsMin[axis];
+	}
+}
+
+void VertexQuantizer::EncodeOctahedral(const float* normal, unsigned int bits, int16_t* encoded)
+{
+	// Project onto the octahedron |x| + |y| + |z| = 1, then fold the lower half over the upper one
+	float length = fabsf(normal[0]) + fabsf(normal[1]) + fabsf(normal[2]);
+	float x = length > 0.0f ? normal[0] / length : 0.0f;
+	float y = length > 0.0f ? normal[1] / length : 0.0f;
+	if (normal[2] < 0.0f)
+	{
+		float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	float steps = (float)((1 << (bits - 1)) - 1);
+	encoded[0] = (int16_t)floorf(x * steps + 0.5f);
+	encoded[1] = (int16_t)floorf(y * steps + 0.5f);
+}
+
+void VertexQuantizer::DecodeOctahedral(const int16_t* encoded, unsigned int bits, float* normal)
+{
+	float steps = (float)((1 << (bits - 1)) - 1);
+	float x = encoded[0] / steps;
+	float y = encoded[1] / steps;
+	float z = 1.0f - fabsf(x) - fabsf(y);
+	if (z < 0.0f)
+	{
+		float unfoldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float unfoldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = unfoldedX;
+		y = unfoldedY;
+	}
+
+	float length = sqrtf(x * x + y * y + z * z);
+	normal[0] = x / length;
+	normal[1] = y / length;
+	normal[2] = z / length;
+}
+
+uint16_t VertexQuantizer::FloatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+	uint32_t magnitude = bits & 0x7FFFFFFF;
+
+	if (magnitude > 0x7F800000)
+	{
+		return sign | 0x7E00;
+	}
+	// 65520 and up would round past 65504
+	if (magnitude >= 0x477FF000)
+	{
+		return sign | 0x7BFF;
+	}
+
+	uint32_t half, remainder, halfway;
+	if (magnitude < 0x38800000)
+	{
+		// Below the smallest normal half, the 24-bit mantissa shifted into a denormal
+		uint32_t shift = 126 - (magnitude >> 23);
+		if (shift > 24)
+		{
+			return sign;
+		}
+		uint32_t mantissa = (magnitude & 0x7FFFFF) | 0x800000;
+		half = mantissa >> shift;
+		remainder = mantissa & ((1u << shift) - 1);
+		halfway = 1u << (shift - 1);
+	}
+	else
+	{
+		// Rebias the exponent from 127 to 15 and drop 13 mantissa bits, a carry rolls into the exponent
+		half = (magnitude - 0x38000000) >> 13;
+		remainder = magnitude & 0x1FFF;
+		halfway = 0x1000;
+	}
+
+	if (remainder > halfway || (remainder == halfway && (half & 1)))
+	{
+		half++;
+	}
+	return sign | (uint16_t)half;
+}
+
+float VertexQuantizer::HalfToFloat(uint16_t value)
+{
+	float sign = value & 0x8000 ? -1.0f : 1.0f;
+	uint32_t exponent = (value >> 10) & 0x1F;
+	uint32_t mantissa = value & 0x3FF;
+
+	if (exponent == 0)
+	{
+		return sign * ldexpf((float)mantissa, -24);
+	}
+	if (exponent == 31)
+	{
+		return mantissa ? NAN : sign * INFINITY;
+	}
+
+	uint32_t bits = ((uint32_t)(value & 0x8000) << 16) | ((exponent + 112) << 23) | (mantissa << 13);
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "MeshFormat.h"
+
+struct VertexQuantizeStats
+{
+	double milliseconds;
+	// Largest distance between a position and its dequantized value, in object units
+	float maxPositionError;
+	// Largest texture coordinate difference after the round trip through half floats
+	float maxUvError;
+	size_t bytesBefore, bytesAfter;
+};
+
+// Smaller vertex formats for meshes whose precision needs are known. Positions become 16-bit normalized values
+// spanning the mesh bounds, which the vertex shader scales back with a per-mesh transform, texture coordinates
+// become half floats and unit vectors are stored octahedrally (Cigolle et al., "A Survey of Efficient
+// Representations for Independent Unit Vectors").
+class VertexQuantizer
+{
+public:
+	// Interleaved vertices with the position in the first three floats and the texture coordinate in the next two
+	static void QuantizeVertices(const float* vertices, size_t vertexCount, unsigned int floatsPerVertex, const float* boundsMin, const float* boundsMax, std::vector<QuantizedVertex>& quantized, VertexQuantizeStats& stats);
+	// Back to x, y, z, u, v floats for consumers that only read those
+	static void DequantizeVertices(const QuantizedVertex* quantized, size_t vertexCount, const float* boundsMin, const float* boundsMax, std::vector<float>& vertices);
+	// What the shader applies to the normalized position, position * scale + offset
+	static void GetPositionTransform(const float* boundsMin, const float* boundsMax, float* scale, float* offset);
+
+	// A unit vector as two signed normalized values of bits bits each (8 or 16), as GL_BYTE or GL_SHORT
+	static void EncodeOctahedral(const float* normal, unsigned int bits, int16_t* encoded);
+	static void DecodeOctahedral(const int16_t* encoded, unsigned int bits, float* normal);
+
+	// IEEE half floats, rounded to nearest even and clamped to the largest finite half
+	static uint16_t FloatToHalf(float value);
+	static float HalfToFloat(uint16_t value);
+};
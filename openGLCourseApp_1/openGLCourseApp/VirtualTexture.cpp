@@ -0,0 +1,663 @@
+#include "VirtualTexture.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+#include "stb_image.h"
+
+#include "VirtualTextureFormat.h"
+#include "Texture.h"
+
+// The feedback target is this many times smaller than the screen on each side
+static const int feedbackDivisor = 8;
+
+// Read backs in flight, a frame's feedback is normally consumed two frames later
+static const int feedbackBufferCount = 3;
+
+// Pages requested this recently keep their slot, the GPU may still be sampling them
+static const unsigned int slotProtectionFrames = 2;
+
+VirtualTexture::VirtualTexture()
+{
+	workerPool = NULL;
+	useTiles = false;
+	srgb = true;
+
+	virtualSize = 0;
+	pageSize = 0;
+	border = 0;
+	levelCount = 0;
+	pagesPerSide = 0;
+	cachePagesPerSide = 0;
+	slotSize = 0;
+
+	cacheTexture = 0;
+	pageTableTexture = 0;
+	feedbackFramebuffer = 0;
+	feedbackColour = 0;
+	feedbackDepth = 0;
+	feedbackWidth = 0;
+	feedbackHeight = 0;
+	memset(savedViewport, 0, sizeof(savedViewport));
+
+	uploadBudget = 8;
+	maxPending = 32;
+	currentFrame = 0;
+	pageTableDirty = false;
+
+	memset(&stats, 0, sizeof(stats));
+}
+
+bool VirtualTexture::ReadTileHeader(const char* directory)
+{
+	std::string location = std::string(directory) + "/" + virtualTextureHeaderName;
+	FILE* file = fopen(location.c_str(), "rb");
+	if (!file)
+	{
+		return false;
+	}
+
+	VirtualTextureHeader header;
+	size_t read = fread(&header, sizeof(header), 1, file);
+	fclose(file);
+
+	if (read != 1 || memcmp(header.identifier, virtualTextureIdentifier, sizeof(header.identifier)) != 0 || header.version != virtualTextureVersion)
+	{
+		printf("Invalid virtual texture header: %s\n", location.c_str());
+		return false;
+	}
+
+	virtualSize = (int)header.virtualSize;
+	pageSize = (int)header.pageSize;
+	border = (int)header.border;
+	srgb = (header.flags & VIRTUAL_FLAG_SRGB) != 0;
+	return true;
+}
+
+bool VirtualTexture::CreateVirtualTexture(ThreadPool* pool, const char* newTileDirectory, int newVirtualSize, int newPageSize, int newBorder, int newCachePagesPerSide)
+{
+	ClearVirtualTexture();
+
+	workerPool = pool;
+	virtualSize = newVirtualSize;
+	pageSize = newPageSize;
+	border = newBorder;
+	srgb = true;
+
+	useTiles = newTileDirectory && ReadTileHeader(newTileDirectory);
+	if (useTiles)
+	{
+		tileDirectory = newTileDirectory;
+	}
+	else
+	{
+		printf("No virtual texture tiles%s%s, generating debug pages\n", newTileDirectory ? " in " : "", newTileDirectory ? newTileDirectory : "");
+	}
+
+	// Page and slot coordinates travel through 8-bit feedback and page table channels
+	pagesPerSide = pageSize > 0 ? virtualSize / pageSize : 0;
+	if (pagesPerSide <= 0 || pagesPerSide * pageSize != virtualSize || (pagesPerSide & (pagesPerSide - 1)) != 0 || pagesPerSide > 256)
+	{
+		printf("Virtual texture size %d must be a power of two multiple of the page size %d, at most 256 pages across\n", virtualSize, pageSize);
+		return false;
+	}
+	if (newCachePagesPerSide <= 0 || newCachePagesPerSide > 256)
+	{
+		printf("Virtual texture cache must be 1 to 256 pages across\n");
+		return false;
+	}
+
+	levelCount = 1;
+	while ((pagesPerSide >> (levelCount - 1)) > 1)
+	{
+		levelCount++;
+	}
+
+	cachePagesPerSide = newCachePagesPerSide;
+	slotSize = pageSize + border * 2;
+	GLsizei cacheSize = slotSize * cachePagesPerSide;
+
+	GLenum cacheFormat = Texture::ChooseInternalFormat(4, srgb);
+	glGenTextures(1, &cacheTexture);
+	glBindTexture(GL_TEXTURE_2D, cacheTexture);
+	if (GLEW_VERSION_4_2 || GLEW_ARB_texture_storage)
+	{
+		glTexStorage2D(GL_TEXTURE_2D, 1, cacheFormat, cacheSize, cacheSize);
+	}
+	else
+	{
+		glTexImage2D(GL_TEXTURE_2D, 0, cacheFormat, cacheSize, cacheSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+	// Entries are looked up, never blended
+	glGenTextures(1, &pageTableTexture);
+	glBindTexture(GL_TEXTURE_2D, pageTableTexture);
+	if (GLEW_VERSION_4_2 || GLEW_ARB_texture_storage)
+	{
+		glTexStorage2D(GL_TEXTURE_2D, levelCount, GL_RGBA8, pagesPerSide, pagesPerSide);
+	}
+	else
+	{
+		for (int level = 0; level < levelCount; level++)
+		{
+			glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, pagesPerSide >> level, pagesPerSide >> level, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		}
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	pageTableData.resize(levelCount);
+	for (int level = 0; level < levelCount; level++)
+	{
+		int pages = pagesPerSide >> level;
+		pageTableData[level].assign((size_t)pages * pages * 4, 0);
+	}
+	pageTableDirty = true;
+
+	CacheSlot empty = { 0, 0, false };
+	slots.assign((size_t)cachePagesPerSide * cachePagesPerSide, empty);
+
+	feedbackBuffers.resize(feedbackBufferCount);
+	for (size_t i = 0; i < feedbackBuffers.size(); i++)
+	{
+		glGenBuffers(1, &feedbackBuffers[i].buffer);
+		feedbackBuffers[i].fence = 0;
+		feedbackBuffers[i].width = 0;
+		feedbackBuffers[i].height = 0;
+	}
+
+	// The single page of the last level covers everything and is never evicted, so every lookup has a fallback
+	RequestPage(PageKey(levelCount - 1, 0, 0));
+
+	std::lock_guard<std::mutex> lock(statsMutex);
+	memset(&stats, 0, sizeof(stats));
+	stats.virtualSize = virtualSize;
+	stats.cachePages = (unsigned int)slots.size();
+	return true;
+}
+
+void VirtualTexture::RequestPage(uint32_t page)
+{
+	pendingPages.insert(page);
+
+	workerPool->Enqueue([this, page]()
+	{
+		LoadedPage loaded;
+		loaded.page = page;
+		LoadPage(page, loaded.pixels);
+
+		std::lock_guard<std::mutex> lock(loadedMutex);
+		loadedPages.push_back(std::move(loaded));
+	});
+}
+
+void VirtualTexture::LoadPage(uint32_t page, std::vector<unsigned char>& pixels)
+{
+	if (useTiles)
+	{
+		int level = (int)(page >> 24);
+		int y = (int)((page >> 12) & 0xFFF);
+		int x = (int)(page & 0xFFF);
+
+		char location[512];
+		snprintf(location, sizeof(location), "%s/%d_%d_%d.tga", tileDirectory.c_str(), level, x, y);
+
+		int width, height, channels;
+		stbi_set_flip_vertically_on_load(1);
+		unsigned char* data = stbi_load(location, &width, &height, &channels, 4);
+		if (data && width == slotSize && height == slotSize)
+		{
+			pixels.assign(data, data + (size_t)slotSize * slotSize * 4);
+			stbi_image_free(data);
+			return;
+		}
+
+		printf("Failed to load page %s, generating it instead\n", location);
+		if (data)
+		{
+			stbi_image_free(data);
+		}
+	}
+
+	GeneratePage(page, pixels);
+}
+
+void VirtualTexture::GeneratePage(uint32_t page, std::vector<unsigned char>& pixels)
+{
+	int level = (int)(page >> 24);
+	int pageY = (int)((page >> 12) & 0xFFF);
+	int pageX = (int)(page & 0xFFF);
+	int levelSize = virtualSize >> level;
+
+	// A checkerboard tinted per level with the page edges outlined, the border clamped like the cooker's
+	static const unsigned char tints[8][3] = {
+		{ 230, 90, 70 }, { 240, 170, 60 }, { 220, 220, 80 }, { 110, 200, 90 },
+		{ 70, 190, 200 }, { 80, 120, 230 }, { 160, 100, 220 }, { 220, 110, 180 }
+	};
+	const unsigned char* tint = tints[level % 8];
+
+	pixels.resize((size_t)slotSize * slotSize * 4);
+	for (int py = 0; py < slotSize; py++)
+	{
+		int vy = std::min(std::max(pageY * pageSize - border + py, 0), levelSize - 1);
+		for (int px = 0; px < slotSize; px++)
+		{
+			int vx = std::min(std::max(pageX * pageSize - border + px, 0), levelSize - 1);
+
+			bool edge = vx % pageSize == 0 || vy % pageSize == 0;
+			bool odd = ((vx >> 4) + (vy >> 4)) & 1;
+			float shade = edge ? 0.25f : (odd ? 1.0f : 0.7f);
+
+			unsigned char* texel = &pixels[((size_t)py * slotSize + px) * 4];
+			texel[0] = (unsigned char)(tint[0] * shade);
+			texel[1] = (unsigned char)(tint[1] * shade);
+			texel[2] = (unsigned char)(tint[2] * shade);
+			texel[3] = 255;
+		}
+	}
+}
+
+void VirtualTexture::ReadFeedback(const unsigned char* pixels, size_t count)
+{
+	std::unordered_set<uint32_t> requested;
+	for (size_t i = 0; i < count; i++)
+	{
+		const unsigned char* texel = pixels + i * 4;
+		int level = texel[2];
+
+		// Cleared pixels have zero alpha
+		if (texel[3] == 0 || level >= levelCount || texel[0] >= (pagesPerSide >> level) || texel[1] >= (pagesPerSide >> level))
+		{
+			continue;
+		}
+		requested.insert(PageKey(level, texel[0], texel[1]));
+	}
+
+	// A page needs its ancestors resident as well, they are what is drawn while it loads
+	std::unordered_set<uint32_t> visited;
+	std::vector<uint32_t> missing;
+	for (std::unordered_set<uint32_t>::iterator it = requested.begin(); it != requested.end(); ++it)
+	{
+		int level = (int)(*it >> 24);
+		int y = (int)((*it >> 12) & 0xFFF);
+		int x = (int)(*it & 0xFFF);
+		for (; level < levelCount; level++, x >>= 1, y >>= 1)
+		{
+			uint32_t page = PageKey(level, x, y);
+			if (!visited.insert(page).second)
+			{
+				break;
+			}
+
+			std::unordered_map<uint32_t, int>::iterator resident = residentPages.find(page);
+			if (resident != residentPages.end())
+			{
+				slots[resident->second].lastUsedFrame = currentFrame;
+			}
+			else if (!pendingPages.count(page))
+			{
+				missing.push_back(page);
+			}
+		}
+	}
+
+	// Coarse pages first, one of them improves everything under it
+	std::sort(missing.begin(), missing.end(), [](uint32_t a, uint32_t b) { return (a >> 24) > (b >> 24); });
+	for (size_t i = 0; i < missing.size() && pendingPages.size() < maxPending; i++)
+	{
+		RequestPage(missing[i]);
+	}
+
+	std::lock_guard<std::mutex> lock(statsMutex);
+	stats.requestedPages = (unsigned int)requested.size();
+	stats.feedbackReads++;
+}
+
+int VirtualTexture::FindSlot()
+{
+	int oldest = -1;
+	for (size_t i = 0; i < slots.size(); i++)
+	{
+		const CacheSlot& slot = slots[i];
+		if (!slot.occupied)
+		{
+			return (int)i;
+		}
+
+		if ((int)(slot.page >> 24) == levelCount - 1 || slot.lastUsedFrame + slotProtectionFrames >= currentFrame)
+		{
+			continue;
+		}
+
+		if (oldest < 0 || slot.lastUsedFrame < slots[oldest].lastUsedFrame)
+		{
+			oldest = (int)i;
+		}
+	}
+	return oldest;
+}
+
+void VirtualTexture::UploadPages()
+{
+	unsigned int uploaded = 0;
+	unsigned int evicted = 0;
+
+	glBindTexture(GL_TEXTURE_2D, cacheTexture);
+
+	while (uploaded < uploadBudget)
+	{
+		LoadedPage loaded;
+		{
+			std::lock_guard<std::mutex> lock(loadedMutex);
+			if (loadedPages.empty())
+			{
+				break;
+			}
+			loaded = std::move(loadedPages.front());
+			loadedPages.pop_front();
+		}
+		pendingPages.erase(loaded.page);
+
+		if (residentPages.count(loaded.page))
+		{
+			continue;
+		}
+
+		// Every slot is in use by what is on screen, the page is requested again by a later feedback
+		int slotIndex = FindSlot();
+		if (slotIndex < 0)
+		{
+			continue;
+		}
+
+		CacheSlot& slot = slots[slotIndex];
+		if (slot.occupied)
+		{
+			residentPages.erase(slot.page);
+			evicted++;
+		}
+
+		glTexSubImage2D(GL_TEXTURE_2D, 0, (slotIndex % cachePagesPerSide) * slotSize, (slotIndex / cachePagesPerSide) * slotSize,
+			slotSize, slotSize, GL_RGBA, GL_UNSIGNED_BYTE, &loaded.pixels[0]);
+
+		slot.page = loaded.page;
+		slot.lastUsedFrame = currentFrame;
+		slot.occupied = true;
+		residentPages[loaded.page] = slotIndex;
+		pageTableDirty = true;
+		uploaded++;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	std::lock_guard<std::mutex> lock(statsMutex);
+	stats.pagesLoaded += uploaded;
+	stats.pagesEvicted += evicted;
+}
+
+void VirtualTexture::RefreshPageTable()
+{
+	glBindTexture(GL_TEXTURE_2D, pageTableTexture);
+
+	// Coarsest level first, so a missing page can take its parent's entry
+	for (int level = levelCount - 1; level >= 0; level--)
+	{
+		int pages = pagesPerSide >> level;
+		std::vector<unsigned char>& table = pageTableData[level];
+
+		for (int y = 0; y < pages; y++)
+		{
+			for (int x = 0; x < pages; x++)
+			{
+				unsigned char* entry = &table[((size_t)y * pages + x) * 4];
+				std::unordered_map<uint32_t, int>::iterator resident = residentPages.find(PageKey(level, x, y));
+				if (resident != residentPages.end())
+				{
+					entry[0] = (unsigned char)(resident->second % cachePagesPerSide);
+					entry[1] = (unsigned char)(resident->second / cachePagesPerSide);
+					entry[2] = (unsigned char)level;
+					entry[3] = 255;
+				}
+				else if (level + 1 < levelCount)
+				{
+					const unsigned char* parent = &pageTableData[level + 1][((size_t)(y / 2) * (pages / 2) + x / 2) * 4];
+					memcpy(entry, parent, 4);
+				}
+				else
+				{
+					memset(entry, 0, 4);
+				}
+			}
+		}
+
+		glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, pages, pages, GL_RGBA, GL_UNSIGNED_BYTE, &table[0]);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	pageTableDirty = false;
+}
+
+void VirtualTexture::Update(unsigned int frameNumber)
+{
+	if (cacheTexture == 0)
+	{
+		return;
+	}
+
+	currentFrame = frameNumber;
+
+	for (size_t i = 0; i < feedbackBuffers.size(); i++)
+	{
+		FeedbackBuffer& feedback = feedbackBuffers[i];
+		if (!feedback.fence)
+		{
+			continue;
+		}
+
+		GLenum result = glClientWaitSync(feedback.fence, 0, 0);
+		if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+		{
+			continue;
+		}
+		glDeleteSync(feedback.fence);
+		feedback.fence = 0;
+
+		size_t count = (size_t)feedback.width * feedback.height;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, feedback.buffer);
+		const unsigned char* pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, count * 4, GL_MAP_READ_BIT);
+		if (pixels)
+		{
+			ReadFeedback(pixels, count);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	UploadPages();
+
+	if (pageTableDirty)
+	{
+		RefreshPageTable();
+	}
+
+	std::lock_guard<std::mutex> lock(statsMutex);
+	stats.residentPages = (unsigned int)residentPages.size();
+	stats.pendingPages = (unsigned int)pendingPages.size();
+}
+
+void VirtualTexture::CreateFeedbackTarget(GLsizei width, GLsizei height)
+{
+	if (feedbackFramebuffer == 0)
+	{
+		glGenFramebuffers(1, &feedbackFramebuffer);
+		glGenRenderbuffers(1, &feedbackColour);
+		glGenRenderbuffers(1, &feedbackDepth);
+	}
+
+	glBindRenderbuffer(GL_RENDERBUFFER, feedbackColour);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, feedbackDepth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, feedbackFramebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, feedbackColour);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, feedbackDepth);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		printf("Virtual texture feedback target is incomplete!\n");
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	feedbackWidth = width;
+	feedbackHeight = height;
+}
+
+void VirtualTexture::BeginFeedback(Shader* feedbackShader)
+{
+	glGetIntegerv(GL_VIEWPORT, savedViewport);
+
+	GLsizei width = std::max(savedViewport[2] / feedbackDivisor, 1);
+	GLsizei height = std::max(savedViewport[3] / feedbackDivisor, 1);
+	if (width != feedbackWidth || height != feedbackHeight)
+	{
+		CreateFeedbackTarget(width, height);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, feedbackFramebuffer);
+	glViewport(0, 0, feedbackWidth, feedbackHeight);
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	// Derivatives are feedbackDivisor times larger in the small target, the bias brings the level back
+	glUniform4f(feedbackShader->GetUniformLocation("vtParams"), (GLfloat)virtualSize, (GLfloat)pageSize, (GLfloat)border, (GLfloat)(levelCount - 1));
+	glUniform1f(feedbackShader->GetUniformLocation("feedbackBias"), -log2f((float)feedbackDivisor));
+}
+
+void VirtualTexture::EndFeedback()
+{
+	// With every buffer still in flight this frame's requests are skipped, the next frame repeats them
+	for (size_t i = 0; i < feedbackBuffers.size(); i++)
+	{
+		FeedbackBuffer& feedback = feedbackBuffers[i];
+		if (feedback.fence)
+		{
+			continue;
+		}
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, feedback.buffer);
+		if (feedback.width != feedbackWidth || feedback.height != feedbackHeight)
+		{
+			glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)feedbackWidth * feedbackHeight * 4, NULL, GL_STREAM_READ);
+			feedback.width = feedbackWidth;
+			feedback.height = feedbackHeight;
+		}
+
+		// Into the buffer, the copy completes on the GPU and the fence says when
+		glReadPixels(0, 0, feedbackWidth, feedbackHeight, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+		feedback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		break;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+}
+
+void VirtualTexture::UseVirtualTexture(Shader* shader, GLuint cacheUnit, GLuint pageTableUnit)
+{
+	glActiveTexture(GL_TEXTURE0 + cacheUnit);
+	glBindTexture(GL_TEXTURE_2D, cacheTexture);
+	glActiveTexture(GL_TEXTURE0 + pageTableUnit);
+	glBindTexture(GL_TEXTURE_2D, pageTableTexture);
+	glActiveTexture(GL_TEXTURE0);
+
+	glUniform1i(shader->GetUniformLocation("pageCache"), cacheUnit);
+	glUniform1i(shader->GetUniformLocation("pageTable"), pageTableUnit);
+	glUniform4f(shader->GetUniformLocation("vtParams"), (GLfloat)virtualSize, (GLfloat)pageSize, (GLfloat)border, (GLfloat)(levelCount - 1));
+}
+
+VirtualTextureStats VirtualTexture::GetStats()
+{
+	std::lock_guard<std::mutex> lock(statsMutex);
+	return stats;
+}
+
+size_t VirtualTexture::GetMemoryUsage()
+{
+	if (cacheTexture == 0)
+	{
+		return 0;
+	}
+
+	size_t cacheSize = (size_t)slotSize * cachePagesPerSide;
+	size_t total = cacheSize * cacheSize * 4;
+	for (int level = 0; level < levelCount; level++)
+	{
+		size_t pages = pagesPerSide >> level;
+		total += pages * pages * 4;
+	}
+	return total;
+}
+
+void VirtualTexture::ClearVirtualTexture()
+{
+	if (cacheTexture != 0)
+	{
+		glDeleteTextures(1, &cacheTexture);
+		cacheTexture = 0;
+	}
+
+	if (pageTableTexture != 0)
+	{
+		glDeleteTextures(1, &pageTableTexture);
+		pageTableTexture = 0;
+	}
+
+	if (feedbackFramebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &feedbackFramebuffer);
+		glDeleteRenderbuffers(1, &feedbackColour);
+		glDeleteRenderbuffers(1, &feedbackDepth);
+		feedbackFramebuffer = 0;
+		feedbackColour = 0;
+		feedbackDepth = 0;
+	}
+	feedbackWidth = 0;
+	feedbackHeight = 0;
+
+	for (size_t i = 0; i < feedbackBuffers.size(); i++)
+	{
+		if (feedbackBuffers[i].fence)
+		{
+			glDeleteSync(feedbackBuffers[i].fence);
+		}
+		glDeleteBuffers(1, &feedbackBuffers[i].buffer);
+	}
+	feedbackBuffers.clear();
+
+	slots.clear();
+	residentPages.clear();
+	pendingPages.clear();
+	pageTableData.clear();
+	pageTableDirty = false;
+
+	std::lock_guard<std::mutex> lock(loadedMutex);
+	loadedPages.clear();
+}
+
+VirtualTexture::~VirtualTexture()
+{
+	ClearVirtualTexture();
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <stdint.h>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <GL\glew.h>
+
+#include "Shader.h"
+#include "ThreadPool.h"
+
+struct VirtualTextureStats
+{
+	unsigned int virtualSize;
+	unsigned int cachePages;
+	unsigned int residentPages;
+	unsigned int pendingPages;
+	// Distinct pages seen in the last feedback read back
+	unsigned int requestedPages;
+
+	// Totals for the session
+	unsigned int pagesLoaded;
+	unsigned int pagesEvicted;
+	unsigned int feedbackReads;
+};
+
+// A texture far larger than VRAM, split into pages that are streamed into a fixed size physical cache as
+// the camera needs them. A page table texture (one texel per page, one mip per level) maps every virtual
+// page to the cache slot of the finest resident page covering it. What is needed comes from a feedback
+// pass: the scene is drawn into a small target writing the page each pixel would sample, read back a few
+// frames later through a pixel buffer so the render thread never waits on it. Missing pages are decoded
+// on the worker pool and uploaded a few per frame, the least recently requested page giving up its slot.
+class VirtualTexture
+{
+public:
+	VirtualTexture();
+
+	// Context thread. Pages come from tileDirectory (TextureCooker --vt-tiles output) which also supplies
+	// the sizes; without it, generated debug pages of the given sizes are used. The cache holds
+	// cachePagesPerSide squared pages and is the only memory the texture ever uses.
+	bool CreateVirtualTexture(ThreadPool* pool, const char* tileDirectory, int virtualSize, int pageSize, int border, int cachePagesPerSide);
+
+	// Pages uploaded per frame at most, and decodes in flight at most
+	void SetStreamingLimits(unsigned int uploadsPerFrame, unsigned int maxPendingPages) { uploadBudget = uploadsPerFrame; maxPending = maxPendingPages; }
+
+	// Render thread, at the start of a frame: consume finished feedback, request and upload pages
+	void Update(unsigned int frameNumber);
+
+	// Render thread: draw the virtually textured meshes between these with feedbackShader in use
+	void BeginFeedback(Shader* feedbackShader);
+	void EndFeedback();
+
+	// Render thread: bind the cache and page table and set the sampling uniforms of shader (in use)
+	void UseVirtualTexture(Shader* shader, GLuint cacheUnit, GLuint pageTableUnit);
+
+	// Any thread
+	VirtualTextureStats GetStats();
+	size_t GetMemoryUsage();
+
+	void ClearVirtualTexture();
+
+	~VirtualTexture();
+
+private:
+	struct CacheSlot
+	{
+		uint32_t page;
+		unsigned int lastUsedFrame;
+		bool occupied;
+	};
+
+	struct LoadedPage
+	{
+		uint32_t page;
+		std::vector<unsigned char> pixels;
+	};
+
+	// Feedback read back ring, a buffer is reused once its fence has been consumed
+	struct FeedbackBuffer
+	{
+		GLuint buffer;
+		GLsync fence;
+		GLsizei width, height;
+	};
+
+	ThreadPool* workerPool;
+	std::string tileDirectory;
+	bool useTiles;
+	bool srgb;
+
+	int virtualSize, pageSize, border, levelCount;
+	int pagesPerSide, cachePagesPerSide, slotSize;
+
+	GLuint cacheTexture, pageTableTexture;
+	GLuint feedbackFramebuffer, feedbackColour, feedbackDepth;
+	GLsizei feedbackWidth, feedbackHeight;
+	GLint savedViewport[4];
+	std::vector<FeedbackBuffer> feedbackBuffers;
+
+	unsigned int uploadBudget;
+	unsigned int maxPending;
+	unsigned int currentFrame;
+
+	// Render thread only
+	std::vector<CacheSlot> slots;
+	std::unordered_map<uint32_t, int> residentPages;
+	std::unordered_set<uint32_t> pendingPages;
+	std::vector<std::vector<unsigned char>> pageTableData;
+	bool pageTableDirty;
+
+	// Filled by the workers
+	std::mutex loadedMutex;
+	std::deque<LoadedPage> loadedPages;
+
+	std::mutex statsMutex;
+	VirtualTextureStats stats;
+
+	static uint32_t PageKey(int level, int x, int y) { return ((uint32_t)level << 24) | ((uint32_t)y << 12) | (uint32_t)x; }
+
+	bool ReadTileHeader(const char* directory);
+	void ReadFeedback(const unsigned char* pixels, size_t count);
+	void RequestPage(uint32_t page);
+	void LoadPage(uint32_t page, std::vector<unsigned char>& pixels);
+	void GeneratePage(uint32_t page, std::vector<unsigned char>& pixels);
+	int FindSlot();
+	void UploadPages();
+	void RefreshPageTable();
+	void CreateFeedbackTarget(GLsizei width, GLsizei height);
+};
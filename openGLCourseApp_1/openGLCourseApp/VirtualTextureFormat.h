@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+// Tile directory layout shared by the texture cooker and VirtualTexture: a "tiles.vt" header plus one
+// uncompressed TGA per page named "<level>_<x>_<y>.tga", page (0, 0) at the bottom left. Every tile is
+// pageSize + 2 * border texels square, the border repeating the neighbouring pages so filtering near
+// a page edge never reads from an unrelated page in the cache.
+
+static const char virtualTextureIdentifier[4] = { 'V', 'T', 'E', 'X' };
+static const uint32_t virtualTextureVersion = 1;
+static const char virtualTextureHeaderName[] = "tiles.vt";
+
+enum VirtualTextureFlags
+{
+	VIRTUAL_FLAG_SRGB = 1
+};
+
+struct VirtualTextureHeader
+{
+	char identifier[4];
+	uint32_t version;
+	uint32_t flags;
+	// Square, a power of two multiple of pageSize, the last level being a single page
+	uint32_t virtualSize;
+	uint32_t pageSize;
+	uint32_t border;
+	uint32_t levelCount;
+};
@@ -1,152 +1,239 @@
-#include "Window.h"
-
-Window::Window()
-{
-	width = 800;
-	height = 600;
-
-	for(size_t i = 0; i < 1024; i++)
-	{
-		keys[i] = 0;
-	}
-	
-	xChange = 0.0f;
-	yChange = 0.0f;
-}
-
-Window::Window(GLint windowWidth, GLint windowHeight)
-{
-	width = windowWidth;
-	height = windowHeight;
-
-	for (size_t i = 0; i < 1024; i++)
-	{
-		keys[i] = 0;
-	}
-	
-	xChange = 0.0f;
-	yChange = 0.0f;
-}
-
-int Window::Initialise()
-{
-	if (!glfwInit())
-	{
-		printf("Error Initialising GLFW");
-		glfwTerminate();
-		return 1;
-	}
-
-	// Setup GLFW Windows Properties
-	// OpenGL version
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	// Core Profile
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-	// Allow forward compatiblity
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-
-	// Create the window
-	mainWindow = glfwCreateWindow(width, height, "Test Window", NULL, NULL);
-	if (!mainWindow)
-	{
-		printf("Error creating GLFW window!");
-		glfwTerminate();
-		return 1;
-	}
-
-	// Get buffer size information
-	glfwGetFramebufferSize(mainWindow, &bufferWidth, &bufferHeight);
-
-	// Set the current context
-	glfwMakeContextCurrent(mainWindow);
-
-	// Handle Key + Mouse Input
-	createCallbacks();
-	glfwSetInputMode(mainWindow, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-
-	// Allow modern extension access
-	glewExperimental = GL_TRUE;
-
-	GLenum error = glewInit();
-	if (error != GLEW_OK)
-	{
-		printf("Error: %s", glewGetErrorString(error));
-		glfwDestroyWindow(mainWindow);
-		glfwTerminate();
-		return 1;
-	}
-
-	glEnable(GL_DEPTH_TEST);
-
-	// Create Viewport
-	glViewport(0, 0, bufferWidth, bufferHeight);
-
-	glfwSetWindowUserPointer(mainWindow, this);
-}
-
-void Window::createCallbacks()
-{
-	glfwSetKeyCallback(mainWindow, handleKeys);
-	glfwSetCursorPosCallback(mainWindow, handleMouse);
-}
-
-GLfloat Window::getXChange()
-{
-	GLfloat theChange = xChange;
-	xChange = 0.0f;
-	return theChange;
-}
-
-GLfloat Window::getYChange()
-{
-	GLfloat theChange = yChange;
-	yChange = 0.0f;
-	return theChange;
-}
-
-void Window::handleKeys(GLFWwindow* window, int key, int code, int action, int mode)
-{
-	Window* theWindow = static_cast<Window*>(glfwGetWindowUserPointer(window));
-
-	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
-	{
-		glfwSetWindowShouldClose(window, GL_TRUE);
-	}
-
-	if (key >= 0 && key < 1024)
-	{
-		if (action == GLFW_PRESS)
-		{
-			theWindow->keys[key] = true;
-		}
-		else if (action == GLFW_RELEASE)
-		{
-			theWindow->keys[key] = false;
-		}
-	}
-}
-
-void Window::handleMouse(GLFWwindow* window, double xPos, double yPos)
-{
-	Window* theWindow = static_cast<Window*>(glfwGetWindowUserPointer(window));
-
-	if (theWindow->mouseFirstMoved)
-	{
-		theWindow->lastX = xPos;
-		theWindow->lastY = yPos;
-		theWindow->mouseFirstMoved = false;
-	}
-
-	theWindow->xChange = xPos - theWindow->lastX;
-	theWindow->yChange = theWindow->lastY - yPos;
-
-	theWindow->lastX = xPos;
-	theWindow->lastY = yPos;
-}
-
-Window::~Window()
-{
-	glfwDestroyWindow(mainWindow);
-	glfwTerminate();
-}
+#include "Window.h"
+
+Window::Window()
+{
+	width = 800;
+	height = 600;
+
+	for(size_t i = 0; i < 1024; i++)
+	{
+		keys[i] = 0;
+	}
+	
+	xChange = 0.0f;
+	yChange = 0.0f;
+	mouseFirstMoved = true;
+	lastInputTime = 0.0;
+	droppedInputCount = 0;
+
+	presentMode = PRESENT_VSYNC;
+	useEGL = false;
+}
+
+Window::Window(GLint windowWidth, GLint windowHeight)
+{
+	width = windowWidth;
+	height = windowHeight;
+
+	for (size_t i = 0; i < 1024; i++)
+	{
+		keys[i] = 0;
+	}
+	
+	xChange = 0.0f;
+	yChange = 0.0f;
+	mouseFirstMoved = true;
+	lastInputTime = 0.0;
+	droppedInputCount = 0;
+
+	presentMode = PRESENT_VSYNC;
+	useEGL = false;
+}
+
+int Window::Initialise()
+{
+	if (!glfwInit())
+	{
+		printf("Error Initialising GLFW");
+		glfwTerminate();
+		return 1;
+	}
+
+	// Setup GLFW Windows Properties
+	// OpenGL version
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	// Core Profile
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	// Allow forward compatiblity
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+	// Context creation API
+	glfwWindowHint(GLFW_CONTEXT_CREATION_API, useEGL ? GLFW_EGL_CONTEXT_API : GLFW_NATIVE_CONTEXT_API);
+
+	// Create the window
+	mainWindow = glfwCreateWindow(width, height, "Test Window", NULL, NULL);
+	if (!mainWindow)
+	{
+		printf("Error creating GLFW window!");
+		glfwTerminate();
+		return 1;
+	}
+
+	// Get buffer size information
+	glfwGetFramebufferSize(mainWindow, &bufferWidth, &bufferHeight);
+
+	// Set the current context
+	glfwMakeContextCurrent(mainWindow);
+
+	// Handle Key + Mouse Input
+	createCallbacks();
+	glfwSetInputMode(mainWindow, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+	// Allow modern extension access
+	glewExperimental = GL_TRUE;
+
+	GLenum error = glewInit();
+	if (error != GLEW_OK)
+	{
+		printf("Error: %s", glewGetErrorString(error));
+		glfwDestroyWindow(mainWindow);
+		glfwTerminate();
+		return 1;
+	}
+
+	glEnable(GL_DEPTH_TEST);
+
+	// Create Viewport
+	glViewport(0, 0, bufferWidth, bufferHeight);
+
+	glfwSetWindowUserPointer(mainWindow, this);
+
+	applyPresentMode();
+
+	return 0;
+}
+
+void Window::applyPresentMode()
+{
+	switch (presentMode)
+	{
+	case PRESENT_IMMEDIATE:
+		glfwSwapInterval(0);
+		break;
+	case PRESENT_ADAPTIVE:
+		// Negative intervals are only valid with the swap control tear extensions
+		if (glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear"))
+		{
+			glfwSwapInterval(-1);
+		}
+		else
+		{
+			printf("Adaptive vsync not supported, falling back to vsync\n");
+			glfwSwapInterval(1);
+		}
+		break;
+	default:
+		glfwSwapInterval(1);
+		break;
+	}
+}
+
+void Window::createCallbacks()
+{
+	glfwSetKeyCallback(mainWindow, handleKeys);
+	glfwSetCursorPosCallback(mainWindow, handleMouse);
+}
+
+void Window::consumeInput(double upToTime)
+{
+	const InputEvent* next;
+	while ((next = inputQueue.front()) != NULL && next->timestamp <= upToTime)
+	{
+		InputEvent inputEvent;
+		inputQueue.pop(inputEvent);
+
+		if (inputEvent.type == INPUT_KEY)
+		{
+			if (inputEvent.action == GLFW_PRESS)
+			{
+				keys[inputEvent.key] = true;
+			}
+			else if (inputEvent.action == GLFW_RELEASE)
+			{
+				keys[inputEvent.key] = false;
+			}
+		}
+		else if (inputEvent.type == INPUT_MOUSE_MOVE)
+		{
+			// Accumulate every movement since the last step rather than keeping only the latest
+			xChange += inputEvent.xChange;
+			yChange += inputEvent.yChange;
+		}
+
+		lastInputTime = inputEvent.timestamp;
+	}
+}
+
+GLfloat Window::getXChange()
+{
+	GLfloat theChange = xChange;
+	xChange = 0.0f;
+	return theChange;
+}
+
+GLfloat Window::getYChange()
+{
+	GLfloat theChange = yChange;
+	yChange = 0.0f;
+	return theChange;
+}
+
+void Window::queueInput(const InputEvent& inputEvent)
+{
+	if (!inputQueue.push(inputEvent))
+	{
+		droppedInputCount++;
+	}
+}
+
+void Window::handleKeys(GLFWwindow* window, int key, int code, int action, int mode)
+{
+	Window* theWindow = static_cast<Window*>(glfwGetWindowUserPointer(window));
+
+	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
+	{
+		glfwSetWindowShouldClose(window, GL_TRUE);
+	}
+
+	if (key >= 0 && key < 1024 && action != GLFW_REPEAT)
+	{
+		InputEvent inputEvent;
+		inputEvent.type = INPUT_KEY;
+		inputEvent.key = key;
+		inputEvent.action = action;
+		inputEvent.xChange = 0.0f;
+		inputEvent.yChange = 0.0f;
+		inputEvent.timestamp = glfwGetTime();
+		theWindow->queueInput(inputEvent);
+	}
+}
+
+void Window::handleMouse(GLFWwindow* window, double xPos, double yPos)
+{
+	Window* theWindow = static_cast<Window*>(glfwGetWindowUserPointer(window));
+
+	if (theWindow->mouseFirstMoved)
+	{
+		theWindow->lastX = xPos;
+		theWindow->lastY = yPos;
+		theWindow->mouseFirstMoved = false;
+	}
+
+	InputEvent inputEvent;
+	inputEvent.type = INPUT_MOUSE_MOVE;
+	inputEvent.key = 0;
+	inputEvent.action = 0;
+	inputEvent.xChange = xPos - theWindow->lastX;
+	inputEvent.yChange = theWindow->lastY - yPos;
+	inputEvent.timestamp = glfwGetTime();
+	theWindow->queueInput(inputEvent);
+
+	theWindow->lastX = xPos;
+	theWindow->lastY = yPos;
+}
+
+Window::~Window()
+{
+	glfwDestroyWindow(mainWindow);
+	glfwTerminate();
+}
@@ -1,47 +1,87 @@
-#pragma once
-
-#include "stdio.h"
-
-#include <GL\glew.h>
-#include <GLFW\glfw3.h>
-
-class Window
-{
-public:
-	Window();
-
-	Window(GLint windowWidth, GLint windowHeight);
-
-	int Initialise();
-
-	GLint getBufferWidth() { return bufferWidth; }
-	GLint getBufferHeight() { return bufferHeight; }
-
-	bool getShouldClose() { return glfwWindowShouldClose(mainWindow); }
-
-	bool* getsKeys() { return keys; }
-	GLfloat getXChange();
-	GLfloat getYChange();
-
-	void swapBuffers() { glfwSwapBuffers(mainWindow); }
-
-	~Window();
-
-private:
-	GLFWwindow* mainWindow;
-
-	GLint width, height;
-	GLint bufferWidth, bufferHeight;
-
-	bool keys[1024];
-
-	GLfloat lastX;
-	GLfloat lastY;
-	GLfloat xChange;
-	GLfloat yChange;
-	bool mouseFirstMoved;
-
-	void createCallbacks();
-	static void handleKeys(GLFWwindow* window, int key, int code, int action, int mode);
-	static void handleMouse(GLFWwindow* window, double xPos, double yPos);
-};
\ No newline at end of file
+#pragma once
+
+#include "stdio.h"
+
+#include <GL\glew.h>
+#include <GLFW\glfw3.h>
+
+#include "InputEvent.h"
+#include "SPSCQueue.h"
+
+enum PresentMode
+{
+	PRESENT_VSYNC,		// wait for vertical blank every frame
+	PRESENT_IMMEDIATE,	// never wait, may tear
+	PRESENT_ADAPTIVE	// vsync, but tear instead of halving the rate when a frame is late
+};
+
+class Window
+{
+public:
+	Window();
+
+	Window(GLint windowWidth, GLint windowHeight);
+
+	// Create the context through EGL instead of WGL/GLX, for headless machines. Set before Initialise.
+	void setUseEGL(bool egl) { useEGL = egl; }
+	bool getUseEGL() { return useEGL; }
+
+	int Initialise();
+
+	GLFWwindow* getGLFWWindow() { return mainWindow; }
+
+	GLint getBufferWidth() { return bufferWidth; }
+	GLint getBufferHeight() { return bufferHeight; }
+
+	bool getShouldClose() { return glfwWindowShouldClose(mainWindow); }
+
+	// Drain queued input events up to and including upToTime into the key state and mouse deltas,
+	// call once per simulation step before reading getsKeys()/getXChange()/getYChange()
+	void consumeInput(double upToTime);
+
+	bool* getsKeys() { return keys; }
+	GLfloat getXChange();
+	GLfloat getYChange();
+	double getLastInputTime() { return lastInputTime; }
+	unsigned int getDroppedInputCount() { return droppedInputCount; }
+
+	// The GL context can only be current on one thread at a time, release it before handing it to the render thread
+	void makeContextCurrent() { glfwMakeContextCurrent(mainWindow); }
+	void releaseContext() { glfwMakeContextCurrent(NULL); }
+
+	// Takes effect on the next applyPresentMode(), which must run on the thread the context is current on
+	void setPresentMode(PresentMode mode) { presentMode = mode; }
+	PresentMode getPresentMode() { return presentMode; }
+	void applyPresentMode();
+
+	void swapBuffers() { glfwSwapBuffers(mainWindow); }
+
+	~Window();
+
+private:
+	GLFWwindow* mainWindow;
+
+	GLint width, height;
+	GLint bufferWidth, bufferHeight;
+
+	PresentMode presentMode;
+	bool useEGL;
+
+	// Written by the GLFW callbacks, read by consumeInput
+	SPSCQueue<InputEvent, 1024> inputQueue;
+	unsigned int droppedInputCount;
+
+	bool keys[1024];
+
+	GLfloat lastX;
+	GLfloat lastY;
+	GLfloat xChange;
+	GLfloat yChange;
+	bool mouseFirstMoved;
+	double lastInputTime;
+
+	void createCallbacks();
+	void queueInput(const InputEvent& inputEvent);
+	static void handleKeys(GLFWwindow* window, int key, int code, int action, int mode);
+	static void handleMouse(GLFWwindow* window, double xPos, double yPos);
+};
@@ -0,0 +1,25 @@
+#include "WorldTransform.h"
+
+WorldTransform::WorldTransform()
+{
+	position = glm::dvec3(0.0);
+	scale = glm::vec3(1.0f);
+}
+
+WorldTransform::WorldTransform(glm::dvec3 startPosition, glm::vec3 startScale)
+{
+	position = startPosition;
+	scale = startScale;
+}
+
+glm::dmat4 WorldTransform::calculateModelMatrix()
+{
+	glm::dmat4 model(1.0);
+	model = glm::translate(model, position);
+	model = glm::scale(model, glm::dvec3(scale));
+	return model;
+}
+
+WorldTransform::~WorldTransform()
+{
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <GL\glew.h>
+
+#include <glm\glm.hpp>
+#include <glm\gtc\matrix_transform.hpp>
+
+// Placement of an object in a large world, position is double precision and relative to the
+// same floating origin as the Camera so it survives being far away from (0, 0, 0)
+class WorldTransform
+{
+public:
+	WorldTransform();
+	WorldTransform(glm::dvec3 startPosition, glm::vec3 startScale);
+
+	glm::dvec3 getPosition() { return position; }
+	void setPosition(glm::dvec3 newPosition) { position = newPosition; }
+
+	glm::vec3 getScale() { return scale; }
+	void setScale(glm::vec3 newScale) { scale = newScale; }
+
+	// Apply the shift returned by Camera::rebaseOrigin
+	void rebase(glm::dvec3 shift) { position -= shift; }
+
+	glm::dmat4 calculateModelMatrix();
+
+	~WorldTransform();
+
+private:
+	glm::dvec3 position;
+	glm::vec3 scale;
+};
@@ -1,122 +1,908 @@
-#include <stdio.h>
-#include <string.h>
-#include <cmath>
-#include <vector>
-
-#include <GL\glew.h>
-#include <GLFW\glfw3.h>
-
-#include <glm\glm.hpp>
-#include <glm\gtc\matrix_transform.hpp>
-#include <glm\gtc\type_ptr.hpp>
-
-#include "Window.h"
-#include "Mesh.h"
-#include "Shader.h"
-#include "Camera.h"
-
-const float toRadians = 3.14159265f / 180.0f;
-
-Window mainWindow;
-std::vector<Mesh*> meshList;
-std::vector<Shader> shaderList;
-Camera camera;
-
-GLfloat deltaTime = 0.0f;
-GLfloat lastTime = 0.0f;
-
-// Vertex Shader
-static const char* vShader = "Shaders/shader.vert";
-
-// Fragment Shader
-static const char* fShader = "Shaders/shader.frag";
-
-void CreateObjects() 
-{
-	unsigned int indices[] = {
-		0, 3, 1,
-		1, 3, 2,
-		2, 3, 0,
-		0, 1, 2
-	};
-
-	GLfloat vertices[] = {
-		-1.0f, -1.0f, 0.0f,
-		0.0f, -1.0f, 1.0f,
-		1.0f, -1.0f, 0.0f,
-		0.0f, 1.0f, 0.0f
-	};
-
-	Mesh *obj1 = new Mesh();
-	obj1->CreateMesh(vertices, indices, 12, 12);
-	meshList.push_back(obj1);
-
-	Mesh *obj2 = new Mesh();
-	obj2->CreateMesh(vertices, indices, 12, 12);
-	meshList.push_back(obj2);
-}
-
-void CreateShaders()
-{
-	Shader *shader1 = new Shader();
-	shader1->CreateFromFiles(vShader, fShader);
-	shaderList.push_back(*shader1);
-}
-
-int main() 
-{
-	mainWindow = Window(800, 600);
-	mainWindow.Initialise();
-
-	CreateObjects();
-	CreateShaders();
-
-	camera = Camera(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, 0.0f, 5.0f, 0.5f);
-
-	GLuint uniformProjection = 0, uniformModel = 0, uniformView = 0;
-	glm::mat4 projection = glm::perspective(glm::radians(45.0f), (GLfloat)mainWindow.getBufferWidth() / mainWindow.getBufferHeight(), 0.1f, 100.0f);
-
-	// Loop until window closed
-	while (!mainWindow.getShouldClose())
-	{
-		GLfloat now = glfwGetTime(); // SDL_GetPerformanceCounter();
-		deltaTime = now - lastTime; // (now - lastTime)*1000/SDL_GetPerformanceFrequency();
-		lastTime = now;
-
-		// Get + Handle User Input
-		glfwPollEvents();
-
-		camera.keyControl(mainWindow.getsKeys(), deltaTime);
-		camera.mouseControl(mainWindow.getXChange(), mainWindow.getYChange());
-
-		// Clear the window
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		shaderList[0].UseShader();
-		uniformModel = shaderList[0].GetModelLocation();
-		uniformProjection = shaderList[0].GetProjectionLocation();
-		uniformView = shaderList[0].GetViewLocation();
-
-		glm::mat4 model(1.0f);	
-
-		model = glm::translate(model, glm::vec3(0.0f, 0.0f, -2.5f));
-		model = glm::scale(model, glm::vec3(0.4f, 0.4f, 1.0f));
-		glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-		glUniformMatrix4fv(uniformProjection, 1, GL_FALSE, glm::value_ptr(projection));
-		glUniformMatrix4fv(uniformView, 1, GL_FALSE, glm::value_ptr(camera.calculateViewMatrix()));
-		meshList[0]->RenderMesh();
-
-		model = glm::mat4(1.0f);
-		model = glm::translate(model, glm::vec3(0.0f, 1.0f, -2.5f));
-		model = glm::scale(model, glm::vec3(0.4f, 0.4f, 1.0f));
-		glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-		meshList[1]->RenderMesh();
-
-		glUseProgram(0);
-
-		mainWindow.swapBuffers();
-	}
-
-	return 0;
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmath>
+#include <vector>
+#include <memory>
+
+#include <GL\glew.h>
+#include <GLFW\glfw3.h>
+
+#include <glm\glm.hpp>
+#include <glm\gtc\matrix_transform.hpp>
+#include <glm\gtc\type_ptr.hpp>
+
+#include "Window.h"
+#include "Mesh.h"
+#include "Shader.h"
+#include "Camera.h"
+#include "CameraPath.h"
+#include "WorldTransform.h"
+#include "Renderer.h"
+#include "Texture.h"
+#include "Sampler.h"
+#include "ThreadPool.h"
+#include "TextureLoader.h"
+#include "UploadQueue.h"
+#include "ResourceLoader.h"
+#include "MeshBatch.h"
+#include "TextureAtlas.h"
+#include "ResidencyManager.h"
+#include "VirtualTexture.h"
+#include "MeshFile.h"
+#include "ObjImporter.h"
+#include "GltfModel.h"
+#include "MeshOptimizer.h"
+#include "VertexQuantizer.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "MeshletCuller.h"
+#include "Terrain.h"
+#include "SkinnedModel.h"
+#include "AnimationSampler.h"
+#include "JointPalette.h"
+
+const float toRadians = 3.14159265f / 180.0f;
+
+Window mainWindow(800, 600);
+std::vector<Mesh*> meshList;
+std::vector<Shader> shaderList;
+std::vector<WorldTransform> transformList;
+// Bounding sphere of each mesh in meshList, centre and radius in object units
+std::vector<glm::vec4> boundsList;
+// Meshlets of each mesh in meshList culled every frame, NULL when it has none or culling is off
+std::vector<MeshletCuller*> meshletList;
+Camera camera;
+Renderer renderer;
+
+Texture brickTexture("Textures/brick.png");
+Texture dirtTexture("Textures/dirt.png");
+// Cooked files the textures were loaded from, NULL when they came from their source images
+const char* brickCookedLocation = NULL;
+const char* dirtCookedLocation = NULL;
+Sampler defaultSampler;
+
+ThreadPool workerPool;
+TextureLoader textureLoader;
+UploadQueue uploadQueue;
+ResourceLoader resourceLoader;
+ResidencyManager residencyManager;
+
+MeshBatch meshBatch;
+TextureAtlas textureAtlas;
+std::vector<unsigned int> batchMeshList;
+std::vector<AtlasRegion> atlasRegionList;
+
+VirtualTexture virtualTexture;
+
+// A glTF scene keeps its node transforms under one placement of its own
+GltfModel gltfModel;
+WorldTransform gltfTransform;
+
+// Heightmap terrain spread out below the scene, its corner placed by terrainTransform
+Terrain terrain;
+WorldTransform terrainTransform;
+
+// Animated characters sharing one skinned model, their poses evaluated on the pool into jointPalette each frame
+SkinnedModel skinnedModel;
+JointPalette jointPalette;
+std::vector<WorldTransform> characterTransforms;
+
+CameraRecorder cameraRecorder;
+CameraReplay cameraReplay;
+
+GLfloat deltaTime = 0.0f;
+GLfloat lastTime = 0.0f;
+
+// Vertex Shader
+static const char* vShader = "Shaders/shader.vert";
+
+// Fragment Shader
+static const char* fShader = "Shaders/shader.frag";
+
+// Multi-draw batch shaders, sampling the texture atlas
+static const char* vBatchShader = "Shaders/batch.vert";
+static const char* fBatchShader = "Shaders/batch.frag";
+
+// Virtual texture sampling and its page feedback pass, both over the regular vertex shader
+static const char* fVirtualShader = "Shaders/virtual.frag";
+static const char* fFeedbackShader = "Shaders/feedback.frag";
+
+// Terrain nodes, placed and raised from the heightmap in the vertex shader
+static const char* vTerrainShader = "Shaders/terrain.vert";
+static const char* fTerrainShader = "Shaders/terrain.frag";
+
+// Skinned characters, deformed by the joint palette in the vertex shader and shaded like everything else
+static const char* vSkinnedShader = "Shaders/skinned.vert";
+
+WorldTransform FitModel(const float* boundsMin, const float* boundsMax)
+{
+	// Fitted into a unit box below the other objects, whatever units the model was authored in
+	float extent = 0.0f;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float size = boundsMax[axis] - boundsMin[axis];
+		extent = size > extent ? size : extent;
+	}
+	float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+
+	return WorldTransform(glm::dvec3(0.0, -1.0, -2.5), glm::vec3(scale));
+}
+
+glm::vec4 BoundingSphere(const float* boundsMin, const float* boundsMax)
+{
+	glm::vec3 low(boundsMin[0], boundsMin[1], boundsMin[2]);
+	glm::vec3 high(boundsMax[0], boundsMax[1], boundsMax[2]);
+	return glm::vec4((low + high) * 0.5f, glm::length(high - low) * 0.5f);
+}
+
+void AddModel(Mesh* mesh, const float* boundsMin, const float* boundsMax, MeshletCuller* meshlets)
+{
+	meshList.push_back(mesh);
+	transformList.push_back(FitModel(boundsMin, boundsMax));
+	boundsList.push_back(BoundingSphere(boundsMin, boundsMax));
+	meshletList.push_back(meshlets);
+}
+
+MeshletCuller* CreateMeshletCuller(const MeshFileMeshlet* meshlets, size_t count, size_t indexCount)
+{
+	MeshletCuller* culler = new MeshletCuller();
+	if (!culler->SetMeshlets(meshlets, count, indexCount))
+	{
+		delete culler;
+		return NULL;
+	}
+	return culler;
+}
+
+void CreateModel(const char* modelLocation, bool optimize, bool quantize, bool generateLods, bool cullMeshlets)
+{
+	const char* extension = strrchr(modelLocation, '.');
+	if (extension && (strcmp(extension, ".gltf") == 0 || strcmp(extension, ".glb") == 0))
+	{
+		GltfLoadStats stats;
+		if (!gltfModel.Load(modelLocation, &resourceLoader, &textureLoader, stats))
+		{
+			return;
+		}
+		printf("Loaded %s in %.1f ms: %u primitives in %u instances, %u buffer views bound in place, %u accessors repacked, %.2f MB of buffers, %u images decoding\n",
+			modelLocation, stats.milliseconds, stats.primitives, stats.instances, stats.directViews, stats.repackedAccessors, stats.bufferBytes / 1048576.0, stats.images);
+
+		float boundsMin[3], boundsMax[3];
+		gltfModel.GetBounds(boundsMin, boundsMax);
+		gltfTransform = FitModel(boundsMin, boundsMax);
+		return;
+	}
+
+	if (extension && (strcmp(extension, ".obj") == 0 || strcmp(extension, ".OBJ") == 0))
+	{
+		std::vector<float> vertices;
+		std::vector<unsigned int> indices;
+		ObjImportStats stats;
+		if (!ObjImporter::ImportObj(modelLocation, &workerPool, vertices, indices, stats))
+		{
+			return;
+		}
+		printf("Imported %s in %.1f ms: %u vertices, %u triangles from %.1f MB\n", modelLocation, stats.milliseconds, stats.vertices, stats.triangles, stats.fileBytes / 1048576.0);
+
+		// Converted .mesh files are optimised by MeshConverter already
+		if (optimize)
+		{
+			MeshOptimizeStats optimizeStats;
+			MeshOptimizer::OptimizeMesh(vertices, indices, 5, optimizeStats);
+			printf("Optimised in %.1f ms: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", optimizeStats.milliseconds,
+				optimizeStats.acmrBefore, optimizeStats.acmrAfter, optimizeStats.atvrBefore, optimizeStats.atvrAfter);
+		}
+
+		float boundsMin[3] = { vertices[0], vertices[1], vertices[2] };
+		float boundsMax[3] = { vertices[0], vertices[1], vertices[2] };
+		for (size_t i = 0; i < vertices.size(); i += 5)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				boundsMin[axis] = vertices[i + axis] < boundsMin[axis] ? vertices[i + axis] : boundsMin[axis];
+				boundsMax[axis] = vertices[i + axis] > boundsMax[axis] ? vertices[i + axis] : boundsMax[axis];
+			}
+		}
+
+		// Meshlets reorder the triangles, so they are built before anything else takes a copy of the indices
+		MeshletCuller* culler = NULL;
+		if (cullMeshlets)
+		{
+			std::vector<MeshFileMeshlet> meshlets;
+			std::vector<uint32_t> meshletVertices;
+			std::vector<uint8_t> meshletTriangles;
+			MeshletBuildStats meshletStats;
+			MeshletBuilder::BuildMeshlets(&vertices[0], vertices.size() / 5, 5, &indices[0], indices.size(), meshlets, meshletVertices, meshletTriangles, meshletStats);
+			printf("Built %u meshlets in %.1f ms: %.1f vertices and %.1f triangles each, %u without a normal cone\n", meshletStats.meshlets, meshletStats.milliseconds,
+				meshletStats.averageVertices, meshletStats.averageTriangles, meshletStats.unconedMeshlets);
+			culler = meshlets.empty() ? NULL : CreateMeshletCuller(&meshlets[0], meshlets.size(), indices.size() - indices.size() % 3);
+		}
+
+		batchMeshList.push_back(meshBatch.AddMesh(&vertices[0], &indices[0], (unsigned int)vertices.size(), (unsigned int)indices.size()));
+
+		// Coarser levels are appended to the indices, the batch keeps drawing the full mesh
+		Mesh *obj = new Mesh();
+		if (generateLods)
+		{
+			std::vector<MeshFileLod> lods;
+			MeshSimplifyStats simplifyStats;
+			MeshSimplifier::BuildLodChain(vertices, 5, indices, 8, lods, simplifyStats);
+			printf("Simplified in %.1f ms: %u levels, %u -> %u triangles\n", simplifyStats.milliseconds, simplifyStats.levels, simplifyStats.trianglesBefore, simplifyStats.trianglesAfter);
+			obj->SetLods(&lods[0], (unsigned int)lods.size());
+		}
+
+		if (quantize)
+		{
+			std::vector<QuantizedVertex> quantized;
+			VertexQuantizeStats quantizeStats;
+			VertexQuantizer::QuantizeVertices(&vertices[0], vertices.size() / 5, 5, boundsMin, boundsMax, quantized, quantizeStats);
+			printf("Quantized in %.1f ms: %.2f -> %.2f MB, position error up to %g, texture coordinate error up to %g\n", quantizeStats.milliseconds,
+				quantizeStats.bytesBefore / 1048576.0, quantizeStats.bytesAfter / 1048576.0, quantizeStats.maxPositionError, quantizeStats.maxUvError);
+			obj->CreateMesh(&quantized[0], boundsMin, boundsMax, &indices[0], (unsigned int)quantized.size(), (unsigned int)indices.size(), &resourceLoader);
+		}
+		else
+		{
+			obj->CreateMesh(&vertices[0], &indices[0], (unsigned int)vertices.size(), (unsigned int)indices.size(), &resourceLoader);
+		}
+		AddModel(obj, boundsMin, boundsMax, culler);
+		return;
+	}
+
+	std::shared_ptr<MeshFile> model = std::make_shared<MeshFile>();
+	if (!model->Open(modelLocation))
+	{
+		return;
+	}
+
+	// The batch shares one float vertex buffer with 32-bit indices, compressed or quantized data is expanded for it
+	const MeshFileHeader& header = model->GetHeader();
+	// The indices are decoded once, the mesh uploads the same copy
+	std::vector<float> vertices;
+	std::shared_ptr<std::vector<uint32_t>> indices = std::make_shared<std::vector<uint32_t>>();
+	if (!model->ReadVertices(vertices) || !model->ReadIndices(*indices) || vertices.empty() || indices->empty())
+	{
+		printf("Mesh data could not be decoded\n");
+		return;
+	}
+	uint32_t lodCount;
+	const MeshFileLod* lods = model->GetLods(lodCount);
+	uint32_t fullCount = lods && lodCount > 0 && lods[0].firstIndex == 0 && lods[0].indexCount <= header.indexCount ? lods[0].indexCount : header.indexCount;
+	batchMeshList.push_back(meshBatch.AddMesh(&vertices[0], &(*indices)[0], header.vertexCount * 5, fullCount));
+
+	// MeshConverter builds meshlets unless told not to
+	MeshletCuller* culler = NULL;
+	uint32_t meshletCount;
+	const MeshFileMeshlet* meshlets = model->GetMeshlets(meshletCount);
+	if (cullMeshlets && meshlets && meshletCount > 0)
+	{
+		culler = CreateMeshletCuller(meshlets, meshletCount, fullCount);
+	}
+
+	Mesh *obj = new Mesh();
+	obj->CreateMesh(model, indices, &resourceLoader);
+	AddModel(obj, header.boundsMin, header.boundsMax, culler);
+}
+
+void CreateObjects(const char* modelLocation, bool optimizeModel, bool quantizeModel, bool generateLods, bool cullMeshlets)
+{
+	unsigned int indices[] = {
+		0, 3, 1,
+		1, 3, 2,
+		2, 3, 0,
+		0, 1, 2
+	};
+
+	GLfloat vertices[] = {
+	//	x      y      z			u	  v
+		-1.0f, -1.0f, 0.0f,		0.0f, 0.0f,
+		0.0f, -1.0f, 1.0f,		0.5f, 0.0f,
+		1.0f, -1.0f, 0.0f,		1.0f, 0.0f,
+		0.0f, 1.0f, 0.0f,		0.5f, 1.0f
+	};
+	float pyramidMin[3] = { -1.0f, -1.0f, 0.0f };
+	float pyramidMax[3] = { 1.0f, 1.0f, 1.0f };
+
+	Mesh *obj1 = new Mesh();
+	obj1->CreateMesh(vertices, indices, 20, 12, &resourceLoader);
+	meshList.push_back(obj1);
+	transformList.push_back(WorldTransform(glm::dvec3(0.0, 0.0, -2.5), glm::vec3(0.4f, 0.4f, 1.0f)));
+	boundsList.push_back(BoundingSphere(pyramidMin, pyramidMax));
+	meshletList.push_back(NULL);
+
+	Mesh *obj2 = new Mesh();
+	obj2->CreateMesh(vertices, indices, 20, 12, &resourceLoader);
+	meshList.push_back(obj2);
+	transformList.push_back(WorldTransform(glm::dvec3(0.0, 1.0, -2.5), glm::vec3(0.4f, 0.4f, 1.0f)));
+	boundsList.push_back(BoundingSphere(pyramidMin, pyramidMax));
+	meshletList.push_back(NULL);
+
+	// The same geometry merged into the batch, used instead of the meshes when batching
+	batchMeshList.push_back(meshBatch.AddMesh(vertices, indices, 20, 12));
+	batchMeshList.push_back(meshBatch.AddMesh(vertices, indices, 20, 12));
+
+	if (modelLocation)
+	{
+		CreateModel(modelLocation, optimizeModel, quantizeModel, generateLods, cullMeshlets);
+	}
+
+	meshBatch.CreateBuffers();
+}
+
+void CreateTextures()
+{
+	// Cooked textures are ready immediately, source images draw with the fallback until the decoded
+	// pixels are uploaded by the render thread
+	if (brickTexture.LoadCookedTexture("Textures/brick.ctex"))
+	{
+		brickCookedLocation = "Textures/brick.ctex";
+	}
+	else
+	{
+		brickTexture.LoadFallback();
+		textureLoader.QueueTexture(&brickTexture, brickTexture.GetFileLocation(), true, 0.0f);
+	}
+
+	if (dirtTexture.LoadCookedTexture("Textures/dirt.ctex"))
+	{
+		dirtCookedLocation = "Textures/dirt.ctex";
+	}
+	else
+	{
+		dirtTexture.LoadFallback();
+		textureLoader.QueueTexture(&dirtTexture, dirtTexture.GetFileLocation(), true, 0.0f);
+	}
+
+	defaultSampler.CreateSampler(GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT, 4.0f);
+}
+
+void CreateAtlas()
+{
+	// Small textures share the layers of one array texture, so the whole batch needs a single bind
+	textureAtlas.CreateAtlas(1024, 4, 4, true);
+
+	const char* atlasFiles[] = { brickTexture.GetFileLocation(), dirtTexture.GetFileLocation() };
+	for (size_t i = 0; i < 2; i++)
+	{
+		AtlasRegion region;
+		if (!textureAtlas.AddFile(atlasFiles[i], region))
+		{
+			// Stand in with a generated checkerboard so the batch still has something to sample
+			std::vector<unsigned char> checker(64 * 64 * 4);
+			for (int p = 0; p < 64 * 64; p++)
+			{
+				bool odd = ((p % 64) / 8 + (p / 64) / 8) % 2 != 0;
+				checker[p * 4 + 0] = odd ? 255 : (i == 0 ? 160 : 90);
+				checker[p * 4 + 1] = odd ? 0 : (i == 0 ? 60 : 70);
+				checker[p * 4 + 2] = odd ? 255 : (i == 0 ? 40 : 50);
+				checker[p * 4 + 3] = 255;
+			}
+			textureAtlas.AddImage(&checker[0], 64, 64, region);
+		}
+		atlasRegionList.push_back(region);
+	}
+
+	AtlasStats stats = textureAtlas.GetStats();
+	printf("Atlas: %u images in %u layers, %.1f%% occupied (%.1f%% without gutters)\n", stats.entryCount, stats.layerCount, stats.occupancy * 100.0f, stats.efficiency * 100.0f);
+}
+
+void CreateShaders()
+{
+	Shader *shader1 = new Shader();
+	shader1->CreateFromFiles(vShader, fShader);
+	shaderList.push_back(*shader1);
+
+	Shader *shader2 = new Shader();
+	shader2->CreateFromFiles(vBatchShader, fBatchShader);
+	shaderList.push_back(*shader2);
+
+	Shader *shader3 = new Shader();
+	shader3->CreateFromFiles(vShader, fVirtualShader);
+	shaderList.push_back(*shader3);
+
+	Shader *shader4 = new Shader();
+	shader4->CreateFromFiles(vShader, fFeedbackShader);
+	shaderList.push_back(*shader4);
+
+	Shader *shader5 = new Shader();
+	shader5->CreateFromFiles(vTerrainShader, fTerrainShader);
+	shaderList.push_back(*shader5);
+
+	Shader *shader6 = new Shader();
+	shader6->CreateFromFiles(vSkinnedShader, fShader);
+	shaderList.push_back(*shader6);
+}
+
+int main(int argc, char* argv[])
+{
+	// --record <file> captures the flythrough, --replay <file> plays one back instead of live input,
+	// --rebase <distance> enables floating origin rebasing once the camera travels that far,
+	// --vsync on|off|adaptive, --fps-limit <fps> and --frames-ahead <count> control frame pacing,
+	// --egl creates the contexts through EGL for headless machines,
+	// --batch draws everything from the texture atlas with one multi-draw,
+	// --vram-budget <MB> caps the GPU memory of textures, meshes and atlases,
+	// --virtual-texture <directory> draws with a streamed virtual texture cooked into that directory,
+	// --model <file.mesh|file.obj|file.gltf|file.glb> adds a model, converted by MeshConverter or imported directly,
+	// --optimize-meshes reorders an imported OBJ for the vertex cache, overdraw and vertex fetch before upload,
+	// --quantize-meshes uploads it with 16-bit positions and half float texture coordinates,
+	// --generate-lods simplifies it into levels of detail, --lod-error <pixels> sets how far levels may be off on screen,
+	// --cull-meshlets splits it into meshlets culled against the frustum and by facing each frame,
+	// --terrain <heightmap.r16|generate> adds a heightmap terrain, --terrain-size and --terrain-height <units> scale it,
+	// --characters <file.gltf|file.glb|generate> adds a crowd of animated characters, --character-count <n> sizes it,
+	// --skinning lbs|dq picks linear blend or dual quaternion skinning
+	const char* recordPath = NULL;
+	const char* replayPath = NULL;
+	GLdouble rebaseDistance = 0.0;
+	double fpsLimit = 0.0;
+	unsigned int framesAhead = 2;
+	bool batching = false;
+	double vramBudgetMB = 0.0;
+	const char* virtualTextureDirectory = NULL;
+	const char* modelPath = NULL;
+	bool optimizeMeshes = false;
+	bool quantizeMeshes = false;
+	bool generateLods = false;
+	bool cullMeshlets = false;
+	float lodPixelError = 1.0f;
+	const char* terrainPath = NULL;
+	float terrainSize = 512.0f;
+	float terrainHeight = 40.0f;
+	const char* charactersPath = NULL;
+	unsigned int characterCount = 200;
+	bool dualQuaternion = false;
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+
+		if (strcmp(argv[i], "--egl") == 0)
+		{
+			mainWindow.setUseEGL(true);
+		}
+		else if (strcmp(argv[i], "--batch") == 0)
+		{
+			batching = true;
+		}
+		else if (strcmp(argv[i], "--optimize-meshes") == 0)
+		{
+			optimizeMeshes = true;
+		}
+		else if (strcmp(argv[i], "--quantize-meshes") == 0)
+		{
+			quantizeMeshes = true;
+		}
+		else if (strcmp(argv[i], "--generate-lods") == 0)
+		{
+			generateLods = true;
+		}
+		else if (strcmp(argv[i], "--cull-meshlets") == 0)
+		{
+			cullMeshlets = true;
+		}
+		else if (!hasValue)
+		{
+			printf("Missing value for %s\n", argv[i]);
+		}
+		else if (strcmp(argv[i], "--record") == 0)
+		{
+			recordPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--replay") == 0)
+		{
+			replayPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--rebase") == 0)
+		{
+			rebaseDistance = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--vsync") == 0)
+		{
+			const char* mode = argv[++i];
+			if (strcmp(mode, "off") == 0)
+			{
+				mainWindow.setPresentMode(PRESENT_IMMEDIATE);
+			}
+			else if (strcmp(mode, "adaptive") == 0)
+			{
+				mainWindow.setPresentMode(PRESENT_ADAPTIVE);
+			}
+			else
+			{
+				mainWindow.setPresentMode(PRESENT_VSYNC);
+			}
+		}
+		else if (strcmp(argv[i], "--fps-limit") == 0)
+		{
+			fpsLimit = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--frames-ahead") == 0)
+		{
+			framesAhead = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--vram-budget") == 0)
+		{
+			vramBudgetMB = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--virtual-texture") == 0)
+		{
+			virtualTextureDirectory = argv[++i];
+		}
+		else if (strcmp(argv[i], "--lod-error") == 0)
+		{
+			lodPixelError = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--model") == 0)
+		{
+			modelPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--terrain") == 0)
+		{
+			terrainPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--terrain-size") == 0)
+		{
+			terrainSize = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--terrain-height") == 0)
+		{
+			terrainHeight = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--characters") == 0)
+		{
+			charactersPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--character-count") == 0)
+		{
+			characterCount = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--skinning") == 0)
+		{
+			dualQuaternion = strcmp(argv[++i], "dq") == 0;
+		}
+	}
+
+	mainWindow.Initialise();
+
+	workerPool.Start(0);
+	textureLoader.Initialise(&workerPool);
+
+	// Four 4MB staging buffers, drained at up to 8MB per frame by the render thread
+	uploadQueue.Initialise(4 * 1024 * 1024, 4);
+	uploadQueue.SetWorkerPool(&workerPool);
+	textureLoader.SetUploadQueue(&uploadQueue);
+
+	// Meshes are created on the loader's shared context and picked up by the render thread when fenced
+	resourceLoader.Initialise(&mainWindow);
+
+	CreateObjects(modelPath, optimizeMeshes, quantizeMeshes, generateLods, cullMeshlets);
+	CreateTextures();
+	CreateAtlas();
+	CreateShaders();
+
+	// 16K virtual texels in 128 texel pages through a 16x16 page cache (about 19MB), unless the tiles say otherwise
+	bool virtualTexturing = virtualTextureDirectory && virtualTexture.CreateVirtualTexture(&workerPool, virtualTextureDirectory, 16384, 128, 4, 16);
+
+	// Generated terrains are 2048 heights across, centred under the scene with their highest point below it
+	bool terrainEnabled = terrainPath && terrain.CreateTerrain(&workerPool, strcmp(terrainPath, "generate") == 0 ? NULL : terrainPath, 2048, terrainSize, terrainHeight);
+	terrainTransform = WorldTransform(glm::dvec3(-terrainSize * 0.5, -terrainHeight - 2.0, -terrainSize * 0.5), glm::vec3(1.0f));
+	TerrainStats terrainStats = {};
+
+	// Characters stand centred on a grid in front of the camera, each scaled to 1.8 units tall. Generated ones are 16 joints.
+	bool charactersEnabled = false;
+	if (charactersPath && characterCount > 0)
+	{
+		SkinnedLoadStats skinnedStats;
+		if (strcmp(charactersPath, "generate") == 0)
+		{
+			skinnedModel.CreateGenerated(16, &workerPool, &resourceLoader, skinnedStats);
+			charactersEnabled = true;
+		}
+		else
+		{
+			charactersEnabled = skinnedModel.LoadModel(charactersPath, 30.0f, &workerPool, &resourceLoader, skinnedStats);
+		}
+		if (charactersEnabled)
+		{
+			printf("Characters: %u vertices, %u triangles, %u joints, %u clips loaded in %.1f ms (%u vertices rebound)\n", skinnedStats.vertices, skinnedStats.triangles,
+				skinnedStats.joints, skinnedStats.clips, skinnedStats.milliseconds, skinnedStats.repairedVertices);
+
+			float boundsMin[3], boundsMax[3];
+			skinnedModel.GetBounds(boundsMin, boundsMax);
+			float height = boundsMax[1] - boundsMin[1];
+			float scale = height > 0.0f ? 1.8f / height : 1.0f;
+			unsigned int columns = (unsigned int)ceil(sqrt((double)characterCount));
+			for (unsigned int i = 0; i < characterCount; i++)
+			{
+				glm::dvec3 position(((double)(i % columns) - columns * 0.5) * 1.5 - (boundsMin[0] + boundsMax[0]) * 0.5 * scale, -2.0 - boundsMin[1] * scale,
+					-5.0 - (double)(i / columns) * 1.5 - (boundsMin[2] + boundsMax[2]) * 0.5 * scale);
+				characterTransforms.push_back(WorldTransform(position, glm::vec3(scale)));
+			}
+
+			unsigned int texels = AnimationSampler::GetPaletteTexels(skinnedModel.GetSkeleton(), dualQuaternion);
+			charactersEnabled = jointPalette.CreatePalette(characterCount * texels);
+		}
+	}
+
+	// Textures reload through the loader thread's context, from the cooked versions they were loaded from
+	residencyManager.SetBudget((size_t)(vramBudgetMB * 1024.0 * 1024.0));
+	residencyManager.SetResourceLoader(&resourceLoader);
+	residencyManager.RegisterTexture(&brickTexture, brickCookedLocation, true);
+	residencyManager.RegisterTexture(&dirtTexture, dirtCookedLocation, true);
+	for (size_t i = 0; i < meshList.size(); i++)
+	{
+		residencyManager.RegisterMesh(meshList[i]);
+	}
+	if (charactersEnabled)
+	{
+		residencyManager.RegisterMesh(skinnedModel.GetMesh());
+	}
+	residencyManager.RegisterMeshBatch(&meshBatch);
+	residencyManager.RegisterAtlas(&textureAtlas);
+
+	camera = Camera(glm::dvec3(0.0, 0.0, 0.0), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, 0.0f, 5.0f, 0.5f);
+
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), (GLfloat)mainWindow.getBufferWidth() / mainWindow.getBufferHeight(), 0.1f, 100.0f);
+
+	bool replaying = replayPath && cameraReplay.LoadFromFile(replayPath);
+	if (recordPath && !replaying)
+	{
+		cameraRecorder.StartRecording(recordPath, glfwGetTime());
+	}
+
+	GLfloat replayStart = glfwGetTime();
+	unsigned int replayFrames = 0;
+
+	// Meshlet culling summed over the last frame's meshes
+	MeshletCullStats meshletStats = {};
+	AnimationStats animationStats = {};
+
+	// Resources are created above on this thread, from here on the render thread owns the context
+	mainWindow.releaseContext();
+	renderer.GetPacer().setTargetFrameRate(fpsLimit);
+	renderer.GetPacer().setMaxFramesInFlight(framesAhead);
+	renderer.SetTextureLoader(&textureLoader, 2.0);
+	renderer.SetUploadQueue(&uploadQueue, 8 * 1024 * 1024);
+	renderer.SetResourceLoader(&resourceLoader);
+	renderer.SetBatch(&meshBatch, &textureAtlas, &shaderList[1]);
+	renderer.SetResidencyManager(&residencyManager);
+	renderer.SetLodPixelError(lodPixelError);
+	renderer.SetVirtualTexture(&virtualTexture, &shaderList[2], &shaderList[3]);
+	if (terrainEnabled)
+	{
+		// Finer heightmap mips stream in at up to 1MB per frame
+		renderer.SetTerrain(&terrain, &shaderList[4], &dirtTexture, 1024 * 1024);
+	}
+	if (charactersEnabled)
+	{
+		renderer.SetSkinning(&jointPalette, &shaderList[5]);
+	}
+	renderer.Start(&mainWindow, &shaderList[0], &defaultSampler);
+
+	// Loop until window closed
+	while (!mainWindow.getShouldClose())
+	{
+		GLfloat now = glfwGetTime(); // SDL_GetPerformanceCounter();
+		deltaTime = now - lastTime; // (now - lastTime)*1000/SDL_GetPerformanceFrequency();
+		lastTime = now;
+
+		// Get + Handle User Input
+		glfwPollEvents();
+		mainWindow.consumeInput(glfwGetTime());
+
+		if (replaying)
+		{
+			if (!cameraReplay.ApplyAtTime(now - replayStart, camera))
+			{
+				GLfloat replayTime = now - replayStart;
+				printf("Replay finished: %u frames in %.3fs (%.3f ms/frame)\n", replayFrames, replayTime, replayFrames ? replayTime * 1000.0f / replayFrames : 0.0f);
+
+				FrameStats stats = renderer.GetPacer().GetStats();
+				printf("Last %u frames: avg %.3f ms, min %.3f ms, max %.3f ms, 99th %.3f ms\n", stats.frameCount, stats.averageMs, stats.minMs, stats.maxMs, stats.percentile99Ms);
+
+				RenderStats renderStats = renderer.GetRenderStats();
+				printf("Last frame: %u draw calls, %u texture binds, %u batched objects, %u triangles\n", renderStats.drawCalls, renderStats.textureBinds, renderStats.batchedItems, renderStats.triangles);
+				if (meshletStats.meshlets > 0)
+				{
+					printf("Meshlets: %u of %u culled (%u outside the frustum, %u facing away), drawn as %u ranges, culled in %.3f ms\n",
+						meshletStats.frustumCulled + meshletStats.backfaceCulled, meshletStats.meshlets, meshletStats.frustumCulled, meshletStats.backfaceCulled,
+						meshletStats.ranges, meshletStats.milliseconds);
+				}
+
+				ResidencyReport residency = residencyManager.GetReport();
+				printf("GPU memory: %.2f MB of %.2f MB budget (textures %.2f MB x%u, meshes %.2f MB x%u, atlases %.2f MB x%u)\n",
+					residency.totalBytes / 1048576.0, residency.budgetBytes / 1048576.0,
+					residency.categoryBytes[RESIDENCY_TEXTURES] / 1048576.0, residency.categoryCount[RESIDENCY_TEXTURES],
+					residency.categoryBytes[RESIDENCY_MESHES] / 1048576.0, residency.categoryCount[RESIDENCY_MESHES],
+					residency.categoryBytes[RESIDENCY_ATLASES] / 1048576.0, residency.categoryCount[RESIDENCY_ATLASES]);
+				printf("Residency: %u textures reduced, %u evicted; %u mips dropped, %u evictions, %u reloads this session\n",
+					residency.reducedTextures, residency.evictedTextures, residency.levelsDropped, residency.texturesEvicted, residency.texturesReloaded);
+
+				if (virtualTexturing)
+				{
+					VirtualTextureStats virtualStats = virtualTexture.GetStats();
+					printf("Virtual texture: %u of %u cache pages resident, %u pending, %u requested; %u pages loaded, %u evicted, %u feedback reads (%.2f MB for %uK texels)\n",
+						virtualStats.residentPages, virtualStats.cachePages, virtualStats.pendingPages, virtualStats.requestedPages,
+						virtualStats.pagesLoaded, virtualStats.pagesEvicted, virtualStats.feedbackReads,
+						virtualTexture.GetMemoryUsage() / 1048576.0, virtualStats.virtualSize / 1024);
+				}
+				if (terrainEnabled)
+				{
+					printf("Terrain: %u nodes (finest level %u), %u culled, selected in %.3f ms; heightmap mip %u of %ux%u resident (%.2f MB)\n",
+						terrainStats.nodes, terrainStats.finestLod, terrainStats.frustumCulled, terrainStats.milliseconds,
+						terrainStats.residentLevel, terrainStats.heightmapSize, terrainStats.heightmapSize, terrain.GetMemoryUsage() / 1048576.0);
+				}
+				if (charactersEnabled)
+				{
+					printf("Animation: %u characters of %u joints posed in %.3f ms over %u jobs (%s skinning, %.2f MB palette)\n",
+						animationStats.characters, animationStats.joints, animationStats.milliseconds, animationStats.jobs,
+						dualQuaternion ? "dual quaternion" : "linear blend", jointPalette.GetMemoryUsage() / 1048576.0);
+				}
+				break;
+			}
+			replayFrames++;
+		}
+		else
+		{
+			camera.keyControl(mainWindow.getsKeys(), deltaTime);
+			camera.mouseControl(mainWindow.getXChange(), mainWindow.getYChange());
+			cameraRecorder.RecordFrame(now, camera);
+		}
+
+		glm::dvec3 originShift;
+		if (camera.rebaseOrigin(rebaseDistance, originShift))
+		{
+			for (size_t i = 0; i < transformList.size(); i++)
+			{
+				transformList[i].rebase(originShift);
+			}
+			gltfTransform.rebase(originShift);
+			terrainTransform.rebase(originShift);
+			for (size_t i = 0; i < characterTransforms.size(); i++)
+			{
+				characterTransforms[i].rebase(originShift);
+			}
+		}
+
+		FramePacket& packet = renderer.BeginFrame();
+		packet.projection = projection;
+		packet.view = camera.calculateViewMatrix();
+
+		// Objects are drawn relative to the eye so large world positions never reach the GPU
+		MeshletCullStats frameMeshletStats = {};
+		for (size_t i = 0; i < meshList.size(); i++)
+		{
+			glm::mat4 model = camera.calculateRelativeModelMatrix(transformList[i].calculateModelMatrix());
+			float lodScale = camera.calculateLodScale(model, boundsList[i], projection, mainWindow.getBufferHeight());
+
+			// Meshlets are tested in object space, where the eye is the relative space origin brought back through the model
+			int firstRange = -1;
+			unsigned int rangeCount = 0;
+			if (meshletList[i] && !batching)
+			{
+				MeshletCullStats cullStats;
+				firstRange = (int)packet.meshletRanges.size();
+				meshletList[i]->Cull(projection * packet.view * model, glm::vec3(glm::inverse(model)[3]), &workerPool, packet.meshletRanges, cullStats);
+				rangeCount = (unsigned int)packet.meshletRanges.size() - firstRange;
+
+				frameMeshletStats.milliseconds += cullStats.milliseconds;
+				frameMeshletStats.meshlets += cullStats.meshlets;
+				frameMeshletStats.frustumCulled += cullStats.frustumCulled;
+				frameMeshletStats.backfaceCulled += cullStats.backfaceCulled;
+				frameMeshletStats.ranges += cullStats.ranges;
+			}
+			if (virtualTexturing)
+			{
+				DrawItem item;
+				item.mesh = meshList[i];
+				item.texture = NULL;
+				item.model = model;
+				item.lodScale = lodScale;
+				item.firstRange = firstRange;
+				item.rangeCount = rangeCount;
+				packet.virtualList.push_back(item);
+			}
+			else if (batching)
+			{
+				BatchItem item;
+				item.mesh = batchMeshList[i];
+				item.layer = atlasRegionList[i % atlasRegionList.size()].layer;
+				item.uvTransform = atlasRegionList[i % atlasRegionList.size()].uvTransform;
+				item.model = model;
+				packet.batchList.push_back(item);
+			}
+			else
+			{
+				DrawItem item;
+				item.mesh = meshList[i];
+				item.texture = i % 2 == 0 ? &brickTexture : &dirtTexture;
+				item.model = model;
+				item.lodScale = lodScale;
+				item.firstRange = firstRange;
+				item.rangeCount = rangeCount;
+				packet.drawList.push_back(item);
+			}
+		}
+
+		meshletStats = frameMeshletStats;
+
+		// glTF primitives are not in the batch, they always draw individually with their own textures
+		const std::vector<DrawItem>& gltfItems = gltfModel.GetDrawItems();
+		glm::mat4 gltfModelMatrix = camera.calculateRelativeModelMatrix(gltfTransform.calculateModelMatrix());
+		for (size_t i = 0; i < gltfItems.size(); i++)
+		{
+			DrawItem item = gltfItems[i];
+			item.model = gltfModelMatrix * item.model;
+			item.texture = item.texture ? item.texture : &brickTexture;
+			if (virtualTexturing)
+			{
+				packet.virtualList.push_back(item);
+			}
+			else
+			{
+				packet.drawList.push_back(item);
+			}
+		}
+
+		// Terrain space is only translated, so the eye is the camera offset from the terrain's corner
+		if (terrainEnabled)
+		{
+			packet.terrainModel = camera.calculateRelativeModelMatrix(terrainTransform.calculateModelMatrix());
+			packet.terrainEye = glm::vec3(camera.getPosition() - terrainTransform.getPosition());
+			terrain.SelectNodes(packet.terrainEye, projection * packet.view * packet.terrainModel, packet.terrainNodes, terrainStats);
+		}
+
+		// Every character plays the first clip blended in and out of the last, each at its own phase, so the crowd
+		// never moves in step. Model matrices go into the palette with the joints, one instanced draw covers them all.
+		if (charactersEnabled)
+		{
+			const std::vector<AnimationClip>& clips = skinnedModel.GetClips();
+			std::vector<glm::mat4> characterModels(characterTransforms.size());
+			std::vector<AnimationInstance> instances(characterTransforms.size());
+			for (size_t i = 0; i < characterTransforms.size(); i++)
+			{
+				float phase = (float)i * 0.37f;
+				characterModels[i] = camera.calculateRelativeModelMatrix(characterTransforms[i].calculateModelMatrix());
+				instances[i].clips[0] = clips.empty() ? NULL : &clips[0];
+				instances[i].clips[1] = clips.empty() ? NULL : &clips.back();
+				instances[i].times[0] = now * (0.8f + 0.05f * (float)(i % 8)) + phase;
+				instances[i].times[1] = instances[i].times[0];
+				instances[i].blendWeight = 0.5f + 0.5f * sinf(now * 0.5f + phase);
+				instances[i].model = glm::value_ptr(characterModels[i]);
+			}
+
+			unsigned int texels = AnimationSampler::GetPaletteTexels(skinnedModel.GetSkeleton(), dualQuaternion);
+			packet.jointPalette.resize(instances.size() * texels);
+			AnimationSampler::EvaluatePoses(skinnedModel.GetSkeleton(), &instances[0], instances.size(), dualQuaternion, &workerPool, &packet.jointPalette[0].x, animationStats);
+
+			SkinnedItem item;
+			item.mesh = skinnedModel.GetMesh();
+			item.texture = &brickTexture;
+			item.firstTexel = 0;
+			item.texelsPerInstance = texels;
+			item.instanceCount = (unsigned int)instances.size();
+			item.dualQuaternion = dualQuaternion;
+			packet.skinnedList.push_back(item);
+		}
+
+		renderer.SubmitFrame();
+	}
+
+	renderer.Stop();
+	workerPool.Stop();
+	mainWindow.makeContextCurrent();
+	resourceLoader.Stop();
+	meshBatch.ClearBatch();
+	textureAtlas.ClearAtlas();
+	gltfModel.ClearModel();
+	virtualTexture.ClearVirtualTexture();
+	terrain.ClearTerrain();
+	skinnedModel.ClearModel();
+	jointPalette.ClearPalette();
+	for (size_t i = 0; i < meshletList.size(); i++)
+	{
+		delete meshletList[i];
+	}
+
+	cameraRecorder.StopRecording();
+
+	return 0;
 }
\ No newline at end of file